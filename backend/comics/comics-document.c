@@ -35,9 +35,19 @@
 #include "ev-document-misc.h"
 #include "ev-file-helpers.h"
 #include "ev-archive.h"
+#include "comics-image-size.h"
 
 #define BLOCK_SIZE 10240
 
+/* Number of pages after the last one rendered whose compressed data
+ * is kept in memory, and number of them decoded ahead */
+#define PREFETCH_N_PAGES   4
+#define PREFETCH_N_DECODED 2
+
+/* Renders smaller than this, like thumbnails, neither use nor
+ * schedule the pages decoded ahead */
+#define PREFETCH_MIN_SIZE  256
+
 typedef struct _ComicsDocumentClass ComicsDocumentClass;
 
 struct _ComicsDocumentClass
@@ -52,8 +62,41 @@ struct _ComicsDocument
 	gchar         *archive_path;
 	gchar         *archive_uri;
 	GPtrArray     *page_names;
+	/* Sizes of the pages read from the image headers while listing
+	 * the archive, by page name. Shared with the clones. */
+	GHashTable    *page_sizes;
+
+	/* Decode-ahead of the next pages, on a thread with its own
+	 * EvArchive. Everything below is protected by prefetch_mutex */
+	GMutex         prefetch_mutex;
+	GCond          prefetch_cond;
+	GThread       *prefetch_thread;
+	EvArchive     *prefetch_archive;
+	gboolean       prefetch_quit;
+	/* Page to prefetch after, -1 if there's no new request */
+	gint           prefetch_page;
+	gdouble        prefetch_scale;
+	gint           last_page;
+	gdouble        last_scale;
+	/* Page index -> GBytes with the compressed page */
+	GHashTable    *prefetch_data;
+	/* ComicsDecodedPage */
+	GPtrArray     *decoded_pages;
+	gint           decoding_page;
+	gdouble        decoding_scale;
 };
 
+typedef struct {
+	gint       page;
+	gdouble    scale;
+	GdkPixbuf *pixbuf;
+} ComicsDecodedPage;
+
+typedef struct {
+	gint width;
+	gint height;
+} ComicsPageSize;
+
 EV_BACKEND_REGISTER (ComicsDocument, comics_document)
 
 #define FORMAT_UNKNOWN     0
@@ -143,6 +186,55 @@ is_apple_double (const char *name)
 	return ret;
 }
 
+/* Reads the size of the image in the current entry from its headers */
+static ComicsPageSize *
+comics_document_probe_page_size (ComicsDocument *comics_document)
+{
+	EvArchive *archive = comics_document->archive;
+	ComicsImageSizeResult result = COMICS_IMAGE_SIZE_NEED_MORE;
+	ComicsPageSize *page_size;
+	GByteArray *header;
+	char buf[BLOCK_SIZE];
+	gint width, height;
+	gint64 left;
+	gssize read;
+
+	header = g_byte_array_new ();
+	left = ev_archive_get_entry_size (archive);
+
+	while (result == COMICS_IMAGE_SIZE_NEED_MORE && left > 0 &&
+	       header->len < COMICS_IMAGE_SIZE_MAX_HEADER) {
+		read = ev_archive_read_data (archive, buf, MIN (BLOCK_SIZE, left), NULL);
+		if (read <= 0)
+			break;
+
+		g_byte_array_append (header, (guchar *) buf, read);
+		left -= read;
+		result = comics_image_get_size (header->data, header->len, &width, &height);
+	}
+	g_byte_array_unref (header);
+
+	/* unarr decompresses solid RAR archives again from the first
+	 * entry when an entry was not read to the end */
+	if (ev_archive_get_archive_type (archive) == EV_ARCHIVE_TYPE_RAR) {
+		while (left > 0) {
+			read = ev_archive_read_data (archive, buf, MIN (BLOCK_SIZE, left), NULL);
+			if (read <= 0)
+				break;
+			left -= read;
+		}
+	}
+
+	if (result != COMICS_IMAGE_SIZE_FOUND)
+		return NULL;
+
+	page_size = g_new (ComicsPageSize, 1);
+	page_size->width = width;
+	page_size->height = height;
+
+	return page_size;
+}
+
 static GPtrArray *
 comics_document_list (ComicsDocument  *comics_document,
 		      GError         **error)
@@ -169,6 +261,9 @@ comics_document_list (ComicsDocument  *comics_document,
 	has_encrypted_files = FALSE;
 	has_unsupported_images = FALSE;
 	array = g_ptr_array_sized_new (64);
+	g_clear_pointer (&comics_document->page_sizes, g_hash_table_unref);
+	comics_document->page_sizes = g_hash_table_new_full (g_str_hash, g_str_equal,
+							     g_free, g_free);
 
 	while (1) {
 		const char *name;
@@ -215,6 +310,17 @@ comics_document_list (ComicsDocument  *comics_document,
 
 		g_debug ("Adding '%s' to the list of files in the comics", name);
 		g_ptr_array_add (array, g_strdup (name));
+
+		if (!g_hash_table_contains (comics_document->page_sizes, name)) {
+			ComicsPageSize *page_size;
+
+			/* The name is no longer valid once the data was read */
+			name = g_ptr_array_index (array, array->len - 1);
+			page_size = comics_document_probe_page_size (comics_document);
+			if (page_size)
+				g_hash_table_insert (comics_document->page_sizes,
+						     g_strdup (name), page_size);
+		}
 	}
 
 	if (array->len == 0) {
@@ -347,6 +453,32 @@ comics_document_load (EvDocument *document,
 	return TRUE;
 }
 
+/* A clone shares nothing but the list of pages, their sizes and the
+ * index of the archive entries with @document, it opens the archive on
+ * its own EvArchive.
+ */
+static EvDocument *
+comics_document_clone (EvDocument *document)
+{
+	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
+	ComicsDocument *clone;
+	guint           i;
+
+	clone = COMICS_DOCUMENT (g_object_new (COMICS_TYPE_DOCUMENT, NULL));
+	g_object_unref (clone->archive);
+	clone->archive = ev_archive_clone (comics_document->archive);
+
+	clone->archive_path = g_strdup (comics_document->archive_path);
+	clone->archive_uri = g_strdup (comics_document->archive_uri);
+	clone->page_sizes = g_hash_table_ref (comics_document->page_sizes);
+	clone->page_names = g_ptr_array_sized_new (comics_document->page_names->len);
+	for (i = 0; i < comics_document->page_names->len; i++)
+		g_ptr_array_add (clone->page_names,
+				 g_strdup (g_ptr_array_index (comics_document->page_names, i)));
+
+	return EV_DOCUMENT (clone);
+}
+
 static gboolean
 comics_document_save (EvDocument *document,
 		      const char *uri,
@@ -394,13 +526,29 @@ comics_document_get_page_size (EvDocument *document,
 	GdkPixbufLoader *loader;
 	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
 	const char *page_path;
+	ComicsPageSize *page_size;
 	PixbufInfo info;
+	char buf[BLOCK_SIZE];
+	gssize read;
+	gint64 left;
 	GError *error = NULL;
 
-	if (!ev_archive_open_filename (comics_document->archive, comics_document->archive_path, &error)) {
-		g_warning ("Fatal error opening archive: %s", error->message);
+	page_path = g_ptr_array_index (comics_document->page_names, page->index);
+	page_size = g_hash_table_lookup (comics_document->page_sizes, page_path);
+	if (page_size) {
+		if (width)
+			*width = page_size->width;
+		if (height)
+			*height = page_size->height;
+		return;
+	}
+
+	/* Fall back to the image loader for the formats that
+	 * comics_image_get_size() doesn't know */
+	if (!ev_archive_seek_entry (comics_document->archive, page_path, &error)) {
+		g_warning ("Fatal error handling archive: %s", error->message);
 		g_error_free (error);
-		goto out;
+		return;
 	}
 
 	loader = gdk_pixbuf_loader_new ();
@@ -409,44 +557,21 @@ comics_document_get_page_size (EvDocument *document,
 			  G_CALLBACK (get_page_size_prepared_cb),
 			  &info);
 
-	page_path = g_ptr_array_index (comics_document->page_names, page->index);
-
-	while (1) {
-		const char *name;
-		GError *error = NULL;
-
-		if (!ev_archive_read_next_header (comics_document->archive, &error)) {
-			if (error != NULL) {
-				g_warning ("Fatal error handling archive: %s", error->message);
-				g_error_free (error);
-			}
-			break;
-		}
-
-		name = ev_archive_get_entry_pathname (comics_document->archive);
-		if (g_strcmp0 (name, page_path) == 0) {
-			char buf[BLOCK_SIZE];
-			gssize read;
-			gint64 left;
-
-			left = ev_archive_get_entry_size (comics_document->archive);
-			read = ev_archive_read_data (comics_document->archive, buf,
-						     MIN(BLOCK_SIZE, left), &error);
-			while (read > 0 && !info.got_info) {
-				if (!gdk_pixbuf_loader_write (loader, (guchar *) buf, read, &error)) {
-					read = -1;
-					break;
-				}
-				left -= read;
-				read = ev_archive_read_data (comics_document->archive, buf,
-							     MIN(BLOCK_SIZE, left), &error);
-			}
-			if (read < 0) {
-				g_warning ("Fatal error reading '%s' in archive: %s", name, error->message);
-				g_error_free (error);
-			}
+	left = ev_archive_get_entry_size (comics_document->archive);
+	read = ev_archive_read_data (comics_document->archive, buf,
+				     MIN(BLOCK_SIZE, left), &error);
+	while (read > 0 && !info.got_info) {
+		if (!gdk_pixbuf_loader_write (loader, (guchar *) buf, read, &error)) {
+			read = -1;
 			break;
 		}
+		left -= read;
+		read = ev_archive_read_data (comics_document->archive, buf,
+					     MIN(BLOCK_SIZE, left), &error);
+	}
+	if (read < 0) {
+		g_warning ("Fatal error reading '%s' in archive: %s", page_path, error->message);
+		g_error_free (error);
 	}
 
 	gdk_pixbuf_loader_close (loader, NULL);
@@ -458,9 +583,6 @@ comics_document_get_page_size (EvDocument *document,
 		if (height)
 			*height = info.height;
 	}
-
-out:
-	ev_archive_reset (comics_document->archive);
 }
 
 static void
@@ -475,77 +597,326 @@ render_pixbuf_size_prepared_cb (GdkPixbufLoader *loader,
 	gdk_pixbuf_loader_set_size (loader, scaled_width, scaled_height);
 }
 
-static GdkPixbuf *
-comics_document_render_pixbuf (EvDocument      *document,
-			       EvRenderContext *rc)
+static GBytes *
+comics_document_read_page (ComicsDocument *comics_document,
+			   EvArchive      *archive,
+			   gint            page,
+			   GError        **error)
 {
-	GdkPixbufLoader *loader;
-	GdkPixbuf *tmp_pixbuf;
-	GdkPixbuf *rotated_pixbuf = NULL;
-	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
 	const char *page_path;
-	GError *error = NULL;
-
-	if (!ev_archive_open_filename (comics_document->archive, comics_document->archive_path, &error)) {
-		g_warning ("Fatal error opening archive: %s", error->message);
-		g_error_free (error);
-		goto out;
+	GBytes *data;
+
+	page_path = g_ptr_array_index (comics_document->page_names, page);
+	if (!ev_archive_seek_entry (archive, page_path, error))
+		return NULL;
+
+	/* Stored entries come straight from the mapped archive */
+	data = ev_archive_read_entry (archive, error);
+	if (data && g_bytes_get_size (data) == 0) {
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+			     "Read an empty file '%s' from the archive", page_path);
+		g_clear_pointer (&data, g_bytes_unref);
 	}
 
+	return data;
+}
+
+static GdkPixbuf *
+comics_document_decode_page (GBytes          *data,
+			     EvRenderContext *rc)
+{
+	GdkPixbufLoader *loader;
+	GdkPixbuf *pixbuf;
+
 	loader = gdk_pixbuf_loader_new ();
 	g_signal_connect (loader, "size-prepared",
 			  G_CALLBACK (render_pixbuf_size_prepared_cb),
 			  rc);
 
-	page_path = g_ptr_array_index (comics_document->page_names, rc->page->index);
+	gdk_pixbuf_loader_write_bytes (loader, data, NULL);
+	gdk_pixbuf_loader_close (loader, NULL);
 
-	while (1) {
-		const char *name;
+	pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+	if (pixbuf)
+		g_object_ref (pixbuf);
+	g_object_unref (loader);
+
+	return pixbuf;
+}
+
+static void
+comics_decoded_page_free (ComicsDecodedPage *decoded)
+{
+	g_clear_object (&decoded->pixbuf);
+	g_free (decoded);
+}
+
+/* Called with the prefetch mutex held */
+static gint
+comics_document_find_decoded_page (ComicsDocument *comics_document,
+				   gint            page,
+				   gdouble         scale)
+{
+	guint i;
+
+	for (i = 0; i < comics_document->decoded_pages->len; i++) {
+		ComicsDecodedPage *decoded = g_ptr_array_index (comics_document->decoded_pages, i);
 
-		if (!ev_archive_read_next_header (comics_document->archive, &error)) {
-			if (error != NULL) {
-				g_warning ("Fatal error handling archive: %s", error->message);
+		if (decoded->page == page && decoded->scale == scale)
+			return i;
+	}
+
+	return -1;
+}
+
+static gboolean
+prefetch_data_is_behind (gpointer key,
+			 gpointer value,
+			 gpointer user_data)
+{
+	gint page = GPOINTER_TO_INT (key);
+	gint first = GPOINTER_TO_INT (user_data);
+
+	return page < first || page >= first + PREFETCH_N_PAGES;
+}
+
+/* Called with the prefetch mutex held, which is released while the
+ * pages are read and decoded. Returns early when a new request comes.
+ */
+static void
+comics_document_prefetch (ComicsDocument *comics_document,
+			  gint            page,
+			  gdouble         scale)
+{
+	gint n_pages = comics_document->page_names->len;
+	gint i;
+
+	/* Drop what is not ahead of @page anymore */
+	g_hash_table_foreach_remove (comics_document->prefetch_data,
+				     prefetch_data_is_behind,
+				     GINT_TO_POINTER (page + 1));
+	for (i = comics_document->decoded_pages->len - 1; i >= 0; i--) {
+		ComicsDecodedPage *decoded = g_ptr_array_index (comics_document->decoded_pages, i);
+
+		if (decoded->page <= page || decoded->page > page + PREFETCH_N_DECODED ||
+		    decoded->scale != scale)
+			g_ptr_array_remove_index (comics_document->decoded_pages, i);
+	}
+
+	for (i = page + 1; i <= page + PREFETCH_N_PAGES && i < n_pages; i++) {
+		ComicsDecodedPage *decoded;
+		EvRenderContext   *rc;
+		EvPage            *ev_page;
+		GBytes            *data;
+		GError            *error = NULL;
+
+		if (comics_document->prefetch_quit || comics_document->prefetch_page >= 0)
+			return;
+
+		data = g_hash_table_lookup (comics_document->prefetch_data, GINT_TO_POINTER (i));
+		if (!data) {
+			g_mutex_unlock (&comics_document->prefetch_mutex);
+			data = comics_document_read_page (comics_document,
+							  comics_document->prefetch_archive,
+							  i, &error);
+			g_mutex_lock (&comics_document->prefetch_mutex);
+
+			if (!data) {
+				g_debug ("Failed to prefetch page %d: %s", i, error->message);
 				g_error_free (error);
+				continue;
 			}
-			break;
+			g_hash_table_insert (comics_document->prefetch_data,
+					     GINT_TO_POINTER (i), data);
 		}
 
-		name = ev_archive_get_entry_pathname (comics_document->archive);
-		if (g_strcmp0 (name, page_path) == 0) {
-			size_t size = ev_archive_get_entry_size (comics_document->archive);
-			char *buf;
-			ssize_t read;
-
-			buf = g_malloc (size);
-			read = ev_archive_read_data (comics_document->archive, buf, size, &error);
-			if (read <= 0) {
-				if (read < 0) {
-					g_warning ("Fatal error reading '%s' in archive: %s", name, error->message);
-					g_error_free (error);
-				} else {
-					g_warning ("Read an empty file from the archive");
-				}
-			} else {
-				gdk_pixbuf_loader_write (loader, (guchar *) buf, size, NULL);
-			}
-			g_free (buf);
-			gdk_pixbuf_loader_close (loader, NULL);
-			break;
+		if (i > page + PREFETCH_N_DECODED ||
+		    comics_document_find_decoded_page (comics_document, i, scale) >= 0)
+			continue;
+
+		if (comics_document->prefetch_quit || comics_document->prefetch_page >= 0)
+			return;
+
+		comics_document->decoding_page = i;
+		comics_document->decoding_scale = scale;
+		g_bytes_ref (data);
+		g_mutex_unlock (&comics_document->prefetch_mutex);
+
+		ev_page = ev_page_new (i);
+		rc = ev_render_context_new (ev_page, 0, scale);
+		decoded = g_new0 (ComicsDecodedPage, 1);
+		decoded->page = i;
+		decoded->scale = scale;
+		decoded->pixbuf = comics_document_decode_page (data, rc);
+		g_object_unref (rc);
+		g_object_unref (ev_page);
+		g_bytes_unref (data);
+
+		g_mutex_lock (&comics_document->prefetch_mutex);
+		comics_document->decoding_page = -1;
+		if (decoded->pixbuf)
+			g_ptr_array_add (comics_document->decoded_pages, decoded);
+		else
+			comics_decoded_page_free (decoded);
+		g_cond_broadcast (&comics_document->prefetch_cond);
+	}
+}
+
+static gpointer
+comics_document_prefetch_thread (ComicsDocument *comics_document)
+{
+	g_mutex_lock (&comics_document->prefetch_mutex);
+
+	while (!comics_document->prefetch_quit) {
+		gint page = comics_document->prefetch_page;
+
+		if (page < 0) {
+			g_cond_wait (&comics_document->prefetch_cond,
+				     &comics_document->prefetch_mutex);
+			continue;
 		}
+
+		comics_document->prefetch_page = -1;
+		comics_document_prefetch (comics_document, page,
+					  comics_document->prefetch_scale);
+	}
+
+	g_mutex_unlock (&comics_document->prefetch_mutex);
+
+	return NULL;
+}
+
+/* Comics are read page by page, so the pages after the one
+ * rendered are read and decoded ahead at the same scale.
+ */
+static void
+comics_document_schedule_prefetch (ComicsDocument  *comics_document,
+				   EvRenderContext *rc)
+{
+	gint page = rc->page->index;
+
+	g_mutex_lock (&comics_document->prefetch_mutex);
+
+	/* The pages just before the last one are rendered when the
+	 * view preloads them, keep going forward */
+	if (rc->scale == comics_document->last_scale &&
+	    page < comics_document->last_page &&
+	    page >= comics_document->last_page - PREFETCH_N_PAGES) {
+		g_mutex_unlock (&comics_document->prefetch_mutex);
+		return;
+	}
+
+	comics_document->last_page = page;
+	comics_document->last_scale = rc->scale;
+	comics_document->prefetch_page = page;
+	comics_document->prefetch_scale = rc->scale;
+
+	if (!comics_document->prefetch_thread) {
+		comics_document->prefetch_archive = ev_archive_clone (comics_document->archive);
+		comics_document->prefetch_thread =
+			g_thread_new ("ComicsPrefetch",
+				      (GThreadFunc) comics_document_prefetch_thread,
+				      comics_document);
+	}
+
+	g_cond_broadcast (&comics_document->prefetch_cond);
+	g_mutex_unlock (&comics_document->prefetch_mutex);
+}
+
+/* Returns the page decoded ahead for @rc or its compressed data in
+ * @data, waiting for the prefetch thread if it's decoding the page.
+ * Pages are decoded ahead at the scale of the last render, and only
+ * used when they have the @width and @height the render asks for:
+ * views ask for a target size, computed from the page size and scale.
+ */
+static GdkPixbuf *
+comics_document_get_prefetched_page (ComicsDocument  *comics_document,
+				     EvRenderContext *rc,
+				     gint             width,
+				     gint             height,
+				     GBytes         **data)
+{
+	GdkPixbuf *pixbuf = NULL;
+	gint page = rc->page->index;
+	gint i;
+
+	g_mutex_lock (&comics_document->prefetch_mutex);
+
+	while (comics_document->decoding_page == page &&
+	       comics_document->decoding_scale == rc->scale)
+		g_cond_wait (&comics_document->prefetch_cond,
+			     &comics_document->prefetch_mutex);
+
+	i = comics_document_find_decoded_page (comics_document, page, rc->scale);
+	if (i >= 0) {
+		ComicsDecodedPage *decoded = g_ptr_array_index (comics_document->decoded_pages, i);
+
+		if (gdk_pixbuf_get_width (decoded->pixbuf) == width &&
+		    gdk_pixbuf_get_height (decoded->pixbuf) == height)
+			pixbuf = g_steal_pointer (&decoded->pixbuf);
+		g_ptr_array_remove_index (comics_document->decoded_pages, i);
+	}
+
+	if (!pixbuf) {
+		*data = g_hash_table_lookup (comics_document->prefetch_data, GINT_TO_POINTER (page));
+		if (*data)
+			g_bytes_ref (*data);
+	}
+
+	g_mutex_unlock (&comics_document->prefetch_mutex);
+
+	return pixbuf;
+}
+
+static GdkPixbuf *
+comics_document_render_pixbuf (EvDocument      *document,
+			       EvRenderContext *rc)
+{
+	GdkPixbuf *tmp_pixbuf;
+	GdkPixbuf *rotated_pixbuf = NULL;
+	ComicsDocument *comics_document = COMICS_DOCUMENT (document);
+	GBytes *data = NULL;
+	GError *error = NULL;
+	gdouble page_width = 0, page_height = 0;
+	gint width, height;
+
+	/* The size the page is decoded at, before it's rotated */
+	comics_document_get_page_size (document, rc->page, &page_width, &page_height);
+	ev_render_context_compute_scaled_size (rc, page_width, page_height, &width, &height);
+
+	if (MAX (width, height) >= PREFETCH_MIN_SIZE) {
+		tmp_pixbuf = comics_document_get_prefetched_page (comics_document, rc,
+								  width, height, &data);
+		comics_document_schedule_prefetch (comics_document, rc);
+	} else {
+		tmp_pixbuf = NULL;
+	}
+
+	if (!tmp_pixbuf) {
+		if (!data)
+			data = comics_document_read_page (comics_document, comics_document->archive,
+							  rc->page->index, &error);
+		if (!data) {
+			g_warning ("Fatal error reading '%s' in archive: %s",
+				   (const char *) g_ptr_array_index (comics_document->page_names, rc->page->index),
+				   error->message);
+			g_error_free (error);
+			return NULL;
+		}
+
+		tmp_pixbuf = comics_document_decode_page (data, rc);
+		g_bytes_unref (data);
 	}
 
-	tmp_pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
 	if (tmp_pixbuf) {
 		if ((rc->rotation % 360) == 0)
 			rotated_pixbuf = g_object_ref (tmp_pixbuf);
 		else
 			rotated_pixbuf = gdk_pixbuf_rotate_simple (tmp_pixbuf,
 								   360 - rc->rotation);
+		g_object_unref (tmp_pixbuf);
 	}
-	g_object_unref (loader);
 
-out:
-	ev_archive_reset (comics_document->archive);
 	return rotated_pixbuf;
 }
 
@@ -568,11 +939,26 @@ comics_document_finalize (GObject *object)
 {
 	ComicsDocument *comics_document = COMICS_DOCUMENT (object);
 
+	if (comics_document->prefetch_thread) {
+		g_mutex_lock (&comics_document->prefetch_mutex);
+		comics_document->prefetch_quit = TRUE;
+		g_cond_broadcast (&comics_document->prefetch_cond);
+		g_mutex_unlock (&comics_document->prefetch_mutex);
+
+		g_thread_join (comics_document->prefetch_thread);
+	}
+	g_clear_object (&comics_document->prefetch_archive);
+	g_hash_table_destroy (comics_document->prefetch_data);
+	g_ptr_array_free (comics_document->decoded_pages, TRUE);
+	g_mutex_clear (&comics_document->prefetch_mutex);
+	g_cond_clear (&comics_document->prefetch_cond);
+
 	if (comics_document->page_names) {
                 g_ptr_array_foreach (comics_document->page_names, (GFunc) g_free, NULL);
                 g_ptr_array_free (comics_document->page_names, TRUE);
 	}
 
+	g_clear_pointer (&comics_document->page_sizes, g_hash_table_unref);
 	g_clear_object (&comics_document->archive);
 	g_free (comics_document->archive_path);
 	g_free (comics_document->archive_uri);
@@ -593,10 +979,20 @@ comics_document_class_init (ComicsDocumentClass *klass)
 	ev_document_class->get_n_pages = comics_document_get_n_pages;
 	ev_document_class->get_page_size = comics_document_get_page_size;
 	ev_document_class->render = comics_document_render;
+	ev_document_class->clone = comics_document_clone;
 }
 
 static void
 comics_document_init (ComicsDocument *comics_document)
 {
 	comics_document->archive = ev_archive_new ();
+
+	g_mutex_init (&comics_document->prefetch_mutex);
+	g_cond_init (&comics_document->prefetch_cond);
+	comics_document->prefetch_page = -1;
+	comics_document->last_page = -1;
+	comics_document->decoding_page = -1;
+	comics_document->prefetch_data = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+								(GDestroyNotify) g_bytes_unref);
+	comics_document->decoded_pages = g_ptr_array_new_with_free_func ((GDestroyNotify) comics_decoded_page_free);
 }
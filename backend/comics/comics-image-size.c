@@ -0,0 +1,278 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "comics-image-size.h"
+
+/* The sizes are read from the headers of the formats commonly found in
+ * comic books, so that the page sizes of a document are known without
+ * running an image loader for every page. They match the sizes given by
+ * the gdk-pixbuf loaders in the "size-prepared" signal.
+ */
+
+static guint16
+get_u16 (const guchar *p,
+	 gboolean      le)
+{
+	return le ? p[0] | (p[1] << 8) : (p[0] << 8) | p[1];
+}
+
+static guint32
+get_u32 (const guchar *p,
+	 gboolean      le)
+{
+	return le ?
+		get_u16 (p, TRUE) | ((guint32) get_u16 (p + 2, TRUE) << 16) :
+		((guint32) get_u16 (p, FALSE) << 16) | get_u16 (p + 2, FALSE);
+}
+
+static ComicsImageSizeResult
+check_size (gint64 width,
+	    gint64 height,
+	    gint  *width_out,
+	    gint  *height_out)
+{
+	if (width <= 0 || height <= 0 || width > G_MAXINT || height > G_MAXINT)
+		return COMICS_IMAGE_SIZE_UNKNOWN;
+
+	*width_out = width;
+	*height_out = height;
+
+	return COMICS_IMAGE_SIZE_FOUND;
+}
+
+static gboolean
+jpeg_is_frame_header (guchar marker)
+{
+	/* SOF0 to SOF15, but DHT, JPG and DAC */
+	return marker >= 0xc0 && marker <= 0xcf &&
+		marker != 0xc4 && marker != 0xc8 && marker != 0xcc;
+}
+
+static ComicsImageSizeResult
+jpeg_get_size (const guchar *data,
+	       gsize         len,
+	       gint         *width,
+	       gint         *height)
+{
+	gsize pos = 2;
+
+	while (TRUE) {
+		guchar  marker;
+		guint16 length;
+
+		if (pos + 2 > len)
+			return COMICS_IMAGE_SIZE_NEED_MORE;
+		if (data[pos] != 0xff)
+			return COMICS_IMAGE_SIZE_UNKNOWN;
+
+		marker = data[pos + 1];
+		if (marker == 0xff) {
+			/* Fill byte */
+			pos++;
+			continue;
+		}
+		if (marker == 0x01 || (marker >= 0xd0 && marker <= 0xd8)) {
+			/* Markers without a segment */
+			pos += 2;
+			continue;
+		}
+		if (marker == 0xd9 || marker == 0xda)
+			return COMICS_IMAGE_SIZE_UNKNOWN;
+
+		if (pos + 4 > len)
+			return COMICS_IMAGE_SIZE_NEED_MORE;
+		length = get_u16 (data + pos + 2, FALSE);
+		if (length < 2)
+			return COMICS_IMAGE_SIZE_UNKNOWN;
+
+		if (jpeg_is_frame_header (marker)) {
+			if (pos + 9 > len)
+				return COMICS_IMAGE_SIZE_NEED_MORE;
+
+			return check_size (get_u16 (data + pos + 7, FALSE),
+					   get_u16 (data + pos + 5, FALSE),
+					   width, height);
+		}
+
+		pos += 2 + length;
+	}
+}
+
+static ComicsImageSizeResult
+png_get_size (const guchar *data,
+	      gsize         len,
+	      gint         *width,
+	      gint         *height)
+{
+	if (len < 24)
+		return COMICS_IMAGE_SIZE_NEED_MORE;
+	if (memcmp (data + 12, "IHDR", 4) != 0)
+		return COMICS_IMAGE_SIZE_UNKNOWN;
+
+	return check_size (get_u32 (data + 16, FALSE),
+			   get_u32 (data + 20, FALSE),
+			   width, height);
+}
+
+static ComicsImageSizeResult
+gif_get_size (const guchar *data,
+	      gsize         len,
+	      gint         *width,
+	      gint         *height)
+{
+	/* Logical screen size */
+	return check_size (get_u16 (data + 6, TRUE),
+			   get_u16 (data + 8, TRUE),
+			   width, height);
+}
+
+static ComicsImageSizeResult
+webp_get_size (const guchar *data,
+	       gsize         len,
+	       gint         *width,
+	       gint         *height)
+{
+	const guchar *chunk = data + 12;
+
+	if (len < 30)
+		return COMICS_IMAGE_SIZE_NEED_MORE;
+
+	if (memcmp (chunk, "VP8 ", 4) == 0) {
+		/* Lossy key frame: 3 bytes of frame tag and a start code */
+		if (chunk[11] != 0x9d || chunk[12] != 0x01 || chunk[13] != 0x2a)
+			return COMICS_IMAGE_SIZE_UNKNOWN;
+
+		return check_size (get_u16 (chunk + 14, TRUE) & 0x3fff,
+				   get_u16 (chunk + 16, TRUE) & 0x3fff,
+				   width, height);
+	}
+
+	if (memcmp (chunk, "VP8L", 4) == 0) {
+		guint32 bits;
+
+		if (chunk[8] != 0x2f)
+			return COMICS_IMAGE_SIZE_UNKNOWN;
+
+		bits = get_u32 (chunk + 9, TRUE);
+
+		return check_size ((bits & 0x3fff) + 1,
+				   ((bits >> 14) & 0x3fff) + 1,
+				   width, height);
+	}
+
+	if (memcmp (chunk, "VP8X", 4) == 0) {
+		/* Canvas size, on 24 bits */
+		return check_size ((get_u32 (chunk + 12, TRUE) & 0xffffff) + 1,
+				   (get_u32 (chunk + 14, TRUE) >> 8) + 1,
+				   width, height);
+	}
+
+	return COMICS_IMAGE_SIZE_UNKNOWN;
+}
+
+static ComicsImageSizeResult
+tiff_get_size (const guchar *data,
+	       gsize         len,
+	       gint         *width,
+	       gint         *height)
+{
+	gboolean le = data[0] == 'I';
+	gsize    ifd;
+	guint16  n_entries, i;
+	gint64   w = 0, h = 0;
+
+	/* Size in the first image file directory, which can be
+	 * anywhere in the file */
+	ifd = get_u32 (data + 4, le);
+	if (ifd < 8)
+		return COMICS_IMAGE_SIZE_UNKNOWN;
+	if (ifd + 2 > len)
+		return COMICS_IMAGE_SIZE_NEED_MORE;
+
+	n_entries = get_u16 (data + ifd, le);
+	if (ifd + 2 + n_entries * 12 > len)
+		return COMICS_IMAGE_SIZE_NEED_MORE;
+
+	for (i = 0; i < n_entries; i++) {
+		const guchar *entry = data + ifd + 2 + i * 12;
+		guint16 tag = get_u16 (entry, le);
+		guint16 type = get_u16 (entry + 2, le);
+		guint32 value;
+
+		if (tag != 256 && tag != 257)
+			continue;
+
+		/* SHORT or LONG */
+		if (type == 3)
+			value = get_u16 (entry + 8, le);
+		else if (type == 4)
+			value = get_u32 (entry + 8, le);
+		else
+			return COMICS_IMAGE_SIZE_UNKNOWN;
+
+		if (tag == 256)
+			w = value;
+		else
+			h = value;
+	}
+
+	return check_size (w, h, width, height);
+}
+
+/**
+ * comics_image_get_size:
+ * @data: the first bytes of an image file
+ * @len: the length of @data
+ * @width: (out): return location for the width of the image
+ * @height: (out): return location for the height of the image
+ *
+ * Reads the size of a JPEG, PNG, GIF, WebP or TIFF image from its
+ * headers.
+ *
+ * Returns: %COMICS_IMAGE_SIZE_FOUND if @width and @height were set,
+ *   %COMICS_IMAGE_SIZE_NEED_MORE if the size is further in the file
+ *   than @len, or %COMICS_IMAGE_SIZE_UNKNOWN if the format is not
+ *   known or the headers are not valid
+ */
+ComicsImageSizeResult
+comics_image_get_size (const guchar *data,
+		       gsize         len,
+		       gint         *width,
+		       gint         *height)
+{
+	g_return_val_if_fail (data != NULL || len == 0, COMICS_IMAGE_SIZE_UNKNOWN);
+
+	if (len < 12)
+		return COMICS_IMAGE_SIZE_NEED_MORE;
+
+	if (data[0] == 0xff && data[1] == 0xd8)
+		return jpeg_get_size (data, len, width, height);
+	if (memcmp (data, "\x89PNG\r\n\x1a\n", 8) == 0)
+		return png_get_size (data, len, width, height);
+	if (memcmp (data, "GIF87a", 6) == 0 || memcmp (data, "GIF89a", 6) == 0)
+		return gif_get_size (data, len, width, height);
+	if (memcmp (data, "RIFF", 4) == 0 && memcmp (data + 8, "WEBP", 4) == 0)
+		return webp_get_size (data, len, width, height);
+	if (memcmp (data, "II*\0", 4) == 0 || memcmp (data, "MM\0*", 4) == 0)
+		return tiff_get_size (data, len, width, height);
+
+	return COMICS_IMAGE_SIZE_UNKNOWN;
+}
@@ -0,0 +1,42 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __COMICS_IMAGE_SIZE_H__
+#define __COMICS_IMAGE_SIZE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Largest header read to find the size of an image, JPEG files can
+ * have large metadata segments before the frame header */
+#define COMICS_IMAGE_SIZE_MAX_HEADER (256 * 1024)
+
+typedef enum {
+	COMICS_IMAGE_SIZE_FOUND,
+	COMICS_IMAGE_SIZE_NEED_MORE,
+	COMICS_IMAGE_SIZE_UNKNOWN
+} ComicsImageSizeResult;
+
+ComicsImageSizeResult comics_image_get_size (const guchar *data,
+					     gsize         len,
+					     gint         *width,
+					     gint         *height);
+
+G_END_DECLS
+
+#endif /* __COMICS_IMAGE_SIZE_H__ */
@@ -27,9 +27,38 @@
 
 #define BUFFER_SIZE (64 * 1024)
 
+/* How an entry can be read without going through the ones before it */
+typedef enum {
+	EV_ARCHIVE_ACCESS_SEQUENTIAL,
+	EV_ARCHIVE_ACCESS_RAR,
+	EV_ARCHIVE_ACCESS_STORED,
+	EV_ARCHIVE_ACCESS_ZIP_STORED,
+	EV_ARCHIVE_ACCESS_ZIP_DEFLATED
+} EvArchiveAccess;
+
+typedef struct {
+	gchar           *name;
+	guint            index;
+	gint64           size;
+	gboolean         is_encrypted;
+
+	EvArchiveAccess  access;
+	/* unarr entry offset for RAR, offset of the data for stored
+	 * entries and offset of the local header for ZIP entries */
+	gint64           offset;
+} EvArchiveEntry;
+
+typedef struct {
+	guint16 flags;
+	guint16 method;
+	gint64  offset;
+	gint64  size;
+} ZipEntryInfo;
+
 struct _EvArchive {
 	GObject parent_instance;
 	EvArchiveType type;
+	gchar *path;
 
 	/* libarchive */
 	struct archive *libar;
@@ -38,10 +67,44 @@ struct _EvArchive {
 	/* unarr */
 	ar_stream *unarr_stream;
 	ar_archive *unarr;
+
+	/* Index of the entries, built while they are read in order the
+	 * first time, and shared with the clones once complete */
+	GPtrArray *entries;
+	GHashTable *entries_by_name;
+	gboolean index_complete;
+	/* Position of the sequential reader, -1 if not open */
+	gint n_read;
+	/* ZIP central directory, only while building the index */
+	GHashTable *zip_entries;
+
+	/* The file mapped in memory, shared with the clones */
+	GBytes *mapped;
+
+	/* Entry read directly from the file */
+	EvArchiveEntry *direct_entry;
+	GInputStream *file_stream;
+	GInputStream *direct_stream;
+	gint64 direct_offset;
+	gint64 direct_left;
 };
 
 G_DEFINE_TYPE(EvArchive, ev_archive, G_TYPE_OBJECT);
 
+static void
+ev_archive_entry_free (EvArchiveEntry *entry)
+{
+	g_free (entry->name);
+	g_free (entry);
+}
+
+static void
+ev_archive_close_direct (EvArchive *archive)
+{
+	archive->direct_entry = NULL;
+	g_clear_object (&archive->direct_stream);
+}
+
 static void
 ev_archive_finalize (GObject *object)
 {
@@ -61,6 +124,14 @@ ev_archive_finalize (GObject *object)
 		break;
 	}
 
+	ev_archive_close_direct (archive);
+	g_clear_object (&archive->file_stream);
+	g_clear_pointer (&archive->mapped, g_bytes_unref);
+	g_clear_pointer (&archive->zip_entries, g_hash_table_unref);
+	g_clear_pointer (&archive->entries_by_name, g_hash_table_unref);
+	g_clear_pointer (&archive->entries, g_ptr_array_unref);
+	g_free (archive->path);
+
 	G_OBJECT_CLASS (ev_archive_parent_class)->finalize (object);
 }
 
@@ -78,6 +149,43 @@ ev_archive_new (void)
 	return g_object_new (EV_TYPE_ARCHIVE, NULL);
 }
 
+/**
+ * ev_archive_clone:
+ * @archive: an #EvArchive
+ *
+ * Creates a new archive of the same type for the file @archive was
+ * opened with, that can be used from another thread. The mapping of
+ * the file is shared with @archive, and so is the index of the entries
+ * once it is complete, so that the clone can seek to the entries
+ * without listing them again.
+ *
+ * Returns: (transfer full): a new #EvArchive
+ */
+EvArchive *
+ev_archive_clone (EvArchive *archive)
+{
+	EvArchive *clone;
+
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), NULL);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, NULL);
+
+	clone = ev_archive_new ();
+	ev_archive_set_archive_type (clone, archive->type);
+	clone->path = g_strdup (archive->path);
+	if (archive->mapped)
+		clone->mapped = g_bytes_ref (archive->mapped);
+
+	if (archive->index_complete) {
+		g_ptr_array_unref (clone->entries);
+		g_hash_table_unref (clone->entries_by_name);
+		clone->entries = g_ptr_array_ref (archive->entries);
+		clone->entries_by_name = g_hash_table_ref (archive->entries_by_name);
+		clone->index_complete = TRUE;
+	}
+
+	return clone;
+}
+
 static void
 libarchive_set_archive_type (EvArchive *archive,
 			     EvArchiveType archive_type)
@@ -124,6 +232,306 @@ ev_archive_set_archive_type (EvArchive *archive,
 	return TRUE;
 }
 
+/* Returns a seekable stream on the mapping, or on the file itself
+ * when it could not be mapped */
+static GInputStream *
+ev_archive_get_file_stream (EvArchive *archive,
+			    GError   **error)
+{
+	GFile *file;
+
+	if (archive->file_stream)
+		return archive->file_stream;
+
+	if (archive->mapped) {
+		archive->file_stream = g_memory_input_stream_new_from_bytes (archive->mapped);
+		return archive->file_stream;
+	}
+
+	file = g_file_new_for_path (archive->path);
+	archive->file_stream = G_INPUT_STREAM (g_file_read (file, NULL, error));
+	g_object_unref (file);
+
+	return archive->file_stream;
+}
+
+static gboolean
+read_at (GInputStream *stream,
+	 goffset       offset,
+	 void         *buf,
+	 gsize         count,
+	 GError      **error)
+{
+	gsize n_read;
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), offset, G_SEEK_SET, NULL, error))
+		return FALSE;
+	if (!g_input_stream_read_all (stream, buf, count, &n_read, NULL, error))
+		return FALSE;
+	if (n_read != count) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     "Unexpected end of archive");
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+#define ZIP_EOCD_SIGNATURE         0x06054b50
+#define ZIP_EOCD_SIZE              22
+#define ZIP64_EOCD_SIGNATURE       0x06064b50
+#define ZIP64_EOCD_LOCATOR_SIZE    20
+#define ZIP_CENTRAL_SIGNATURE      0x02014b50
+#define ZIP_CENTRAL_SIZE           46
+#define ZIP_LOCAL_SIGNATURE        0x04034b50
+#define ZIP_LOCAL_SIZE             30
+#define ZIP_MAX_COMMENT            0xffff
+#define ZIP_FLAG_ENCRYPTED         (1 << 0)
+
+/* ZIP values are little endian and not aligned */
+static guint16
+zip_get_u16 (const guchar *p)
+{
+	return p[0] | (p[1] << 8);
+}
+
+static guint32
+zip_get_u32 (const guchar *p)
+{
+	return zip_get_u16 (p) | ((guint32) zip_get_u16 (p + 2) << 16);
+}
+
+static guint64
+zip_get_u64 (const guchar *p)
+{
+	return zip_get_u32 (p) | ((guint64) zip_get_u32 (p + 4) << 32);
+}
+
+static gboolean
+zip_find_central_directory (GInputStream *stream,
+			    goffset      *cd_offset,
+			    gsize        *cd_size)
+{
+	guchar *buf;
+	goffset file_size, start;
+	gsize len;
+	gssize i;
+	gboolean found = FALSE;
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), 0, G_SEEK_END, NULL, NULL))
+		return FALSE;
+	file_size = g_seekable_tell (G_SEEKABLE (stream));
+	if (file_size < ZIP_EOCD_SIZE)
+		return FALSE;
+
+	/* The end of central directory record is followed by a comment
+	 * of up to 64 KB, look for it backwards from the end of the file */
+	len = MIN (file_size, ZIP_EOCD_SIZE + ZIP64_EOCD_LOCATOR_SIZE + ZIP_MAX_COMMENT);
+	start = file_size - len;
+	buf = g_malloc (len);
+	if (!read_at (stream, start, buf, len, NULL)) {
+		g_free (buf);
+		return FALSE;
+	}
+
+	for (i = (gssize) len - ZIP_EOCD_SIZE; i >= 0; i--) {
+		const guchar *eocd = buf + i;
+		guint64 offset, size;
+
+		if (zip_get_u32 (eocd) != ZIP_EOCD_SIGNATURE)
+			continue;
+
+		size = zip_get_u32 (eocd + 12);
+		offset = zip_get_u32 (eocd + 16);
+
+		if ((size == 0xffffffff || offset == 0xffffffff) &&
+		    i >= ZIP64_EOCD_LOCATOR_SIZE) {
+			guchar zip64[56];
+			guint64 zip64_offset;
+
+			zip64_offset = zip_get_u64 (eocd - ZIP64_EOCD_LOCATOR_SIZE + 8);
+			if (!read_at (stream, zip64_offset, zip64, sizeof (zip64), NULL) ||
+			    zip_get_u32 (zip64) != ZIP64_EOCD_SIGNATURE)
+				break;
+
+			size = zip_get_u64 (zip64 + 40);
+			offset = zip_get_u64 (zip64 + 48);
+		}
+
+		if (offset + size > (guint64) file_size || size > G_MAXINT32)
+			break;
+
+		*cd_offset = offset;
+		*cd_size = size;
+		found = TRUE;
+		break;
+	}
+
+	g_free (buf);
+
+	return found;
+}
+
+/* Returns the entries of the central directory by name, so that they
+ * can be read directly once libarchive listed them, or %NULL if the
+ * central directory can't be read.
+ */
+static GHashTable *
+zip_read_central_directory (EvArchive *archive)
+{
+	GInputStream *stream;
+	GHashTable *zip_entries;
+	goffset cd_offset;
+	gsize cd_size, pos;
+	guchar *cd;
+
+	stream = ev_archive_get_file_stream (archive, NULL);
+	if (!stream || !zip_find_central_directory (stream, &cd_offset, &cd_size))
+		return NULL;
+
+	cd = g_malloc (cd_size);
+	if (!read_at (stream, cd_offset, cd, cd_size, NULL)) {
+		g_free (cd);
+		return NULL;
+	}
+
+	zip_entries = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+	for (pos = 0; pos + ZIP_CENTRAL_SIZE <= cd_size;) {
+		const guchar *header = cd + pos;
+		ZipEntryInfo *info;
+		guint16 name_len, extra_len, comment_len;
+		guint64 offset, size;
+		gchar *name;
+
+		if (zip_get_u32 (header) != ZIP_CENTRAL_SIGNATURE)
+			break;
+
+		name_len = zip_get_u16 (header + 28);
+		extra_len = zip_get_u16 (header + 30);
+		comment_len = zip_get_u16 (header + 32);
+		if (pos + ZIP_CENTRAL_SIZE + name_len + extra_len > cd_size)
+			break;
+
+		size = zip_get_u32 (header + 24);
+		offset = zip_get_u32 (header + 42);
+		if (size == 0xffffffff || offset == 0xffffffff) {
+			const guchar *extra = header + ZIP_CENTRAL_SIZE + name_len;
+			const guchar *extra_end = extra + extra_len;
+
+			/* The ZIP64 extended information has the 64 bits
+			 * values that don't fit in the header, in order */
+			offset = G_MAXUINT64;
+			while (extra + 4 <= extra_end) {
+				guint16 id = zip_get_u16 (extra);
+				guint16 len = zip_get_u16 (extra + 2);
+				const guchar *value = extra + 4;
+				const guchar *value_end = value + len;
+
+				if (value_end > extra_end)
+					break;
+
+				if (id == 0x0001) {
+					if (size == 0xffffffff) {
+						if (value + 8 > value_end)
+							break;
+						size = zip_get_u64 (value);
+						value += 8;
+					}
+					if (zip_get_u32 (header + 20) == 0xffffffff)
+						value += 8;
+					if (zip_get_u32 (header + 42) != 0xffffffff)
+						offset = zip_get_u32 (header + 42);
+					else if (value + 8 <= value_end)
+						offset = zip_get_u64 (value);
+					break;
+				}
+				extra = value_end;
+			}
+		}
+
+		name = g_strndup ((const gchar *) header + ZIP_CENTRAL_SIZE, name_len);
+		if (offset != G_MAXUINT64 && !g_hash_table_contains (zip_entries, name)) {
+			info = g_new (ZipEntryInfo, 1);
+			info->flags = zip_get_u16 (header + 8);
+			info->method = zip_get_u16 (header + 10);
+			info->offset = offset;
+			info->size = size;
+			g_hash_table_insert (zip_entries, name, info);
+		} else {
+			g_free (name);
+		}
+
+		pos += ZIP_CENTRAL_SIZE + name_len + extra_len + comment_len;
+	}
+
+	g_free (cd);
+
+	return zip_entries;
+}
+
+/* Adds the current entry of the sequential reader to the index. Entries
+ * without a name can't be looked up, but are kept so that the index of
+ * every entry is its position in the archive.
+ */
+static void
+ev_archive_index_entry (EvArchive *archive)
+{
+	EvArchiveEntry *entry;
+	const char *name;
+
+	name = ev_archive_get_entry_pathname (archive);
+
+	entry = g_new0 (EvArchiveEntry, 1);
+	entry->index = archive->entries->len;
+	entry->access = EV_ARCHIVE_ACCESS_SEQUENTIAL;
+	g_ptr_array_add (archive->entries, entry);
+
+	if (!name)
+		return;
+
+	entry->name = g_strdup (name);
+	entry->size = ev_archive_get_entry_size (archive);
+	entry->is_encrypted = ev_archive_get_entry_is_encrypted (archive);
+
+	switch (archive->type) {
+	case EV_ARCHIVE_TYPE_RAR:
+		entry->access = EV_ARCHIVE_ACCESS_RAR;
+		entry->offset = ar_entry_get_offset (archive->unarr);
+		break;
+	case EV_ARCHIVE_TYPE_TAR:
+		/* Only uncompressed TAR files are supported, the data
+		 * of the entry follows the headers read so far */
+		if (archive_filter_count (archive->libar) == 1 &&
+		    archive_entry_sparse_count (archive->libar_entry) == 0) {
+			entry->access = EV_ARCHIVE_ACCESS_STORED;
+			entry->offset = archive_filter_bytes (archive->libar, 0);
+		}
+		break;
+	case EV_ARCHIVE_TYPE_ZIP: {
+		ZipEntryInfo *info;
+
+		info = archive->zip_entries ? g_hash_table_lookup (archive->zip_entries, name) : NULL;
+		if (!info || (info->flags & ZIP_FLAG_ENCRYPTED))
+			break;
+
+		if (info->method == 0)
+			entry->access = EV_ARCHIVE_ACCESS_ZIP_STORED;
+		else if (info->method == 8)
+			entry->access = EV_ARCHIVE_ACCESS_ZIP_DEFLATED;
+		entry->offset = info->offset;
+		entry->size = info->size;
+	}
+		break;
+	default:
+		/* 7z folders can't be reached without libarchive */
+		break;
+	}
+
+	if (!g_hash_table_contains (archive->entries_by_name, entry->name))
+		g_hash_table_insert (archive->entries_by_name, entry->name, entry);
+}
+
 gboolean
 ev_archive_open_filename (EvArchive   *archive,
 			  const char  *path,
@@ -135,11 +543,49 @@ ev_archive_open_filename (EvArchive   *archive,
 	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
 	g_return_val_if_fail (path != NULL, FALSE);
 
+	if (g_strcmp0 (archive->path, path) != 0) {
+		g_free (archive->path);
+		archive->path = g_strdup (path);
+		g_clear_object (&archive->file_stream);
+		g_clear_pointer (&archive->mapped, g_bytes_unref);
+	}
+
+	ev_archive_close_direct (archive);
+	archive->n_read = -1;
+
+	/* The file is mapped once, and read from memory by the
+	 * decompressors and for the entries that are read directly */
+	if (!archive->mapped) {
+		GMappedFile *mapped_file;
+		GError *map_error = NULL;
+
+		mapped_file = g_mapped_file_new (path, FALSE, &map_error);
+		if (mapped_file) {
+			archive->mapped = g_mapped_file_get_bytes (mapped_file);
+			g_mapped_file_unref (mapped_file);
+		} else {
+			g_debug ("Could not map '%s', reading it instead: %s", path, map_error->message);
+			g_error_free (map_error);
+		}
+	}
+
+	/* The ZIP central directory gives the local header of the
+	 * entries while they are indexed, and libarchive is only
+	 * used to list them.
+	 */
+	if (archive->type == EV_ARCHIVE_TYPE_ZIP && !archive->index_complete &&
+	    !archive->zip_entries)
+		archive->zip_entries = zip_read_central_directory (archive);
+
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_NONE:
 		g_assert_not_reached ();
 	case EV_ARCHIVE_TYPE_RAR:
-		archive->unarr_stream = ar_open_file (path);
+		if (archive->mapped)
+			archive->unarr_stream = ar_open_memory (g_bytes_get_data (archive->mapped, NULL),
+								g_bytes_get_size (archive->mapped));
+		else
+			archive->unarr_stream = ar_open_file (path);
 		if (archive->unarr_stream == NULL) {
 			g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
 					     "Error opening archive");
@@ -155,7 +601,12 @@ ev_archive_open_filename (EvArchive   *archive,
 	case EV_ARCHIVE_TYPE_ZIP:
 	case EV_ARCHIVE_TYPE_7Z:
 	case EV_ARCHIVE_TYPE_TAR:
-		r = archive_read_open_filename (archive->libar, path, BUFFER_SIZE);
+		if (archive->mapped)
+			r = archive_read_open_memory (archive->libar,
+						      g_bytes_get_data (archive->mapped, NULL),
+						      g_bytes_get_size (archive->mapped));
+		else
+			r = archive_read_open_filename (archive->libar, path, BUFFER_SIZE);
 		if (r != ARCHIVE_OK) {
 			g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
 				     "Error opening archive: %s", archive_error_string (archive->libar));
@@ -196,22 +647,58 @@ libarchive_read_next_header (EvArchive *archive,
 	return TRUE;
 }
 
-gboolean
-ev_archive_read_next_header (EvArchive *archive,
-			     GError   **error)
+static gboolean
+ev_archive_read_next_header_sequential (EvArchive *archive,
+					GError   **error)
 {
-	g_return_val_if_fail (EV_IS_ARCHIVE (archive), FALSE);
-	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
+	gboolean retval = FALSE;
 
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_NONE:
 		g_assert_not_reached ();
 	case EV_ARCHIVE_TYPE_RAR:
-		return ar_parse_entry (archive->unarr);
+		retval = ar_parse_entry (archive->unarr);
+		break;
 	case EV_ARCHIVE_TYPE_ZIP:
 	case EV_ARCHIVE_TYPE_7Z:
 	case EV_ARCHIVE_TYPE_TAR:
-		return libarchive_read_next_header (archive, error);
+		retval = libarchive_read_next_header (archive, error);
+		break;
+	}
+
+	if (!retval)
+		return FALSE;
+
+	archive->n_read++;
+	if (!archive->index_complete && archive->n_read == (gint) archive->entries->len)
+		ev_archive_index_entry (archive);
+
+	return TRUE;
+}
+
+gboolean
+ev_archive_read_next_header (EvArchive *archive,
+			     GError   **error)
+{
+	GError *local_error = NULL;
+
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), FALSE);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
+
+	ev_archive_close_direct (archive);
+
+	if (ev_archive_read_next_header_sequential (archive, &local_error))
+		return TRUE;
+
+	if (local_error) {
+		g_propagate_error (error, local_error);
+		return FALSE;
+	}
+
+	/* All the entries have been read in order */
+	if (!archive->index_complete && archive->n_read + 1 == (gint) archive->entries->len) {
+		archive->index_complete = TRUE;
+		g_clear_pointer (&archive->zip_entries, g_hash_table_unref);
 	}
 
 	return FALSE;
@@ -223,6 +710,9 @@ ev_archive_get_entry_pathname (EvArchive *archive)
 	g_return_val_if_fail (EV_IS_ARCHIVE (archive), NULL);
 	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, NULL);
 
+	if (archive->direct_entry)
+		return archive->direct_entry->name;
+
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_NONE:
 		g_assert_not_reached ();
@@ -245,6 +735,9 @@ ev_archive_get_entry_size (EvArchive *archive)
 	g_return_val_if_fail (EV_IS_ARCHIVE (archive), -1);
 	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, -1);
 
+	if (archive->direct_entry)
+		return archive->direct_entry->size;
+
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_RAR:
 		g_return_val_if_fail (archive->unarr != NULL, -1);
@@ -267,6 +760,9 @@ ev_archive_get_entry_is_encrypted (EvArchive *archive)
 	g_return_val_if_fail (EV_IS_ARCHIVE (archive), FALSE);
 	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
 
+	if (archive->direct_entry)
+		return archive->direct_entry->is_encrypted;
+
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_RAR:
 		g_return_val_if_fail (archive->unarr != NULL, FALSE);
@@ -284,6 +780,26 @@ ev_archive_get_entry_is_encrypted (EvArchive *archive)
 	return FALSE;
 }
 
+static gssize
+ev_archive_read_direct_data (EvArchive *archive,
+			     void      *buf,
+			     gsize      count,
+			     GError   **error)
+{
+	gsize n_read;
+
+	count = MIN (count, archive->direct_left);
+	if (count == 0)
+		return 0;
+
+	if (!g_input_stream_read_all (archive->direct_stream, buf, count, &n_read, NULL, error))
+		return -1;
+
+	archive->direct_left -= n_read;
+
+	return n_read;
+}
+
 gssize
 ev_archive_read_data (EvArchive *archive,
 		      void      *buf,
@@ -295,6 +811,9 @@ ev_archive_read_data (EvArchive *archive,
 	g_return_val_if_fail (EV_IS_ARCHIVE (archive), -1);
 	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, -1);
 
+	if (archive->direct_entry)
+		return ev_archive_read_direct_data (archive, buf, count, error);
+
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_RAR:
 		g_return_val_if_fail (archive->unarr != NULL, -1);
@@ -322,12 +841,58 @@ ev_archive_read_data (EvArchive *archive,
 	return r;
 }
 
-void
-ev_archive_reset (EvArchive *archive)
+/**
+ * ev_archive_read_entry:
+ * @archive: an #EvArchive
+ * @error: a #GError location
+ *
+ * Reads all the data of the current entry. The data of the entries
+ * stored without compression are not copied when the archive could be
+ * mapped in memory, the returned #GBytes refers to the mapping.
+ *
+ * Returns: (transfer full): the data of the current entry, or %NULL
+ *   on error
+ */
+GBytes *
+ev_archive_read_entry (EvArchive *archive,
+		       GError   **error)
 {
-	g_return_if_fail (EV_IS_ARCHIVE (archive));
-	g_return_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE);
+	gint64 size;
+	gssize read;
+	char *buf;
+
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), NULL);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, NULL);
+
+	size = ev_archive_get_entry_size (archive);
+	if (size < 0 || size > G_MAXSSIZE) {
+		g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     "Invalid entry size");
+		return NULL;
+	}
+
+	if (archive->direct_entry && archive->mapped &&
+	    archive->direct_entry->access != EV_ARCHIVE_ACCESS_ZIP_DEFLATED &&
+	    archive->direct_left == size &&
+	    archive->direct_offset + size <= (gint64) g_bytes_get_size (archive->mapped)) {
+		archive->direct_left = 0;
+
+		return g_bytes_new_from_bytes (archive->mapped, archive->direct_offset, size);
+	}
+
+	buf = g_malloc (MAX (size, 1));
+	read = size > 0 ? ev_archive_read_data (archive, buf, size, error) : 0;
+	if (read < 0) {
+		g_free (buf);
+		return NULL;
+	}
 
+	return g_bytes_new_take (buf, read);
+}
+
+static void
+ev_archive_close_sequential (EvArchive *archive)
+{
 	switch (archive->type) {
 	case EV_ARCHIVE_TYPE_RAR:
 		g_clear_pointer (&archive->unarr, ar_close_archive);
@@ -342,9 +907,150 @@ ev_archive_reset (EvArchive *archive)
 	default:
 		g_assert_not_reached ();
 	}
+
+	archive->libar_entry = NULL;
+	archive->n_read = -1;
+}
+
+void
+ev_archive_reset (EvArchive *archive)
+{
+	g_return_if_fail (EV_IS_ARCHIVE (archive));
+	g_return_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE);
+
+	ev_archive_close_direct (archive);
+	ev_archive_close_sequential (archive);
+}
+
+static gboolean
+ev_archive_seek_direct_entry (EvArchive      *archive,
+			      EvArchiveEntry *entry,
+			      GError        **error)
+{
+	GInputStream *stream;
+	goffset data_offset = entry->offset;
+
+	stream = ev_archive_get_file_stream (archive, error);
+	if (!stream)
+		return FALSE;
+
+	if (entry->access != EV_ARCHIVE_ACCESS_STORED) {
+		guchar header[ZIP_LOCAL_SIZE];
+
+		if (!read_at (stream, entry->offset, header, sizeof (header), error))
+			return FALSE;
+		/* The central directory doesn't match the entries,
+		 * the caller reads this one in order instead */
+		if (zip_get_u32 (header) != ZIP_LOCAL_SIGNATURE) {
+			g_debug ("No local header for '%s', reading it sequentially", entry->name);
+			entry->access = EV_ARCHIVE_ACCESS_SEQUENTIAL;
+			return FALSE;
+		}
+		data_offset += ZIP_LOCAL_SIZE + zip_get_u16 (header + 26) + zip_get_u16 (header + 28);
+	}
+
+	if (!g_seekable_seek (G_SEEKABLE (stream), data_offset, G_SEEK_SET, NULL, error))
+		return FALSE;
+
+	if (entry->access == EV_ARCHIVE_ACCESS_ZIP_DEFLATED) {
+		GZlibDecompressor *decompressor;
+
+		decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW);
+		archive->direct_stream = g_converter_input_stream_new (stream, G_CONVERTER (decompressor));
+		g_filter_input_stream_set_close_base_stream (G_FILTER_INPUT_STREAM (archive->direct_stream),
+							     FALSE);
+		g_object_unref (decompressor);
+	} else {
+		archive->direct_stream = g_object_ref (stream);
+	}
+
+	archive->direct_entry = entry;
+	archive->direct_offset = data_offset;
+	archive->direct_left = entry->size;
+
+	return TRUE;
+}
+
+/**
+ * ev_archive_seek_entry:
+ * @archive: an #EvArchive
+ * @pathname: the name of an entry
+ * @error: a #GError location
+ *
+ * Makes @pathname the current entry of @archive, so that it can be read
+ * with ev_archive_read_data(). The archive must have been opened with
+ * ev_archive_open_filename() before, and is opened again if needed.
+ *
+ * The entries that were listed in order before are reached directly
+ * when the format allows it: stored and deflated ZIP entries, TAR
+ * entries and RAR entries (unarr decompresses solid RAR archives from
+ * the start when needed). Other entries are read after the ones before
+ * them, from the current entry when it comes before @pathname.
+ *
+ * Returns: %TRUE if @pathname is the current entry
+ */
+gboolean
+ev_archive_seek_entry (EvArchive   *archive,
+		       const char  *pathname,
+		       GError     **error)
+{
+	EvArchiveEntry *entry;
+
+	g_return_val_if_fail (EV_IS_ARCHIVE (archive), FALSE);
+	g_return_val_if_fail (archive->type != EV_ARCHIVE_TYPE_NONE, FALSE);
+	g_return_val_if_fail (archive->path != NULL, FALSE);
+	g_return_val_if_fail (pathname != NULL, FALSE);
+
+	ev_archive_close_direct (archive);
+
+	entry = g_hash_table_lookup (archive->entries_by_name, pathname);
+	if (entry && entry->access == EV_ARCHIVE_ACCESS_RAR) {
+		if (!archive->unarr &&
+		    !ev_archive_open_filename (archive, archive->path, error))
+			return FALSE;
+
+		if (!ar_parse_entry_at (archive->unarr, entry->offset)) {
+			g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+				     "Error reading RAR entry '%s'", pathname);
+			return FALSE;
+		}
+		archive->n_read = entry->index;
+
+		return TRUE;
+	}
+
+	if (entry && entry->access != EV_ARCHIVE_ACCESS_SEQUENTIAL) {
+		if (ev_archive_seek_direct_entry (archive, entry, error))
+			return TRUE;
+		if (entry->access != EV_ARCHIVE_ACCESS_SEQUENTIAL)
+			return FALSE;
+	}
+
+	/* Start again from the first entry unless the reader is
+	 * already before the entry */
+	if (archive->n_read < 0 || !entry || archive->n_read >= (gint) entry->index) {
+		ev_archive_close_sequential (archive);
+		if (!ev_archive_open_filename (archive, archive->path, error))
+			return FALSE;
+	}
+
+	while (ev_archive_read_next_header_sequential (archive, error)) {
+		if (entry ? archive->n_read == (gint) entry->index :
+		    g_strcmp0 (ev_archive_get_entry_pathname (archive), pathname) == 0)
+			return TRUE;
+	}
+
+	if (error && !*error)
+		g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+			     "No entry '%s' in archive", pathname);
+
+	return FALSE;
 }
 
 static void
 ev_archive_init (EvArchive *archive)
 {
+	archive->entries = g_ptr_array_new_with_free_func ((GDestroyNotify) ev_archive_entry_free);
+	archive->entries_by_name = g_hash_table_new (g_str_hash, g_str_equal);
+	archive->n_read = -1;
 }
@@ -36,6 +36,7 @@ typedef enum {
 } EvArchiveType;
 
 EvArchive     *ev_archive_new                (void);
+EvArchive     *ev_archive_clone              (EvArchive     *archive);
 gboolean       ev_archive_set_archive_type   (EvArchive     *archive,
 					      EvArchiveType  archive_type);
 EvArchiveType  ev_archive_get_archive_type   (EvArchive     *archive);
@@ -51,7 +52,12 @@ gssize         ev_archive_read_data          (EvArchive     *archive,
 					      void          *buf,
 					      gsize          count,
 					      GError       **error);
+GBytes        *ev_archive_read_entry         (EvArchive     *archive,
+					      GError       **error);
 void           ev_archive_reset              (EvArchive     *archive);
+gboolean       ev_archive_seek_entry         (EvArchive     *archive,
+					      const char    *pathname,
+					      GError       **error);
 
 G_END_DECLS
 
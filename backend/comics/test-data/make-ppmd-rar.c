@@ -0,0 +1,536 @@
+/*
+ * Generates ppmd.rar, a solid RAR fixture whose entries are compressed
+ * with PPMd, for the checkpoint test of unarr.
+ *
+ * rar isn't free software, so the archive is written by a small RAR 2.9
+ * PPMd encoder instead, which uses the PPMd model of unarr itself. The
+ * entries share one PPMd model, the first one creates it and the
+ * following ones keep it. Every entry:
+ * - starts a PPMd block, with a new range coder;
+ * - goes through escaped literals, single byte runs and matches;
+ * - ends the PPMd block with a tiny LZ block holding the end of file
+ *   code, which tells to read new tables for the next entry.
+ * so that the PPMd model carries over entries, like in archives with
+ * PPMd text followed by other entries.
+ *
+ * The entry checksums are the ones of the generated content, not of the
+ * output of a decoder.
+ *
+ * Build and run from this directory:
+ *   cc -I../../../cut-n-paste/unarr/lzmasdk -o make-ppmd-rar make-ppmd-rar.c \
+ *      ../../../cut-n-paste/unarr/lzmasdk/Ppmd7.c
+ *   ./make-ppmd-rar [output-directory]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Ppmd7.h"
+
+#define N_ENTRIES     6
+#define ENTRY_SIZE    12000
+#define MAX_ORDER     8
+#define MAX_ALLOC_MB  1
+#define PPMD_ESCAPE   2
+
+static void *alloc_alloc (ISzAllocPtr p, size_t size) { return malloc (size); }
+static void alloc_free (ISzAllocPtr p, void *ptr) { free (ptr); }
+static ISzAlloc alloc = { alloc_alloc, alloc_free };
+
+typedef struct {
+	unsigned char *data;
+	size_t         size;
+	size_t         allocated;
+	unsigned       bits;
+	int            n_bits;
+} Buffer;
+
+static void
+buffer_append (Buffer *buffer, const void *data, size_t size)
+{
+	if (buffer->size + size > buffer->allocated) {
+		buffer->allocated = (buffer->size + size) * 2;
+		buffer->data = realloc (buffer->data, buffer->allocated);
+	}
+	memcpy (buffer->data + buffer->size, data, size);
+	buffer->size += size;
+}
+
+static void
+buffer_append_byte (Buffer *buffer, unsigned char byte)
+{
+	buffer_append (buffer, &byte, 1);
+}
+
+/* Bits are read from the most significant one */
+static void
+buffer_write_bits (Buffer *buffer, unsigned value, int count)
+{
+	while (count-- > 0) {
+		buffer->bits = (buffer->bits << 1) | ((value >> count) & 1);
+		if (++buffer->n_bits == 8) {
+			buffer_append_byte (buffer, (unsigned char)buffer->bits);
+			buffer->bits = 0;
+			buffer->n_bits = 0;
+		}
+	}
+}
+
+static void
+buffer_flush_bits (Buffer *buffer)
+{
+	if (buffer->n_bits)
+		buffer_write_bits (buffer, 0, 8 - buffer->n_bits);
+}
+
+/* The carryless range coder of RAR, the decoder is PpmdRAR_RangeDec */
+typedef struct {
+	UInt32  low;
+	UInt32  range;
+	Buffer *out;
+} RangeEnc;
+
+#define TOP (1 << 24)
+#define BOT (1 << 15)
+
+static void
+range_enc_init (RangeEnc *rc, Buffer *out)
+{
+	rc->low = 0;
+	rc->range = 0xFFFFFFFF;
+	rc->out = out;
+}
+
+static void
+range_enc_encode (RangeEnc *rc, UInt32 start, UInt32 size, UInt32 total)
+{
+	rc->range /= total;
+	rc->low += start * rc->range;
+	rc->range *= size;
+	for (;;) {
+		if ((rc->low ^ (rc->low + rc->range)) >= TOP) {
+			if (rc->range >= BOT)
+				break;
+			rc->range = (UInt32)(-(Int32)rc->low) & (BOT - 1);
+		}
+		buffer_append_byte (rc->out, (unsigned char)(rc->low >> 24));
+		rc->range <<= 8;
+		rc->low <<= 8;
+	}
+}
+
+static void
+range_enc_flush (RangeEnc *rc)
+{
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		buffer_append_byte (rc->out, (unsigned char)(rc->low >> 24));
+		rc->low <<= 8;
+	}
+}
+
+/* The counterpart of Ppmd7_DecodeSymbol, with the same model updates */
+#define MASK(sym) ((signed char *)char_mask)[sym]
+
+static void
+ppmd_encode_symbol (CPpmd7 *p, RangeEnc *rc, int symbol)
+{
+	size_t char_mask[256 / sizeof (size_t)];
+
+	if (p->MinContext->NumStats != 1) {
+		CPpmd_State *s = Ppmd7_GetStats (p, p->MinContext);
+		UInt32 sum;
+		unsigned i;
+
+		if (s->Symbol == symbol) {
+			range_enc_encode (rc, 0, s->Freq, p->MinContext->SummFreq);
+			p->FoundState = s;
+			Ppmd7_Update1_0 (p);
+			return;
+		}
+		p->PrevSuccess = 0;
+		sum = s->Freq;
+		i = p->MinContext->NumStats - 1;
+		do {
+			if ((++s)->Symbol == symbol) {
+				range_enc_encode (rc, sum, s->Freq, p->MinContext->SummFreq);
+				p->FoundState = s;
+				Ppmd7_Update1 (p);
+				return;
+			}
+			sum += s->Freq;
+		} while (--i);
+
+		p->HiBitsFlag = p->HB2Flag[p->FoundState->Symbol];
+		PPMD_SetAllBitsIn256Bytes (char_mask);
+		MASK (s->Symbol) = 0;
+		i = p->MinContext->NumStats - 1;
+		do { MASK ((--s)->Symbol) = 0; } while (--i);
+		range_enc_encode (rc, sum, p->MinContext->SummFreq - sum, p->MinContext->SummFreq);
+	} else {
+		UInt16 *prob = Ppmd7_GetBinSumm (p);
+		CPpmd_State *s = Ppmd7Context_OneState (p->MinContext);
+
+		if (s->Symbol == symbol) {
+			range_enc_encode (rc, 0, *prob, PPMD_BIN_SCALE);
+			*prob = (UInt16)PPMD_UPDATE_PROB_0 (*prob);
+			p->FoundState = s;
+			Ppmd7_UpdateBin (p);
+			return;
+		}
+		range_enc_encode (rc, *prob, PPMD_BIN_SCALE - *prob, PPMD_BIN_SCALE);
+		*prob = (UInt16)PPMD_UPDATE_PROB_1 (*prob);
+		p->InitEsc = PPMD7_kExpEscape[*prob >> 10];
+		PPMD_SetAllBitsIn256Bytes (char_mask);
+		MASK (s->Symbol) = 0;
+		p->PrevSuccess = 0;
+	}
+
+	for (;;) {
+		CPpmd_See *see;
+		CPpmd_State *s;
+		UInt32 esc_freq, sum;
+		unsigned i, num_masked = p->MinContext->NumStats;
+
+		do {
+			p->OrderFall++;
+			if (!p->MinContext->Suffix) {
+				fprintf (stderr, "Symbol %d can't be encoded\n", symbol);
+				exit (1);
+			}
+			p->MinContext = Ppmd7_GetContext (p, p->MinContext->Suffix);
+		} while (p->MinContext->NumStats == num_masked);
+
+		see = Ppmd7_MakeEscFreq (p, num_masked, &esc_freq);
+		s = Ppmd7_GetStats (p, p->MinContext);
+		sum = 0;
+		i = p->MinContext->NumStats;
+		do {
+			int cur = s->Symbol;
+
+			if (cur == symbol) {
+				UInt32 low = sum;
+				CPpmd_State *found = s;
+
+				do {
+					sum += (s->Freq & (int)(MASK (s->Symbol)));
+					s++;
+				} while (--i);
+				range_enc_encode (rc, low, found->Freq, sum + esc_freq);
+				Ppmd_See_Update (see);
+				p->FoundState = found;
+				Ppmd7_Update2 (p);
+				return;
+			}
+			sum += (s->Freq & (int)(MASK (cur)));
+			MASK (cur) = 0;
+			s++;
+		} while (--i);
+
+		range_enc_encode (rc, sum, esc_freq, sum + esc_freq);
+		see->Summ = (UInt16)(see->Summ + sum + esc_freq);
+	}
+}
+
+static UInt32 rand_seed = 20201019;
+
+static unsigned
+rand_int (unsigned n)
+{
+	rand_seed = rand_seed * 1103515245 + 12345;
+	return (rand_seed >> 16) % n;
+}
+
+/* Words and numbers, byte runs, escape characters and pieces of the
+ * previous entries, so that literals, runs and matches are escaped.
+ */
+static void
+make_entry (unsigned char *data, size_t size, const unsigned char *previous, size_t n_previous)
+{
+	static const char *words[] = {
+		"page", "panel", "comic", "strip", "balloon", "caption", "archive",
+		"solid", "entry", "model", "context", "escape", "symbol", "range",
+		"coder", "order", "scan", "cover", "issue", "volume", "chapter"
+	};
+	size_t pos = 0;
+
+	while (pos < size) {
+		unsigned kind = rand_int (100);
+		unsigned char piece[400];
+		size_t length = 0, i;
+
+		if (kind < 55) {
+			length = snprintf ((char *)piece, sizeof (piece), "%s %s %u, ",
+					   words[rand_int (21)], words[rand_int (21)], rand_int (1000));
+		} else if (kind < 65) {
+			length = 4 + rand_int (200);
+			memset (piece, rand_int (256), length);
+		} else if (kind < 75) {
+			/* Escape characters in the text */
+			length = 1 + rand_int (8);
+			for (i = 0; i < length; i++)
+				piece[i] = rand_int (2) ? PPMD_ESCAPE : rand_int (256);
+		} else if (kind < 90 && n_previous > 400) {
+			size_t start = rand_int (n_previous - 400);
+
+			length = 32 + rand_int (300);
+			memcpy (piece, previous + start, length);
+		} else {
+			length = 1 + rand_int (64);
+			for (i = 0; i < length; i++)
+				piece[i] = rand_int (256);
+		}
+
+		if (length > size - pos)
+			length = size - pos;
+		memcpy (data + pos, piece, length);
+		pos += length;
+	}
+}
+
+/* Positions of the previous data, by their first 3 bytes */
+#define HASH_SIZE (1 << 16)
+#define MAX_CANDIDATES 64
+
+static size_t *chain_head;
+static size_t *chain_prev;
+
+static unsigned
+hash (const unsigned char *data)
+{
+	return ((data[0] << 8) ^ (data[1] << 4) ^ data[2]) & (HASH_SIZE - 1);
+}
+
+static void
+insert (const unsigned char *window, size_t pos, size_t end)
+{
+	unsigned h;
+
+	if (pos + 3 > end)
+		return;
+	h = hash (window + pos);
+	chain_prev[pos] = chain_head[h];
+	chain_head[h] = pos + 1;
+}
+
+static void
+encode_entry (CPpmd7 *ppmd, Buffer *out, const unsigned char *window, size_t start, size_t end)
+{
+	RangeEnc rc;
+	size_t pos = start, i;
+
+	/* PPMd block, the first one creates the model */
+	buffer_write_bits (out, 1, 1);
+	if (start == 0) {
+		buffer_write_bits (out, 0x20 | (MAX_ORDER - 1), 7);
+		buffer_write_bits (out, MAX_ALLOC_MB - 1, 8);
+		Ppmd7_Init (ppmd, MAX_ORDER);
+	} else {
+		buffer_write_bits (out, 0, 7);
+	}
+	buffer_flush_bits (out);
+	range_enc_init (&rc, out);
+
+	while (pos < end) {
+		size_t run = 0, best_length = 0, best_distance = 0, candidate;
+		size_t next = pos + 1;
+		int n_candidates = 0;
+
+		/* Runs repeat the previous byte */
+		while (pos > 0 && pos + run < end && run < 259 && window[pos + run] == window[pos - 1])
+			run++;
+
+		/* Matches of 32 to 287 bytes, anywhere in the previous data */
+		candidate = pos + 3 <= end ? chain_head[hash (window + pos)] : 0;
+		while (candidate && n_candidates++ < MAX_CANDIDATES) {
+			size_t distance = pos - (candidate - 1);
+			size_t length = 0;
+
+			while (pos + length < end && length < 287 &&
+			       window[pos + length] == window[pos + length - distance])
+				length++;
+			if (distance >= 2 && length > best_length) {
+				best_length = length;
+				best_distance = distance;
+			}
+			candidate = chain_prev[candidate - 1];
+		}
+
+		if (run >= 4 && run >= best_length) {
+			ppmd_encode_symbol (ppmd, &rc, PPMD_ESCAPE);
+			ppmd_encode_symbol (ppmd, &rc, 5);
+			ppmd_encode_symbol (ppmd, &rc, (int)(run - 4));
+			next = pos + run;
+		} else if (best_length >= 32) {
+			size_t offset = best_distance - 2;
+
+			ppmd_encode_symbol (ppmd, &rc, PPMD_ESCAPE);
+			ppmd_encode_symbol (ppmd, &rc, 4);
+			ppmd_encode_symbol (ppmd, &rc, (int)((offset >> 16) & 0xFF));
+			ppmd_encode_symbol (ppmd, &rc, (int)((offset >> 8) & 0xFF));
+			ppmd_encode_symbol (ppmd, &rc, (int)(offset & 0xFF));
+			ppmd_encode_symbol (ppmd, &rc, (int)(best_length - 32));
+			next = pos + best_length;
+		} else if (window[pos] == PPMD_ESCAPE) {
+			ppmd_encode_symbol (ppmd, &rc, PPMD_ESCAPE);
+			ppmd_encode_symbol (ppmd, &rc, 1);
+		} else {
+			ppmd_encode_symbol (ppmd, &rc, window[pos]);
+		}
+
+		for (i = pos; i < next; i++)
+			insert (window, i, end);
+		pos = next;
+	}
+
+	/* End of the PPMd block, new tables follow */
+	ppmd_encode_symbol (ppmd, &rc, PPMD_ESCAPE);
+	ppmd_encode_symbol (ppmd, &rc, 0);
+	range_enc_flush (&rc);
+
+	/* LZ block with new tables, the main code only has the symbols 0
+	 * and 256, both one bit long, its lengths are written with the
+	 * precode symbols 1 (length 1), 18 and 19 (runs of zeros).
+	 */
+	buffer_write_bits (out, 0, 1);
+	buffer_write_bits (out, 0, 1);
+	{
+		static const unsigned char precode_lengths[20] = {
+			0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2
+		};
+		int i;
+
+		for (i = 0; i < 20; i++)
+			buffer_write_bits (out, precode_lengths[i], 4);
+	}
+	/* symbol 0 */
+	buffer_write_bits (out, 0, 1);
+	/* symbols 1 to 255 */
+	buffer_write_bits (out, 3, 2);
+	buffer_write_bits (out, 138 - 11, 7);
+	buffer_write_bits (out, 3, 2);
+	buffer_write_bits (out, 117 - 11, 7);
+	/* symbol 256 */
+	buffer_write_bits (out, 0, 1);
+	/* symbols 257 to 403 */
+	buffer_write_bits (out, 3, 2);
+	buffer_write_bits (out, 138 - 11, 7);
+	buffer_write_bits (out, 2, 2);
+	buffer_write_bits (out, 9 - 3, 3);
+
+	/* End of file, new tables for the next one */
+	buffer_write_bits (out, 1, 1);
+	buffer_write_bits (out, 0, 1);
+	buffer_write_bits (out, 1, 1);
+	buffer_flush_bits (out);
+}
+
+static UInt32
+crc32 (UInt32 crc, const unsigned char *data, size_t size)
+{
+	size_t i;
+	int j;
+
+	crc = ~crc;
+	for (i = 0; i < size; i++) {
+		crc ^= data[i];
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	}
+	return ~crc;
+}
+
+static void
+put_le (unsigned char *p, UInt32 value, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		p[i] = (unsigned char)(value >> (8 * i));
+}
+
+static void
+write_header (Buffer *archive, int type, int flags, const unsigned char *body, size_t body_size)
+{
+	unsigned char header[7 + 64];
+	size_t size = 7 + body_size;
+
+	header[2] = (unsigned char)type;
+	put_le (header + 3, flags, 2);
+	put_le (header + 5, (UInt32)size, 2);
+	if (body_size)
+		memcpy (header + 7, body, body_size);
+	put_le (header, crc32 (0, header + 2, size - 2) & 0xFFFF, 2);
+	buffer_append (archive, header, size);
+}
+
+int
+main (int argc, char **argv)
+{
+	const char *output = argc > 1 ? argv[1] : ".";
+	unsigned char *window;
+	Buffer archive = { 0 };
+	CPpmd7 ppmd;
+	char path[4096];
+	FILE *file;
+	int i;
+
+	window = malloc (N_ENTRIES * ENTRY_SIZE);
+	chain_head = calloc (HASH_SIZE, sizeof (size_t));
+	chain_prev = calloc (N_ENTRIES * ENTRY_SIZE, sizeof (size_t));
+	for (i = 0; i < N_ENTRIES; i++)
+		make_entry (window + i * ENTRY_SIZE, ENTRY_SIZE, window, i * ENTRY_SIZE);
+
+	Ppmd7_Construct (&ppmd);
+	if (!Ppmd7_Alloc (&ppmd, MAX_ALLOC_MB << 20, &alloc))
+		return 1;
+
+	buffer_append (&archive, "Rar!\x1a\x07\x00", 7);
+	/* MHD_SOLID */
+	write_header (&archive, 0x73, 0x0008, (const unsigned char *)"\0\0\0\0\0\0", 6);
+	for (i = 0; i < N_ENTRIES; i++) {
+		const unsigned char *content = window + i * ENTRY_SIZE;
+		unsigned char body[25 + 16];
+		Buffer packed = { 0 };
+		char name[16];
+		size_t name_size;
+
+		encode_entry (&ppmd, &packed, window, i * ENTRY_SIZE, (i + 1) * ENTRY_SIZE);
+
+		name_size = snprintf (name, sizeof (name), "page%d.txt", i + 1);
+		put_le (body, (UInt32)packed.size, 4);
+		put_le (body + 4, ENTRY_SIZE, 4);
+		body[8] = 3;
+		put_le (body + 9, crc32 (0, content, ENTRY_SIZE), 4);
+		put_le (body + 13, (40u << 25) | (10 << 21) | (19 << 16), 4);
+		body[17] = 29;
+		body[18] = 0x33;
+		put_le (body + 19, (UInt32)name_size, 2);
+		put_le (body + 21, 0x20, 4);
+		memcpy (body + 25, name, name_size);
+
+		/* LHD_LONG_BLOCK, LHD_SOLID after the first entry */
+		write_header (&archive, 0x74, 0x8000 | (i > 0 ? 0x0010 : 0), body, 25 + name_size);
+		buffer_append (&archive, packed.data, packed.size);
+		free (packed.data);
+	}
+	write_header (&archive, 0x7B, 0x4000, NULL, 0);
+
+	snprintf (path, sizeof (path), "%s/ppmd.rar", output);
+	file = fopen (path, "wb");
+	if (!file || fwrite (archive.data, 1, archive.size, file) != archive.size) {
+		fprintf (stderr, "Couldn't write %s\n", path);
+		return 1;
+	}
+	fclose (file);
+
+	Ppmd7_Free (&ppmd, &alloc);
+	free (archive.data);
+	free (window);
+	free (chain_head);
+	free (chain_prev);
+
+	return 0;
+}
@@ -0,0 +1,382 @@
+#!/usr/bin/env python3
+#
+# Generates solid.rar and solid.sha1, the RAR fixture of test-ev-archive.
+#
+# rar isn't free software, so the archive is written by a small RAR 2.9
+# (LZ, no PPMd and no filters) encoder instead. The entries share one
+# solid stream and one set of Huffman tables, their content is chosen so
+# that decoding them goes through:
+# - main codes longer than 10 bits, read with the second level tables;
+# - matches of every kind: repeated, old offsets, short and long ones,
+#   including offsets using the low offset code and crossing entries;
+# - single byte runs, overlapping and non overlapping copies.
+#
+# The checksums are the ones of the generated content, not of the output
+# of a decoder.
+#
+# Usage: make-solid-rar.py [output-directory]
+
+import hashlib
+import os
+import random
+import struct
+import sys
+import zlib
+
+MAINCODE_SIZE = 299
+OFFSETCODE_SIZE = 60
+LOWOFFSETCODE_SIZE = 17
+LENGTHCODE_SIZE = 28
+MAX_CODE_LENGTH = 15
+
+LENGTH_BASES = [0, 1, 2, 3, 4, 5, 6, 7, 8, 10, 12, 14, 16, 20,
+                24, 28, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224]
+LENGTH_BITS = [0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2,
+               2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5]
+OFFSET_BASES = [0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192,
+                256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144,
+                8192, 12288, 16384, 24576, 32768, 49152, 65536, 98304,
+                131072, 196608, 262144, 327680, 393216, 458752, 524288,
+                589824, 655360, 720896, 786432, 851968, 917504, 983040,
+                1048576, 1310720, 1572864, 1835008, 2097152, 2359296,
+                2621440, 2883584, 3145728, 3407872, 3670016, 3932160]
+OFFSET_BITS = [0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8,
+               9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15, 16, 16,
+               16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+               18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18]
+SHORT_BASES = [0, 4, 8, 16, 32, 64, 128, 192]
+SHORT_BITS = [2, 2, 3, 4, 5, 6, 6, 6]
+
+MAX_MATCH = 257
+MAX_DISTANCE = 0x3FFFFF
+
+
+def make_entries():
+    rand = random.Random(20201019)
+    words = ('page panel comic strip balloon caption archive solid entry '
+             'window offset length huffman table decoder reader image '
+             'scan cover issue volume chapter').split()
+
+    # Text with repeated phrases, short and long matches
+    lines = []
+    for i in range(400):
+        n = rand.randint(4, 12)
+        lines.append('%04d %s.' % (i, ' '.join(rand.choice(words) for _ in range(n))))
+    text = ('\n'.join(lines) + '\n').encode('ascii')
+
+    # Rare byte values get long codes, runs and short periods get
+    # single byte and overlapping copies, numbered records get the
+    # same match again
+    binary = bytearray()
+    while len(binary) < 12000:
+        kind = rand.random()
+        if kind < 0.3:
+            binary += bytes([rand.randrange(256)]) * rand.randint(4, 300)
+        elif kind < 0.45:
+            period = bytes(rand.randrange(256) for _ in range(rand.randint(2, 7)))
+            binary += period * rand.randint(2, 40)
+        elif kind < 0.55:
+            record = bytes(rand.randrange(256) for _ in range(rand.randint(4, 12)))
+            binary += b''.join(record + bytes([i]) for i in range(rand.randint(3, 20)))
+        elif kind < 0.8:
+            binary += bytes(rand.randrange(256) for _ in range(rand.randint(1, 64)))
+        else:
+            binary += bytes(rand.choice(b'\x00\x01\x02\x7f\x80\xff')
+                            for _ in range(rand.randint(1, 32)))
+    binary = bytes(binary)
+
+    # Pieces of the previous entries, far away in the window
+    quotes = bytearray()
+    while len(quotes) < 10000:
+        source = text if rand.random() < 0.6 else binary
+        start = rand.randrange(len(source) - 300)
+        quotes += source[start:start + rand.randint(3, 300)]
+        quotes += rand.choice(words).encode('ascii')
+    quotes = bytes(quotes)
+
+    return [('text.txt', text), ('binary.dat', binary), ('quotes.txt', quotes)]
+
+
+class Matcher:
+    def __init__(self):
+        self.data = bytearray()
+        self.chains = {}
+
+    def insert(self, pos):
+        if pos + 3 <= len(self.data):
+            key = bytes(self.data[pos:pos + 3])
+            self.chains.setdefault(key, []).append(pos)
+
+    def match_length(self, pos, distance, limit):
+        data = self.data
+        length = 0
+        while length < limit and data[pos + length] == data[pos + length - distance]:
+            length += 1
+        return length
+
+    def find(self, pos, end, old_offsets):
+        limit = min(MAX_MATCH, end - pos)
+        best_length, best_distance = 0, 0
+        for distance in old_offsets:
+            if 0 < distance <= pos:
+                length = self.match_length(pos, distance, limit)
+                if length > best_length:
+                    best_length, best_distance = length, distance
+        if limit >= 3:
+            candidates = self.chains.get(bytes(self.data[pos:pos + 3]), [])
+            for start in reversed(candidates[-64:]):
+                distance = pos - start
+                if distance > MAX_DISTANCE:
+                    break
+                length = self.match_length(pos, distance, limit)
+                if length > best_length:
+                    best_length, best_distance = length, distance
+        if best_length < 2 and limit >= 2:
+            for distance in range(1, min(pos, 256) + 1):
+                if self.data[pos - distance:pos - distance + 2] == self.data[pos:pos + 2]:
+                    return 2, distance
+        return best_length, best_distance
+
+
+class Tokenizer:
+    """Turns the entries into symbols of the four codes, with the
+    state the decoder keeps between matches."""
+
+    def __init__(self):
+        self.matcher = Matcher()
+        self.old_offsets = [0, 0, 0, 0]
+        self.last_offset = 0
+        self.last_length = 0
+
+    def push_offset(self, offset, index=3):
+        del self.old_offsets[index]
+        self.old_offsets.insert(0, offset)
+
+    def match_tokens(self, length, distance):
+        if distance == self.last_offset and length == self.last_length:
+            return [('main', 258)]
+
+        if distance in self.old_offsets and 2 <= length <= 257:
+            index = self.old_offsets.index(distance)
+            self.push_offset(distance, index)
+            code = length - 2
+            slot = max(i for i in range(LENGTHCODE_SIZE) if LENGTH_BASES[i] <= code)
+            return [('main', 259 + index), ('length', slot),
+                    ('bits', code - LENGTH_BASES[slot], LENGTH_BITS[slot])]
+
+        if length == 2:
+            if distance > 256:
+                return None
+            code = distance - 1
+            slot = max(i for i in range(8) if SHORT_BASES[i] <= code)
+            self.push_offset(distance)
+            return [('main', 263 + slot), ('bits', code - SHORT_BASES[slot], SHORT_BITS[slot])]
+
+        code_length = length - (distance >= 0x2000) - (distance >= 0x40000)
+        if code_length < 3:
+            return None
+        code = code_length - 3
+        slot = max(i for i in range(LENGTHCODE_SIZE) if LENGTH_BASES[i] <= code)
+        if code - LENGTH_BASES[slot] >= 1 << LENGTH_BITS[slot]:
+            return None
+        tokens = [('main', 271 + slot), ('bits', code - LENGTH_BASES[slot], LENGTH_BITS[slot])]
+
+        code = distance - 1
+        slot = max(i for i in range(OFFSETCODE_SIZE) if OFFSET_BASES[i] <= code)
+        tokens.append(('offset', slot))
+        extra = code - OFFSET_BASES[slot]
+        if slot > 9:
+            if OFFSET_BITS[slot] > 4:
+                tokens.append(('bits', extra >> 4, OFFSET_BITS[slot] - 4))
+            tokens.append(('lowoffset', extra & 0x0F))
+        elif OFFSET_BITS[slot] > 0:
+            tokens.append(('bits', extra, OFFSET_BITS[slot]))
+        self.push_offset(distance)
+        return tokens
+
+    def tokenize(self, content):
+        matcher = self.matcher
+        start = len(matcher.data)
+        matcher.data += content
+        end = len(matcher.data)
+        tokens = []
+        pos = start
+        while pos < end:
+            length, distance = matcher.find(pos, end, self.old_offsets)
+            match = None
+            while length >= 2 and match is None:
+                match = self.match_tokens(length, distance)
+                if match is None:
+                    length -= 1
+            if match is None:
+                tokens.append(('main', matcher.data[pos]))
+                matcher.insert(pos)
+                pos += 1
+                continue
+            tokens += match
+            self.last_offset, self.last_length = distance, length
+            for i in range(pos, pos + length):
+                matcher.insert(i)
+            pos += length
+        # End of the entry, the next one uses the same tables
+        tokens += [('main', 256), ('bits', 0, 2)]
+        return tokens
+
+
+def code_lengths(frequencies, max_length):
+    """Length limited Huffman code lengths, by package-merge."""
+    symbols = [(f, [s]) for s, f in enumerate(frequencies) if f > 0]
+    lengths = [0] * len(frequencies)
+    if len(symbols) == 1:
+        lengths[symbols[0][1][0]] = 1
+        return lengths
+    symbols.sort(key=lambda item: item[0])
+    packages = list(symbols)
+    for _ in range(max_length - 1):
+        paired = [(packages[i][0] + packages[i + 1][0], packages[i][1] + packages[i + 1][1])
+                  for i in range(0, len(packages) - 1, 2)]
+        packages = sorted(symbols + paired, key=lambda item: item[0])
+    for _, members in packages[:2 * len(symbols) - 2]:
+        for symbol in members:
+            lengths[symbol] += 1
+    return lengths
+
+
+def canonical_codes(lengths):
+    codes = {}
+    code = 0
+    for length in range(1, MAX_CODE_LENGTH + 1):
+        for symbol, symbol_length in enumerate(lengths):
+            if symbol_length == length:
+                codes[symbol] = (code, length)
+                code += 1
+        code <<= 1
+    return codes
+
+
+class BitWriter:
+    def __init__(self):
+        self.bytes = bytearray()
+        self.value = 0
+        self.count = 0
+
+    def write(self, value, count):
+        for i in range(count - 1, -1, -1):
+            self.value = (self.value << 1) | ((value >> i) & 1)
+            self.count += 1
+            if self.count == 8:
+                self.bytes.append(self.value)
+                self.value = 0
+                self.count = 0
+
+    def flush(self):
+        if self.count:
+            self.write(0, 8 - self.count)
+        data = bytes(self.bytes)
+        self.bytes = bytearray()
+        return data
+
+
+def write_tables(writer, lengths):
+    # Run lengths of zeros, the first table starts from scratch
+    precode_symbols = []
+    i = 0
+    while i < len(lengths):
+        if lengths[i] == 0:
+            run = 1
+            while i + run < len(lengths) and lengths[i + run] == 0 and run < 138:
+                run += 1
+            if run >= 11:
+                precode_symbols.append((19, run - 11, 7))
+                i += run
+                continue
+            if run >= 3:
+                precode_symbols.append((18, run - 3, 3))
+                i += run
+                continue
+        precode_symbols.append((lengths[i], 0, 0))
+        i += 1
+
+    frequencies = [0] * 20
+    for symbol, _, _ in precode_symbols:
+        frequencies[symbol] += 1
+    precode_lengths = code_lengths(frequencies, 14)
+    precode = canonical_codes(precode_lengths)
+
+    writer.write(0, 1)  # LZ block
+    writer.write(0, 1)  # new tables
+    for length in precode_lengths:
+        writer.write(length, 4)
+        if length == 15:
+            writer.write(0, 4)
+    for symbol, extra, extra_bits in precode_symbols:
+        writer.write(*precode[symbol])
+        if extra_bits:
+            writer.write(extra, extra_bits)
+
+
+def compress(entries):
+    tokenizer = Tokenizer()
+    streams = [tokenizer.tokenize(content) for _, content in entries]
+
+    sizes = {'main': MAINCODE_SIZE, 'offset': OFFSETCODE_SIZE,
+             'lowoffset': LOWOFFSETCODE_SIZE, 'length': LENGTHCODE_SIZE}
+    frequencies = {name: [0] * size for name, size in sizes.items()}
+    for tokens in streams:
+        for token in tokens:
+            if token[0] != 'bits':
+                frequencies[token[0]][token[1]] += 1
+
+    lengths = {name: code_lengths(frequencies[name], MAX_CODE_LENGTH) for name in sizes}
+    if max(lengths['main']) <= 10:
+        sys.exit('The main code has no code longer than 10 bits')
+    codes = {name: canonical_codes(lengths[name]) for name in sizes}
+
+    packed = []
+    writer = BitWriter()
+    write_tables(writer, lengths['main'] + lengths['offset'] +
+                 lengths['lowoffset'] + lengths['length'])
+    for tokens in streams:
+        for token in tokens:
+            if token[0] == 'bits':
+                if token[2]:
+                    writer.write(token[1], token[2])
+            else:
+                writer.write(*codes[token[0]][token[1]])
+        packed.append(writer.flush())
+    return packed
+
+
+def header(block_type, flags, body):
+    data = struct.pack('<BHH', block_type, flags, 5 + len(body) + 2) + body
+    crc = zlib.crc32(data) & 0xFFFF
+    return struct.pack('<H', crc) + data
+
+
+def main():
+    output = sys.argv[1] if len(sys.argv) > 1 else os.path.dirname(os.path.abspath(__file__))
+    entries = make_entries()
+    packed = compress(entries)
+
+    archive = bytearray(b'Rar!\x1a\x07\x00')
+    # MHD_SOLID
+    archive += header(0x73, 0x0008, b'\x00' * 6)
+    for i, ((name, content), data) in enumerate(zip(entries, packed)):
+        # LHD_LONG_BLOCK, LHD_SOLID after the first entry
+        flags = 0x8000 | (0x0010 if i > 0 else 0)
+        dosdate = (40 << 25) | (10 << 21) | (19 << 16)
+        body = struct.pack('<IIBIIBBHI', len(data), len(content), 3,
+                           zlib.crc32(content), dosdate, 29, 0x33,
+                           len(name), 0x20) + name.encode('ascii')
+        archive += header(0x74, flags, body) + data
+    archive += header(0x7B, 0x4000, b'')
+
+    with open(os.path.join(output, 'solid.rar'), 'wb') as f:
+        f.write(archive)
+    with open(os.path.join(output, 'solid.sha1'), 'w') as f:
+        for name, content in entries:
+            f.write('%s\t%d\t%s\n' % (hashlib.sha1(content).hexdigest(), len(content), name))
+
+
+if __name__ == '__main__':
+    main()
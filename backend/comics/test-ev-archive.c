@@ -19,14 +19,172 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "ev-archive.h"
 
 static void
 usage (const char *prog)
 {
 	g_print ("- Lists file in a supported archive format\n");
-	g_print ("Usage: %s archive-type filename\n", prog);
+	g_print ("Usage: %s archive-type filename [entry|--all|--check checksums]\n", prog);
 	g_print ("Where archive-type is one of rar, zip, 7z or tar\n");
+	g_print ("When entry is given, it is read again after the listing\n");
+	g_print ("With --all, every entry is read in order and the time it took is printed,\n"
+		 "the checksums can be compared with the ones of another build\n");
+	g_print ("With --check, the entries are read in order and then again in reverse\n"
+		 "order, and their checksums compared with the ones in the checksums file\n");
+}
+
+static gboolean
+checksum_entry (EvArchive  *ar,
+		const char *name,
+		gint64     *size,
+		GString    *output)
+{
+	GChecksum *checksum;
+	GError *error = NULL;
+	char buf[10240];
+	gint64 left;
+	gssize read = 0;
+
+	/* RAR entries can't be read past their end */
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+	left = ev_archive_get_entry_size (ar);
+	while (left > 0) {
+		read = ev_archive_read_data (ar, buf, MIN (sizeof (buf), left), &error);
+		if (read <= 0)
+			break;
+		g_checksum_update (checksum, (guchar *) buf, read);
+		left -= read;
+	}
+	if (read < 0) {
+		g_warning ("Failed to read '%s': %s", name, error->message);
+		g_error_free (error);
+		g_checksum_free (checksum);
+		return FALSE;
+	}
+
+	*size = ev_archive_get_entry_size (ar) - left;
+	g_print ("%s\t%"G_GINT64_FORMAT"\t%s\n",
+		 g_checksum_get_string (checksum), *size, name);
+	if (output)
+		g_string_append_printf (output, "%s\t%"G_GINT64_FORMAT"\t%s\n",
+					g_checksum_get_string (checksum), *size, name);
+	g_checksum_free (checksum);
+
+	return TRUE;
+}
+
+static gboolean
+read_entry (EvArchive  *ar,
+	    const char *name,
+	    GString    *output)
+{
+	GError *error = NULL;
+	gint64 size;
+
+	if (!ev_archive_seek_entry (ar, name, &error)) {
+		g_warning ("Failed to seek to '%s': %s", name, error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	return checksum_entry (ar, name, &size, output);
+}
+
+/* Decompresses the whole archive, RAR checksums are verified by unarr */
+static gboolean
+read_all_entries (EvArchive  *ar,
+		  const char *filename,
+		  GString    *output)
+{
+	GError *error = NULL;
+	gint64 start, total = 0;
+	gdouble elapsed;
+	guint n_entries = 0;
+
+	if (!ev_archive_open_filename (ar, filename, &error)) {
+		g_warning ("Failed to open '%s': %s", filename, error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	start = g_get_monotonic_time ();
+
+	while (ev_archive_read_next_header (ar, &error)) {
+		gint64 size;
+
+		if (!checksum_entry (ar, ev_archive_get_entry_pathname (ar), &size, output))
+			return FALSE;
+		total += size;
+		n_entries++;
+	}
+	if (error) {
+		g_warning ("Fatal error handling archive: %s", error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+	g_print ("Read %u entries, %"G_GINT64_FORMAT" bytes in %.3f s (%.1f MB/s)\n",
+		 n_entries, total, elapsed,
+		 elapsed > 0 ? total / elapsed / (1024 * 1024) : 0);
+
+	ev_archive_reset (ar);
+
+	return TRUE;
+}
+
+/* The checksums file has the lines printed for every entry, in order */
+static gboolean
+check_entries (EvArchive  *ar,
+	       const char *filename,
+	       const char *checksums)
+{
+	GError *error = NULL;
+	GString *output;
+	gchar *expected;
+	gchar **lines;
+	gint i;
+	gboolean retval;
+
+	if (!g_file_get_contents (checksums, &expected, NULL, &error)) {
+		g_warning ("Failed to read '%s': %s", checksums, error->message);
+		g_error_free (error);
+		return FALSE;
+	}
+
+	output = g_string_new (NULL);
+	retval = read_all_entries (ar, filename, output);
+	if (retval && g_strcmp0 (output->str, expected) != 0) {
+		g_warning ("Entries read in order don't match '%s'", checksums);
+		retval = FALSE;
+	}
+
+	/* Seeking back goes through the earlier entries of solid archives */
+	lines = g_strsplit (expected, "\n", -1);
+	for (i = g_strv_length (lines) - 1; retval && i >= 0; i--) {
+		const char *name;
+
+		name = strrchr (lines[i], '\t');
+		if (!name)
+			continue;
+
+		g_string_truncate (output, 0);
+		if (!read_entry (ar, name + 1, output)) {
+			retval = FALSE;
+		} else if (g_strcmp0 (g_strchomp (output->str), lines[i]) != 0) {
+			g_warning ("Entry '%s' doesn't match '%s'", name + 1, checksums);
+			retval = FALSE;
+		}
+	}
+
+	g_strfreev (lines);
+	g_string_free (output, TRUE);
+	g_free (expected);
+
+	return retval;
 }
 
 static EvArchiveType
@@ -55,7 +213,8 @@ main (int argc, char **argv)
 	GError *error = NULL;
 	gboolean printed_header = FALSE;
 
-	if (argc != 3) {
+	if (argc != 3 && argc != 4 &&
+	    (argc != 5 || g_strcmp0 (argv[3], "--check") != 0)) {
 		usage (argv[0]);
 		return 1;
 	}
@@ -106,6 +265,17 @@ main (int argc, char **argv)
 	}
 
 	ev_archive_reset (ar);
+
+	if (argc == 5) {
+		if (!check_entries (ar, argv[2], argv[4]))
+			goto out;
+	} else if (argc == 4 && g_strcmp0 (argv[3], "--all") == 0) {
+		if (!read_all_entries (ar, argv[2], NULL))
+			goto out;
+	} else if (argc == 4 && !read_entry (ar, argv[3], NULL)) {
+		goto out;
+	}
+
 	g_clear_object (&ar);
 
 	return 0;
@@ -25,6 +25,14 @@
 
 #include <libdjvu/ddjvuapi.h>
 
+/* A handle of the pool used to decode pages,
+ * see djvu_document_acquire ().
+ */
+typedef struct {
+	DjvuDocument     *document;
+	GThread          *thread;
+} DjvuPooledDocument;
+
 struct _DjvuDocument {
 	EvDocument        parent_instance;
 
@@ -41,6 +49,22 @@ struct _DjvuDocument {
 	ddjvu_fileinfo_t *fileinfo_pages;
 	gint		  n_pages;
 	GHashTable	 *file_ids;
+
+	/* Decoded pages, most recently used first */
+	GQueue		 *pages;
+	gsize		  pages_n_pixels;
+
+	/* Text of the pages, most recently used first */
+	GQueue		 *text_pages;
+	gsize		  text_pages_size;
+
+	/* Pool of handles with their own ddjvu context */
+	GMutex		  pool_mutex;
+	GCond		  pool_cond;
+	DjvuPooledDocument primary;
+	GSList		 *idle_documents;
+	guint		  n_pooled_documents;
+	gboolean	  pool_disabled;
 };
 
 int  djvu_document_get_n_pages (EvDocument   *document);
@@ -145,6 +145,60 @@ djvu_wait_for_message (DjvuDocument *djvu_document, ddjvu_message_tag_t message,
 		ddjvu_message_pop (ctx);
 }
 
+/* Handle pool
+ *
+ * Decoding a page takes most of the time of rendering it, and a ddjvu
+ * document decodes one page at a time on its context. Rendering,
+ * thumbnails, selections, text, find and links take a handle from a
+ * pool instead, so that several threads can decode pages at the same
+ * time. The pool only holds independent documents opened from the same
+ * file with their own context, up to ev_document_get_max_render_threads ().
+ * The loaded document stays out of it, since page sizes, labels, the
+ * outline, links and printing use it directly; it's only pooled when no
+ * other document can be opened. Handles remember the last thread that
+ * used them and threads take their own handle first, so every worker
+ * keeps its decoded pages. The caches of decoded pages are shared out
+ * between the handles, so the pool doesn't use more memory than a
+ * single document.
+ */
+static void
+djvu_pooled_document_free (DjvuPooledDocument *pooled)
+{
+	g_object_unref (pooled->document);
+	g_free (pooled);
+}
+
+static void
+djvu_document_pool_clear (DjvuDocument *djvu_document)
+{
+	GSList *l;
+
+	g_mutex_lock (&djvu_document->pool_mutex);
+	for (l = djvu_document->idle_documents; l; l = l->next) {
+		DjvuPooledDocument *pooled = l->data;
+
+		if (pooled != &djvu_document->primary)
+			djvu_pooled_document_free (pooled);
+	}
+	g_clear_pointer (&djvu_document->idle_documents, g_slist_free);
+	djvu_document->primary.document = NULL;
+	djvu_document->n_pooled_documents = 0;
+	g_mutex_unlock (&djvu_document->pool_mutex);
+}
+
+static void
+djvu_document_pool_init (DjvuDocument *djvu_document)
+{
+	djvu_document_pool_clear (djvu_document);
+
+	g_mutex_lock (&djvu_document->pool_mutex);
+	djvu_document->primary.document = djvu_document;
+	djvu_document->primary.thread = NULL;
+	djvu_document->n_pooled_documents = 0;
+	djvu_document->pool_disabled = FALSE;
+	g_mutex_unlock (&djvu_document->pool_mutex);
+}
+
 static gboolean
 djvu_document_load (EvDocument  *document,
 		    const char  *uri,
@@ -269,10 +323,110 @@ djvu_document_load (EvDocument  *document,
 		return FALSE;
 	}
 
+	djvu_document_pool_init (djvu_document);
+
 	return TRUE;
 }
 
 
+/* Every clone has its own ddjvu context, so it decodes independently */
+static EvDocument *
+djvu_document_clone (EvDocument *document)
+{
+	DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
+	EvDocument   *clone;
+
+	clone = EV_DOCUMENT (g_object_new (DJVU_TYPE_DOCUMENT, NULL));
+	if (!djvu_document_load (clone, djvu_document->uri, NULL)) {
+		g_object_unref (clone);
+		return NULL;
+	}
+
+	return clone;
+}
+
+static DjvuPooledDocument *
+djvu_document_pool_open (DjvuDocument *djvu_document)
+{
+	DjvuPooledDocument *pooled;
+	EvDocument *document;
+
+	document = djvu_document_clone (EV_DOCUMENT (djvu_document));
+	if (!document)
+		return NULL;
+
+	pooled = g_new0 (DjvuPooledDocument, 1);
+	pooled->document = DJVU_DOCUMENT (document);
+
+	return pooled;
+}
+
+/* Returns a handle that no other thread uses until it's given back
+ * with djvu_document_release ().
+ */
+static DjvuPooledDocument *
+djvu_document_acquire (DjvuDocument *djvu_document)
+{
+	DjvuPooledDocument *pooled = NULL;
+	GThread *self = g_thread_self ();
+
+	g_mutex_lock (&djvu_document->pool_mutex);
+	while (!pooled) {
+		GSList *l;
+
+		for (l = djvu_document->idle_documents; l; l = l->next) {
+			DjvuPooledDocument *idle = l->data;
+
+			if (!pooled || idle->thread == self)
+				pooled = idle;
+			if (idle->thread == self)
+				break;
+		}
+
+		if (pooled) {
+			djvu_document->idle_documents = g_slist_remove (djvu_document->idle_documents, pooled);
+			break;
+		}
+
+		if (!djvu_document->pool_disabled &&
+		    djvu_document->n_pooled_documents < ev_document_get_max_render_threads ()) {
+			/* Open without holding the lock, it can take a while */
+			djvu_document->n_pooled_documents++;
+			g_mutex_unlock (&djvu_document->pool_mutex);
+			pooled = djvu_document_pool_open (djvu_document);
+			g_mutex_lock (&djvu_document->pool_mutex);
+
+			if (!pooled) {
+				djvu_document->n_pooled_documents--;
+				djvu_document->pool_disabled = TRUE;
+			}
+			continue;
+		}
+
+		if (djvu_document->n_pooled_documents == 0) {
+			pooled = &djvu_document->primary;
+			djvu_document->n_pooled_documents = 1;
+			break;
+		}
+
+		g_cond_wait (&djvu_document->pool_cond, &djvu_document->pool_mutex);
+	}
+	g_mutex_unlock (&djvu_document->pool_mutex);
+
+	return pooled;
+}
+
+static void
+djvu_document_release (DjvuDocument       *djvu_document,
+		       DjvuPooledDocument *pooled)
+{
+	g_mutex_lock (&djvu_document->pool_mutex);
+	pooled->thread = g_thread_self ();
+	djvu_document->idle_documents = g_slist_prepend (djvu_document->idle_documents, pooled);
+	g_cond_signal (&djvu_document->pool_cond);
+	g_mutex_unlock (&djvu_document->pool_mutex);
+}
+
 static gboolean
 djvu_document_save (EvDocument  *document,
 		    const char  *uri,
@@ -331,26 +485,178 @@ djvu_document_get_page_size (EvDocument   *document,
 				width, height, NULL);
 }
 
+/* Pixels of the decoded pages kept around by all the handles of the
+ * pool, about three pages of a 600 dpi scan. The most recently used
+ * page of every handle is always kept.
+ */
+#define PAGES_CACHE_MAX_PIXELS (100 * 1000 * 1000)
+
+typedef struct {
+	gint          index;
+	ddjvu_page_t *d_page;
+	gsize         n_pixels;
+} DjvuCachedPage;
+
+static void
+djvu_cached_page_free (DjvuCachedPage *cached_page)
+{
+	ddjvu_page_release (cached_page->d_page);
+	g_free (cached_page);
+}
+
+/* Returns page @index decoded, owned by @djvu_document. Decoding a page
+ * is much more expensive than rendering it, so the last pages are kept
+ * for rendering them again at another scale or rotation.
+ */
+static ddjvu_page_t *
+djvu_document_get_d_page (DjvuDocument *djvu_document,
+			  gint          index)
+{
+	DjvuCachedPage *cached_page;
+	ddjvu_page_t *d_page;
+	GList *l;
+
+	for (l = djvu_document->pages->head; l; l = l->next) {
+		cached_page = l->data;
+		if (cached_page->index != index)
+			continue;
+
+		g_queue_unlink (djvu_document->pages, l);
+		g_queue_push_head_link (djvu_document->pages, l);
+
+		return cached_page->d_page;
+	}
+
+	d_page = ddjvu_page_create_by_pageno (djvu_document->d_document, index);
+	if (!d_page)
+		return NULL;
+
+	while (!ddjvu_page_decoding_done (d_page))
+		djvu_handle_events(djvu_document, TRUE, NULL);
+
+	cached_page = g_new (DjvuCachedPage, 1);
+	cached_page->index = index;
+	cached_page->d_page = d_page;
+	cached_page->n_pixels = (gsize) ddjvu_page_get_width (d_page) * ddjvu_page_get_height (d_page);
+	g_queue_push_head (djvu_document->pages, cached_page);
+	djvu_document->pages_n_pixels += cached_page->n_pixels;
+
+	while (djvu_document->pages_n_pixels > PAGES_CACHE_MAX_PIXELS / ev_document_get_max_render_threads () &&
+	       g_queue_get_length (djvu_document->pages) > 1) {
+		cached_page = g_queue_pop_tail (djvu_document->pages);
+		djvu_document->pages_n_pixels -= cached_page->n_pixels;
+		djvu_cached_page_free (cached_page);
+	}
+
+	return d_page;
+}
+
+/* Memory used by the text of the pages kept around by all the handles
+ * of the pool, enough for the hidden text layer of a few hundred
+ * scanned pages.
+ */
+#define TEXT_PAGES_CACHE_MAX_SIZE (32 * 1024 * 1024)
+
+typedef struct {
+	gint          index;
+	DjvuTextPage *page;
+	gsize         size;
+} DjvuCachedTextPage;
+
+static void
+djvu_cached_text_page_free (DjvuCachedTextPage *cached_page)
+{
+	if (cached_page->page)
+		djvu_text_page_free (cached_page->page);
+	g_free (cached_page);
+}
+
+/* Accounts for the memory used by the most recently used page, which
+ * grows when it's first searched ignoring case, and drops the least
+ * recently used pages beyond the limit.
+ */
+static void
+djvu_document_trim_text_pages (DjvuDocument *djvu_document)
+{
+	DjvuCachedTextPage *cached_page;
+	gsize size;
+
+	cached_page = g_queue_peek_head (djvu_document->text_pages);
+	if (!cached_page)
+		return;
+
+	size = sizeof (DjvuCachedTextPage);
+	if (cached_page->page)
+		size += djvu_text_page_get_size (cached_page->page);
+	djvu_document->text_pages_size += size - cached_page->size;
+	cached_page->size = size;
+
+	while (djvu_document->text_pages_size > TEXT_PAGES_CACHE_MAX_SIZE / ev_document_get_max_render_threads () &&
+	       g_queue_get_length (djvu_document->text_pages) > 1) {
+		cached_page = g_queue_pop_tail (djvu_document->text_pages);
+		djvu_document->text_pages_size -= cached_page->size;
+		djvu_cached_text_page_free (cached_page);
+	}
+}
+
+/* Returns the text of page @index, owned by @djvu_document, or %NULL if
+ * the page has no text. Parsing the hidden text layer of a page is
+ * expensive, so find, selection and text queries share the last pages.
+ */
+static DjvuTextPage *
+djvu_document_get_text_page (DjvuDocument *djvu_document,
+			     gint          index)
+{
+	DjvuCachedTextPage *cached_page;
+	miniexp_t page_text;
+	GList *l;
+
+	for (l = djvu_document->text_pages->head; l; l = l->next) {
+		cached_page = l->data;
+		if (cached_page->index != index)
+			continue;
+
+		g_queue_unlink (djvu_document->text_pages, l);
+		g_queue_push_head_link (djvu_document->text_pages, l);
+
+		return cached_page->page;
+	}
+
+	while ((page_text = ddjvu_document_get_pagetext (djvu_document->d_document,
+							 index, "char")) == miniexp_dummy)
+		djvu_handle_events (djvu_document, TRUE, NULL);
+
+	cached_page = g_new0 (DjvuCachedTextPage, 1);
+	cached_page->index = index;
+	if (page_text != miniexp_nil) {
+		cached_page->page = djvu_text_page_new (page_text);
+		ddjvu_miniexp_release (djvu_document->d_document, page_text);
+	}
+	g_queue_push_head (djvu_document->text_pages, cached_page);
+	djvu_document_trim_text_pages (djvu_document);
+
+	return cached_page->page;
+}
+
 static cairo_surface_t *
-djvu_document_render (EvDocument      *document, 
-		      EvRenderContext *rc)
+djvu_page_render (DjvuDocument    *djvu_document,
+		  EvRenderContext *rc)
 {
-	DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
 	cairo_surface_t *surface;
 	gchar *pixels;
 	gint   rowstride;
     	ddjvu_rect_t rrect;
 	ddjvu_rect_t prect;
+	cairo_rectangle_int_t region, bounds, area;
 	ddjvu_page_t *d_page;
 	ddjvu_page_rotation_t rotation;
 	gint buffer_modified;
 	double page_width, page_height;
 	gint transformed_width, transformed_height;
 
-	d_page = ddjvu_page_create_by_pageno (djvu_document->d_document, rc->page->index);
-	
-	while (!ddjvu_page_decoding_done (d_page))
-		djvu_handle_events(djvu_document, TRUE, NULL);
+	d_page = djvu_document_get_d_page (djvu_document, rc->page->index);
+	if (!d_page)
+		return NULL;
 
 	document_get_page_size (djvu_document, rc->page->index, &page_width, &page_height, NULL);
 	rotation = ddjvu_page_get_initial_rotation (d_page);
@@ -380,8 +686,17 @@ djvu_document_render (EvDocument      *document,
 	}
 	rotation = rotation % 4;
 
+	if (rc->has_region) {
+		region = rc->region;
+	} else {
+		region.x = 0;
+		region.y = 0;
+		region.width = transformed_width;
+		region.height = transformed_height;
+	}
+
 	surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24,
-					      transformed_width, transformed_height);
+					      region.width, region.height);
 
 	rowstride = cairo_image_surface_get_stride (surface);
 	pixels = (gchar *)cairo_image_surface_get_data (surface);
@@ -390,16 +705,41 @@ djvu_document_render (EvDocument      *document,
 	prect.y = 0;
 	prect.w = transformed_width;
 	prect.h = transformed_height;
-	rrect = prect;
 
-	ddjvu_page_set_rotation (d_page, rotation);
-	
-	buffer_modified = ddjvu_page_render (d_page, DDJVU_RENDER_COLOR,
-					     &prect,
-					     &rrect,
-					     djvu_document->d_format,
-					     rowstride,
-					     pixels);
+	/* Only the part of the region within the page is rendered, at its
+	 * place in the surface.
+	 */
+	bounds.x = 0;
+	bounds.y = 0;
+	bounds.width = transformed_width;
+	bounds.height = transformed_height;
+	buffer_modified = FALSE;
+	if (gdk_rectangle_intersect (&region, &bounds, &area)) {
+		if (area.width != region.width || area.height != region.height) {
+			cairo_t *cr = cairo_create (surface);
+
+			cairo_set_source_rgb (cr, 1.0, 1.0, 1.0);
+			cairo_paint (cr);
+			cairo_destroy (cr);
+			cairo_surface_flush (surface);
+		}
+
+		/* djvulibre counts y from the bottom of the page */
+		rrect.x = area.x;
+		rrect.y = transformed_height - area.y - area.height;
+		rrect.w = area.width;
+		rrect.h = area.height;
+
+		ddjvu_page_set_rotation (d_page, rotation);
+
+		buffer_modified = ddjvu_page_render (d_page, DDJVU_RENDER_COLOR,
+						     &prect,
+						     &rrect,
+						     djvu_document->d_format,
+						     rowstride,
+						     pixels + (area.y - region.y) * rowstride +
+						     (area.x - region.x) * 4);
+	}
 
 	if (!buffer_modified) {
 		cairo_t *cr = cairo_create (surface);
@@ -414,6 +754,27 @@ djvu_document_render (EvDocument      *document,
 	return surface;
 }
 
+static cairo_surface_t *
+djvu_document_render (EvDocument      *document,
+		      EvRenderContext *rc)
+{
+	DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
+	DjvuPooledDocument *pooled;
+	cairo_surface_t *surface;
+
+	pooled = djvu_document_acquire (djvu_document);
+	surface = djvu_page_render (pooled->document, rc);
+	djvu_document_release (djvu_document, pooled);
+
+	return surface;
+}
+
+static gboolean
+djvu_document_can_render_regions (EvDocument *document)
+{
+	return TRUE;
+}
+
 static char *
 djvu_document_get_page_label (EvDocument *document,
                               EvPage     *page)
@@ -436,16 +797,13 @@ djvu_document_get_page_label (EvDocument *document,
 }
 
 static GdkPixbuf *
-djvu_document_get_thumbnail (EvDocument      *document,
-			     EvRenderContext *rc)
+djvu_page_get_thumbnail (DjvuDocument    *djvu_document,
+			 EvRenderContext *rc)
 {
-	DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
 	GdkPixbuf *pixbuf, *rotated_pixbuf;
 	gdouble page_width, page_height;
 	gint thumb_width, thumb_height;
 	guchar *pixels;
-	
-	g_return_val_if_fail (djvu_document->d_document, NULL);
 
 	djvu_document_get_page_size (EV_DOCUMENT(djvu_document), rc->page,
 				     &page_width, &page_height);
@@ -473,19 +831,33 @@ djvu_document_get_thumbnail (EvDocument      *document,
 	return rotated_pixbuf;
 }
 
-static cairo_surface_t *
-djvu_document_get_thumbnail_surface (EvDocument      *document,
-				     EvRenderContext *rc)
+static GdkPixbuf *
+djvu_document_get_thumbnail (EvDocument      *document,
+			     EvRenderContext *rc)
 {
 	DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
+	DjvuPooledDocument *pooled;
+	GdkPixbuf *pixbuf;
+
+	g_return_val_if_fail (djvu_document->d_document, NULL);
+
+	pooled = djvu_document_acquire (djvu_document);
+	pixbuf = djvu_page_get_thumbnail (pooled->document, rc);
+	djvu_document_release (djvu_document, pooled);
+
+	return pixbuf;
+}
+
+static cairo_surface_t *
+djvu_page_get_thumbnail_surface (DjvuDocument    *djvu_document,
+				 EvRenderContext *rc)
+{
 	cairo_surface_t *surface, *rotated_surface;
 	gdouble page_width, page_height;
 	gint thumb_width, thumb_height;
 	gchar *pixels;
 	gint thumbnail_rendered;
 
-	g_return_val_if_fail (djvu_document->d_document, NULL);
-
 	djvu_document_get_page_size (EV_DOCUMENT(djvu_document), rc->page,
 				     &page_width, &page_height);
 
@@ -508,7 +880,7 @@ djvu_document_get_thumbnail_surface (EvDocument      *document,
 
 	if (!thumbnail_rendered) {
 		cairo_surface_destroy (surface);
-		surface = djvu_document_render (document, rc);
+		surface = djvu_page_render (djvu_document, rc);
 	} else {
 		cairo_surface_mark_dirty (surface);
 		rotated_surface = ev_document_misc_surface_rotate_and_scale (surface,
@@ -522,11 +894,35 @@ djvu_document_get_thumbnail_surface (EvDocument      *document,
 	return surface;
 }
 
+static cairo_surface_t *
+djvu_document_get_thumbnail_surface (EvDocument      *document,
+				     EvRenderContext *rc)
+{
+	DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
+	DjvuPooledDocument *pooled;
+	cairo_surface_t *surface;
+
+	g_return_val_if_fail (djvu_document->d_document, NULL);
+
+	pooled = djvu_document_acquire (djvu_document);
+	surface = djvu_page_get_thumbnail_surface (pooled->document, rc);
+	djvu_document_release (djvu_document, pooled);
+
+	return surface;
+}
+
 static void
 djvu_document_finalize (GObject *object)
 {
 	DjvuDocument *djvu_document = DJVU_DOCUMENT (object);
 
+	djvu_document_pool_clear (djvu_document);
+	g_mutex_clear (&djvu_document->pool_mutex);
+	g_cond_clear (&djvu_document->pool_cond);
+
+	g_queue_free_full (djvu_document->pages, (GDestroyNotify) djvu_cached_page_free);
+	g_queue_free_full (djvu_document->text_pages, (GDestroyNotify) djvu_cached_text_page_free);
+
 	if (djvu_document->d_document)
 	    ddjvu_document_release (djvu_document->d_document);
 	    
@@ -566,6 +962,8 @@ djvu_document_class_init (DjvuDocumentClass *klass)
 	ev_document_class->render = djvu_document_render;
 	ev_document_class->get_thumbnail = djvu_document_get_thumbnail;
 	ev_document_class->get_thumbnail_surface = djvu_document_get_thumbnail_surface;
+	ev_document_class->clone = djvu_document_clone;
+	ev_document_class->can_render_regions = djvu_document_can_render_regions;
 }
 
 static gchar *
@@ -573,23 +971,13 @@ djvu_text_copy (DjvuDocument *djvu_document,
 		gint           page_num,
 		EvRectangle  *rectangle)
 {
-	miniexp_t page_text;
-	gchar    *text = NULL;
+	DjvuTextPage *page;
 
-	while ((page_text =
-		ddjvu_document_get_pagetext (djvu_document->d_document,
-					     page_num, "char")) == miniexp_dummy)
-		djvu_handle_events (djvu_document, TRUE, NULL);
-
-	if (page_text != miniexp_nil) {
-		DjvuTextPage *page = djvu_text_page_new (page_text);
-		
-		text = djvu_text_page_copy (page, rectangle);
-		djvu_text_page_free (page);
-		ddjvu_miniexp_release (djvu_document->d_document, page_text);
-	}
+	page = djvu_document_get_text_page (djvu_document, page_num);
+	if (!page)
+		return NULL;
 
-	return text;
+	return djvu_text_page_copy (page, rectangle);
 }
 
 static void
@@ -611,25 +999,16 @@ djvu_selection_get_selection_rects (DjvuDocument    *djvu_document,
 				    gdouble          height,
 				    gdouble          dpi)
 {
-	miniexp_t   page_text;
-	EvRectangle rectangle;
-	GList      *rects = NULL;
+	DjvuTextPage *tpage;
+	EvRectangle   rectangle;
 
 	djvu_convert_to_doc_rect (&rectangle, points, height, dpi);
 
-	while ((page_text = ddjvu_document_get_pagetext (djvu_document->d_document,
-							 page, "char")) == miniexp_dummy)
-		djvu_handle_events (djvu_document, TRUE, NULL);
-
-	if (page_text != miniexp_nil) {
-		DjvuTextPage *tpage = djvu_text_page_new (page_text);
-
-		rects = djvu_text_page_get_selection_region (tpage, &rectangle);
-		djvu_text_page_free (tpage);
-		ddjvu_miniexp_release (djvu_document->d_document, page_text);
-	}
+	tpage = djvu_document_get_text_page (djvu_document, page);
+	if (!tpage)
+		return NULL;
 
-	return rects;
+	return djvu_text_page_get_selection_region (tpage, &rectangle);
 }
 
 static cairo_region_t *
@@ -677,14 +1056,20 @@ djvu_selection_get_selection_region (EvSelection    *selection,
 				     EvRectangle     *points)
 {
 	DjvuDocument *djvu_document = DJVU_DOCUMENT (selection);
+	DjvuPooledDocument *pooled;
+	cairo_region_t *region;
 	gdouble page_width, page_height;
 	gdouble scale_x, scale_y;
 
-	document_get_page_size (djvu_document, rc->page->index, &page_width, &page_height, NULL);
+	pooled = djvu_document_acquire (djvu_document);
+	document_get_page_size (pooled->document, rc->page->index, &page_width, &page_height, NULL);
 	ev_render_context_compute_scales (rc, page_width, page_height, &scale_x, &scale_y);
 
-	return djvu_get_selection_region (djvu_document, rc->page->index,
-					  scale_x, scale_y, points);
+	region = djvu_get_selection_region (pooled->document, rc->page->index,
+					    scale_x, scale_y, points);
+	djvu_document_release (djvu_document, pooled);
+
+	return region;
 }
 
 static gchar *
@@ -694,13 +1079,16 @@ djvu_selection_get_selected_text (EvSelection     *selection,
 				  EvRectangle     *points)
 {
       	DjvuDocument *djvu_document = DJVU_DOCUMENT (selection);
+	DjvuPooledDocument *pooled;
 	double height, dpi;
       	EvRectangle rectangle;
       	gchar *text;
 
-	document_get_page_size (djvu_document, page->index, NULL, &height, &dpi);
+	pooled = djvu_document_acquire (djvu_document);
+	document_get_page_size (pooled->document, page->index, NULL, &height, &dpi);
 	djvu_convert_to_doc_rect (&rectangle, points, height, dpi);
-      	text = djvu_text_copy (djvu_document, page->index, &rectangle);
+      	text = djvu_text_copy (pooled->document, page->index, &rectangle);
+	djvu_document_release (djvu_document, pooled);
       
       	if (text == NULL)
 		text = g_strdup ("");
@@ -720,16 +1108,22 @@ djvu_document_text_get_text_mapping (EvDocumentText *document_text,
 				     EvPage         *page)
 {
 	DjvuDocument *djvu_document = DJVU_DOCUMENT (document_text);
+	DjvuPooledDocument *pooled;
+	cairo_region_t *region;
 	EvRectangle points;
 
 	points.x1 = 0;
 	points.y1 = 0;
 
-	document_get_page_size (djvu_document, page->index,
+	pooled = djvu_document_acquire (djvu_document);
+	document_get_page_size (pooled->document, page->index,
 				&points.x2, &points.y2, NULL);
 
-	return djvu_get_selection_region (djvu_document, page->index,
-					  1.0, 1.0, &points);
+	region = djvu_get_selection_region (pooled->document, page->index,
+					    1.0, 1.0, &points);
+	djvu_document_release (djvu_document, pooled);
+
+	return region;
 }
 
 static gchar *
@@ -737,23 +1131,16 @@ djvu_document_text_get_text (EvDocumentText  *selection,
                              EvPage          *page)
 {
 	DjvuDocument *djvu_document = DJVU_DOCUMENT (selection);
-	miniexp_t     page_text;
-	gchar        *text = NULL;
+	DjvuPooledDocument *pooled;
+	DjvuTextPage *tpage;
+	gchar *text = NULL;
 
-	while ((page_text = ddjvu_document_get_pagetext (djvu_document->d_document,
-							 page->index,
-							 "char")) == miniexp_dummy)
-		djvu_handle_events (djvu_document, TRUE, NULL);
+	pooled = djvu_document_acquire (djvu_document);
+	tpage = djvu_document_get_text_page (pooled->document, page->index);
+	if (tpage)
+		text = g_strdup (djvu_text_page_get_text (tpage));
+	djvu_document_release (djvu_document, pooled);
 
-	if (page_text != miniexp_nil) {
-		DjvuTextPage *tpage = djvu_text_page_new (page_text);
-
-		djvu_text_page_index_text (tpage, TRUE);
-		text = tpage->text;
-		tpage->text = NULL;
-		djvu_text_page_free (tpage);
-		ddjvu_miniexp_release (djvu_document->d_document, page_text);
-	}
 	return text;
 }
 
@@ -847,6 +1234,11 @@ djvu_document_init (DjvuDocument *djvu_document)
 	djvu_document->opts = g_string_new ("");
 	
 	djvu_document->d_document = NULL;
+	djvu_document->pages = g_queue_new ();
+	djvu_document->text_pages = g_queue_new ();
+
+	g_mutex_init (&djvu_document->pool_mutex);
+	g_cond_init (&djvu_document->pool_cond);
 }
 
 static GList *
@@ -856,39 +1248,26 @@ djvu_document_find_find_text (EvDocumentFind   *document,
 			      gboolean          case_sensitive)
 {
         DjvuDocument *djvu_document = DJVU_DOCUMENT (document);
-	miniexp_t page_text;
+	DjvuPooledDocument *pooled;
+	DjvuTextPage *tpage;
 	gdouble width, height, dpi;
 	GList *matches = NULL, *l;
-	char *search_text = NULL;
 
 	g_return_val_if_fail (text != NULL, NULL);
 
-	while ((page_text = ddjvu_document_get_pagetext (djvu_document->d_document,
-							 page->index,
-							 "char")) == miniexp_dummy)
-		djvu_handle_events (djvu_document, TRUE, NULL);
-
-	if (page_text != miniexp_nil) {
-		DjvuTextPage *tpage = djvu_text_page_new (page_text);
-		
-		djvu_text_page_index_text (tpage, case_sensitive);
-		if (tpage->links->len > 0) {
-			if (!case_sensitive) {
-				search_text = g_utf8_casefold (text, -1);
-				djvu_text_page_search (tpage, search_text);
-				g_free (search_text);
-			} else {
-				djvu_text_page_search (tpage, text);
-			}
-			matches = tpage->results;
-		}
-		djvu_text_page_free (tpage);
-		ddjvu_miniexp_release (djvu_document->d_document, page_text);
+	pooled = djvu_document_acquire (djvu_document);
+	tpage = djvu_document_get_text_page (pooled->document, page->index);
+	if (tpage) {
+		matches = djvu_text_page_search (tpage, text, case_sensitive);
+		djvu_document_trim_text_pages (pooled->document);
 	}
+	if (matches)
+		document_get_page_size (pooled->document, page->index, &width, &height, &dpi);
+	djvu_document_release (djvu_document, pooled);
+
 	if (!matches)
 		return NULL;
 
-	document_get_page_size (djvu_document, page->index, &width, &height, &dpi);
 	for (l = matches; l && l->data; l = g_list_next (l)) {
 		EvRectangle *r = (EvRectangle *)l->data;
 		gdouble tmp = r->y1;
@@ -921,10 +1300,17 @@ static EvMappingList *
 djvu_document_links_get_links (EvDocumentLinks *document_links,
 			       EvPage          *page)
 {
+	DjvuDocument *djvu_document = DJVU_DOCUMENT (document_links);
+	DjvuPooledDocument *pooled;
+	EvMappingList *links;
 	gdouble dpi;
 
-	document_get_page_size (DJVU_DOCUMENT (document_links), page->index, NULL, NULL, &dpi);
-	return djvu_links_get_links (document_links, page->index, 72.0 / dpi);
+	pooled = djvu_document_acquire (djvu_document);
+	document_get_page_size (pooled->document, page->index, NULL, NULL, &dpi);
+	links = djvu_links_get_links (EV_DOCUMENT_LINKS (pooled->document), page->index, 72.0 / dpi);
+	djvu_document_release (djvu_document, pooled);
+
+	return links;
 }
 
 static void
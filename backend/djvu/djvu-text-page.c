@@ -47,455 +47,334 @@ djvu_text_page_union (EvRectangle *target,
 }
 
 /**
- * djvu_text_page_selection_process_box:
+ * djvu_text_page_limits:
  * @page: #DjvuTextPage instance
- * @p: s-expression to append bounding box of
- * @delimit: character/word/... delimiter
+ * @rect: #EvRectangle of the selection
+ * @start: (out): first token in the selection
+ * @end: (out): last token in the selection
  *
- * Appends bounding box of the line containing miniexp_t to page->results
+ * Finds the first and the last tokens with text within @rect.
  *
- * Returns: whether the end was not reached in this s-expression
+ * Returns: whether there is any token with text within @rect
  */
 static gboolean
-djvu_text_page_selection_process_box (DjvuTextPage *page,
-				      miniexp_t     p,
-				      int           delimit)
+djvu_text_page_limits (DjvuTextPage *page,
+		       EvRectangle  *rect,
+		       guint        *start,
+		       guint        *end)
 {
-	if (page->results || p == page->start) {
-		EvRectangle box;
-		const char *text;
-
-		box.x1 = miniexp_to_int (miniexp_nth (1, p));
-		box.y1 = miniexp_to_int (miniexp_nth (2, p));
-		box.x2 = miniexp_to_int (miniexp_nth (3, p));
-		box.y2 = miniexp_to_int (miniexp_nth (4, p));
-		text = miniexp_to_str (miniexp_nth (5, p));
-
-		if (text != NULL && text[0] != '\0') {
-			if (!(delimit & 2) && page->results != NULL) {
-				EvRectangle *union_box = (EvRectangle *)page->results->data;
-
-                                /* If still on the same line, add box to union */
-				djvu_text_page_union (union_box, &box);
-			} else {
-				/* A new line, a new box */
-				page->results = g_list_prepend (page->results, ev_rectangle_copy (&box));
-			}
+	gboolean found = FALSE;
+	guint i;
+
+	for (i = 0; i < page->tokens->len; i++) {
+		DjvuTextToken *token = &g_array_index (page->tokens, DjvuTextToken, i);
+
+		if (token->box.x2 >= rect->x1 && token->box.y1 <= rect->y2 &&
+		    token->box.x1 <= rect->x2 && token->box.y2 >= rect->y1 &&
+		    token->length > 0) {
+			if (!found)
+				*start = i;
+			*end = i;
+			found = TRUE;
 		}
-
-		if (p == page->end)
-			return FALSE;
 	}
-	return TRUE;
-}
 
-/**
- * djvu_text_page_selection_process_text:
- * @page: #DjvuTextPage instance
- * @p: s-expression to append
- * @delimit: character/word/... delimiter
- * 
- * Appends the string in @p to the page text.
- * 
- * Returns: whether the end was not reached in this s-expression
- */
-static gboolean
-djvu_text_page_selection_process_text (DjvuTextPage *page,
-                                       miniexp_t     p,
-                                       int           delimit)
-{
-	if (page->text || p == page->start) {
-		char *token_text = (char *) miniexp_to_str (miniexp_nth (5, p));
-		if (page->text) {
-			char *new_text =
-			    g_strjoin (delimit & 2 ? "\n" : 
-			    	       delimit & 1 ? " " : NULL,
-				       page->text, token_text,
-				       NULL);
-			g_free (page->text);
-			page->text = new_text;
-		} else
-			page->text = g_strdup (token_text);
-		if (p == page->end) 
-			return FALSE;
-	}
-	return TRUE;
+	return found;
 }
 
 /**
- * djvu_text_page_selection:
+ * djvu_text_page_get_selection:
  * @page: #DjvuTextPage instance
- * @p: tree to append
- * @delimit: character/word/... delimiter
- * 
- * Walks the tree in @p and appends the text or bounding boxes with
- * djvu_text_page_selection_process_{text|box}() for all s-expressions
- * between the start and end fields.
- * 
- * Returns: whether the end was not reached in this subtree
+ * @rectangle: #EvRectangle of the selection
+ *
+ * Returns: The bounding boxes of the selection, one for each line
  */
-static gboolean
-djvu_text_page_selection (DjvuSelectionType type,
-			  DjvuTextPage *page,
-			  miniexp_t     p,
-			  int           delimit)
+GList *
+djvu_text_page_get_selection_region (DjvuTextPage *page,
+                                     EvRectangle  *rectangle)
 {
-        miniexp_t deeper;
+	GList *results = NULL;
+	guint start, end, i;
 
-	g_return_val_if_fail (miniexp_consp (p) && miniexp_symbolp
-			      (miniexp_car (p)), FALSE);
+	if (!djvu_text_page_limits (page, rectangle, &start, &end))
+		return NULL;
 
-	if (miniexp_car (p) != page->char_symbol) 
-		delimit |= miniexp_car (p) == page->word_symbol ? 1 : 2;
-		
-	deeper = miniexp_cddr (miniexp_cdddr (p));
-	while (deeper != miniexp_nil) {
-		miniexp_t str = miniexp_car (deeper);
-		if (miniexp_stringp (str)) {
-			if (type == DJVU_SELECTION_TEXT) {
-				if (!djvu_text_page_selection_process_text (page, p, delimit))
-					return FALSE;
-			} else {
-				if (!djvu_text_page_selection_process_box (page, p, delimit))
-					return FALSE;
-			}
+	for (i = start; i <= end; i++) {
+		DjvuTextToken *token = &g_array_index (page->tokens, DjvuTextToken, i);
+
+		if (token->length == 0)
+			continue;
+
+		if (!(token->delimit & 2) && results != NULL) {
+			/* If still on the same line, add box to union */
+			djvu_text_page_union ((EvRectangle *)results->data, &token->box);
 		} else {
-			if (!djvu_text_page_selection (type, page, str, delimit))
-				return FALSE;
+			/* A new line, a new box */
+			results = g_list_prepend (results, ev_rectangle_copy (&token->box));
 		}
-		delimit = 0;
-		deeper = miniexp_cdr (deeper);
 	}
-	return TRUE;
-}
 
-static void
-djvu_text_page_limits_process (DjvuTextPage *page,
-			       miniexp_t     p, 
-			       EvRectangle  *rect)
-{
-	EvRectangle current;
-	const char *text;
-	
-	current.x1 = miniexp_to_int (miniexp_nth (1, p));
-	current.y1 = miniexp_to_int (miniexp_nth (2, p));
-	current.x2 = miniexp_to_int (miniexp_nth (3, p));
-	current.y2 = miniexp_to_int (miniexp_nth (4, p));
-	text = miniexp_to_str (miniexp_nth (5, p));
-	if (current.x2 >= rect->x1 && current.y1 <= rect->y2 &&
-	    current.x1 <= rect->x2 && current.y2 >= rect->y1 &&
-	    text != NULL && text[0] != '\0') {
-	    	if (page->start == miniexp_nil)
-	    		page->start = p;
-	    	page->end = p;
-	}
+	return g_list_reverse (results);
 }
 
-
-static void
-djvu_text_page_limits (DjvuTextPage *page,
-			  miniexp_t     p, 
-			  EvRectangle  *rect)
+char *
+djvu_text_page_copy (DjvuTextPage *page, 
+		     EvRectangle  *rectangle)
 {
-        miniexp_t deeper;
+	GString *text;
+	guint start, end, i;
 
-	g_return_if_fail (miniexp_consp (p) && 
-			  miniexp_symbolp (miniexp_car (p)));
+	if (!djvu_text_page_limits (page, rectangle, &start, &end))
+		return NULL;
 
-	deeper = miniexp_cddr (miniexp_cdddr (p));
-	while (deeper != miniexp_nil) {
-		miniexp_t str = miniexp_car (deeper);
-		if (miniexp_stringp (str))
-			djvu_text_page_limits_process (page, p, rect);
-		else
-			djvu_text_page_limits (page, str, rect);
+	text = g_string_new (NULL);
+	for (i = start; i <= end; i++) {
+		DjvuTextToken *token = &g_array_index (page->tokens, DjvuTextToken, i);
 
-		deeper = miniexp_cdr (deeper);
+		if (i > start) {
+			if (token->delimit & 2)
+				g_string_append_c (text, '\n');
+			else if (token->delimit & 1)
+				g_string_append_c (text, ' ');
+		}
+		g_string_append_len (text, page->strings + token->offset, token->length);
 	}
+
+	return g_string_free (text, FALSE);
 }
 
 /**
- * djvu_text_page_get_selection:
+ * djvu_text_page_get_text:
  * @page: #DjvuTextPage instance
- * @rectangle: #EvRectangle of the selection
  *
- * Returns: The bounding boxes of the selection
+ * Returns: the text of the page, with spaces between words and lines
  */
-GList *
-djvu_text_page_get_selection_region (DjvuTextPage *page,
-                                     EvRectangle  *rectangle)
-{
-	page->start = miniexp_nil;
-	page->end = miniexp_nil;
-
-	/* Get page->start and page->end filled from selection rectangle */
-	djvu_text_page_limits (page, page->text_structure, rectangle);
-	/* Fills page->results with the bouding boxes */
-	djvu_text_page_selection (DJVU_SELECTION_BOX,
-	                          page, page->text_structure, 0);
-
-	return g_list_reverse (page->results);
-}
-
-char *
-djvu_text_page_copy (DjvuTextPage *page, 
-		     EvRectangle  *rectangle)
+const char *
+djvu_text_page_get_text (DjvuTextPage *page)
 {
-	char* text;
-	
-	page->start = miniexp_nil;
-	page->end = miniexp_nil;
-	djvu_text_page_limits (page, page->text_structure, rectangle);
-	djvu_text_page_selection (DJVU_SELECTION_TEXT, page,
-	                          page->text_structure, 0);
-	
-	/* Do not free the string */	  
-	text = page->text;
-	page->text = NULL;
-	
-	return text;
+	return page->index.text;
 }
 
 /**
  * djvu_text_page_position:
  * @page: #DjvuTextPage instance
+ * @index: index of the page text
  * @position: index in the page text
  * 
- * Returns the closest s-expression that contains the given position in 
- * the page text.
+ * Returns the token that contains the given position in the page text.
  * 
- * Returns: closest s-expression
+ * Returns: index of the token
  */
-static miniexp_t
-djvu_text_page_position (DjvuTextPage *page, 
-			 int           position)
+static guint
+djvu_text_page_position (DjvuTextPage  *page,
+			 DjvuTextIndex *index,
+			 int            position)
 {
-	GArray *links = page->links;
-	int low = 0;
-	int hi = links->len - 1;
-	int mid = 0;
-
-	g_return_val_if_fail (hi >= 0, miniexp_nil);
-
-	/* Shamelessly copied from GNU classpath */
-	while (low <= hi) {
-                DjvuTextLink *link;
-
-		mid = (low + hi) >> 1;
-		link = &g_array_index (links, DjvuTextLink, mid);
-		if (link->position == position)
-			break;
-		else if (link->position > position)
-			hi = --mid;
+	guint low = 0;
+	guint hi = page->tokens->len;
+
+	/* Last token starting at or before the position */
+	while (hi - low > 1) {
+		guint mid = (low + hi) / 2;
+
+		if (index->positions[mid] <= position)
+			low = mid;
 		else
-			low = mid + 1;
+			hi = mid;
 	}
 
-	return g_array_index (page->links, DjvuTextLink, mid).pair;
+	return low;
 }
 
 /**
- * djvu_text_page_sexpr_process:
+ * djvu_text_page_box:
  * @page: #DjvuTextPage instance
- * @p: s-expression to append
- * @start: first s-expression in the selection
- * @end: last s-expression in the selection
- * 
- * Appends the rectangle defined by @p to the internal bounding box rectangle.
+ * @start: first token in the selection
+ * @end: last token in the selection
  * 
- * Returns: whether the end was not reached in this s-expression
+ * Builds a rectangle that contains all tokens in the given range.
  */
-static gboolean
-djvu_text_page_sexpr_process (DjvuTextPage *page, 
-                              miniexp_t     p,
-                              miniexp_t     start, 
-                              miniexp_t     end)
+static EvRectangle *
+djvu_text_page_box (DjvuTextPage *page,
+		    guint         start,
+		    guint         end)
 {
-	if (page->bounding_box || p == start) {
-		EvRectangle *new_rectangle = ev_rectangle_new ();
-		new_rectangle->x1 = miniexp_to_int (miniexp_nth (1, p));
-		new_rectangle->y1 = miniexp_to_int (miniexp_nth (2, p));
-		new_rectangle->x2 = miniexp_to_int (miniexp_nth (3, p));
-		new_rectangle->y2 = miniexp_to_int (miniexp_nth (4, p));
-		if (page->bounding_box) {
-			djvu_text_page_union (page->bounding_box,
-					      new_rectangle);
-			g_free (new_rectangle);
-		} else
-			page->bounding_box = new_rectangle;
-		if (p == end)
-			return FALSE;
-	}
-	return TRUE;
+	EvRectangle *box;
+	guint i;
+
+	box = ev_rectangle_copy (&g_array_index (page->tokens, DjvuTextToken, start).box);
+	for (i = start + 1; i <= end; i++)
+		djvu_text_page_union (box, &g_array_index (page->tokens, DjvuTextToken, i).box);
+
+	return box;
 }
 
 /**
- * djvu_text_page_sexpr:
+ * djvu_text_page_build_index:
  * @page: #DjvuTextPage instance
- * @p: tree to append
- * @start: first s-expression in the selection
- * @end: last s-expression in the selection
- * 
- * Walks the tree in @p and extends the rectangle with 
- * djvu_text_page_process() for all s-expressions between @start and @end.
+ * @index: the #DjvuTextIndex to fill
+ * @case_sensitive: do not ignore case
  * 
- * Returns: whether the end was not reached in this subtree
+ * Joins the text of the tokens, with a space before each word, and
+ * records where each token is in the result.
  */
-static gboolean
-djvu_text_page_sexpr (DjvuTextPage *page, 
-		      miniexp_t p,
-		      miniexp_t start, 
-		      miniexp_t end)
+static void
+djvu_text_page_build_index (DjvuTextPage  *page,
+			    DjvuTextIndex *index,
+			    gboolean       case_sensitive)
 {
-        miniexp_t deeper;
-
-	g_return_val_if_fail (miniexp_consp (p) && miniexp_symbolp
-			      (miniexp_car (p)), FALSE);
-
-	deeper = miniexp_cddr (miniexp_cdddr (p));
-	while (deeper != miniexp_nil) {
-		miniexp_t str = miniexp_car (deeper);
-		if (miniexp_stringp (str)) {
-			if (!djvu_text_page_sexpr_process
-			    (page, p, start, end))
-				return FALSE;
+	GString *text;
+	guint i;
+
+	text = g_string_new (NULL);
+	index->positions = g_new (int, page->tokens->len);
+	for (i = 0; i < page->tokens->len; i++) {
+		DjvuTextToken *token = &g_array_index (page->tokens, DjvuTextToken, i);
+		const char *token_text = page->strings + token->offset;
+
+		index->positions[i] = text->len;
+		if (i > 0 && token->delimit)
+			g_string_append_c (text, ' ');
+		if (case_sensitive) {
+			g_string_append_len (text, token_text, token->length);
 		} else {
-			if (!djvu_text_page_sexpr
-			    (page, str, start, end))
-				return FALSE;
+			char *folded = g_utf8_casefold (token_text, token->length);
+
+			g_string_append (text, folded);
+			g_free (folded);
 		}
-		deeper = miniexp_cdr (deeper);
 	}
-	return TRUE;
+	/* Pages without text have no text, rather than an empty one */
+	index->text = g_string_free (text, page->tokens->len == 0);
 }
 
 /**
- * djvu_text_page_box:
+ * djvu_text_page_search:
  * @page: #DjvuTextPage instance
- * @start: first s-expression in the selection
- * @end: last s-expression in the selection
+ * @text: text to search
+ * @case_sensitive: do not ignore case
  * 
- * Builds a rectangle that contains all s-expressions in the given range.
+ * Searches the page for the given text.
+ *
+ * Returns: the bounding boxes of the matches, to be freed by the caller
  */
-static EvRectangle *
-djvu_text_page_box (DjvuTextPage *page,
-		    miniexp_t     start, 
-		    miniexp_t     end)
+GList *
+djvu_text_page_search (DjvuTextPage *page, 
+		       const char   *text,
+		       gboolean      case_sensitive)
 {
-	page->bounding_box = NULL;
-	djvu_text_page_sexpr (page, page->text_structure, start, end);
-	return page->bounding_box;
+	DjvuTextIndex *index = &page->index;
+	GList *results = NULL;
+	char *search_text = NULL;
+	char *haystack;
+	int search_len;
+
+	if (page->tokens->len == 0)
+		return NULL;
+
+	if (!case_sensitive) {
+		index = &page->folded_index;
+		if (!index->text)
+			djvu_text_page_build_index (page, index, FALSE);
+		search_text = g_utf8_casefold (text, -1);
+		text = search_text;
+	}
+
+	search_len = strlen (text);
+	if (search_len == 0) {
+		g_free (search_text);
+		return NULL;
+	}
+
+	haystack = index->text;
+	while ((haystack = strstr (haystack, text)) != NULL) {
+		int start_p = haystack - index->text;
+		guint start = djvu_text_page_position (page, index, start_p);
+		int end_p = start_p + search_len - 1;
+		guint end = djvu_text_page_position (page, index, end_p);
+
+		results = g_list_prepend (results, djvu_text_page_box (page, start, end));
+		haystack = haystack + search_len;
+	}
+	g_free (search_text);
+
+	return g_list_reverse (results);
 }
 
 /**
- * djvu_text_page_append_search:
+ * djvu_text_page_append:
  * @page: #DjvuTextPage instance
+ * @strings: the text of the tokens
  * @p: tree to append
- * @case_sensitive: do not ignore case
- * @delimit: insert spaces because of higher (sentence/paragraph/...) break
+ * @delimit: character/word/... delimiter
  * 
- * Appends the tree in @p to the internal text string. 
+ * Appends the tokens of the tree in @p to the page.
  */
 static void
-djvu_text_page_append_text (DjvuTextPage *page,
-			    miniexp_t     p, 
-			    gboolean      case_sensitive, 
-			    gboolean      delimit)
+djvu_text_page_append (DjvuTextPage *page,
+		       GString      *strings,
+		       miniexp_t     p,
+		       int           delimit)
 {
-	char *token_text;
+	miniexp_t char_symbol = miniexp_symbol ("char");
+	miniexp_t word_symbol = miniexp_symbol ("word");
 	miniexp_t deeper;
-	
+
 	g_return_if_fail (miniexp_consp (p) && 
 			  miniexp_symbolp (miniexp_car (p)));
 
-	delimit |= page->char_symbol != miniexp_car (p);
-	
+	if (miniexp_car (p) != char_symbol)
+		delimit |= miniexp_car (p) == word_symbol ? 1 : 2;
+
 	deeper = miniexp_cddr (miniexp_cdddr (p));
 	while (deeper != miniexp_nil) {
 		miniexp_t data = miniexp_car (deeper);
 		if (miniexp_stringp (data)) {
-			DjvuTextLink link;
-			link.position = page->text == NULL ? 0 :
-			    strlen (page->text);
-			link.pair = p;
-			g_array_append_val (page->links, link);
-
-			token_text = (char *) miniexp_to_str (data);
-			if (!case_sensitive)
-				token_text = g_utf8_casefold (token_text, -1);
-			if (page->text == NULL)
-				page->text = g_strdup (token_text);
-			else {
-				char *new_text =
-				    g_strjoin (delimit ? " " : NULL,
-					       page->text, token_text,
-					       NULL);
-				g_free (page->text);
-				page->text = new_text;
-			}
-			if (!case_sensitive)
-				g_free (token_text);
+			DjvuTextToken token;
+			const char *token_text = miniexp_to_str (data);
+
+			token.box.x1 = miniexp_to_int (miniexp_nth (1, p));
+			token.box.y1 = miniexp_to_int (miniexp_nth (2, p));
+			token.box.x2 = miniexp_to_int (miniexp_nth (3, p));
+			token.box.y2 = miniexp_to_int (miniexp_nth (4, p));
+			token.delimit = delimit;
+			token.offset = strings->len;
+			token.length = strlen (token_text);
+			g_string_append_len (strings, token_text, token.length + 1);
+			g_array_append_val (page->tokens, token);
 		} else
-			djvu_text_page_append_text (page, data, 
-						    case_sensitive, delimit);
-		delimit = FALSE;
+			djvu_text_page_append (page, strings, data, delimit);
+		delimit = 0;
 		deeper = miniexp_cdr (deeper);
 	}
 }
 
 /**
- * djvu_text_page_search:
+ * djvu_text_page_get_size:
  * @page: #DjvuTextPage instance
- * @text: text to search
  * 
- * Searches the page for the given text. The results list has to be 
- * externally freed afterwards.
+ * Returns: the memory used by @page, in bytes
  */
-void 
-djvu_text_page_search (DjvuTextPage *page, 
-		       const char   *text)
+gsize
+djvu_text_page_get_size (DjvuTextPage *page)
 {
-	char *haystack = page->text;
-	int search_len;
-	EvRectangle *result;
-	if (page->links->len == 0)
-		return;
-
-	search_len = strlen (text);
-	while ((haystack = strstr (haystack, text)) != NULL) {
-		int start_p = haystack - page->text;
-		miniexp_t start = djvu_text_page_position (page, start_p);
-		int end_p = start_p + search_len - 1;
-		miniexp_t end = djvu_text_page_position (page, end_p);
-		result = djvu_text_page_box (page, start, end);
-		g_assert (result);
-		page->results = g_list_prepend (page->results, result);
-		haystack = haystack + search_len;
-	}
-	page->results = g_list_reverse (page->results);
-}
+	gsize size;
 
+	size = sizeof (DjvuTextPage) + page->tokens->len * (sizeof (DjvuTextToken) + sizeof (int));
+	if (page->index.text)
+		size += 2 * strlen (page->index.text);
+	if (page->folded_index.text)
+		size += strlen (page->folded_index.text) + page->tokens->len * sizeof (int);
 
-/**
- * djvu_text_page_index_text:
- * @page: #DjvuTextPage instance
- * @case_sensitive: do not ignore case
- * 
- * Indexes the page text and prepares the page for subsequent searches.
- */
-void
-djvu_text_page_index_text (DjvuTextPage *page,
-	       		       gboolean      case_sensitive)
-{
-	djvu_text_page_append_text (page, page->text_structure, 
-				    case_sensitive, FALSE);	
+	return size;
 }
 
 /**
  * djvu_text_page_new:
  * @text: S-expression of the page text
  * 
- * Creates a new page to search. 
+ * Creates a new page to search, holding the tokens of @text. @text
+ * isn't needed by the page afterwards.
  * 
  * Returns: new #DjvuTextPage instance
  */
@@ -503,12 +382,15 @@ DjvuTextPage *
 djvu_text_page_new (miniexp_t text)
 {
 	DjvuTextPage *page;
+	GString *strings;
 
 	page = g_new0 (DjvuTextPage, 1);
-	page->links = g_array_new (FALSE, FALSE, sizeof (DjvuTextLink));
-	page->char_symbol = miniexp_symbol ("char");
-	page->word_symbol = miniexp_symbol ("word");
-	page->text_structure = text;
+	page->tokens = g_array_new (FALSE, FALSE, sizeof (DjvuTextToken));
+	strings = g_string_new (NULL);
+	djvu_text_page_append (page, strings, text, 0);
+	page->strings = g_string_free (strings, FALSE);
+	djvu_text_page_build_index (page, &page->index, TRUE);
+
 	return page;
 }
 
@@ -521,7 +403,11 @@ djvu_text_page_new (miniexp_t text)
 void 
 djvu_text_page_free (DjvuTextPage *page)
 {
-	g_free (page->text);
-	g_array_free (page->links, TRUE);
+	g_free (page->index.text);
+	g_free (page->index.positions);
+	g_free (page->folded_index.text);
+	g_free (page->folded_index.positions);
+	g_free (page->strings);
+	g_array_free (page->tokens, TRUE);
 	g_free (page);
 }
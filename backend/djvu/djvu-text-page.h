@@ -27,38 +27,46 @@
 
 
 typedef struct _DjvuTextPage DjvuTextPage;
-typedef struct _DjvuTextLink DjvuTextLink;
+typedef struct _DjvuTextToken DjvuTextToken;
+typedef struct _DjvuTextIndex DjvuTextIndex;
 
-struct _DjvuTextPage {
-	char *text;
-	GArray *links;
-	GList *results;
-	miniexp_t char_symbol;
-	miniexp_t word_symbol;
-	EvRectangle *bounding_box;
-	miniexp_t text_structure;
-	miniexp_t start;
-	miniexp_t end;
+/* A character, or a word when the page has no character level */
+struct _DjvuTextToken {
+	EvRectangle box;
+	/* 1 when the token starts a word, 2 when it starts a line or a
+	 * larger block */
+	int delimit;
+	/* Position of the token in the strings of the page */
+	int offset;
+	int length;
 };
 
-struct _DjvuTextLink {
-	int position;
-	miniexp_t pair;
+/* The text of the page with a space before each word, and the
+ * position of every token in it, including the space.
+ */
+struct _DjvuTextIndex {
+	char *text;
+	int *positions;
 };
 
-typedef enum {
-	DJVU_SELECTION_TEXT,
-	DJVU_SELECTION_BOX,
-} DjvuSelectionType;
+struct _DjvuTextPage {
+	GArray *tokens;
+	/* The text of the tokens, each followed by a nul character */
+	char *strings;
+	DjvuTextIndex index;
+	/* Case folded index, built on the first search ignoring case */
+	DjvuTextIndex folded_index;
+};
 
 GList        *djvu_text_page_get_selection_region (DjvuTextPage *page,
                                                    EvRectangle  *rectangle);
 char         *djvu_text_page_copy                 (DjvuTextPage *page,
                                                    EvRectangle  *rectangle);
-void          djvu_text_page_index_text           (DjvuTextPage *page,
+const char   *djvu_text_page_get_text             (DjvuTextPage *page);
+GList        *djvu_text_page_search               (DjvuTextPage *page,
+                                                   const char   *text,
                                                    gboolean      case_sensitive);
-void          djvu_text_page_search               (DjvuTextPage *page,
-                                                   const char   *text);
+gsize         djvu_text_page_get_size             (DjvuTextPage *page);
 DjvuTextPage *djvu_text_page_new                  (miniexp_t     text);
 void          djvu_text_page_free                 (DjvuTextPage *page);
 
@@ -0,0 +1,228 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib.h>
+#include <libdjvu/ddjvuapi.h>
+
+/* Resolution the pages are rendered at, about the one of a screen */
+#define RENDER_DPI 96
+
+static const guint n_workers_list[] = { 1, 2, 4, 8 };
+
+typedef struct {
+	ddjvu_context_t  *context;
+	ddjvu_document_t *document;
+	GThread          *thread;
+	guint             n_decoded;
+	guint             n_failed;
+} Worker;
+
+/* Pages are taken in order by the first worker that is free */
+static gint next_page;
+static gint n_pages_to_render;
+
+static void
+usage (const char *prog)
+{
+	g_print ("- Decodes and renders the pages of a DjVu document\n");
+	g_print ("Usage: %s filename [n-pages]\n", prog);
+	g_print ("Every page is decoded once with 1, 2, 4 and 8 workers, each with\n"
+		 "its own ddjvu context and document, and the pages per second are printed\n");
+}
+
+static void
+handle_events (ddjvu_context_t *context)
+{
+	const ddjvu_message_t *msg;
+
+	ddjvu_message_wait (context);
+	while ((msg = ddjvu_message_peek (context))) {
+		if (msg->m_any.tag == DDJVU_ERROR)
+			g_printerr ("DjvuLibre error: %s\n", msg->m_error.message);
+		ddjvu_message_pop (context);
+	}
+}
+
+static gboolean
+worker_open (Worker     *worker,
+	     const char *filename)
+{
+	worker->context = ddjvu_context_create ("test-djvu-decode");
+	worker->document = ddjvu_document_create_by_filename (worker->context, filename, TRUE);
+	if (!worker->document)
+		return FALSE;
+
+	while (!ddjvu_document_decoding_done (worker->document))
+		handle_events (worker->context);
+
+	return !ddjvu_document_decoding_error (worker->document);
+}
+
+static void
+worker_close (Worker *worker)
+{
+	if (worker->document)
+		ddjvu_document_release (worker->document);
+	if (worker->context)
+		ddjvu_context_release (worker->context);
+}
+
+static gboolean
+worker_render_page (Worker         *worker,
+		    ddjvu_format_t *format,
+		    gint            index)
+{
+	ddjvu_page_t *page;
+	ddjvu_rect_t  rect;
+	gchar        *pixels;
+	gint          rowstride;
+	gboolean      rendered;
+
+	page = ddjvu_page_create_by_pageno (worker->document, index);
+	if (!page)
+		return FALSE;
+
+	while (!ddjvu_page_decoding_done (page))
+		handle_events (worker->context);
+
+	if (ddjvu_page_decoding_error (page)) {
+		ddjvu_page_release (page);
+		return FALSE;
+	}
+
+	rect.x = 0;
+	rect.y = 0;
+	rect.w = MAX (ddjvu_page_get_width (page) * RENDER_DPI / ddjvu_page_get_resolution (page), 1);
+	rect.h = MAX (ddjvu_page_get_height (page) * RENDER_DPI / ddjvu_page_get_resolution (page), 1);
+
+	rowstride = rect.w * 4;
+	pixels = g_malloc (rowstride * rect.h);
+	rendered = ddjvu_page_render (page, DDJVU_RENDER_COLOR,
+				      &rect, &rect, format,
+				      rowstride, pixels);
+	g_free (pixels);
+	ddjvu_page_release (page);
+
+	return rendered;
+}
+
+static gpointer
+worker_run (Worker *worker)
+{
+	guint           masks[4] = { 0xff0000, 0xff00, 0xff, 0xff000000 };
+	ddjvu_format_t *format;
+	gint            index;
+
+	format = ddjvu_format_create (DDJVU_FORMAT_RGBMASK32, 4, masks);
+	ddjvu_format_set_row_order (format, 1);
+
+	while ((index = g_atomic_int_add (&next_page, 1)) < n_pages_to_render) {
+		if (worker_render_page (worker, format, index))
+			worker->n_decoded++;
+		else
+			worker->n_failed++;
+	}
+
+	ddjvu_format_release (format);
+
+	return NULL;
+}
+
+/* Documents are opened before the clock starts, so that only decoding
+ * and rendering the pages is measured.
+ */
+static gboolean
+run (const char *filename,
+     gint        n_pages,
+     guint       n_workers)
+{
+	Worker   *workers;
+	gint64    start;
+	gdouble   elapsed;
+	guint     n_decoded = 0, n_failed = 0;
+	gboolean  retval = TRUE;
+	guint     i;
+
+	workers = g_new0 (Worker, n_workers);
+	for (i = 0; i < n_workers; i++) {
+		if (!worker_open (&workers[i], filename)) {
+			g_printerr ("Failed to open '%s'\n", filename);
+			retval = FALSE;
+			goto out;
+		}
+	}
+
+	if (n_pages <= 0 || n_pages > ddjvu_document_get_pagenum (workers[0].document))
+		n_pages = ddjvu_document_get_pagenum (workers[0].document);
+	next_page = 0;
+	n_pages_to_render = n_pages;
+
+	start = g_get_monotonic_time ();
+
+	for (i = 0; i < n_workers; i++) {
+		workers[i].thread = g_thread_new ("DjvuDecode",
+						  (GThreadFunc) worker_run,
+						  &workers[i]);
+	}
+	for (i = 0; i < n_workers; i++) {
+		g_thread_join (workers[i].thread);
+		n_decoded += workers[i].n_decoded;
+		n_failed += workers[i].n_failed;
+	}
+
+	elapsed = (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC;
+	g_print ("%u workers: %u pages in %.3f s (%.1f pages/s)",
+		 n_workers, n_decoded, elapsed,
+		 elapsed > 0 ? n_decoded / elapsed : 0);
+	if (n_failed > 0)
+		g_print (", %u pages failed", n_failed);
+	g_print ("\n");
+
+out:
+	for (i = 0; i < n_workers; i++)
+		worker_close (&workers[i]);
+	g_free (workers);
+
+	return retval;
+}
+
+int
+main (int argc, char **argv)
+{
+	gint  n_pages = 0;
+	guint i;
+
+	if (argc != 2 && argc != 3) {
+		usage (argv[0]);
+		return 1;
+	}
+
+	if (argc == 3)
+		n_pages = atoi (argv[2]);
+
+	g_print ("%u processors\n", g_get_num_processors ());
+
+	for (i = 0; i < G_N_ELEMENTS (n_workers_list); i++) {
+		if (!run (argv[1], n_pages, n_workers_list[i]))
+			return 1;
+	}
+
+	return 0;
+}
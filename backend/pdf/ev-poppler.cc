@@ -59,6 +59,9 @@
 #include "ev-image.h"
 #include "ev-media.h"
 #include "ev-file-helpers.h"
+#include "ev-surface-pool.h"
+#include "pdf-outline-model.h"
+#include "pdf-text-index.h"
 
 #include <libxml/tree.h>
 #include <libxml/parser.h>
@@ -121,6 +124,19 @@ typedef struct {
 #endif
 } PdfPrintContext;
 
+/* A document of the pool used by read-only operations,
+ * see pdf_document_acquire ().
+ */
+typedef struct {
+	PopplerDocument *document;
+	GThread         *thread;
+} PdfPooledDocument;
+
+typedef struct {
+	gchar *name;
+	gchar *details;
+} PdfFont;
+
 struct _PdfDocumentClass
 {
 	EvDocumentClass parent_class;
@@ -135,14 +151,38 @@ struct _PdfDocument
 	gboolean forms_modified;
 	gboolean annots_modified;
 
+	PopplerDocument *fonts_document;
 	PopplerFontInfo *font_info;
-	PopplerFontsIter *fonts_iter;
 	int fonts_scanned_pages;
+	gboolean fonts_scan_completed;
 	gboolean missing_fonts;
+	/* Fonts found by the scan, added by the job thread and
+	 * read by the main thread while the scan goes on.
+	 */
+	GMutex fonts_mutex;
+	GPtrArray *fonts;
+	GHashTable *fonts_seen;
 
 	PdfPrintContext *print_ctx;
 
+	/* Annotations of every page, shared by the annotations
+	 * sidebar and the page cache of the view, and the
+	 * pages known to have none.
+	 */
 	GHashTable *annots;
+	GHashTable *pages_without_annots;
+
+	/* Pool of documents for read-only operations */
+	GMutex pool_mutex;
+	GCond pool_cond;
+	GFile *file;
+	gchar *file_identity;
+	PdfPooledDocument primary;
+	GSList *idle_documents;
+	guint n_pooled_documents;
+	gboolean pool_disabled;
+
+	PdfTextIndex *text_index;
 };
 
 static void pdf_document_security_iface_init             (EvDocumentSecurityInterface    *iface);
@@ -167,6 +207,7 @@ static EvLinkDest *ev_link_dest_from_dest    (PdfDocument       *pdf_document,
 static EvLink     *ev_link_from_action       (PdfDocument       *pdf_document,
 					      PopplerAction     *action);
 static void        pdf_print_context_free    (PdfPrintContext   *ctx);
+static void        pdf_document_pool_clear   (PdfDocument       *pdf_document);
 static gboolean    attachment_save_to_buffer (PopplerAttachment *attachment,
 					      gchar            **buffer,
 					      gsize             *buffer_size,
@@ -206,6 +247,14 @@ EV_BACKEND_REGISTER_WITH_CODE (PdfDocument, pdf_document,
 								 pdf_document_text_iface_init);
 			 });
 
+static void
+pdf_font_free (PdfFont *font)
+{
+	g_free (font->name);
+	g_free (font->details);
+	g_free (font);
+}
+
 static void
 pdf_document_dispose (GObject *object)
 {
@@ -221,25 +270,55 @@ pdf_document_dispose (GObject *object)
 		pdf_document->annots = NULL;
 	}
 
+	g_clear_pointer (&pdf_document->pages_without_annots, g_hash_table_destroy);
+
+	pdf_document_pool_clear (pdf_document);
+
+	if (pdf_document->text_index) {
+		pdf_text_index_free (pdf_document->text_index);
+		pdf_document->text_index = NULL;
+	}
+
 	if (pdf_document->document) {
 		g_object_unref (pdf_document->document);
+		pdf_document->document = NULL;
 	}
 
 	if (pdf_document->font_info) {
 		poppler_font_info_free (pdf_document->font_info);
+		pdf_document->font_info = NULL;
 	}
 
-	if (pdf_document->fonts_iter) {
-		poppler_fonts_iter_free (pdf_document->fonts_iter);
-	}
+	g_clear_object (&pdf_document->fonts_document);
 
 	G_OBJECT_CLASS (pdf_document_parent_class)->dispose (object);
 }
 
+static void
+pdf_document_finalize (GObject *object)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (object);
+
+	g_mutex_clear (&pdf_document->pool_mutex);
+	g_cond_clear (&pdf_document->pool_cond);
+
+	g_mutex_clear (&pdf_document->fonts_mutex);
+	g_ptr_array_free (pdf_document->fonts, TRUE);
+	g_hash_table_destroy (pdf_document->fonts_seen);
+
+	G_OBJECT_CLASS (pdf_document_parent_class)->finalize (object);
+}
+
 static void
 pdf_document_init (PdfDocument *pdf_document)
 {
 	pdf_document->password = NULL;
+	g_mutex_init (&pdf_document->pool_mutex);
+	g_cond_init (&pdf_document->pool_cond);
+
+	g_mutex_init (&pdf_document->fonts_mutex);
+	pdf_document->fonts = g_ptr_array_new_with_free_func ((GDestroyNotify)pdf_font_free);
+	pdf_document->fonts_seen = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 }
 
 static void
@@ -268,6 +347,296 @@ convert_error (GError  *poppler_error,
 	}
 }
 
+/* Document pool
+ *
+ * Read-only operations (rendering, thumbnails, text, find and links)
+ * don't have to run on the loaded document: they take a document from
+ * a pool, so that several threads can run them at the same time. The
+ * pool starts with the loaded document only, independent documents are
+ * opened from the same file when all of them are in use, up to
+ * ev_document_get_max_render_threads (). Documents remember the last
+ * thread that used them and threads take their own document first, so
+ * every worker keeps using the same document and its caches.
+ *
+ * Edits (annotations, forms and layers) are only done on the loaded
+ * document, once nobody else is using it. The other documents don't
+ * have the edits, so they are closed and no more are opened until the
+ * document is loaded again.
+ */
+static void
+pdf_pooled_document_free (PdfPooledDocument *pooled)
+{
+	g_object_unref (pooled->document);
+	g_free (pooled);
+}
+
+static void
+pdf_document_pool_close_idle_unlocked (PdfDocument *pdf_document)
+{
+	GSList *l = pdf_document->idle_documents;
+
+	while (l) {
+		PdfPooledDocument *pooled = (PdfPooledDocument *)l->data;
+		GSList            *next = l->next;
+
+		if (pooled != &pdf_document->primary) {
+			pdf_document->idle_documents = g_slist_delete_link (pdf_document->idle_documents, l);
+			pdf_document->n_pooled_documents--;
+			pdf_pooled_document_free (pooled);
+		}
+		l = next;
+	}
+}
+
+static void
+pdf_document_pool_clear (PdfDocument *pdf_document)
+{
+	g_mutex_lock (&pdf_document->pool_mutex);
+	pdf_document_pool_close_idle_unlocked (pdf_document);
+	g_clear_pointer (&pdf_document->idle_documents, g_slist_free);
+	g_clear_object (&pdf_document->file);
+	g_clear_pointer (&pdf_document->file_identity, g_free);
+	pdf_document->primary.document = NULL;
+	pdf_document->n_pooled_documents = 0;
+	g_mutex_unlock (&pdf_document->pool_mutex);
+}
+
+/* Returns a string that changes when @file is modified, made of its
+ * entity tag and size, or %NULL if it can't be queried.
+ */
+static gchar *
+pdf_document_query_file_identity (GFile *file)
+{
+	GFileInfo *info;
+	gchar     *identity;
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_ETAG_VALUE ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if (!info)
+		return NULL;
+
+	identity = g_strdup_printf ("%s:%" G_GOFFSET_FORMAT,
+				    g_file_info_get_etag (info),
+				    g_file_info_get_size (info));
+	g_object_unref (info);
+
+	return identity;
+}
+
+/* Whether the file on disk is still the one that was loaded. Documents
+ * opened again from a file that was rewritten, by a LaTeX build for
+ * instance, would have other pages than the loaded one.
+ */
+static gboolean
+pdf_document_file_is_unchanged (PdfDocument *pdf_document)
+{
+	gchar    *identity;
+	gboolean  retval;
+
+	if (!pdf_document->file || !pdf_document->file_identity)
+		return FALSE;
+
+	identity = pdf_document_query_file_identity (pdf_document->file);
+	retval = g_strcmp0 (identity, pdf_document->file_identity) == 0;
+	g_free (identity);
+
+	return retval;
+}
+
+static void
+pdf_document_pool_init (PdfDocument *pdf_document,
+			GFile       *file)
+{
+	gchar *identity;
+
+	pdf_document_pool_clear (pdf_document);
+
+	identity = file ? pdf_document_query_file_identity (file) : NULL;
+
+	g_mutex_lock (&pdf_document->pool_mutex);
+	pdf_document->file = file ? G_FILE (g_object_ref (file)) : NULL;
+	pdf_document->file_identity = identity;
+	pdf_document->primary.document = pdf_document->document;
+	pdf_document->primary.thread = NULL;
+	pdf_document->idle_documents = g_slist_prepend (NULL, &pdf_document->primary);
+	pdf_document->n_pooled_documents = 1;
+	pdf_document->pool_disabled = FALSE;
+	g_mutex_unlock (&pdf_document->pool_mutex);
+}
+
+static PdfPooledDocument *
+pdf_document_pool_open (PdfDocument *pdf_document)
+{
+	PdfPooledDocument *pooled;
+	PopplerDocument   *document;
+
+	if (!pdf_document_file_is_unchanged (pdf_document))
+		return NULL;
+
+	document = poppler_document_new_from_gfile (pdf_document->file,
+						    pdf_document->password,
+						    NULL, NULL);
+	if (!document)
+		return NULL;
+
+	/* The file could have been rewritten while it was read */
+	if (!pdf_document_file_is_unchanged (pdf_document) ||
+	    poppler_document_get_n_pages (document) !=
+	    poppler_document_get_n_pages (pdf_document->document)) {
+		g_object_unref (document);
+		return NULL;
+	}
+
+	pooled = g_new0 (PdfPooledDocument, 1);
+	pooled->document = document;
+
+	return pooled;
+}
+
+/* Documents other than the loaded one can be used without the document
+ * lock, since nothing else uses them. Returns NULL when there can't be
+ * any such document.
+ */
+static PdfPooledDocument *
+pdf_document_acquire_full (PdfDocument *pdf_document,
+			   gboolean     allow_primary)
+{
+	PdfPooledDocument *pooled = NULL;
+	GThread           *self = g_thread_self ();
+
+	g_mutex_lock (&pdf_document->pool_mutex);
+	while (!pooled) {
+		GSList *l;
+
+		if (!allow_primary &&
+		    (!pdf_document->file || pdf_document->pool_disabled ||
+		     ev_document_get_max_render_threads () < 2))
+			break;
+
+		for (l = pdf_document->idle_documents; l; l = l->next) {
+			PdfPooledDocument *idle = (PdfPooledDocument *)l->data;
+
+			if (!allow_primary && idle == &pdf_document->primary)
+				continue;
+			if (!pooled || idle->thread == self)
+				pooled = idle;
+			if (idle->thread == self)
+				break;
+		}
+
+		if (pooled) {
+			pdf_document->idle_documents = g_slist_remove (pdf_document->idle_documents, pooled);
+			break;
+		}
+
+		if (pdf_document->file && !pdf_document->pool_disabled &&
+		    pdf_document->n_pooled_documents < ev_document_get_max_render_threads ()) {
+			/* Open without holding the lock, it can take a while */
+			pdf_document->n_pooled_documents++;
+			g_mutex_unlock (&pdf_document->pool_mutex);
+			pooled = pdf_document_pool_open (pdf_document);
+			g_mutex_lock (&pdf_document->pool_mutex);
+
+			if (!pooled) {
+				pdf_document->n_pooled_documents--;
+				pdf_document->pool_disabled = TRUE;
+			}
+			continue;
+		}
+
+		g_cond_wait (&pdf_document->pool_cond, &pdf_document->pool_mutex);
+	}
+	g_mutex_unlock (&pdf_document->pool_mutex);
+
+	return pooled;
+}
+
+static PdfPooledDocument *
+pdf_document_acquire (PdfDocument *pdf_document)
+{
+	return pdf_document_acquire_full (pdf_document, TRUE);
+}
+
+static void
+pdf_document_release (PdfDocument       *pdf_document,
+		      PdfPooledDocument *pooled)
+{
+	g_mutex_lock (&pdf_document->pool_mutex);
+	pooled->thread = g_thread_self ();
+	if (pooled != &pdf_document->primary && pdf_document->pool_disabled) {
+		pdf_document->n_pooled_documents--;
+		pdf_pooled_document_free (pooled);
+	} else {
+		pdf_document->idle_documents = g_slist_prepend (pdf_document->idle_documents, pooled);
+	}
+	g_cond_broadcast (&pdf_document->pool_cond);
+	g_mutex_unlock (&pdf_document->pool_mutex);
+}
+
+static PopplerPage *
+pdf_document_get_pooled_page (PdfDocument       *pdf_document,
+			      PdfPooledDocument *pooled,
+			      EvPage            *page)
+{
+	if (pooled == &pdf_document->primary)
+		return POPPLER_PAGE (g_object_ref (page->backend_page));
+
+	return poppler_document_get_page (pooled->document, page->index);
+}
+
+/* Returns @page from a document of the pool, given back in @pooled.
+ * When a document of the pool doesn't have the page, the documents
+ * other than the loaded one are closed and the page of the loaded
+ * document is returned, so it's never %NULL.
+ */
+static PopplerPage *
+pdf_document_acquire_page (PdfDocument        *pdf_document,
+			   EvPage             *page,
+			   PdfPooledDocument **pooled)
+{
+	PopplerPage *poppler_page;
+
+	*pooled = pdf_document_acquire (pdf_document);
+	poppler_page = pdf_document_get_pooled_page (pdf_document, *pooled, page);
+	while (!poppler_page) {
+		g_mutex_lock (&pdf_document->pool_mutex);
+		pdf_document->pool_disabled = TRUE;
+		pdf_document_pool_close_idle_unlocked (pdf_document);
+		g_mutex_unlock (&pdf_document->pool_mutex);
+
+		/* Closed when given back, since the pool is disabled */
+		pdf_document_release (pdf_document, *pooled);
+
+		*pooled = pdf_document_acquire (pdf_document);
+		poppler_page = pdf_document_get_pooled_page (pdf_document, *pooled, page);
+	}
+
+	return poppler_page;
+}
+
+/* Waits until the loaded document is not used by read-only
+ * operations, and closes the other documents of the pool.
+ */
+static void
+pdf_document_begin_edit (PdfDocument *pdf_document)
+{
+	g_mutex_lock (&pdf_document->pool_mutex);
+	pdf_document->pool_disabled = TRUE;
+	pdf_document_pool_close_idle_unlocked (pdf_document);
+	while (!g_slist_find (pdf_document->idle_documents, &pdf_document->primary))
+		g_cond_wait (&pdf_document->pool_cond, &pdf_document->pool_mutex);
+	pdf_document->idle_documents = g_slist_remove (pdf_document->idle_documents,
+						       &pdf_document->primary);
+	g_mutex_unlock (&pdf_document->pool_mutex);
+}
+
+static void
+pdf_document_end_edit (PdfDocument *pdf_document)
+{
+	pdf_document_release (pdf_document, &pdf_document->primary);
+}
 
 /* EvDocument */
 static gboolean
@@ -300,6 +669,8 @@ pdf_document_load (EvDocument   *document,
 	GError *poppler_error = NULL;
 	PdfDocument *pdf_document = PDF_DOCUMENT (document);
 
+	GFile *file;
+
 	pdf_document->document =
 		poppler_document_new_from_file (uri, pdf_document->password, &poppler_error);
 
@@ -308,6 +679,10 @@ pdf_document_load (EvDocument   *document,
 		return FALSE;
 	}
 
+	file = g_file_new_for_uri (uri);
+	pdf_document_pool_init (pdf_document, file);
+	g_object_unref (file);
+
 	return TRUE;
 }
 
@@ -332,6 +707,9 @@ pdf_document_load_stream (EvDocument          *document,
                 return FALSE;
         }
 
+        /* Streams can't be opened again */
+        pdf_document_pool_init (pdf_document, NULL);
+
         return TRUE;
 }
 
@@ -356,9 +734,46 @@ pdf_document_load_gfile (EvDocument          *document,
                 return FALSE;
         }
 
+        pdf_document_pool_init (pdf_document, file);
+
         return TRUE;
 }
 
+static EvDocument *
+pdf_document_clone (EvDocument *document)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (document);
+	PdfDocument *clone;
+	const gchar *uri;
+
+	uri = ev_document_get_uri (document);
+	if (!uri)
+		return NULL;
+
+	clone = PDF_DOCUMENT (g_object_new (PDF_TYPE_DOCUMENT, NULL));
+	clone->document = poppler_document_new_from_file (uri, pdf_document->password, NULL);
+	if (!clone->document) {
+		g_object_unref (clone);
+		return NULL;
+	}
+
+	return EV_DOCUMENT (clone);
+}
+
+#if POPPLER_CHECK_VERSION(21, 12, 0)
+static gboolean
+pdf_document_can_render_layers (EvDocument *document)
+{
+	return TRUE;
+}
+#endif
+
+static gboolean
+pdf_document_can_render_regions (EvDocument *document)
+{
+	return TRUE;
+}
+
 static int
 pdf_document_get_n_pages (EvDocument *document)
 {
@@ -407,20 +822,18 @@ pdf_document_get_page_label (EvDocument *document,
 	return label;
 }
 
-static cairo_surface_t *
-pdf_page_render (PopplerPage     *page,
-		 gint             width,
-		 gint             height,
-		 EvRenderContext *rc)
+static void
+pdf_page_set_transform (PopplerPage     *page,
+			cairo_t         *cr,
+			gint             width,
+			gint             height,
+			EvRenderContext *rc)
 {
-	cairo_surface_t *surface;
-	cairo_t *cr;
 	double page_width, page_height;
 	double xscale, yscale;
 
-	surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
-					      width, height);
-	cr = cairo_create (surface);
+	if (rc->has_region)
+		cairo_translate (cr, -rc->region.x, -rc->region.y);
 
 	switch (rc->rotation) {
 	        case 90:
@@ -442,15 +855,202 @@ pdf_page_render (PopplerPage     *page,
 	ev_render_context_compute_scales (rc, page_width, page_height, &xscale, &yscale);
 	cairo_scale (cr, xscale, yscale);
 	cairo_rotate (cr, rc->rotation * G_PI / 180.0);
-	poppler_page_render (page, cr);
-
-	cairo_set_operator (cr, CAIRO_OPERATOR_DEST_OVER);
+}
 
+static void
+pdf_page_paint_background (cairo_t *cr)
+{
 	/* gnome's dark bg color is #373737
 	 * 0x37 = 55
 	 * 1 - 55 / 256 = 0.79 */
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
 	cairo_set_source_rgb (cr, .79, .79, .79);
 	cairo_paint (cr);
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+}
+
+#if POPPLER_CHECK_VERSION(21, 12, 0)
+/* Links can't be edited, they are drawn with the content of the page.
+ * Hidden annotations and empty ones don't draw anything.
+ */
+static gboolean
+pdf_annot_is_in_annots_layer (PopplerAnnotMapping *mapping)
+{
+	PopplerAnnotFlag flags;
+
+	if (poppler_annot_get_annot_type (mapping->annot) == POPPLER_ANNOT_LINK)
+		return FALSE;
+
+	flags = poppler_annot_get_flags (mapping->annot);
+	if (flags & (POPPLER_ANNOT_FLAG_HIDDEN | POPPLER_ANNOT_FLAG_NO_VIEW))
+		return FALSE;
+
+	return mapping->area.x2 > mapping->area.x1 &&
+		mapping->area.y2 > mapping->area.y1;
+}
+
+/* Clips @cr to the pixels covered by the annotations and form
+ * fields of @page, returns FALSE if there's nothing to draw.
+ */
+static gboolean
+pdf_page_clip_annots (PopplerPage *page,
+		      cairo_t     *cr,
+		      gint         width,
+		      gint         height)
+{
+	cairo_region_t *region;
+	cairo_matrix_t  matrix;
+	cairo_rectangle_int_t bounds = { 0, 0, width, height };
+	GList          *annots, *l;
+	double          page_height;
+	gint            i, n_rects;
+
+	annots = poppler_page_get_annot_mapping (page);
+	if (!annots)
+		return FALSE;
+
+	poppler_page_get_size (page, NULL, &page_height);
+	region = cairo_region_create ();
+
+	for (l = annots; l; l = g_list_next (l)) {
+		PopplerAnnotMapping  *mapping = (PopplerAnnotMapping *) l->data;
+		cairo_rectangle_int_t rect;
+		double x1, y1, x2, y2;
+		double x[4], y[4];
+		gint   j;
+
+		if (!pdf_annot_is_in_annots_layer (mapping))
+			continue;
+
+		x1 = mapping->area.x1;
+		x2 = mapping->area.x2;
+		y1 = page_height - mapping->area.y2;
+		y2 = page_height - mapping->area.y1;
+
+		/* Text annotations are drawn as 24x24 icons, see
+		 * pdf_document_annotations_get_annotations() */
+		if (poppler_annot_get_annot_type (mapping->annot) == POPPLER_ANNOT_TEXT) {
+			x2 = MAX (x2, x1 + 24);
+			y2 = MAX (y2, y1 + 24);
+		}
+
+		x[0] = x1; y[0] = y1;
+		x[1] = x2; y[1] = y1;
+		x[2] = x1; y[2] = y2;
+		x[3] = x2; y[3] = y2;
+		for (j = 0; j < 4; j++)
+			cairo_user_to_device (cr, &x[j], &y[j]);
+
+		rect.x = (gint) floor (MIN (MIN (x[0], x[1]), MIN (x[2], x[3])));
+		rect.y = (gint) floor (MIN (MIN (y[0], y[1]), MIN (y[2], y[3])));
+		rect.width = (gint) ceil (MAX (MAX (x[0], x[1]), MAX (x[2], x[3]))) - rect.x;
+		rect.height = (gint) ceil (MAX (MAX (y[0], y[1]), MAX (y[2], y[3]))) - rect.y;
+		cairo_region_union_rectangle (region, &rect);
+	}
+	poppler_page_free_annot_mapping (annots);
+
+	cairo_region_intersect_rectangle (region, &bounds);
+	n_rects = cairo_region_num_rectangles (region);
+	if (n_rects == 0) {
+		cairo_region_destroy (region);
+		return FALSE;
+	}
+
+	/* The clip is aligned to the pixels, so that the annotations
+	 * drawn over the content rendered without them give exactly
+	 * the same pixels as the whole page rendered at once.
+	 */
+	cairo_get_matrix (cr, &matrix);
+	cairo_identity_matrix (cr);
+	for (i = 0; i < n_rects; i++) {
+		cairo_rectangle_int_t rect;
+
+		cairo_region_get_rectangle (region, i, &rect);
+		cairo_rectangle (cr, rect.x, rect.y, rect.width, rect.height);
+	}
+	cairo_clip (cr);
+	cairo_set_matrix (cr, &matrix);
+
+	cairo_region_destroy (region);
+
+	return TRUE;
+}
+
+/* The annotations are drawn over the content of the page, so the
+ * layer of the annotations is the whole page rendered with them,
+ * clipped to the area they cover and transparent elsewhere.
+ */
+static cairo_surface_t *
+pdf_page_render_annots (PopplerPage     *page,
+			gint             width,
+			gint             height,
+			EvRenderContext *rc)
+{
+	cairo_surface_t *surface;
+	cairo_t *cr;
+	gint surface_width = rc->has_region ? rc->region.width : width;
+	gint surface_height = rc->has_region ? rc->region.height : height;
+
+	surface = ev_surface_pool_create_surface (CAIRO_FORMAT_ARGB32,
+						  surface_width, surface_height);
+	cr = cairo_create (surface);
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint (cr);
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+
+	pdf_page_set_transform (page, cr, width, height, rc);
+	if (!pdf_page_clip_annots (page, cr, surface_width, surface_height)) {
+		cairo_destroy (cr);
+		cairo_surface_destroy (surface);
+
+		return NULL;
+	}
+
+	pdf_page_paint_background (cr);
+	poppler_page_render_full (page, cr, FALSE, POPPLER_RENDER_ANNOTS_ALL);
+
+	cairo_destroy (cr);
+
+	return surface;
+}
+#endif /* POPPLER_CHECK_VERSION(21, 12, 0) */
+
+static cairo_surface_t *
+pdf_page_render (PopplerPage     *page,
+		 gint             width,
+		 gint             height,
+		 EvRenderContext *rc)
+{
+	cairo_surface_t *surface;
+	cairo_t *cr;
+
+#if POPPLER_CHECK_VERSION(21, 12, 0)
+	if (!(rc->layers & EV_RENDER_LAYER_CONTENT))
+		return pdf_page_render_annots (page, width, height, rc);
+#endif
+
+	/* Pages are opaque once the background is painted, so they are
+	 * rendered onto the background, like poppler does on its paper
+	 * colour, instead of compositing the background under the page
+	 * in a second pass over the whole surface.
+	 */
+	surface = ev_surface_pool_create_surface (CAIRO_FORMAT_RGB24,
+						  rc->has_region ? rc->region.width : width,
+						  rc->has_region ? rc->region.height : height);
+	cr = cairo_create (surface);
+
+	pdf_page_paint_background (cr);
+	pdf_page_set_transform (page, cr, width, height, rc);
+#if POPPLER_CHECK_VERSION(21, 12, 0)
+	/* Links aren't in the annotations layer, see
+	 * pdf_annot_is_in_annots_layer() */
+	poppler_page_render_full (page, cr, FALSE,
+				  (rc->layers & EV_RENDER_LAYER_ANNOTATIONS) ?
+				  POPPLER_RENDER_ANNOTS_ALL : POPPLER_RENDER_ANNOTS_LINK);
+#else
+	poppler_page_render (page, cr);
+#endif
 
 	cairo_destroy (cr);
 
@@ -461,19 +1061,27 @@ static cairo_surface_t *
 pdf_document_render (EvDocument      *document,
 		     EvRenderContext *rc)
 {
+	PdfDocument *pdf_document = PDF_DOCUMENT (document);
+	PdfPooledDocument *pooled;
 	PopplerPage *poppler_page;
+	cairo_surface_t *surface;
 	double width_points, height_points;
 	gint width, height;
 
-	poppler_page = POPPLER_PAGE (rc->page->backend_page);
+	poppler_page = pdf_document_acquire_page (pdf_document, rc->page, &pooled);
 
 	poppler_page_get_size (poppler_page,
 			       &width_points, &height_points);
 
 	ev_render_context_compute_transformed_size (rc, width_points, height_points,
 						    &width, &height);
-	return pdf_page_render (poppler_page,
-				width, height, rc);
+	surface = pdf_page_render (poppler_page,
+				   width, height, rc);
+
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
+	return surface;
 }
 
 static GdkPixbuf *
@@ -499,13 +1107,15 @@ static GdkPixbuf *
 pdf_document_get_thumbnail (EvDocument      *document,
 			    EvRenderContext *rc)
 {
+	PdfDocument *pdf_document = PDF_DOCUMENT (document);
+	PdfPooledDocument *pooled;
 	PopplerPage *poppler_page;
 	cairo_surface_t *surface;
 	GdkPixbuf *pixbuf = NULL;
 	double page_width, page_height;
 	gint width, height;
 
-	poppler_page = POPPLER_PAGE (rc->page->backend_page);
+	poppler_page = pdf_document_acquire_page (pdf_document, rc->page, &pooled);
 
 	poppler_page_get_size (poppler_page,
 			       &page_width, &page_height);
@@ -541,6 +1151,9 @@ pdf_document_get_thumbnail (EvDocument      *document,
 		pixbuf = make_thumbnail_for_page (poppler_page, rc, width, height);
 	}
 
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
 	return pixbuf;
 }
 
@@ -548,13 +1161,14 @@ static cairo_surface_t *
 pdf_document_get_thumbnail_surface (EvDocument      *document,
 				    EvRenderContext *rc)
 {
-
+	PdfDocument *pdf_document = PDF_DOCUMENT (document);
+	PdfPooledDocument *pooled;
 	PopplerPage *poppler_page;
 	cairo_surface_t *surface;
 	double page_width, page_height;
 	gint width, height;
 
-	poppler_page = POPPLER_PAGE (rc->page->backend_page);
+	poppler_page = pdf_document_acquire_page (pdf_document, rc->page, &pooled);
 
 	poppler_page_get_size (poppler_page,
 			       &page_width, &page_height);
@@ -573,6 +1187,9 @@ pdf_document_get_thumbnail_surface (EvDocument      *document,
 
 			rotated_surface = ev_document_misc_surface_rotate_and_scale (surface, width, height, rc->rotation);
 			cairo_surface_destroy (surface);
+			g_object_unref (poppler_page);
+			pdf_document_release (pdf_document, pooled);
+
 			return rotated_surface;
 		} else {
 			/* The provided thumbnail has a different size */
@@ -584,6 +1201,9 @@ pdf_document_get_thumbnail_surface (EvDocument      *document,
 	surface = pdf_page_render (poppler_page, width, height, rc);
 	ev_document_fc_mutex_unlock ();
 
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
 	return surface;
 }
 
@@ -1250,6 +1870,7 @@ pdf_document_class_init (PdfDocumentClass *klass)
 	EvDocumentClass *ev_document_class = EV_DOCUMENT_CLASS (klass);
 
 	g_object_class->dispose = pdf_document_dispose;
+	g_object_class->finalize = pdf_document_finalize;
 
 	ev_document_class->save = pdf_document_save;
 	ev_document_class->load = pdf_document_load;
@@ -1265,14 +1886,19 @@ pdf_document_class_init (PdfDocumentClass *klass)
 	ev_document_class->get_info = pdf_document_get_info;
 	ev_document_class->get_backend_info = pdf_document_get_backend_info;
 	ev_document_class->support_synctex = pdf_document_support_synctex;
+	ev_document_class->clone = pdf_document_clone;
+#if POPPLER_CHECK_VERSION(21, 12, 0)
+	ev_document_class->can_render_layers = pdf_document_can_render_layers;
+#endif
+	ev_document_class->can_render_regions = pdf_document_can_render_regions;
 }
 
 /* EvDocumentSecurity */
 static gboolean
 pdf_document_has_document_security (EvDocumentSecurity *document_security)
 {
-	/* FIXME: do we really need to have this? */
-	return FALSE;
+	/* Documents that open without a password can be read by anyone */
+	return PDF_DOCUMENT (document_security)->password != NULL;
 }
 
 static void
@@ -1300,39 +1926,86 @@ pdf_document_fonts_get_progress (EvDocumentFonts *document_fonts)
 	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
 	int n_pages;
 
+	if (pdf_document->fonts_scan_completed)
+		return 1.0;
+
         n_pages = pdf_document_get_n_pages (EV_DOCUMENT (pdf_document));
 
 	return (double)pdf_document->fonts_scanned_pages / (double)n_pages;
 }
 
+static void pdf_document_fonts_add (PdfDocument      *pdf_document,
+				    PopplerFontsIter *iter);
+
+/* The scan goes through the pages in order, and the font info keeps the
+ * fonts already found, so it can't be split in page ranges. It runs on
+ * a document of its own when possible, so that it doesn't use the one
+ * the pool lends to render pages.
+ */
+static PopplerDocument *
+pdf_document_fonts_open_document (PdfDocument *pdf_document)
+{
+	PdfPooledDocument *pooled = NULL;
+	PopplerDocument   *document;
+	gboolean           can_open;
+
+	g_mutex_lock (&pdf_document->pool_mutex);
+	can_open = pdf_document->file && !pdf_document->pool_disabled;
+	g_mutex_unlock (&pdf_document->pool_mutex);
+
+	if (can_open)
+		pooled = pdf_document_pool_open (pdf_document);
+	if (!pooled)
+		return POPPLER_DOCUMENT (g_object_ref (pdf_document->document));
+
+	document = pooled->document;
+	g_free (pooled);
+
+	return document;
+}
+
 static gboolean
 pdf_document_fonts_scan (EvDocumentFonts *document_fonts,
 			 int              n_pages)
 {
 	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
-	gboolean result;
+	PopplerFontsIter *iter = NULL;
+	int n_document_pages;
 
 	g_return_val_if_fail (PDF_IS_DOCUMENT (document_fonts), FALSE);
 
+	/* Fonts are scanned once, later scans use the fonts found */
+	if (pdf_document->fonts_scan_completed)
+		return FALSE;
+
 	if (pdf_document->font_info == NULL) {
-		pdf_document->font_info = poppler_font_info_new (pdf_document->document);
+		pdf_document->fonts_document = pdf_document_fonts_open_document (pdf_document);
+		pdf_document->font_info = poppler_font_info_new (pdf_document->fonts_document);
 	}
 
-	if (pdf_document->fonts_iter) {
-		poppler_fonts_iter_free (pdf_document->fonts_iter);
+	/* It returns FALSE when the pages don't have new fonts too,
+	 * not only after the last page.
+	 */
+	poppler_font_info_scan (pdf_document->font_info, n_pages, &iter);
+	if (iter) {
+		do {
+			pdf_document_fonts_add (pdf_document, iter);
+		} while (poppler_fonts_iter_next (iter));
+		poppler_fonts_iter_free (iter);
 	}
 
-	pdf_document->fonts_scanned_pages += n_pages;
+	n_document_pages = poppler_document_get_n_pages (pdf_document->document);
+	pdf_document->fonts_scanned_pages = MIN (pdf_document->fonts_scanned_pages + n_pages,
+						 n_document_pages);
+	if (pdf_document->fonts_scanned_pages < n_document_pages)
+		return TRUE;
 
-	result = poppler_font_info_scan (pdf_document->font_info, n_pages,
-				         &pdf_document->fonts_iter);
-	if (!result) {
-		pdf_document->fonts_scanned_pages = 0;
-		poppler_font_info_free (pdf_document->font_info);
-		pdf_document->font_info = NULL;
-	}
+	pdf_document->fonts_scan_completed = TRUE;
+	poppler_font_info_free (pdf_document->font_info);
+	pdf_document->font_info = NULL;
+	g_clear_object (&pdf_document->fonts_document);
 
-	return result;
+	return FALSE;
 }
 
 static const char *
@@ -1407,118 +2080,141 @@ pdf_document_fonts_get_fonts_summary (EvDocumentFonts *document_fonts)
 }
 
 static void
-pdf_document_fonts_fill_model (EvDocumentFonts *document_fonts,
-			       GtkTreeModel    *model)
-{
-	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
-	PopplerFontsIter *iter = pdf_document->fonts_iter;
+pdf_document_fonts_add (PdfDocument      *pdf_document,
+			PopplerFontsIter *iter)
+{
+	const char *name;
+	PopplerFontType type;
+	const char *type_str;
+	const char *embedded;
+	const char *standard_str = "";
+	const gchar *substitute;
+	const gchar *filename;
+	const gchar *encoding;
+	char *details;
+	PdfFont *font;
+	gchar *key;
+
+	name = poppler_fonts_iter_get_name (iter);
+
+	if (name == NULL) {
+		name = _("No name");
+	}
 
-	g_return_if_fail (PDF_IS_DOCUMENT (document_fonts));
+	encoding = poppler_fonts_iter_get_encoding (iter);
+	if (!encoding) {
+		/* translators: When a font type does not have
+		   encoding information or it is unknown.  Example:
+		   Encoding: None
+		*/
+		encoding = _("None");
+	}
 
-	if (!iter)
-		return;
+	type = poppler_fonts_iter_get_font_type (iter);
+	type_str = font_type_to_string (type);
 
-	do {
-		GtkTreeIter list_iter;
-		const char *name;
-		PopplerFontType type;
-		const char *type_str;
-		const char *embedded;
-		const char *standard_str = "";
-		const gchar *substitute;
-		const gchar *filename;
-		const gchar *encoding;
-		char *details;
-
-		name = poppler_fonts_iter_get_name (iter);
-
-		if (name == NULL) {
-			name = _("No name");
+	if (poppler_fonts_iter_is_embedded (iter)) {
+		if (poppler_fonts_iter_is_subset (iter))
+			embedded = _("Embedded subset");
+		else
+			embedded = _("Embedded");
+	} else {
+		embedded = _("Not embedded");
+		if (is_standard_font (name, type)) {
+			/* Translators: string starting with a space
+			 * because it is directly appended to the font
+			 * type. Example:
+			 * "Type 1 (One of the Standard 14 Fonts)"
+			 */
+			standard_str = _(" (One of the Standard 14 Fonts)");
+		} else {
+			/* Translators: string starting with a space
+			 * because it is directly appended to the font
+			 * type. Example:
+			 * "TrueType (Not one of the Standard 14 Fonts)"
+			 */
+			standard_str = _(" (Not one of the Standard 14 Fonts)");
+			pdf_document->missing_fonts = TRUE;
 		}
+	}
 
-		encoding = poppler_fonts_iter_get_encoding (iter);
-		if (!encoding) {
-			/* translators: When a font type does not have
-			   encoding information or it is unknown.  Example:
-			   Encoding: None
-			*/
-			encoding = _("None");
-		}
+	/* Pages use different font objects for the same font */
+	key = g_strconcat (name, "\n", embedded, NULL);
+	if (g_hash_table_contains (pdf_document->fonts_seen, key)) {
+		g_free (key);
+		return;
+	}
+	g_hash_table_add (pdf_document->fonts_seen, key);
+
+	substitute = poppler_fonts_iter_get_substitute_name (iter);
+	filename = poppler_fonts_iter_get_file_name (iter);
+
+	if (substitute && filename)
+		/* Translators: string is a concatenation of previous
+		 * translated strings to indicate the fonts properties
+		 * in a PDF document.
+		 *
+		 * Example:
+		 * Type 1 (One of the standard 14 Fonts)
+		 * Not embedded
+		 * Substituting with TeXGyreTermes-Regular
+		 * (/usr/share/textmf/.../texgyretermes-regular.otf)
+		 */
+		details = g_markup_printf_escaped (_("%s%s\n"
+		                                     "Encoding: %s\n"
+		                                     "%s\n"
+		                                     "Substituting with <b>%s</b>\n"
+		                                     "(%s)"),
+						   type_str, standard_str,
+						   encoding, embedded,
+						   substitute, filename);
+	else
+		/* Translators: string is a concatenation of previous
+		 * translated strings to indicate the fonts properties
+		 * in a PDF document.
+		 *
+		 * Example:
+		 * TrueType (CID)
+		 * Encoding: Custom
+		 * Embedded subset
+		 */
+		details = g_markup_printf_escaped (_("%s%s\n"
+		                                     "Encoding: %s\n"
+		                                     "%s"),
+						   type_str, standard_str,
+						   encoding, embedded);
+
+	font = g_new (PdfFont, 1);
+	font->name = g_strdup (name);
+	font->details = details;
+
+	g_mutex_lock (&pdf_document->fonts_mutex);
+	g_ptr_array_add (pdf_document->fonts, font);
+	g_mutex_unlock (&pdf_document->fonts_mutex);
+}
 
-		type = poppler_fonts_iter_get_font_type (iter);
-		type_str = font_type_to_string (type);
+static void
+pdf_document_fonts_fill_model (EvDocumentFonts *document_fonts,
+			       GtkTreeModel    *model)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (document_fonts);
+	guint i;
 
-		if (poppler_fonts_iter_is_embedded (iter)) {
-			if (poppler_fonts_iter_is_subset (iter))
-				embedded = _("Embedded subset");
-			else
-				embedded = _("Embedded");
-		} else {
-			embedded = _("Not embedded");
-			if (is_standard_font (name, type)) {
-				/* Translators: string starting with a space
-				 * because it is directly appended to the font
-				 * type. Example:
-				 * "Type 1 (One of the Standard 14 Fonts)"
-				 */
-				standard_str = _(" (One of the Standard 14 Fonts)");
-			} else {
-				/* Translators: string starting with a space
-				 * because it is directly appended to the font
-				 * type. Example:
-				 * "TrueType (Not one of the Standard 14 Fonts)"
-				 */
-				standard_str = _(" (Not one of the Standard 14 Fonts)");
-				pdf_document->missing_fonts = TRUE;
-			}
-		}
+	g_return_if_fail (PDF_IS_DOCUMENT (document_fonts));
 
-		substitute = poppler_fonts_iter_get_substitute_name (iter);
-		filename = poppler_fonts_iter_get_file_name (iter);
-
-		if (substitute && filename)
-			/* Translators: string is a concatenation of previous
-			 * translated strings to indicate the fonts properties
-			 * in a PDF document.
-			 *
-			 * Example:
-			 * Type 1 (One of the standard 14 Fonts)
-			 * Not embedded
-			 * Substituting with TeXGyreTermes-Regular
-			 * (/usr/share/textmf/.../texgyretermes-regular.otf)
-			 */
-			details = g_markup_printf_escaped (_("%s%s\n"
-			                                     "Encoding: %s\n"
-			                                     "%s\n"
-			                                     "Substituting with <b>%s</b>\n"
-			                                     "(%s)"),
-							   type_str, standard_str,
-							   encoding, embedded,
-							   substitute, filename);
-		else
-			/* Translators: string is a concatenation of previous
-			 * translated strings to indicate the fonts properties
-			 * in a PDF document.
-			 *
-			 * Example:
-			 * TrueType (CID)
-			 * Encoding: Custom
-			 * Embedded subset
-			 */
-			details = g_markup_printf_escaped (_("%s%s\n"
-			                                     "Encoding: %s\n"
-			                                     "%s"),
-							   type_str, standard_str,
-							   encoding, embedded);
+	/* Only add the fonts found since the model was filled */
+	g_mutex_lock (&pdf_document->fonts_mutex);
+	for (i = gtk_tree_model_iter_n_children (model, NULL); i < pdf_document->fonts->len; i++) {
+		PdfFont *font = (PdfFont *)g_ptr_array_index (pdf_document->fonts, i);
+		GtkTreeIter list_iter;
 
 		gtk_list_store_append (GTK_LIST_STORE (model), &list_iter);
 		gtk_list_store_set (GTK_LIST_STORE (model), &list_iter,
-				    EV_DOCUMENT_FONTS_COLUMN_NAME, name,
-				    EV_DOCUMENT_FONTS_COLUMN_DETAILS, details,
+				    EV_DOCUMENT_FONTS_COLUMN_NAME, font->name,
+				    EV_DOCUMENT_FONTS_COLUMN_DETAILS, font->details,
 				    -1);
-
-		g_free (details);
-	} while (poppler_fonts_iter_next (iter));
+	}
+	g_mutex_unlock (&pdf_document->fonts_mutex);
 }
 
 static void
@@ -1759,55 +2455,11 @@ ev_link_from_action (PdfDocument   *pdf_document,
 	return link;
 }
 
-static void
-build_tree (PdfDocument      *pdf_document,
-	    GtkTreeModel     *model,
-	    GtkTreeIter      *parent,
-	    PopplerIndexIter *iter)
+static EvLink *
+pdf_document_outline_link (EvDocument    *document,
+			   PopplerAction *action)
 {
-
-	do {
-		GtkTreeIter tree_iter;
-		PopplerIndexIter *child;
-		PopplerAction *action;
-		EvLink *link = NULL;
-		gboolean expand;
-		char *title_markup;
-
-		action = poppler_index_iter_get_action (iter);
-		expand = poppler_index_iter_is_open (iter);
-
-		if (!action)
-			continue;
-
-		link = ev_link_from_action (pdf_document, action);
-		if (!link || strlen (ev_link_get_title (link)) <= 0) {
-			poppler_action_free (action);
-			if (link)
-				g_object_unref (link);
-
-			continue;
-		}
-
-		gtk_tree_store_append (GTK_TREE_STORE (model), &tree_iter, parent);
-		title_markup = g_markup_escape_text (ev_link_get_title (link), -1);
-
-		gtk_tree_store_set (GTK_TREE_STORE (model), &tree_iter,
-				    EV_DOCUMENT_LINKS_COLUMN_MARKUP, title_markup,
-				    EV_DOCUMENT_LINKS_COLUMN_LINK, link,
-				    EV_DOCUMENT_LINKS_COLUMN_EXPAND, expand,
-				    -1);
-
-		g_free (title_markup);
-		g_object_unref (link);
-
-		child = poppler_index_iter_get_child (iter);
-		if (child)
-			build_tree (pdf_document, model, &tree_iter, child);
-		poppler_index_iter_free (child);
-		poppler_action_free (action);
-
-	} while (poppler_index_iter_next (iter));
+	return ev_link_from_action (PDF_DOCUMENT (document), action);
 }
 
 static GtkTreeModel *
@@ -1822,12 +2474,8 @@ pdf_document_links_get_links_model (EvDocumentLinks *document_links)
 	iter = poppler_index_iter_new (pdf_document->document);
 	/* Create the model if we have items*/
 	if (iter != NULL) {
-		model = (GtkTreeModel *) gtk_tree_store_new (EV_DOCUMENT_LINKS_COLUMN_NUM_COLUMNS,
-							     G_TYPE_STRING,
-							     G_TYPE_OBJECT,
-							     G_TYPE_BOOLEAN,
-							     G_TYPE_STRING);
-		build_tree (pdf_document, model, NULL, iter);
+		model = pdf_outline_model_new (EV_DOCUMENT (pdf_document), iter,
+					       pdf_document_outline_link);
 		poppler_index_iter_free (iter);
 	}
 
@@ -1844,9 +2492,10 @@ pdf_document_links_get_links (EvDocumentLinks *document_links,
 	GList *mapping_list;
 	GList *list;
 	double height;
+	PdfPooledDocument *pooled;
 
 	pdf_document = PDF_DOCUMENT (document_links);
-	poppler_page = POPPLER_PAGE (page->backend_page);
+	poppler_page = pdf_document_acquire_page (pdf_document, page, &pooled);
 	mapping_list = poppler_page_get_link_mapping (poppler_page);
 	poppler_page_get_size (poppler_page, NULL, &height);
 
@@ -1868,6 +2517,8 @@ pdf_document_links_get_links (EvDocumentLinks *document_links,
 	}
 
 	poppler_page_free_link_mapping (mapping_list);
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
 
 	return ev_mapping_list_new (page->index, g_list_reverse (retval), (GDestroyNotify)g_object_unref);
 }
@@ -1985,12 +2636,77 @@ pdf_document_document_images_iface_init (EvDocumentImagesInterface *iface)
 	iface->get_image = pdf_document_images_get_image;
 }
 
+static PdfTextIndex *
+pdf_document_get_text_index (PdfDocument *pdf_document)
+{
+	PdfTextIndex *index;
+
+	index = (PdfTextIndex *)g_atomic_pointer_get (&pdf_document->text_index);
+	if (index)
+		return index;
+
+	index = pdf_text_index_new (poppler_document_get_n_pages (pdf_document->document));
+	if (!g_atomic_pointer_compare_and_exchange (&pdf_document->text_index,
+						    (PdfTextIndex *)NULL, index)) {
+		pdf_text_index_free (index);
+		index = (PdfTextIndex *)g_atomic_pointer_get (&pdf_document->text_index);
+	}
+
+	return index;
+}
+
+static gboolean
+pdf_document_find_is_page_indexed (EvDocumentFind *document_find,
+				   gint            page)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (document_find);
+
+	return pdf_text_index_has_page (pdf_document_get_text_index (pdf_document), page);
+}
+
+/* Extracts the text of the page once, in the thread of the index
+ * job, searches are answered by the text index without asking poppler.
+ */
+static void
+pdf_document_find_index_page (EvDocumentFind *document_find,
+			      EvPage         *page)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (document_find);
+	PdfTextIndex *index;
+	PdfPooledDocument *pooled;
+	PopplerPage *poppler_page;
+	PopplerRectangle *areas = NULL;
+	guint n_areas = 0;
+	gchar *text;
+
+	index = pdf_document_get_text_index (pdf_document);
+	if (pdf_text_index_has_page (index, page->index))
+		return;
+
+	poppler_page = pdf_document_acquire_page (pdf_document, page, &pooled);
+	text = poppler_page_get_text (poppler_page);
+	if (!poppler_page_get_text_layout (poppler_page, &areas, &n_areas)) {
+		areas = NULL;
+		n_areas = 0;
+	}
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
+	pdf_text_index_add_page (index, page->index, text,
+				 (EvRectangle *)areas, n_areas);
+	g_free (text);
+	g_free (areas);
+}
+
 static GList *
 pdf_document_find_find_text_with_options (EvDocumentFind *document_find,
 					  EvPage         *page,
 					  const gchar    *text,
 					  EvFindOptions   options)
 {
+	PdfDocument *pdf_document = PDF_DOCUMENT (document_find);
+	PdfPooledDocument *pooled;
+	PdfTextIndex *index;
 	GList *matches, *l;
 	PopplerPage *poppler_page;
 	gdouble height;
@@ -2000,8 +2716,6 @@ pdf_document_find_find_text_with_options (EvDocumentFind *document_find,
 	g_return_val_if_fail (POPPLER_IS_PAGE (page->backend_page), NULL);
 	g_return_val_if_fail (text != NULL, NULL);
 
-	poppler_page = POPPLER_PAGE (page->backend_page);
-
 	if (options & EV_FIND_CASE_SENSITIVE)
 		find_flags |= POPPLER_FIND_CASE_SENSITIVE;
 #if POPPLER_CHECK_VERSION(0, 76, 0)
@@ -2011,11 +2725,32 @@ pdf_document_find_find_text_with_options (EvDocumentFind *document_find,
 #endif
 	if (options & EV_FIND_WHOLE_WORDS_ONLY)
 		find_flags |= POPPLER_FIND_WHOLE_WORDS_ONLY;
+
+	/* Pages are indexed by the index job, the ones that aren't
+	 * yet, or whose text layout doesn't match their text, are
+	 * searched by poppler.
+	 */
+	index = pdf_document_get_text_index (pdf_document);
+	if (pdf_text_index_find (index, page->index, text,
+				 (find_flags & POPPLER_FIND_CASE_SENSITIVE) != 0,
+#if POPPLER_CHECK_VERSION(0, 76, 0)
+				 (find_flags & POPPLER_FIND_IGNORE_DIACRITICS) != 0,
+#else
+				 FALSE,
+#endif
+				 (find_flags & POPPLER_FIND_WHOLE_WORDS_ONLY) != 0,
+				 &retval))
+		return retval;
+
+	poppler_page = pdf_document_acquire_page (pdf_document, page, &pooled);
 	matches = poppler_page_find_text_with_options (poppler_page, text, (PopplerFindFlags)find_flags);
+	poppler_page_get_size (poppler_page, NULL, &height);
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
 	if (!matches)
 		return NULL;
 
-	poppler_page_get_size (poppler_page, NULL, &height);
 	for (l = matches; l && l->data; l = g_list_next (l)) {
 		PopplerRectangle *rect = (PopplerRectangle *)l->data;
 		EvRectangle      *ev_rect;
@@ -2062,6 +2797,8 @@ pdf_document_find_iface_init (EvDocumentFindInterface *iface)
         iface->find_text = pdf_document_find_find_text;
 	iface->find_text_with_options = pdf_document_find_find_text_with_options;
 	iface->get_supported_options = pdf_document_find_get_supported_options;
+	iface->is_page_indexed = pdf_document_find_is_page_indexed;
+	iface->index_page = pdf_document_find_index_page;
 }
 
 static void
@@ -2190,30 +2927,21 @@ pdf_document_file_exporter_begin_page (EvFileExporter *exporter)
 #endif /* HAVE_CAIRO_PRINT */
 }
 
+#ifdef HAVE_CAIRO_PRINT
+/* Sets up the print context to draw the next page of the sheet */
 static void
-pdf_document_file_exporter_do_page (EvFileExporter  *exporter,
-				    EvRenderContext *rc)
+pdf_print_context_begin_page (PdfPrintContext *ctx,
+			      gdouble          page_width,
+			      gdouble          page_height)
 {
-	PdfDocument *pdf_document = PDF_DOCUMENT (exporter);
-	PdfPrintContext *ctx = pdf_document->print_ctx;
-	PopplerPage *poppler_page;
-#ifdef HAVE_CAIRO_PRINT
-	gdouble  page_width, page_height;
 	gint     x, y;
 	gboolean rotate;
 	gdouble  width, height;
 	gdouble  pwidth, pheight;
 	gdouble  xscale, yscale;
-#endif
-
-	g_return_if_fail (pdf_document->print_ctx != NULL);
 
-	poppler_page = POPPLER_PAGE (rc->page->backend_page);
-
-#ifdef HAVE_CAIRO_PRINT
 	x = (ctx->pages_printed % ctx->pages_per_sheet) % ctx->pages_x;
 	y = (ctx->pages_printed % ctx->pages_per_sheet) / ctx->pages_x;
-	poppler_page_get_size (poppler_page, &page_width, &page_height);
 
 	if (page_width > page_height && page_width > ctx->paper_width) {
 		rotate = TRUE;
@@ -2284,18 +3012,96 @@ pdf_document_file_exporter_do_page (EvFileExporter  *exporter,
 			 x * (rotate ? pheight : pwidth),
 			 y * (rotate ? pwidth : pheight));
 	cairo_scale (ctx->cr, xscale, yscale);
+}
 
-	poppler_page_render_for_printing (poppler_page, ctx->cr);
-
+static void
+pdf_print_context_end_page (PdfPrintContext *ctx)
+{
 	ctx->pages_printed++;
 
 	cairo_restore (ctx->cr);
+}
+#endif /* HAVE_CAIRO_PRINT */
+
+static void
+pdf_document_file_exporter_do_page (EvFileExporter  *exporter,
+				    EvRenderContext *rc)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (exporter);
+	PdfPrintContext *ctx = pdf_document->print_ctx;
+	PopplerPage *poppler_page;
+#ifdef HAVE_CAIRO_PRINT
+	gdouble  page_width, page_height;
+#endif
+
+	g_return_if_fail (pdf_document->print_ctx != NULL);
+
+	poppler_page = POPPLER_PAGE (rc->page->backend_page);
+
+#ifdef HAVE_CAIRO_PRINT
+	poppler_page_get_size (poppler_page, &page_width, &page_height);
+
+	pdf_print_context_begin_page (ctx, page_width, page_height);
+	poppler_page_render_for_printing (poppler_page, ctx->cr);
+	pdf_print_context_end_page (ctx);
 #else /* HAVE_CAIRO_PRINT */
 	if (ctx->format == EV_FILE_FORMAT_PS)
 		poppler_page_render_to_ps (poppler_page, ctx->ps_file);
 #endif /* HAVE_CAIRO_PRINT */
 }
 
+#ifdef HAVE_CAIRO_PRINT
+static cairo_surface_t *
+pdf_document_file_exporter_record_page (EvFileExporter *exporter,
+					gint            page)
+{
+	PdfDocument       *pdf_document = PDF_DOCUMENT (exporter);
+	PdfPooledDocument *pooled;
+	PopplerPage       *poppler_page;
+	cairo_surface_t   *surface = NULL;
+	cairo_rectangle_t  extents = { 0, 0, 0, 0 };
+	cairo_t           *cr;
+
+	/* This runs in the print workers, without the document lock */
+	pooled = pdf_document_acquire_full (pdf_document, FALSE);
+	if (!pooled)
+		return NULL;
+
+	poppler_page = poppler_document_get_page (pooled->document, page);
+	if (poppler_page) {
+		poppler_page_get_size (poppler_page, &extents.width, &extents.height);
+
+		surface = cairo_recording_surface_create (CAIRO_CONTENT_COLOR_ALPHA, &extents);
+		cr = cairo_create (surface);
+		poppler_page_render_for_printing (poppler_page, cr);
+		cairo_destroy (cr);
+
+		g_object_unref (poppler_page);
+	}
+	pdf_document_release (pdf_document, pooled);
+
+	return surface;
+}
+
+static void
+pdf_document_file_exporter_do_recorded_page (EvFileExporter  *exporter,
+					     cairo_surface_t *recording)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (exporter);
+	PdfPrintContext *ctx = pdf_document->print_ctx;
+	cairo_rectangle_t extents;
+
+	g_return_if_fail (pdf_document->print_ctx != NULL);
+
+	cairo_recording_surface_get_extents (recording, &extents);
+
+	pdf_print_context_begin_page (ctx, extents.width, extents.height);
+	cairo_set_source_surface (ctx->cr, recording, 0, 0);
+	cairo_paint (ctx->cr);
+	pdf_print_context_end_page (ctx);
+}
+#endif /* HAVE_CAIRO_PRINT */
+
 static void
 pdf_document_file_exporter_end_page (EvFileExporter *exporter)
 {
@@ -2317,6 +3123,32 @@ pdf_document_file_exporter_end (EvFileExporter *exporter)
 	pdf_document->print_ctx = NULL;
 }
 
+static GFile *
+pdf_document_file_exporter_get_source_file (EvFileExporter       *exporter,
+					    EvFileExporterFormat  format)
+{
+	PdfDocument *pdf_document = PDF_DOCUMENT (exporter);
+	GFile       *file = NULL;
+
+	/* The printer couldn't open an encrypted file */
+	if (format != EV_FILE_FORMAT_PDF || pdf_document->password ||
+	    ev_document_get_modified (EV_DOCUMENT (exporter)))
+		return NULL;
+
+	/* Changing annotations, forms or layers disables the pool, the
+	 * file doesn't have those changes then */
+	g_mutex_lock (&pdf_document->pool_mutex);
+	if (pdf_document->file && !pdf_document->pool_disabled)
+		file = G_FILE (g_object_ref (pdf_document->file));
+	g_mutex_unlock (&pdf_document->pool_mutex);
+
+	/* A file rewritten since it was loaded isn't what's on screen */
+	if (file && !pdf_document_file_is_unchanged (pdf_document))
+		g_clear_object (&file);
+
+	return file;
+}
+
 static EvFileExporterCapabilities
 pdf_document_file_exporter_get_capabilities (EvFileExporter *exporter)
 {
@@ -2342,9 +3174,14 @@ pdf_document_file_exporter_iface_init (EvFileExporterInterface *iface)
         iface->begin = pdf_document_file_exporter_begin;
 	iface->begin_page = pdf_document_file_exporter_begin_page;
         iface->do_page = pdf_document_file_exporter_do_page;
+#ifdef HAVE_CAIRO_PRINT
+	iface->record_page = pdf_document_file_exporter_record_page;
+	iface->do_recorded_page = pdf_document_file_exporter_do_recorded_page;
+#endif
 	iface->end_page = pdf_document_file_exporter_end_page;
         iface->end = pdf_document_file_exporter_end;
 	iface->get_capabilities = pdf_document_file_exporter_get_capabilities;
+	iface->get_source_file = pdf_document_file_exporter_get_source_file;
 }
 
 /* EvDocumentPrint */
@@ -2372,6 +3209,8 @@ pdf_selection_render_selection (EvSelection      *selection,
 				GdkColor         *text,
 				GdkColor         *base)
 {
+	PdfDocument *pdf_document = PDF_DOCUMENT (selection);
+	PdfPooledDocument *pooled;
 	PopplerPage *poppler_page;
 	cairo_t *cr;
 	PopplerColor text_color, base_color;
@@ -2379,7 +3218,7 @@ pdf_selection_render_selection (EvSelection      *selection,
 	gint width, height;
 	double xscale, yscale;
 
-	poppler_page = POPPLER_PAGE (rc->page->backend_page);
+	poppler_page = pdf_document_acquire_page (pdf_document, rc->page, &pooled);
 
 	poppler_page_get_size (poppler_page,
 			       &width_points, &height_points);
@@ -2414,6 +3253,9 @@ pdf_selection_render_selection (EvSelection      *selection,
 				       &text_color,
 				       &base_color);
 	cairo_destroy (cr);
+
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
 }
 
 static gchar *
@@ -2471,19 +3313,24 @@ pdf_selection_get_selection_region (EvSelection     *selection,
 				    EvSelectionStyle style,
 				    EvRectangle     *points)
 {
-	PopplerPage    *poppler_page;
-	cairo_region_t *retval;
-	GList          *region;
+	PdfDocument       *pdf_document = PDF_DOCUMENT (selection);
+	PdfPooledDocument *pooled;
+	PopplerPage       *poppler_page;
+	cairo_region_t    *retval;
+	GList             *region;
 	double page_width, page_height;
 	double xscale, yscale;
 
-	poppler_page = POPPLER_PAGE (rc->page->backend_page);
+	poppler_page = pdf_document_acquire_page (pdf_document, rc->page, &pooled);
 	region = poppler_page_get_selection_region (poppler_page,
 						    1.0,
 						    (PopplerSelectionStyle)style,
 						    (PopplerRectangle *) points);
 	poppler_page_get_size (poppler_page,
 			       &page_width, &page_height);
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
 	ev_render_context_compute_scales (rc, page_width, page_height, &xscale, &yscale);
 	retval = create_region_from_poppler_region (region, xscale, yscale);
 	g_list_free (region);
@@ -2505,6 +3352,8 @@ static cairo_region_t *
 pdf_document_text_get_text_mapping (EvDocumentText *document_text,
 				    EvPage         *page)
 {
+	PdfDocument *pdf_document = PDF_DOCUMENT (document_text);
+	PdfPooledDocument *pooled;
 	PopplerPage *poppler_page;
 	PopplerRectangle points;
 	GList *region;
@@ -2512,7 +3361,7 @@ pdf_document_text_get_text_mapping (EvDocumentText *document_text,
 
 	g_return_val_if_fail (POPPLER_IS_PAGE (page->backend_page), NULL);
 
-	poppler_page = POPPLER_PAGE (page->backend_page);
+	poppler_page = pdf_document_acquire_page (pdf_document, page, &pooled);
 
 	points.x1 = 0.0;
 	points.y1 = 0.0;
@@ -2521,6 +3370,9 @@ pdf_document_text_get_text_mapping (EvDocumentText *document_text,
 	region = poppler_page_get_selection_region (poppler_page, 1.0,
 						    POPPLER_SELECTION_GLYPH,
 						    &points);
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
 	retval = create_region_from_poppler_region (region, 1.0, 1.0);
 	g_list_free (region);
 
@@ -2531,9 +3383,19 @@ static gchar *
 pdf_document_text_get_text (EvDocumentText  *selection,
 			    EvPage          *page)
 {
+	PdfDocument *pdf_document = PDF_DOCUMENT (selection);
+	PdfPooledDocument *pooled;
+	PopplerPage *poppler_page;
+	gchar *text;
+
 	g_return_val_if_fail (POPPLER_IS_PAGE (page->backend_page), NULL);
 
-	return poppler_page_get_text (POPPLER_PAGE (page->backend_page));
+	poppler_page = pdf_document_acquire_page (pdf_document, page, &pooled);
+	text = poppler_page_get_text (poppler_page);
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
+	return text;
 }
 
 static gboolean
@@ -2542,22 +3404,39 @@ pdf_document_text_get_text_layout (EvDocumentText  *selection,
 				   EvRectangle    **areas,
 				   guint           *n_areas)
 {
+	PdfDocument *pdf_document = PDF_DOCUMENT (selection);
+	PdfPooledDocument *pooled;
+	PopplerPage *poppler_page;
+	gboolean retval;
+
 	g_return_val_if_fail (POPPLER_IS_PAGE (page->backend_page), FALSE);
 
-	return poppler_page_get_text_layout (POPPLER_PAGE (page->backend_page),
-					     (PopplerRectangle **)areas, n_areas);
+	poppler_page = pdf_document_acquire_page (pdf_document, page, &pooled);
+	retval = poppler_page_get_text_layout (poppler_page,
+					       (PopplerRectangle **)areas, n_areas);
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
+	return retval;
 }
 
 static PangoAttrList *
 pdf_document_text_get_text_attrs (EvDocumentText *document_text,
 				  EvPage         *page)
 {
+	PdfDocument       *pdf_document = PDF_DOCUMENT (document_text);
+	PdfPooledDocument *pooled;
+	PopplerPage       *poppler_page;
 	GList         *backend_attrs_list,  *l;
 	PangoAttrList *attrs_list;
 
 	g_return_val_if_fail (POPPLER_IS_PAGE (page->backend_page), NULL);
 
-	backend_attrs_list = poppler_page_get_text_attributes (POPPLER_PAGE (page->backend_page));
+	poppler_page = pdf_document_acquire_page (pdf_document, page, &pooled);
+	backend_attrs_list = poppler_page_get_text_attributes (poppler_page);
+	g_object_unref (poppler_page);
+	pdf_document_release (pdf_document, pooled);
+
 	if (!backend_attrs_list)
 		return NULL;
 
@@ -2871,9 +3750,11 @@ pdf_document_forms_reset_form (EvDocumentForms *document,
                                EvLinkAction    *action)
 {
 #if POPPLER_CHECK_VERSION(0, 90, 0)
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_document_reset_form (PDF_DOCUMENT (document)->document,
 	                             ev_link_action_get_reset_fields (action),
 	                             ev_link_action_get_exclude_reset_fields (action));
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 #endif
 }
 
@@ -2905,7 +3786,9 @@ pdf_document_forms_form_field_text_set_text (EvDocumentForms *document,
 	if (!poppler_field)
 		return;
 
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_form_field_text_set_text (poppler_field, text);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
@@ -2921,7 +3804,9 @@ pdf_document_forms_form_field_button_set_state (EvDocumentForms *document,
 	if (!poppler_field)
 		return;
 
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_form_field_button_set_state (poppler_field, state);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
@@ -3003,7 +3888,9 @@ pdf_document_forms_form_field_choice_select_item (EvDocumentForms *document,
 	if (!poppler_field)
 		return;
 
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_form_field_choice_select_item (poppler_field, index);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
@@ -3019,7 +3906,9 @@ pdf_document_forms_form_field_choice_toggle_item (EvDocumentForms *document,
 	if (!poppler_field)
 		return;
 
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_form_field_choice_toggle_item (poppler_field, index);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
@@ -3034,7 +3923,9 @@ pdf_document_forms_form_field_choice_unselect_all (EvDocumentForms *document,
 	if (!poppler_field)
 		return;
 
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_form_field_choice_unselect_all (poppler_field);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
@@ -3050,7 +3941,9 @@ pdf_document_forms_form_field_choice_set_text (EvDocumentForms *document,
 	if (!poppler_field)
 		return;
 
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_form_field_choice_set_text (poppler_field, text);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 	PDF_DOCUMENT (document)->forms_modified = TRUE;
 	ev_document_set_modified (EV_DOCUMENT (document), TRUE);
 }
@@ -3437,6 +4330,10 @@ pdf_document_annotations_get_annotations (EvDocumentAnnotations *document_annota
 			return ev_mapping_list_ref (mapping_list);
 	}
 
+	if (pdf_document->pages_without_annots &&
+	    g_hash_table_contains (pdf_document->pages_without_annots, GINT_TO_POINTER (page->index)))
+		return NULL;
+
 	annots = poppler_page_get_annot_mapping (poppler_page);
 	poppler_page_get_size (poppler_page, NULL, &height);
 
@@ -3486,8 +4383,13 @@ pdf_document_annotations_get_annotations (EvDocumentAnnotations *document_annota
 
 	poppler_page_free_annot_mapping (annots);
 
-	if (!retval)
+	if (!retval) {
+		if (!pdf_document->pages_without_annots)
+			pdf_document->pages_without_annots = g_hash_table_new (g_direct_hash, g_direct_equal);
+		g_hash_table_add (pdf_document->pages_without_annots, GINT_TO_POINTER (page->index));
+
 		return NULL;
+	}
 
 	if (!pdf_document->annots) {
 		pdf_document->annots = g_hash_table_new_full (g_direct_hash,
@@ -3526,7 +4428,9 @@ pdf_document_annotations_remove_annotation (EvDocumentAnnotations *document_anno
         page = ev_annotation_get_page (annot);
         poppler_page = POPPLER_PAGE (page->backend_page);
 
+        pdf_document_begin_edit (pdf_document);
 	poppler_page_remove_annot (poppler_page, poppler_annot);
+        pdf_document_end_edit (pdf_document);
 
         /* We don't check for pdf_document->annots, if it were NULL then something is really wrong */
         mapping_list = (EvMappingList *)g_hash_table_lookup (pdf_document->annots,
@@ -3638,6 +4542,8 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 	page = ev_annotation_get_page (annot);
 	poppler_page = POPPLER_PAGE (page->backend_page);
 
+	pdf_document_begin_edit (pdf_document);
+
 	ev_annotation_get_area (annot, &rect);
 
 	poppler_page_get_size (poppler_page, NULL, &height);
@@ -3719,6 +4625,8 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 
 	poppler_page_add_annot (poppler_page, poppler_annot);
 
+	pdf_document_end_edit (pdf_document);
+
 	annot_mapping = g_new (EvMapping, 1);
 	annot_mapping->area = rect;
 	annot_mapping->data = annot;
@@ -3743,6 +4651,9 @@ pdf_document_annotations_add_annotation (EvDocumentAnnotations *document_annotat
 
 	annot_set_unique_name (annot);
 
+	if (pdf_document->pages_without_annots)
+		g_hash_table_remove (pdf_document->pages_without_annots, GINT_TO_POINTER (page->index));
+
 	if (mapping_list) {
 		list = ev_mapping_list_get_list (mapping_list);
 		list = g_list_append (list, annot_mapping);
@@ -3810,6 +4721,8 @@ pdf_document_annotations_save_annotation (EvDocumentAnnotations *document_annota
 	if (!poppler_annot)
 		return;
 
+	pdf_document_begin_edit (PDF_DOCUMENT (document_annotations));
+
 	if (mask & EV_ANNOTATIONS_SAVE_CONTENTS)
 		poppler_annot_set_contents (poppler_annot,
 					    ev_annotation_get_contents (annot));
@@ -3973,6 +4886,8 @@ pdf_document_annotations_save_annotation (EvDocumentAnnotations *document_annota
 		}
 	}
 
+	pdf_document_end_edit (PDF_DOCUMENT (document_annotations));
+
 	PDF_DOCUMENT (document_annotations)->annots_modified = TRUE;
 	ev_document_set_modified (EV_DOCUMENT (document_annotations), TRUE);
 }
@@ -4479,8 +5394,11 @@ pdf_document_layers_show_layer (EvDocumentLayers *document,
 {
 	PopplerLayer *poppler_layer;
 
+	/* Layers are only shown and hidden in the loaded document */
 	poppler_layer = POPPLER_LAYER (g_object_get_data (G_OBJECT (layer), "poppler-layer"));
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_layer_show (poppler_layer);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 }
 
 static void
@@ -4489,8 +5407,11 @@ pdf_document_layers_hide_layer (EvDocumentLayers *document,
 {
 	PopplerLayer *poppler_layer;
 
+	/* Layers are only shown and hidden in the loaded document */
 	poppler_layer = POPPLER_LAYER (g_object_get_data (G_OBJECT (layer), "poppler-layer"));
+	pdf_document_begin_edit (PDF_DOCUMENT (document));
 	poppler_layer_hide (poppler_layer);
+	pdf_document_end_edit (PDF_DOCUMENT (document));
 }
 
 static gboolean
@@ -0,0 +1,477 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include "ev-document-links.h"
+#include "pdf-outline-model.h"
+
+/* A tree model of the document outline that reads the entries from
+ * poppler's index iterator when they are needed, instead of building
+ * the whole tree up front. The entries of a level are read the first
+ * time the level is asked for, which the tree view does when the parent
+ * row is shown or expanded. Links and page labels are only resolved when
+ * their columns are read.
+ *
+ * Rows are never removed, so iterators persist. The model is created in
+ * the links job, with the document lock held; everything else happens in
+ * the main thread, which takes the document lock to read the outline.
+ */
+
+typedef struct _PdfOutlineNode PdfOutlineNode;
+
+struct _PdfOutlineNode {
+	PdfOutlineNode   *parent;
+	guint             index;
+	/* NULL until the entries of the level below are read */
+	GPtrArray        *children;
+
+	/* Iterator on this entry, or on the first top level entry for the root */
+	PopplerIndexIter *iter;
+	gchar            *markup;
+	gboolean          expand;
+
+	EvLink           *link;
+	gchar            *page_label;
+	gboolean          page_label_loaded;
+};
+
+struct _PdfOutlineModel {
+	GObject             parent_instance;
+
+	EvDocument         *document;
+	PdfOutlineLinkFunc  link_func;
+	PdfOutlineNode     *root;
+	gint                stamp;
+};
+
+static void pdf_outline_model_tree_model_init (GtkTreeModelIface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (PdfOutlineModel, pdf_outline_model, G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL,
+						pdf_outline_model_tree_model_init))
+
+static void
+pdf_outline_node_free (PdfOutlineNode *node)
+{
+	if (node->children)
+		g_ptr_array_free (node->children, TRUE);
+	if (node->iter)
+		poppler_index_iter_free (node->iter);
+	g_free (node->markup);
+	g_clear_object (&node->link);
+	g_free (node->page_label);
+	g_free (node);
+}
+
+static void
+pdf_outline_node_load_children (PdfOutlineNode *node)
+{
+	PopplerIndexIter *iter;
+
+	node->children = g_ptr_array_new_with_free_func ((GDestroyNotify) pdf_outline_node_free);
+
+	if (node->parent)
+		iter = poppler_index_iter_get_child (node->iter);
+	else
+		iter = poppler_index_iter_copy (node->iter);
+	if (!iter)
+		return;
+
+	do {
+		PdfOutlineNode *child;
+		PopplerAction  *action;
+
+		action = poppler_index_iter_get_action (iter);
+		if (!action)
+			continue;
+
+		/* Entries without a title are left out, with their children */
+		if (!action->any.title || action->any.title[0] == '\0') {
+			poppler_action_free (action);
+			continue;
+		}
+
+		child = g_new0 (PdfOutlineNode, 1);
+		child->parent = node;
+		child->index = node->children->len;
+		child->iter = poppler_index_iter_copy (iter);
+		child->markup = g_markup_escape_text (action->any.title, -1);
+		child->expand = poppler_index_iter_is_open (iter);
+		g_ptr_array_add (node->children, child);
+
+		poppler_action_free (action);
+	} while (poppler_index_iter_next (iter));
+
+	poppler_index_iter_free (iter);
+}
+
+static GPtrArray *
+pdf_outline_model_get_children (PdfOutlineModel *model,
+				PdfOutlineNode  *node)
+{
+	if (!node->children) {
+		ev_document_doc_mutex_lock ();
+		pdf_outline_node_load_children (node);
+		ev_document_doc_mutex_unlock ();
+	}
+
+	return node->children;
+}
+
+static EvLink *
+pdf_outline_model_get_link (PdfOutlineModel *model,
+			    PdfOutlineNode  *node)
+{
+	PopplerAction *action;
+
+	if (node->link)
+		return node->link;
+
+	ev_document_doc_mutex_lock ();
+	action = poppler_index_iter_get_action (node->iter);
+	if (action) {
+		node->link = model->link_func (model->document, action);
+		poppler_action_free (action);
+	}
+	ev_document_doc_mutex_unlock ();
+
+	return node->link;
+}
+
+static const gchar *
+pdf_outline_model_get_page_label (PdfOutlineModel *model,
+				  PdfOutlineNode  *node)
+{
+	EvLink *link;
+
+	if (node->page_label_loaded)
+		return node->page_label;
+
+	link = pdf_outline_model_get_link (model, node);
+	if (link) {
+		ev_document_doc_mutex_lock ();
+		node->page_label = ev_document_links_get_link_page_label (EV_DOCUMENT_LINKS (model->document),
+									  link);
+		ev_document_doc_mutex_unlock ();
+	}
+	node->page_label_loaded = TRUE;
+
+	return node->page_label;
+}
+
+static gboolean
+pdf_outline_model_set_iter (PdfOutlineModel *model,
+			    GtkTreeIter     *iter,
+			    GPtrArray       *nodes,
+			    guint            index)
+{
+	if (index >= nodes->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	iter->stamp = model->stamp;
+	iter->user_data = g_ptr_array_index (nodes, index);
+
+	return TRUE;
+}
+
+static GtkTreeModelFlags
+pdf_outline_model_get_flags (GtkTreeModel *tree_model)
+{
+	return GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint
+pdf_outline_model_get_n_columns (GtkTreeModel *tree_model)
+{
+	return EV_DOCUMENT_LINKS_COLUMN_NUM_COLUMNS;
+}
+
+static GType
+pdf_outline_model_get_column_type (GtkTreeModel *tree_model,
+				   gint          column)
+{
+	switch (column) {
+	case EV_DOCUMENT_LINKS_COLUMN_MARKUP:
+	case EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL:
+		return G_TYPE_STRING;
+	case EV_DOCUMENT_LINKS_COLUMN_LINK:
+		return G_TYPE_OBJECT;
+	case EV_DOCUMENT_LINKS_COLUMN_EXPAND:
+		return G_TYPE_BOOLEAN;
+	default:
+		g_assert_not_reached ();
+	}
+
+	return G_TYPE_INVALID;
+}
+
+static gboolean
+pdf_outline_model_get_iter (GtkTreeModel *tree_model,
+			    GtkTreeIter  *iter,
+			    GtkTreePath  *path)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node = model->root;
+	GPtrArray       *nodes;
+	gint            *indices;
+	gint             depth, i;
+
+	indices = gtk_tree_path_get_indices_with_depth (path, &depth);
+	if (depth <= 0)
+		return FALSE;
+
+	for (i = 0; i < depth; i++) {
+		nodes = pdf_outline_model_get_children (model, node);
+		if (indices[i] < 0 || (guint) indices[i] >= nodes->len) {
+			iter->stamp = 0;
+			return FALSE;
+		}
+		node = (PdfOutlineNode *) g_ptr_array_index (nodes, indices[i]);
+	}
+
+	iter->stamp = model->stamp;
+	iter->user_data = node;
+
+	return TRUE;
+}
+
+static GtkTreePath *
+pdf_outline_model_get_path (GtkTreeModel *tree_model,
+			    GtkTreeIter  *iter)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node;
+	GtkTreePath     *path;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, NULL);
+
+	path = gtk_tree_path_new ();
+	for (node = (PdfOutlineNode *) iter->user_data; node->parent; node = node->parent)
+		gtk_tree_path_prepend_index (path, node->index);
+
+	return path;
+}
+
+static void
+pdf_outline_model_get_value (GtkTreeModel *tree_model,
+			     GtkTreeIter  *iter,
+			     gint          column,
+			     GValue       *value)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node;
+
+	g_return_if_fail (iter->stamp == model->stamp);
+
+	node = (PdfOutlineNode *) iter->user_data;
+	g_value_init (value, pdf_outline_model_get_column_type (tree_model, column));
+
+	switch (column) {
+	case EV_DOCUMENT_LINKS_COLUMN_MARKUP:
+		g_value_set_string (value, node->markup);
+		break;
+	case EV_DOCUMENT_LINKS_COLUMN_LINK:
+		g_value_set_object (value, pdf_outline_model_get_link (model, node));
+		break;
+	case EV_DOCUMENT_LINKS_COLUMN_EXPAND:
+		g_value_set_boolean (value, node->expand);
+		break;
+	case EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL:
+		g_value_set_string (value, pdf_outline_model_get_page_label (model, node));
+		break;
+	default:
+		break;
+	}
+}
+
+static gboolean
+pdf_outline_model_iter_next (GtkTreeModel *tree_model,
+			     GtkTreeIter  *iter)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, FALSE);
+
+	node = (PdfOutlineNode *) iter->user_data;
+
+	return pdf_outline_model_set_iter (model, iter, node->parent->children, node->index + 1);
+}
+
+static gboolean
+pdf_outline_model_iter_previous (GtkTreeModel *tree_model,
+				 GtkTreeIter  *iter)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node;
+
+	g_return_val_if_fail (iter->stamp == model->stamp, FALSE);
+
+	node = (PdfOutlineNode *) iter->user_data;
+	if (node->index == 0) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	return pdf_outline_model_set_iter (model, iter, node->parent->children, node->index - 1);
+}
+
+static gboolean
+pdf_outline_model_iter_nth_child (GtkTreeModel *tree_model,
+				  GtkTreeIter  *iter,
+				  GtkTreeIter  *parent,
+				  gint          n)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node;
+
+	node = parent ? (PdfOutlineNode *) parent->user_data : model->root;
+	if (n < 0) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	return pdf_outline_model_set_iter (model, iter,
+					   pdf_outline_model_get_children (model, node),
+					   n);
+}
+
+static gboolean
+pdf_outline_model_iter_children (GtkTreeModel *tree_model,
+				 GtkTreeIter  *iter,
+				 GtkTreeIter  *parent)
+{
+	return pdf_outline_model_iter_nth_child (tree_model, iter, parent, 0);
+}
+
+static gint
+pdf_outline_model_iter_n_children (GtkTreeModel *tree_model,
+				   GtkTreeIter  *iter)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node;
+
+	node = iter ? (PdfOutlineNode *) iter->user_data : model->root;
+
+	return pdf_outline_model_get_children (model, node)->len;
+}
+
+static gboolean
+pdf_outline_model_iter_has_child (GtkTreeModel *tree_model,
+				  GtkTreeIter  *iter)
+{
+	return pdf_outline_model_iter_n_children (tree_model, iter) > 0;
+}
+
+static gboolean
+pdf_outline_model_iter_parent (GtkTreeModel *tree_model,
+			       GtkTreeIter  *iter,
+			       GtkTreeIter  *child)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (tree_model);
+	PdfOutlineNode  *node;
+
+	g_return_val_if_fail (child->stamp == model->stamp, FALSE);
+
+	node = ((PdfOutlineNode *) child->user_data)->parent;
+	if (!node->parent) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	iter->stamp = model->stamp;
+	iter->user_data = node;
+
+	return TRUE;
+}
+
+static void
+pdf_outline_model_finalize (GObject *object)
+{
+	PdfOutlineModel *model = PDF_OUTLINE_MODEL (object);
+
+	pdf_outline_node_free (model->root);
+	g_object_unref (model->document);
+
+	G_OBJECT_CLASS (pdf_outline_model_parent_class)->finalize (object);
+}
+
+static void
+pdf_outline_model_init (PdfOutlineModel *model)
+{
+	do {
+		model->stamp = g_random_int ();
+	} while (model->stamp == 0);
+}
+
+static void
+pdf_outline_model_class_init (PdfOutlineModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	object_class->finalize = pdf_outline_model_finalize;
+}
+
+static void
+pdf_outline_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags = pdf_outline_model_get_flags;
+	iface->get_n_columns = pdf_outline_model_get_n_columns;
+	iface->get_column_type = pdf_outline_model_get_column_type;
+	iface->get_iter = pdf_outline_model_get_iter;
+	iface->get_path = pdf_outline_model_get_path;
+	iface->get_value = pdf_outline_model_get_value;
+	iface->iter_next = pdf_outline_model_iter_next;
+	iface->iter_previous = pdf_outline_model_iter_previous;
+	iface->iter_children = pdf_outline_model_iter_children;
+	iface->iter_has_child = pdf_outline_model_iter_has_child;
+	iface->iter_n_children = pdf_outline_model_iter_n_children;
+	iface->iter_nth_child = pdf_outline_model_iter_nth_child;
+	iface->iter_parent = pdf_outline_model_iter_parent;
+}
+
+/*
+ * pdf_outline_model_new:
+ * @document: the document of the outline
+ * @iter: an iterator on the first top level entry of the outline
+ * @link_func: the function creating the link of an entry
+ *
+ * Creates a model of the outline, reading its top level entries. This
+ * must be called with the document lock held.
+ *
+ * Returns: a new #GtkTreeModel
+ */
+GtkTreeModel *
+pdf_outline_model_new (EvDocument         *document,
+		       PopplerIndexIter   *iter,
+		       PdfOutlineLinkFunc  link_func)
+{
+	PdfOutlineModel *model;
+
+	model = PDF_OUTLINE_MODEL (g_object_new (PDF_TYPE_OUTLINE_MODEL, NULL));
+	model->document = EV_DOCUMENT (g_object_ref (document));
+	model->link_func = link_func;
+
+	model->root = g_new0 (PdfOutlineNode, 1);
+	model->root->iter = poppler_index_iter_copy (iter);
+	pdf_outline_node_load_children (model->root);
+
+	return GTK_TREE_MODEL (model);
+}
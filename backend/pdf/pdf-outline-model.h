@@ -0,0 +1,41 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PDF_OUTLINE_MODEL_H__
+#define __PDF_OUTLINE_MODEL_H__
+
+#include <gtk/gtk.h>
+#include <poppler.h>
+
+#include "ev-document.h"
+#include "ev-link.h"
+
+G_BEGIN_DECLS
+
+#define PDF_TYPE_OUTLINE_MODEL pdf_outline_model_get_type ()
+G_DECLARE_FINAL_TYPE (PdfOutlineModel, pdf_outline_model, PDF, OUTLINE_MODEL, GObject)
+
+typedef EvLink *(* PdfOutlineLinkFunc) (EvDocument    *document,
+					PopplerAction *action);
+
+GtkTreeModel *pdf_outline_model_new (EvDocument         *document,
+				     PopplerIndexIter   *iter,
+				     PdfOutlineLinkFunc  link_func);
+
+G_END_DECLS
+
+#endif /* __PDF_OUTLINE_MODEL_H__ */
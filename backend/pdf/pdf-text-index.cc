@@ -0,0 +1,416 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include "pdf-text-index.h"
+
+/* The text of every page is extracted once, with the box of every
+ * character, and searched in memory. Poppler extracts the text layout
+ * of the page again on every search, which makes searching a big
+ * document take seconds every time the search text changes.
+ *
+ * Matches are the same poppler finds:
+ *  - Text is compared after compatibility decomposition, poppler uses
+ *    the compatibility composition, which is equivalent.
+ *  - Case insensitive searches compare characters converted to upper
+ *    case one by one, like poppler does.
+ *  - Diacritics are only ignored when the search text is ASCII.
+ *  - Matches don't span lines, the line breaks poppler puts between the
+ *    lines of the page text end any match, even if the search text has
+ *    line breaks too.
+ *  - Whole word matches can't be preceded nor followed by letters or
+ *    digits.
+ *  - Matches don't overlap, the search goes on after the end of a match.
+ */
+
+typedef enum {
+	FOLD_NONE,
+	FOLD_CASE,
+	FOLD_CASE_AND_DIACRITICS
+} PdfTextFold;
+
+typedef struct {
+	/* Compatibility decomposition of the page text */
+	gunichar *chars;
+	guint     n_chars;
+	/* Page character of every decomposed one, NULL if they are the same */
+	guint32  *origins;
+
+	/* x1, y1, x2, y2 of every page character, times scale */
+	guint16  *boxes;
+	guint     n_boxes;
+	gdouble   scale;
+} PdfTextIndexPage;
+
+/* Pages whose text layout doesn't match the text */
+static PdfTextIndexPage page_not_indexed;
+
+struct _PdfTextIndex {
+	GMutex             mutex;
+	gint               n_pages;
+	PdfTextIndexPage **pages;
+};
+
+static void
+pdf_text_index_page_free (PdfTextIndexPage *index_page)
+{
+	if (!index_page || index_page == &page_not_indexed)
+		return;
+
+	g_free (index_page->chars);
+	g_free (index_page->origins);
+	g_free (index_page->boxes);
+	g_free (index_page);
+}
+
+PdfTextIndex *
+pdf_text_index_new (gint n_pages)
+{
+	PdfTextIndex *index;
+
+	index = g_new0 (PdfTextIndex, 1);
+	g_mutex_init (&index->mutex);
+	index->n_pages = n_pages;
+	index->pages = g_new0 (PdfTextIndexPage *, n_pages);
+
+	return index;
+}
+
+void
+pdf_text_index_free (PdfTextIndex *index)
+{
+	gint i;
+
+	for (i = 0; i < index->n_pages; i++)
+		pdf_text_index_page_free (index->pages[i]);
+	g_free (index->pages);
+	g_mutex_clear (&index->mutex);
+	g_free (index);
+}
+
+static PdfTextIndexPage *
+pdf_text_index_get_page (PdfTextIndex *index,
+			 gint          page)
+{
+	PdfTextIndexPage *index_page;
+
+	g_mutex_lock (&index->mutex);
+	index_page = index->pages[page];
+	g_mutex_unlock (&index->mutex);
+
+	return index_page;
+}
+
+gboolean
+pdf_text_index_has_page (PdfTextIndex *index,
+			 gint          page)
+{
+	g_return_val_if_fail (page >= 0 && page < index->n_pages, FALSE);
+
+	return pdf_text_index_get_page (index, page) != NULL;
+}
+
+/* Pages are only added once, and never modified afterwards,
+ * so they can be searched without holding the lock.
+ */
+void
+pdf_text_index_add_page (PdfTextIndex      *index,
+			 gint               page,
+			 const gchar       *text,
+			 const EvRectangle *areas,
+			 guint              n_areas)
+{
+	PdfTextIndexPage *index_page;
+	GArray           *chars;
+	GArray           *origins;
+	const gchar      *p;
+	gboolean          same_chars = TRUE;
+	gdouble           max = 0;
+	guint             i;
+
+	g_return_if_fail (page >= 0 && page < index->n_pages);
+
+	if (!text || !areas || (glong)n_areas != g_utf8_strlen (text, -1)) {
+		index_page = &page_not_indexed;
+		goto out;
+	}
+
+	chars = g_array_sized_new (FALSE, FALSE, sizeof (gunichar), n_areas);
+	origins = g_array_sized_new (FALSE, FALSE, sizeof (guint32), n_areas);
+	for (p = text, i = 0; *p; p = g_utf8_next_char (p), i++) {
+		gunichar decomposed[G_UNICHAR_MAX_DECOMPOSITION_LENGTH];
+		gunichar c = g_utf8_get_char (p);
+		gsize    n_decomposed, j;
+
+		if (c < 0x80) {
+			decomposed[0] = c;
+			n_decomposed = 1;
+		} else {
+			n_decomposed = g_unichar_fully_decompose (c, TRUE, decomposed,
+								  G_N_ELEMENTS (decomposed));
+			same_chars = same_chars && n_decomposed == 1;
+		}
+
+		g_array_append_vals (chars, decomposed, n_decomposed);
+		for (j = 0; j < n_decomposed; j++)
+			g_array_append_val (origins, i);
+	}
+
+	index_page = g_new0 (PdfTextIndexPage, 1);
+	index_page->n_chars = chars->len;
+	index_page->chars = (gunichar *)g_array_free (chars, FALSE);
+	index_page->origins = same_chars ? NULL : (guint32 *)g_array_free (origins, FALSE);
+	if (same_chars)
+		g_array_free (origins, TRUE);
+
+	/* Boxes are stored in 16 bits, scaled to the size of the page */
+	for (i = 0; i < n_areas; i++)
+		max = MAX (max, MAX (areas[i].x2, areas[i].y2));
+	index_page->scale = max > 0 ? G_MAXUINT16 / max : 1.;
+	index_page->n_boxes = n_areas;
+	index_page->boxes = g_new (guint16, n_areas * 4);
+	for (i = 0; i < n_areas; i++) {
+		const gdouble coords[4] = { areas[i].x1, areas[i].y1, areas[i].x2, areas[i].y2 };
+		guint         j;
+
+		for (j = 0; j < 4; j++)
+			index_page->boxes[i * 4 + j] =
+				(guint16)CLAMP (round (coords[j] * index_page->scale), 0, G_MAXUINT16);
+	}
+
+out:
+	g_mutex_lock (&index->mutex);
+	if (!index->pages[page]) {
+		index->pages[page] = index_page;
+		index_page = NULL;
+	}
+	g_mutex_unlock (&index->mutex);
+
+	/* Another thread indexed the page in the meantime */
+	pdf_text_index_page_free (index_page);
+}
+
+static inline gunichar
+pdf_text_fold_char (gunichar    c,
+		    PdfTextFold fold)
+{
+	if (fold == FOLD_NONE)
+		return c;
+
+	if (c < 0x80)
+		return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+
+	if (fold == FOLD_CASE_AND_DIACRITICS && g_unichar_ismark (c))
+		return 0;
+
+	return g_unichar_toupper (c);
+}
+
+static inline gboolean
+pdf_text_is_line_break (gunichar c)
+{
+	return c == '\n' || c == '\r';
+}
+
+static gunichar *
+pdf_text_fold_query (const gchar *text,
+		     PdfTextFold *fold,
+		     guint       *n_query)
+{
+	GArray      *query;
+	const gchar *p;
+	gboolean     ascii = TRUE;
+	guint        i;
+
+	query = g_array_new (FALSE, FALSE, sizeof (gunichar));
+	for (p = text; *p; p = g_utf8_next_char (p)) {
+		gunichar decomposed[G_UNICHAR_MAX_DECOMPOSITION_LENGTH];
+		gsize    n_decomposed, j;
+
+		n_decomposed = g_unichar_fully_decompose (g_utf8_get_char (p), TRUE, decomposed,
+							  G_N_ELEMENTS (decomposed));
+		for (j = 0; j < n_decomposed; j++) {
+			gunichar c = pdf_text_fold_char (decomposed[j],
+							 *fold == FOLD_NONE ? FOLD_NONE : FOLD_CASE);
+
+			ascii = ascii && c < 0x80;
+			g_array_append_val (query, c);
+		}
+	}
+
+	/* Like poppler, diacritics are only ignored if the
+	 * search text doesn't have any non ASCII character.
+	 */
+	if (*fold == FOLD_CASE_AND_DIACRITICS && !ascii)
+		*fold = FOLD_CASE;
+
+	if (*fold == FOLD_CASE_AND_DIACRITICS) {
+		guint len = 0;
+
+		for (i = 0; i < query->len; i++) {
+			gunichar c = pdf_text_fold_char (g_array_index (query, gunichar, i), *fold);
+
+			if (c != 0)
+				g_array_index (query, gunichar, len++) = c;
+		}
+		g_array_set_size (query, len);
+	}
+
+	*n_query = query->len;
+
+	return (gunichar *)g_array_free (query, FALSE);
+}
+
+static gboolean
+pdf_text_index_page_is_word (PdfTextIndexPage *index_page,
+			     guint             start,
+			     guint             end)
+{
+	guint i = start;
+
+	/* The character before the match, skipping its marks */
+	while (i > 0) {
+		gunichar c = index_page->chars[--i];
+
+		if (g_unichar_ismark (c))
+			continue;
+		if (g_unichar_isalnum (c))
+			return FALSE;
+		break;
+	}
+
+	return end >= index_page->n_chars || !g_unichar_isalnum (index_page->chars[end]);
+}
+
+static EvRectangle *
+pdf_text_index_page_get_area (PdfTextIndexPage *index_page,
+			      guint             start,
+			      guint             end)
+{
+	EvRectangle *area;
+	guint        first, last, i;
+
+	first = index_page->origins ? index_page->origins[start] : start;
+	last = index_page->origins ? index_page->origins[end - 1] : end - 1;
+
+	area = ev_rectangle_new ();
+	area->x1 = area->y1 = G_MAXDOUBLE;
+	area->x2 = area->y2 = -G_MAXDOUBLE;
+	for (i = first; i <= last; i++) {
+		const guint16 *box = index_page->boxes + i * 4;
+
+		area->x1 = MIN (area->x1, box[0] / index_page->scale);
+		area->y1 = MIN (area->y1, box[1] / index_page->scale);
+		area->x2 = MAX (area->x2, box[2] / index_page->scale);
+		area->y2 = MAX (area->y2, box[3] / index_page->scale);
+	}
+
+	return area;
+}
+
+/*
+ * pdf_text_index_find:
+ *
+ * Looks for @text in @page, if it has been indexed, and returns the
+ * areas of the matches in @matches, in page coordinates.
+ *
+ * Returns: %TRUE if @page was indexed, %FALSE if the caller has
+ * to search the page itself
+ */
+gboolean
+pdf_text_index_find (PdfTextIndex *index,
+		     gint          page,
+		     const gchar  *text,
+		     gboolean      case_sensitive,
+		     gboolean      ignore_diacritics,
+		     gboolean      whole_words_only,
+		     GList       **matches)
+{
+	PdfTextIndexPage *index_page;
+	PdfTextFold       fold;
+	gunichar         *query;
+	guint             n_query;
+	GList            *retval = NULL;
+	guint             i;
+
+	g_return_val_if_fail (page >= 0 && page < index->n_pages, FALSE);
+
+	index_page = pdf_text_index_get_page (index, page);
+	if (!index_page || index_page == &page_not_indexed)
+		return FALSE;
+
+	if (case_sensitive)
+		fold = FOLD_NONE;
+	else if (ignore_diacritics)
+		fold = FOLD_CASE_AND_DIACRITICS;
+	else
+		fold = FOLD_CASE;
+
+	query = pdf_text_fold_query (text, &fold, &n_query);
+	if (n_query == 0) {
+		g_free (query);
+		*matches = NULL;
+
+		return TRUE;
+	}
+
+	for (i = 0; i < index_page->n_chars; i++) {
+		guint j, k;
+
+		if (pdf_text_is_line_break (index_page->chars[i]) ||
+		    pdf_text_fold_char (index_page->chars[i], fold) != query[0])
+			continue;
+
+		for (j = 1, k = i + 1; j < n_query && k < index_page->n_chars; k++) {
+			gunichar c = pdf_text_fold_char (index_page->chars[k], fold);
+
+			if (pdf_text_is_line_break (c))
+				break;
+			/* Ignored diacritic */
+			if (c == 0)
+				continue;
+			if (c != query[j])
+				break;
+			j++;
+		}
+		if (j < n_query)
+			continue;
+
+		if (fold == FOLD_CASE_AND_DIACRITICS) {
+			/* The diacritics of the last character are part of the match */
+			while (k < index_page->n_chars && g_unichar_ismark (index_page->chars[k]))
+				k++;
+		} else if (k < index_page->n_chars && g_unichar_ismark (index_page->chars[k])) {
+			/* The match ends in the middle of a character */
+			continue;
+		}
+
+		if (whole_words_only && !pdf_text_index_page_is_word (index_page, i, k))
+			continue;
+
+		retval = g_list_prepend (retval, pdf_text_index_page_get_area (index_page, i, k));
+		i = k - 1;
+	}
+
+	g_free (query);
+	*matches = g_list_reverse (retval);
+
+	return TRUE;
+}
@@ -0,0 +1,48 @@
+/* this file is part of evince, a gnome document viewer
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __PDF_TEXT_INDEX_H__
+#define __PDF_TEXT_INDEX_H__
+
+#include <glib.h>
+
+#include "ev-document.h"
+
+G_BEGIN_DECLS
+
+typedef struct _PdfTextIndex PdfTextIndex;
+
+PdfTextIndex *pdf_text_index_new      (gint               n_pages);
+void          pdf_text_index_free     (PdfTextIndex      *index);
+gboolean      pdf_text_index_has_page (PdfTextIndex      *index,
+				       gint               page);
+void          pdf_text_index_add_page (PdfTextIndex      *index,
+				       gint               page,
+				       const gchar       *text,
+				       const EvRectangle *areas,
+				       guint              n_areas);
+gboolean      pdf_text_index_find     (PdfTextIndex      *index,
+				       gint               page,
+				       const gchar       *text,
+				       gboolean           case_sensitive,
+				       gboolean           ignore_diacritics,
+				       gboolean           whole_words_only,
+				       GList            **matches);
+
+G_END_DECLS
+
+#endif /* __PDF_TEXT_INDEX_H__ */
@@ -63,18 +63,33 @@ EV_BACKEND_REGISTER_WITH_CODE (TiffDocument, tiff_document,
 static TIFFErrorHandler orig_error_handler = NULL;
 static TIFFErrorHandler orig_warning_handler = NULL;
 
+/* Handlers are global in libtiff, and clones of the document can be
+ * used from several threads, so only the outermost push/pop pair
+ * saves and restores them.
+ */
+static GMutex handlers_mutex;
+static guint  handlers_depth = 0;
+
 static void
 push_handlers (void)
 {
-	orig_error_handler = TIFFSetErrorHandler (NULL);
-	orig_warning_handler = TIFFSetWarningHandler (NULL);
+	g_mutex_lock (&handlers_mutex);
+	if (handlers_depth++ == 0) {
+		orig_error_handler = TIFFSetErrorHandler (NULL);
+		orig_warning_handler = TIFFSetWarningHandler (NULL);
+	}
+	g_mutex_unlock (&handlers_mutex);
 }
 
 static void
 pop_handlers (void)
 {
-	TIFFSetErrorHandler (orig_error_handler);
-	TIFFSetWarningHandler (orig_warning_handler);
+	g_mutex_lock (&handlers_mutex);
+	if (--handlers_depth == 0) {
+		TIFFSetErrorHandler (orig_error_handler);
+		TIFFSetWarningHandler (orig_warning_handler);
+	}
+	g_mutex_unlock (&handlers_mutex);
 }
 
 static gboolean
@@ -135,6 +150,22 @@ tiff_document_load (EvDocument  *document,
 	return TRUE;
 }
 
+/* Every clone reads the file through its own TIFF handle */
+static EvDocument *
+tiff_document_clone (EvDocument *document)
+{
+	TiffDocument *tiff_document = TIFF_DOCUMENT (document);
+	EvDocument   *clone;
+
+	clone = EV_DOCUMENT (g_object_new (TIFF_TYPE_DOCUMENT, NULL));
+	if (!tiff_document_load (clone, tiff_document->uri, NULL)) {
+		g_object_unref (clone);
+		return NULL;
+	}
+
+	return clone;
+}
+
 static gboolean
 tiff_document_save (EvDocument  *document,
 		    const char  *uri,
@@ -457,6 +488,7 @@ tiff_document_class_init (TiffDocumentClass *klass)
 	ev_document_class->render = tiff_document_render;
 	ev_document_class->get_thumbnail = tiff_document_get_thumbnail;
 	ev_document_class->get_page_label = tiff_document_get_page_label;
+	ev_document_class->clone = tiff_document_clone;
 }
 
 /* postscript exporter implementation */
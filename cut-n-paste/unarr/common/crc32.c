@@ -6,34 +6,55 @@
 #ifndef HAVE_ZLIB
 
 /* code adapted from https://gnunet.org/svn/gnunet/src/util/crypto_crc.c (public domain) */
+/* extended to slicing-by-8: crc_table[k][n] is the CRC of byte n followed by k zero bytes */
 
 static bool crc_table_ready = false;
-static uint32_t crc_table[256];
+static uint32_t crc_table[8][256];
 
-uint32_t ar_crc32(uint32_t crc32, const unsigned char *data, size_t data_len)
+static void crc_init_table(void)
 {
-    if (!crc_table_ready) {
-        uint32_t i, j;
-        uint32_t h = 1;
-        crc_table[0] = 0;
-        for (i = 128; i; i >>= 1) {
-            h = (h >> 1) ^ ((h & 1) ? 0xEDB88320 : 0);
-            for (j = 0; j < 256; j += 2 * i) {
-                crc_table[i + j] = crc_table[j] ^ h;
-            }
+    uint32_t i, j;
+    uint32_t h = 1;
+    crc_table[0][0] = 0;
+    for (i = 128; i; i >>= 1) {
+        h = (h >> 1) ^ ((h & 1) ? 0xEDB88320 : 0);
+        for (j = 0; j < 256; j += 2 * i) {
+            crc_table[0][i + j] = crc_table[0][j] ^ h;
+        }
+    }
+    for (i = 0; i < 256; i++) {
+        for (j = 1; j < 8; j++) {
+            crc_table[j][i] = (crc_table[j - 1][i] >> 8) ^ crc_table[0][crc_table[j - 1][i] & 0xFF];
         }
-        crc_table_ready = true;
     }
+    crc_table_ready = true;
+}
+
+uint32_t ar_crc32(uint32_t crc32, const unsigned char *data, size_t data_len)
+{
+    if (!crc_table_ready)
+        crc_init_table();
 
     crc32 = crc32 ^ 0xFFFFFFFF;
+    while (data_len >= 8) {
+        uint32_t lo = crc32 ^ ((uint32_t)data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24);
+        uint32_t hi = (uint32_t)data[4] | (uint32_t)data[5] << 8 | (uint32_t)data[6] << 16 | (uint32_t)data[7] << 24;
+        crc32 = crc_table[7][lo & 0xFF] ^ crc_table[6][(lo >> 8) & 0xFF] ^
+                crc_table[5][(lo >> 16) & 0xFF] ^ crc_table[4][lo >> 24] ^
+                crc_table[3][hi & 0xFF] ^ crc_table[2][(hi >> 8) & 0xFF] ^
+                crc_table[1][(hi >> 16) & 0xFF] ^ crc_table[0][hi >> 24];
+        data += 8;
+        data_len -= 8;
+    }
     while (data_len-- > 0) {
-        crc32 = (crc32 >> 8) ^ crc_table[(crc32 ^ *data++) & 0xFF];
+        crc32 = (crc32 >> 8) ^ crc_table[0][(crc32 ^ *data++) & 0xFF];
     }
     return crc32 ^ 0xFFFFFFFF;
 }
 
 #else
 
+/* zlib has its own fast CRC-32, using the CPU instructions when available */
 #include <zlib.h>
 
 uint32_t ar_crc32(uint32_t crc, const unsigned char *data, size_t data_len)
@@ -89,16 +89,50 @@ bool rar_create_code(struct huffman_code *code, uint8_t *lengths, int numsymbols
     return true;
 }
 
-static bool rar_make_table_rec(struct huffman_code *code, int node, int offset, int depth, int maxdepth)
+/* returns the length of the longest code below node */
+static int rar_tree_depth(struct huffman_code *code, int node)
+{
+    int depth0, depth1;
+
+    if (node < 0 || code->numentries <= node || rar_is_leaf_node(code, node))
+        return 0;
+
+    depth0 = rar_tree_depth(code, code->tree[node].branches[0]);
+    depth1 = rar_tree_depth(code, code->tree[node].branches[1]);
+    return 1 + (depth0 > depth1 ? depth0 : depth1);
+}
+
+/* returns the number of entries of the second level tables for the codes longer than maxdepth */
+static int rar_subtables_size(struct huffman_code *code, int node, int depth, int maxdepth)
+{
+    if (node < 0 || code->numentries <= node || rar_is_leaf_node(code, node))
+        return 0;
+    if (depth == maxdepth)
+        return 1 << rar_tree_depth(code, node);
+    return rar_subtables_size(code, code->tree[node].branches[0], depth + 1, maxdepth) +
+           rar_subtables_size(code, code->tree[node].branches[1], depth + 1, maxdepth);
+}
+
+/* the first level table is indexed by the next tablesize bits and gives either a value and the length
+   of its code, or the offset of a second level table and tablesize plus the number of bits indexing it;
+   second level tables are indexed by the following bits and give a value and the remaining length of
+   its code, or -1 for invalid codes */
+static bool rar_make_table_rec(struct huffman_code *code, int node, int offset, int depth, int maxdepth, int *nextsubtable)
 {
     int currtablesize = 1 << (maxdepth - depth);
 
     if (node < 0 || code->numentries <= node) {
-        warn("Invalid data in bitstream"); /* invalid location to Huffman tree specified */
-        return false;
+        int i;
+        if (nextsubtable) {
+            warn("Invalid data in bitstream"); /* invalid location to Huffman tree specified */
+            return false;
+        }
+        for (i = 0; i < currtablesize; i++) {
+            code->table[offset + i].length = -1;
+            code->table[offset + i].value = -1;
+        }
     }
-
-    if (rar_is_leaf_node(code, node)) {
+    else if (rar_is_leaf_node(code, node)) {
         int i;
         for (i = 0; i < currtablesize; i++) {
             code->table[offset + i].length = depth;
@@ -106,13 +140,20 @@ static bool rar_make_table_rec(struct huffman_code *code, int node, int offset,
         }
     }
     else if (depth == maxdepth) {
-        code->table[offset].length = maxdepth + 1;
-        code->table[offset].value = node;
+        int subtablesize = rar_tree_depth(code, node);
+        if (!nextsubtable) {
+            warn("Invalid data in bitstream");
+            return false;
+        }
+        code->table[offset].length = maxdepth + subtablesize;
+        code->table[offset].value = *nextsubtable;
+        *nextsubtable += 1 << subtablesize;
+        return rar_make_table_rec(code, node, code->table[offset].value, 0, subtablesize, NULL);
     }
     else {
-        if (!rar_make_table_rec(code, code->tree[node].branches[0], offset, depth + 1, maxdepth))
+        if (!rar_make_table_rec(code, code->tree[node].branches[0], offset, depth + 1, maxdepth, nextsubtable))
             return false;
-        if (!rar_make_table_rec(code, code->tree[node].branches[1], offset + currtablesize / 2, depth + 1, maxdepth))
+        if (!rar_make_table_rec(code, code->tree[node].branches[1], offset + currtablesize / 2, depth + 1, maxdepth, nextsubtable))
             return false;
     }
     return true;
@@ -120,18 +161,21 @@ static bool rar_make_table_rec(struct huffman_code *code, int node, int offset,
 
 bool rar_make_table(struct huffman_code *code)
 {
+    int nextsubtable;
+
     if (code->minlength <= code->maxlength && code->maxlength <= 10)
         code->tablesize = code->maxlength;
     else
         code->tablesize = 10;
 
-    code->table = calloc(1ULL << code->tablesize, sizeof(*code->table));
+    nextsubtable = 1 << code->tablesize;
+    code->table = calloc(nextsubtable + rar_subtables_size(code, 0, 0, code->tablesize), sizeof(*code->table));
     if (!code->table) {
         warn("OOM during decompression");
         return false;
     }
 
-    return rar_make_table_rec(code, 0, 0, 0, code->tablesize);
+    return rar_make_table_rec(code, 0, 0, 0, code->tablesize, &nextsubtable);
 }
 
 void rar_free_code(struct huffman_code *code)
@@ -140,3 +184,19 @@ void rar_free_code(struct huffman_code *code)
     free(code->table);
     memset(code, 0, sizeof(*code));
 }
+
+bool rar_copy_code(struct huffman_code *dst, const struct huffman_code *src)
+{
+    memcpy(dst, src, sizeof(*dst));
+    /* the lookup table is rebuilt from the tree on first use */
+    dst->table = NULL;
+    if (!src->tree)
+        return true;
+    dst->tree = malloc(src->capacity * sizeof(*src->tree));
+    if (!dst->tree) {
+        warn("OOM during decompression");
+        return false;
+    }
+    memcpy(dst->tree, src->tree, src->numentries * sizeof(*src->tree));
+    return true;
+}
@@ -51,9 +51,40 @@ static inline void lzss_emit_literal(LZSS *self, uint8_t literal) {
 
 static inline void lzss_emit_match(LZSS *self, int offset, int length) {
     int windowoffs = lzss_current_window_offset(self);
+    int srcoffs = (windowoffs - offset) & lzss_mask(self);
     int i;
-    for (i = 0; i < length; i++) {
-        self->window[(windowoffs + i) & lzss_mask(self)] = self->window[(windowoffs + i - offset) & lzss_mask(self)];
+
+    if (windowoffs + length > lzss_size(self) || srcoffs + length > lzss_size(self)) {
+        /* Match wraps around window */
+        for (i = 0; i < length; i++) {
+            self->window[(windowoffs + i) & lzss_mask(self)] = self->window[(windowoffs + i - offset) & lzss_mask(self)];
+        }
+    }
+    else {
+        uint8_t *dst = &self->window[windowoffs];
+        const uint8_t *src = &self->window[srcoffs];
+
+        if (srcoffs > windowoffs || offset >= length) {
+            /* Source isn't overwritten before it is read */
+            memmove(dst, src, length);
+        }
+        else if (offset >= 8) {
+            /* Each word only depends on bytes written before */
+            for (i = 0; i + 8 <= length; i += 8) {
+                memcpy(dst + i, src + i, 8);
+            }
+            for (; i < length; i++) {
+                dst[i] = src[i];
+            }
+        }
+        else if (offset == 1) {
+            memset(dst, src[0], length);
+        }
+        else {
+            for (i = 0; i < length; i++) {
+                dst[i] = src[i];
+            }
+        }
     }
     self->position += length;
 }
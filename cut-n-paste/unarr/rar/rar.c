@@ -3,11 +3,115 @@
 
 #include "rar.h"
 
+/* solid data between two checkpoints and the memory all checkpoints may use */
+#ifndef CHECKPOINT_SPACING
+/* test-rar-checkpoints uses a smaller spacing than its fixtures */
+#define CHECKPOINT_SPACING LZSS_WINDOW_SIZE
+#endif
+#define CHECKPOINT_MEMORY  (64 * 1024 * 1024)
+
+static void rar_free_checkpoints(ar_archive_rar *rar)
+{
+    size_t i;
+    for (i = 0; i < rar->checkpoints.count; i++)
+        rar_clear_uncompress(&rar->checkpoints.items[i].uncomp);
+    free(rar->checkpoints.items);
+    memset(&rar->checkpoints, 0, sizeof(rar->checkpoints));
+}
+
+static void rar_thin_checkpoints(ar_archive_rar *rar)
+{
+    struct ar_archive_rar_checkpoints *checkpoints = &rar->checkpoints;
+    size_t i, count = 0;
+
+    /* drop every other checkpoint and space the following ones twice as far apart */
+    checkpoints->memsize = 0;
+    for (i = 0; i < checkpoints->count; i++) {
+        if (i % 2 == 1) {
+            rar_clear_uncompress(&checkpoints->items[i].uncomp);
+            continue;
+        }
+        checkpoints->items[count] = checkpoints->items[i];
+        checkpoints->memsize += checkpoints->items[count].memsize;
+        count++;
+    }
+    checkpoints->count = count;
+    checkpoints->spacing *= 2;
+}
+
+static void rar_add_checkpoint(ar_archive_rar *rar)
+{
+    struct ar_archive_rar_checkpoints *checkpoints = &rar->checkpoints;
+    struct ar_archive_rar_checkpoint checkpoint;
+    size_t distance = rar->solid.size_total;
+
+    if (!checkpoints->spacing)
+        checkpoints->spacing = CHECKPOINT_SPACING;
+    if (checkpoints->count > 0) {
+        struct ar_archive_rar_checkpoint *last = &checkpoints->items[checkpoints->count - 1];
+        if (rar->super.entry_offset_next <= last->offset)
+            return;
+        if (distance >= last->size_total)
+            distance -= last->size_total;
+    }
+    /* restarting from the beginning is cheap enough for the first entries */
+    if (distance < checkpoints->spacing)
+        return;
+
+    if (!rar_copy_uncompress(&checkpoint.uncomp, &rar->uncomp, &checkpoint.memsize))
+        return;
+    if (checkpoint.memsize > CHECKPOINT_MEMORY) {
+        rar_clear_uncompress(&checkpoint.uncomp);
+        return;
+    }
+    if (checkpoints->count == checkpoints->capacity) {
+        size_t capacity = checkpoints->capacity ? checkpoints->capacity * 2 : 16;
+        struct ar_archive_rar_checkpoint *items = realloc(checkpoints->items, capacity * sizeof(*items));
+        if (!items) {
+            rar_clear_uncompress(&checkpoint.uncomp);
+            return;
+        }
+        checkpoints->items = items;
+        checkpoints->capacity = capacity;
+    }
+    checkpoint.offset = rar->super.entry_offset_next;
+    checkpoint.size_total = rar->solid.size_total;
+    checkpoints->items[checkpoints->count++] = checkpoint;
+    checkpoints->memsize += checkpoint.memsize;
+
+    while (checkpoints->memsize > CHECKPOINT_MEMORY)
+        rar_thin_checkpoints(rar);
+}
+
+static bool rar_restore_checkpoint(ar_archive_rar *rar, off64_t offset)
+{
+    struct ar_archive_rar_checkpoint *checkpoint = NULL;
+    size_t memsize, i;
+
+    for (i = rar->checkpoints.count; i > 0 && !checkpoint; i--) {
+        if (rar->checkpoints.items[i - 1].offset <= offset)
+            checkpoint = &rar->checkpoints.items[i - 1];
+    }
+    if (!checkpoint || !ar_parse_entry_at(&rar->super, checkpoint->offset))
+        return false;
+    /* entries which don't continue the solid stream start from scratch anyway */
+    if (rar->entry.solid && rar->entry.method != METHOD_STORE) {
+        rar_clear_uncompress(&rar->uncomp);
+        if (!rar_copy_uncompress(&rar->uncomp, &checkpoint->uncomp, &memsize))
+            return false;
+        br_clear_leftover_bits(&rar->uncomp);
+        rar->solid.size_total = checkpoint->size_total;
+    }
+    log("Resuming decompression from checkpoint @%" PRIi64, checkpoint->offset);
+    return true;
+}
+
 static void rar_close(ar_archive *ar)
 {
     ar_archive_rar *rar = (ar_archive_rar *)ar;
     free(rar->entry.name);
     rar_clear_uncompress(&rar->uncomp);
+    rar_free_checkpoints(rar);
 }
 
 static bool rar_parse_entry(ar_archive *ar, off64_t offset)
@@ -137,7 +241,7 @@ static bool rar_restart_solid(ar_archive *ar)
     ar_archive_rar *rar = (ar_archive_rar *)ar;
     off64_t current_offset = ar->entry_offset;
     log("Restarting decompression for solid entry");
-    if (!ar_parse_entry_at(ar, ar->entry_offset_first)) {
+    if (!rar_restore_checkpoint(rar, current_offset) && !ar_parse_entry_at(ar, ar->entry_offset_first)) {
         ar_parse_entry_at(ar, current_offset);
         return false;
     }
@@ -199,6 +303,8 @@ static bool rar_uncompress(ar_archive *ar, void *buffer, size_t count)
         warn("Checksum of extracted data doesn't match");
         return false;
     }
+    if (rar->entry.method != METHOD_STORE)
+        rar_add_checkpoint(rar);
     return true;
 }
 
@@ -34,6 +34,26 @@ static bool br_fill(ar_archive_rar *rar, int bits)
     return true;
 }
 
+/* reads as many bits as possible without failing at the end of the data */
+static void br_refill(ar_archive_rar *rar)
+{
+    uint8_t bytes[8];
+    int count, i;
+
+    count = (64 - rar->uncomp.br.available) / 8;
+    if (rar->progress.data_left < (size_t)count)
+        count = (int)rar->progress.data_left;
+    if (count <= 0)
+        return;
+
+    count = (int)ar_read(rar->super.stream, bytes, count);
+    rar->progress.data_left -= count;
+    for (i = 0; i < count; i++) {
+        rar->uncomp.br.bits = (rar->uncomp.br.bits << 8) | bytes[i];
+    }
+    rar->uncomp.br.available += 8 * count;
+}
+
 static inline bool br_check(ar_archive_rar *rar, int bits)
 {
     return bits <= rar->uncomp.br.available || br_fill(rar, bits);
@@ -158,6 +178,111 @@ void rar_clear_uncompress(struct ar_archive_rar_uncomp *uncomp)
     uncomp->version = 0;
 }
 
+/* UNIT_SIZE in Ppmd7.c, allocated past the end of the model */
+#define PPMD7_UNIT_SIZE 12
+
+static void *rar_rebase_pointer(const void *ptr, const Byte *base, Byte *new_base)
+{
+    return ptr ? new_base + ((const Byte *)ptr - base) : NULL;
+}
+
+static bool rar_copy_ppmd7(CPpmd7 *dst, const CPpmd7 *src, size_t *size)
+{
+    size_t base_size;
+
+    if (!src->Base)
+        return true;
+#ifdef PPMD_32BIT
+    /* the model links its contexts through pointers which can't be rebased */
+    return false;
+#else
+    base_size = src->AlignOffset + src->Size + PPMD7_UNIT_SIZE;
+    dst->Base = ISzAlloc_Alloc(&gSzAlloc, base_size);
+    if (!dst->Base) {
+        warn("OOM during decompression");
+        return false;
+    }
+    memcpy(dst->Base, src->Base, base_size);
+    /* all other references are offsets from Base */
+    dst->MinContext = rar_rebase_pointer(src->MinContext, src->Base, dst->Base);
+    dst->MaxContext = rar_rebase_pointer(src->MaxContext, src->Base, dst->Base);
+    dst->FoundState = rar_rebase_pointer(src->FoundState, src->Base, dst->Base);
+    dst->LoUnit = rar_rebase_pointer(src->LoUnit, src->Base, dst->Base);
+    dst->HiUnit = rar_rebase_pointer(src->HiUnit, src->Base, dst->Base);
+    dst->Text = rar_rebase_pointer(src->Text, src->Base, dst->Base);
+    dst->UnitsStart = rar_rebase_pointer(src->UnitsStart, src->Base, dst->Base);
+    *size += base_size;
+    return true;
+#endif
+}
+
+static bool rar_copy_code_sized(struct huffman_code *dst, const struct huffman_code *src, size_t *size)
+{
+    if (!rar_copy_code(dst, src))
+        return false;
+    *size += src->capacity * sizeof(*src->tree);
+    return true;
+}
+
+bool rar_copy_uncompress(struct ar_archive_rar_uncomp *dst, const struct ar_archive_rar_uncomp *src, size_t *size)
+{
+    bool ok;
+    int i;
+
+    *size = 0;
+    memset(dst, 0, sizeof(*dst));
+    if (!src->version)
+        return true;
+    if (src->version == 3 && (src->state.v3.filters.vm || src->state.v3.filters.progs ||
+                              src->state.v3.filters.stack || src->state.v3.filters.bytes)) {
+        log("Can't copy the decompression state of filtered data");
+        return false;
+    }
+
+    memcpy(dst, src, sizeof(*dst));
+    /* range_dec.Stream keeps pointing to rar->uncomp which is where copies are restored to */
+    dst->lzss.window = malloc(lzss_size(&dst->lzss));
+    if (dst->lzss.window)
+        memcpy(dst->lzss.window, src->lzss.window, lzss_size(&dst->lzss));
+    *size += lzss_size(&dst->lzss);
+
+    if (src->version == 3) {
+        struct ar_archive_rar_uncomp_v3 *uncomp_v3 = &dst->state.v3;
+        memset(&uncomp_v3->maincode, 0, sizeof(uncomp_v3->maincode));
+        memset(&uncomp_v3->offsetcode, 0, sizeof(uncomp_v3->offsetcode));
+        memset(&uncomp_v3->lowoffsetcode, 0, sizeof(uncomp_v3->lowoffsetcode));
+        memset(&uncomp_v3->lengthcode, 0, sizeof(uncomp_v3->lengthcode));
+        uncomp_v3->ppmd7_context.Base = NULL;
+        ok = dst->lzss.window &&
+             rar_copy_code_sized(&uncomp_v3->maincode, &src->state.v3.maincode, size) &&
+             rar_copy_code_sized(&uncomp_v3->offsetcode, &src->state.v3.offsetcode, size) &&
+             rar_copy_code_sized(&uncomp_v3->lowoffsetcode, &src->state.v3.lowoffsetcode, size) &&
+             rar_copy_code_sized(&uncomp_v3->lengthcode, &src->state.v3.lengthcode, size) &&
+             rar_copy_ppmd7(&uncomp_v3->ppmd7_context, &src->state.v3.ppmd7_context, size);
+    }
+    else {
+        struct ar_archive_rar_uncomp_v2 *uncomp_v2 = &dst->state.v2;
+        memset(&uncomp_v2->maincode, 0, sizeof(uncomp_v2->maincode));
+        memset(&uncomp_v2->offsetcode, 0, sizeof(uncomp_v2->offsetcode));
+        memset(&uncomp_v2->lengthcode, 0, sizeof(uncomp_v2->lengthcode));
+        memset(uncomp_v2->audiocode, 0, sizeof(uncomp_v2->audiocode));
+        ok = dst->lzss.window &&
+             rar_copy_code_sized(&uncomp_v2->maincode, &src->state.v2.maincode, size) &&
+             rar_copy_code_sized(&uncomp_v2->offsetcode, &src->state.v2.offsetcode, size) &&
+             rar_copy_code_sized(&uncomp_v2->lengthcode, &src->state.v2.lengthcode, size);
+        for (i = 0; ok && i < 4; i++)
+            ok = rar_copy_code_sized(&uncomp_v2->audiocode[i], &src->state.v2.audiocode[i], size);
+    }
+
+    if (!ok) {
+        if (!dst->lzss.window)
+            warn("OOM during decompression");
+        rar_clear_uncompress(dst);
+        return false;
+    }
+    return true;
+}
+
 static int rar_read_next_symbol(ar_archive_rar *rar, struct huffman_code *code)
 {
     int node = 0;
@@ -166,6 +291,8 @@ static int rar_read_next_symbol(ar_archive_rar *rar, struct huffman_code *code)
         return -1;
 
     /* performance optimization */
+    if (rar->uncomp.br.available < code->maxlength)
+        br_refill(rar);
     if (code->tablesize <= rar->uncomp.br.available) {
         uint16_t bits = (uint16_t)br_bits(rar, code->tablesize);
         int length = code->table[bits].length;
@@ -181,7 +308,22 @@ static int rar_read_next_symbol(ar_archive_rar *rar, struct huffman_code *code)
             return value;
         }
 
-        node = value;
+        /* Look the rest of the code up in the second level table */
+        if (length - code->tablesize <= rar->uncomp.br.available) {
+            int subtablesize = length - code->tablesize;
+            bits = (uint16_t)br_bits(rar, subtablesize);
+            length = code->table[value + bits].length;
+            value = code->table[value + bits].value;
+            if (length < 0) {
+                warn("Invalid data in bitstream"); /* invalid prefix code in bitstream */
+                return -1;
+            }
+            rar->uncomp.br.available += subtablesize - length;
+            return value;
+        }
+
+        /* Not enough data left for the table, walk the tree instead */
+        rar->uncomp.br.available += code->tablesize;
     }
 
     while (!rar_is_leaf_node(code, node)) {
@@ -0,0 +1,50 @@
+/* Copyright 2015 the unarr project authors (see AUTHORS file).
+   License: LGPLv3 */
+
+/* checks ar_crc32() built without zlib against zlib's crc32(), for every
+   length and alignment around the 8 bytes processed at once, and when
+   the data is passed in several parts */
+
+#include "common/unarr-imp.h"
+
+#include <zlib.h>
+
+#define BUFFER_SIZE 4096
+
+int main(void)
+{
+    static const unsigned char check[] = "123456789";
+    unsigned char buffer[BUFFER_SIZE];
+    size_t offset, length, split;
+    uint32_t seed = 1;
+    int failures = 0;
+
+    for (offset = 0; offset < sizeof(buffer); offset++) {
+        seed = seed * 1103515245 + 12345;
+        buffer[offset] = (unsigned char)(seed >> 16);
+    }
+
+    if (ar_crc32(0, check, 9) != 0xCBF43926) {
+        fprintf(stderr, "CRC-32 of \"%s\" is %08" PRIx32 "\n", check, ar_crc32(0, check, 9));
+        failures++;
+    }
+
+    for (offset = 0; offset < 8; offset++) {
+        for (length = 0; length + offset <= sizeof(buffer); length += length < 64 ? 1 : 61) {
+            uint32_t expected = (uint32_t)crc32(0, buffer + offset, (uInt)length);
+
+            if (ar_crc32(0, buffer + offset, length) != expected) {
+                fprintf(stderr, "CRC-32 mismatch at offset %" PRIuPTR " for %" PRIuPTR " bytes\n", offset, length);
+                failures++;
+            }
+            for (split = 1; split < length && split < 24; split += 5) {
+                if (ar_crc32(ar_crc32(0, buffer + offset, split), buffer + offset + split, length - split) != expected) {
+                    fprintf(stderr, "CRC-32 mismatch at offset %" PRIuPTR " for %" PRIuPTR " bytes split at %" PRIuPTR "\n", offset, length, split);
+                    failures++;
+                }
+            }
+        }
+    }
+
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,175 @@
+/* Copyright 2015 the unarr project authors (see AUTHORS file).
+   License: LGPLv3 */
+
+/* reads the entries of a solid RAR archive in order and then in reverse
+   order, which restarts the solid stream for every entry. It is built
+   with a CHECKPOINT_SPACING smaller than the entries, so checkpoints
+   are taken while reading in order and restored when seeking back: the
+   entries must then match the checksums of the first read, without
+   reading anything before their checkpoint again */
+
+#include "rar/rar.h"
+
+#define MAX_ENTRIES 64
+
+/* keeps the lowest offset read from */
+struct tracking_stream {
+    ar_stream *stream;
+    off64_t first_read;
+};
+
+static void tracking_close(void *data)
+{
+    struct tracking_stream *tracking = data;
+    ar_close(tracking->stream);
+    free(tracking);
+}
+
+static size_t tracking_read(void *data, void *buffer, size_t count)
+{
+    struct tracking_stream *tracking = data;
+    off64_t offset = ar_tell(tracking->stream);
+    if (offset < tracking->first_read)
+        tracking->first_read = offset;
+    return ar_read(tracking->stream, buffer, count);
+}
+
+static bool tracking_seek(void *data, off64_t offset, int origin)
+{
+    struct tracking_stream *tracking = data;
+    return ar_seek(tracking->stream, offset, origin);
+}
+
+static off64_t tracking_tell(void *data)
+{
+    struct tracking_stream *tracking = data;
+    return ar_tell(tracking->stream);
+}
+
+static bool read_entry(ar_archive *ar, uint32_t *crc)
+{
+    unsigned char buffer[4096];
+    size_t left = ar_entry_get_size(ar);
+
+    *crc = 0;
+    while (left > 0) {
+        size_t count = smin(left, sizeof(buffer));
+        if (!ar_entry_uncompress(ar, buffer, count))
+            return false;
+        *crc = ar_crc32(*crc, buffer, count);
+        left -= count;
+    }
+    return true;
+}
+
+/* the last checkpoint decompression of the entry at offset resumes from */
+static struct ar_archive_rar_checkpoint *find_checkpoint(ar_archive_rar *rar, off64_t offset)
+{
+    size_t i;
+    for (i = rar->checkpoints.count; i > 0; i--) {
+        if (rar->checkpoints.items[i - 1].offset <= offset)
+            return &rar->checkpoints.items[i - 1];
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    struct {
+        off64_t offset;
+        uint32_t crc;
+    } entries[MAX_ENTRIES];
+    struct tracking_stream *tracking;
+    ar_stream *stream;
+    ar_archive *ar;
+    ar_archive_rar *rar;
+    bool ppmd;
+    size_t count = 0, restored = 0, i;
+    int failures = 0;
+
+    if (argc != 3 || (strcmp(argv[1], "lzss") != 0 && strcmp(argv[1], "ppmd") != 0)) {
+        fprintf(stderr, "Usage: %s lzss|ppmd archive.rar\n", argv[0]);
+        return 1;
+    }
+    ppmd = strcmp(argv[1], "ppmd") == 0;
+
+    tracking = calloc(1, sizeof(*tracking));
+    tracking->stream = ar_open_file(argv[2]);
+    if (!tracking->stream) {
+        fprintf(stderr, "Couldn't open %s\n", argv[2]);
+        free(tracking);
+        return 1;
+    }
+    stream = ar_open_stream(tracking, tracking_close, tracking_read, tracking_seek, tracking_tell);
+    ar = stream ? ar_open_rar_archive(stream) : NULL;
+    if (!ar) {
+        fprintf(stderr, "%s isn't a RAR archive\n", argv[2]);
+        ar_close(stream);
+        return 1;
+    }
+    rar = (ar_archive_rar *)ar;
+
+    while (count < MAX_ENTRIES && ar_parse_entry(ar)) {
+        entries[count].offset = ar_entry_get_offset(ar);
+        if (!read_entry(ar, &entries[count].crc)) {
+            fprintf(stderr, "Couldn't read entry %s in order\n", ar_entry_get_name(ar));
+            failures++;
+            goto out;
+        }
+        count++;
+    }
+    if (count < 2 || !rar->entry.solid) {
+        fprintf(stderr, "%s isn't a solid archive with several entries\n", argv[2]);
+        failures++;
+        goto out;
+    }
+
+    if (rar->checkpoints.count == 0) {
+        fprintf(stderr, "No checkpoints were taken\n");
+        failures++;
+    }
+    for (i = 0; i < rar->checkpoints.count; i++) {
+        struct ar_archive_rar_uncomp *uncomp = &rar->checkpoints.items[i].uncomp;
+        bool has_model = uncomp->version == 3 && uncomp->state.v3.ppmd7_context.Base != NULL;
+        if (has_model != ppmd) {
+            fprintf(stderr, "Checkpoint @%" PRIi64 " %s a PPMd model\n",
+                    rar->checkpoints.items[i].offset, has_model ? "has" : "doesn't have");
+            failures++;
+        }
+    }
+
+    for (i = count; i > 0; i--) {
+        struct ar_archive_rar_checkpoint *checkpoint;
+        uint32_t crc;
+
+        tracking->first_read = INT64_MAX;
+        if (!ar_parse_entry_at(ar, entries[i - 1].offset) || !read_entry(ar, &crc)) {
+            fprintf(stderr, "Couldn't read entry @%" PRIi64 " after seeking back\n", entries[i - 1].offset);
+            failures++;
+            continue;
+        }
+        if (crc != entries[i - 1].crc) {
+            fprintf(stderr, "Entry @%" PRIi64 " doesn't match after seeking back\n", entries[i - 1].offset);
+            failures++;
+        }
+
+        checkpoint = find_checkpoint(rar, entries[i - 1].offset);
+        if (!checkpoint)
+            continue;
+        if (tracking->first_read < checkpoint->offset) {
+            fprintf(stderr, "Entry @%" PRIi64 " wasn't resumed from checkpoint @%" PRIi64 "\n",
+                    entries[i - 1].offset, checkpoint->offset);
+            failures++;
+        }
+        restored++;
+    }
+    if (restored == 0) {
+        fprintf(stderr, "No entries were resumed from a checkpoint\n");
+        failures++;
+    }
+
+out:
+    ar_close_archive(ar);
+    ar_close(stream);
+    return failures ? 1 : 0;
+}
@@ -26,6 +26,7 @@
 #include <libdocument/ev-attachment.h>
 #include <libdocument/ev-backends-manager.h>
 #include <libdocument/ev-document-attachments.h>
+#include <libdocument/ev-document-cache.h>
 #include <libdocument/ev-document-factory.h>
 #include <libdocument/ev-document-find.h>
 #include <libdocument/ev-document-fonts.h>
@@ -54,6 +55,7 @@
 #include <libdocument/ev-page.h>
 #include <libdocument/ev-render-context.h>
 #include <libdocument/ev-selection.h>
+#include <libdocument/ev-surface-pool.h>
 #include <libdocument/ev-transition-effect.h>
 #include <libdocument/ev-version.h>
 #include <libdocument/ev-macros.h>
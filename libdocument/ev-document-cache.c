@@ -0,0 +1,702 @@
+/* ev-document-cache.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <glib/gstdio.h>
+
+#include "ev-document-cache.h"
+#include "ev-document-links.h"
+#include "ev-file-helpers.h"
+#include "ev-link.h"
+
+/**
+ * SECTION: ev-document-cache
+ * @short_description: a persistent on-disk cache of document metadata
+ *
+ * The cache is a single #GVariant file per document, stored under
+ * $XDG_CACHE_HOME/evince/documents. The file name is derived from the
+ * identity of the document (device, inode, size, modification time and a
+ * checksum of its first bytes), so a modified document never hits a stale
+ * entry. The file is memory mapped and its sections are accessed in place.
+ * The least recently used files are removed when the cache directory grows
+ * beyond a fixed size.
+ */
+
+#define CACHE_FORMAT_VERSION 1
+#define CACHE_FORMAT         "(usa{sv})"
+#define CACHE_HASH_PREFIX    (64 * 1024)
+#define CACHE_MAX_SIZE       (32 * 1024 * 1024)
+
+#define OUTLINE_SECTION      "outline"
+#define OUTLINE_ENTRY_FORMAT "(ussbsv)"
+
+struct _EvDocumentCache {
+	gchar         *filename;
+	gchar         *identity;
+
+	GMutex         mutex;
+	GVariant      *sections;
+
+	volatile gint  ref_count;
+};
+
+G_DEFINE_BOXED_TYPE (EvDocumentCache, ev_document_cache, ev_document_cache_ref, ev_document_cache_unref)
+
+static gchar *
+ev_document_cache_compute_identity (GFile *file)
+{
+	GFileInfo        *info;
+	GFileInputStream *stream;
+	guchar           *prefix;
+	gsize             prefix_len = 0;
+	gchar            *checksum;
+	gchar            *identity;
+
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_UNIX_DEVICE ","
+				  G_FILE_ATTRIBUTE_UNIX_INODE ","
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	if (!info)
+		return NULL;
+
+	stream = g_file_read (file, NULL, NULL);
+	if (!stream) {
+		g_object_unref (info);
+		return NULL;
+	}
+
+	prefix = g_malloc (CACHE_HASH_PREFIX);
+	g_input_stream_read_all (G_INPUT_STREAM (stream), prefix, CACHE_HASH_PREFIX,
+				 &prefix_len, NULL, NULL);
+	g_object_unref (stream);
+
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, prefix, prefix_len);
+	g_free (prefix);
+
+	identity = g_strdup_printf ("%u:%" G_GUINT64_FORMAT ":%" G_GINT64_FORMAT ":%" G_GUINT64_FORMAT ".%u:%s",
+				    g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE),
+				    g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE),
+				    g_file_info_get_size (info),
+				    g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+				    g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC),
+				    checksum);
+	g_free (checksum);
+	g_object_unref (info);
+
+	return identity;
+}
+
+static GVariant *
+ev_document_cache_map (EvDocumentCache *cache)
+{
+	GMappedFile *mapped;
+	GBytes      *bytes;
+	GVariant    *variant;
+	GVariant    *sections = NULL;
+	guint32      version;
+	const gchar *identity;
+
+	mapped = g_mapped_file_new (cache->filename, FALSE, NULL);
+	if (!mapped)
+		return NULL;
+
+	bytes = g_mapped_file_get_bytes (mapped);
+	g_mapped_file_unref (mapped);
+
+	variant = g_variant_new_from_bytes (G_VARIANT_TYPE (CACHE_FORMAT), bytes, FALSE);
+	g_bytes_unref (bytes);
+
+	g_variant_get (variant, "(u&s@a{sv})", &version, &identity, &sections);
+	if (version != CACHE_FORMAT_VERSION || g_strcmp0 (identity, cache->identity) != 0)
+		g_clear_pointer (&sections, g_variant_unref);
+	else
+		g_utime (cache->filename, NULL);
+
+	g_variant_unref (variant);
+
+	return sections;
+}
+
+/**
+ * ev_document_cache_new:
+ * @file: the #GFile of a document
+ *
+ * Opens the persistent cache for @file, mapping any previously stored
+ * entry for the same version of the document.
+ *
+ * Returns: (transfer full) (nullable): a new #EvDocumentCache, or %NULL if
+ *   @file is not a regular local file or its identity cannot be computed
+ */
+EvDocumentCache *
+ev_document_cache_new (GFile *file)
+{
+	EvDocumentCache *cache;
+	gchar           *identity;
+	gchar           *key;
+	gchar           *basename;
+
+	g_return_val_if_fail (G_IS_FILE (file), NULL);
+
+	if (!g_file_is_native (file) || ev_file_is_temp (file))
+		return NULL;
+
+	identity = ev_document_cache_compute_identity (file);
+	if (!identity)
+		return NULL;
+
+	key = g_compute_checksum_for_string (G_CHECKSUM_SHA256, identity, -1);
+	basename = g_strconcat (key, ".cache", NULL);
+	g_free (key);
+
+	cache = g_slice_new0 (EvDocumentCache);
+	cache->identity = identity;
+	cache->filename = g_build_filename (g_get_user_cache_dir (),
+					    "evince", "documents", basename, NULL);
+	cache->ref_count = 1;
+	g_mutex_init (&cache->mutex);
+	g_free (basename);
+
+	cache->sections = ev_document_cache_map (cache);
+
+	return cache;
+}
+
+EvDocumentCache *
+ev_document_cache_ref (EvDocumentCache *cache)
+{
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (cache->ref_count > 0, cache);
+
+	g_atomic_int_add (&cache->ref_count, 1);
+
+	return cache;
+}
+
+void
+ev_document_cache_unref (EvDocumentCache *cache)
+{
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (cache->ref_count > 0);
+
+	if (g_atomic_int_dec_and_test (&cache->ref_count)) {
+		g_clear_pointer (&cache->sections, g_variant_unref);
+		g_mutex_clear (&cache->mutex);
+		g_free (cache->filename);
+		g_free (cache->identity);
+		g_slice_free (EvDocumentCache, cache);
+	}
+}
+
+/**
+ * ev_document_cache_lookup:
+ * @cache: an #EvDocumentCache
+ * @section: the name of a cache section
+ *
+ * Returns: (transfer full) (nullable): the stored value of @section, which
+ *   references the mapped cache file, or %NULL if it is not cached
+ */
+GVariant *
+ev_document_cache_lookup (EvDocumentCache *cache,
+			  const gchar     *section)
+{
+	GVariant *value = NULL;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+	g_return_val_if_fail (section != NULL, NULL);
+
+	g_mutex_lock (&cache->mutex);
+	if (cache->sections)
+		value = g_variant_lookup_value (cache->sections, section, NULL);
+	g_mutex_unlock (&cache->mutex);
+
+	return value;
+}
+
+typedef struct {
+	gchar  *filename;
+	goffset size;
+	gint64  mtime;
+} CacheFile;
+
+static gint
+cache_file_compare_mtime (gconstpointer a,
+			  gconstpointer b)
+{
+	const CacheFile *file_a = a;
+	const CacheFile *file_b = b;
+
+	if (file_a->mtime == file_b->mtime)
+		return 0;
+
+	return file_a->mtime < file_b->mtime ? -1 : 1;
+}
+
+/* Files are touched when they are mapped, so their modification time is
+ * the last time they were used. The oldest ones are removed until the
+ * directory fits in CACHE_MAX_SIZE, the file of @cache is always kept.
+ */
+static void
+ev_document_cache_trim (EvDocumentCache *cache,
+			const gchar     *dirname)
+{
+	GDir        *dir;
+	const gchar *name;
+	GArray      *files;
+	goffset      total_size = 0;
+	guint        i;
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (!dir)
+		return;
+
+	files = g_array_new (FALSE, FALSE, sizeof (CacheFile));
+	while ((name = g_dir_read_name (dir))) {
+		CacheFile file;
+		GStatBuf  statbuf;
+
+		if (!g_str_has_suffix (name, ".cache"))
+			continue;
+
+		file.filename = g_build_filename (dirname, name, NULL);
+		if (g_stat (file.filename, &statbuf) != 0 || !S_ISREG (statbuf.st_mode)) {
+			g_free (file.filename);
+			continue;
+		}
+
+		file.size = statbuf.st_size;
+		file.mtime = statbuf.st_mtime;
+		total_size += file.size;
+		g_array_append_val (files, file);
+	}
+	g_dir_close (dir);
+
+	if (total_size > CACHE_MAX_SIZE) {
+		g_array_sort (files, cache_file_compare_mtime);
+
+		for (i = 0; i < files->len && total_size > CACHE_MAX_SIZE; i++) {
+			CacheFile *file = &g_array_index (files, CacheFile, i);
+
+			if (strcmp (file->filename, cache->filename) == 0)
+				continue;
+
+			if (g_unlink (file->filename) == 0)
+				total_size -= file->size;
+		}
+	}
+
+	for (i = 0; i < files->len; i++)
+		g_free (g_array_index (files, CacheFile, i).filename);
+	g_array_free (files, TRUE);
+}
+
+/**
+ * ev_document_cache_store:
+ * @cache: an #EvDocumentCache
+ * @section: the name of a cache section
+ * @value: the value to store
+ *
+ * Replaces @section with @value and atomically rewrites the cache file.
+ * If @value is floating, the reference is consumed. Failing to write the
+ * cache is not an error, the document simply is not cached. Writing the
+ * file removes the least recently used ones if the cache grows too large.
+ */
+void
+ev_document_cache_store (EvDocumentCache *cache,
+			 const gchar     *section,
+			 GVariant        *value)
+{
+	GVariantBuilder builder;
+	GVariant       *sections;
+	GVariant       *variant;
+	GVariantIter    iter;
+	const gchar    *key;
+	GVariant       *old_value;
+	gchar          *dirname;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (section != NULL);
+	g_return_if_fail (value != NULL);
+
+	g_variant_ref_sink (value);
+
+	g_mutex_lock (&cache->mutex);
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+	if (cache->sections) {
+		g_variant_iter_init (&iter, cache->sections);
+		while (g_variant_iter_next (&iter, "{&s@v}", &key, &old_value)) {
+			if (strcmp (key, section) != 0)
+				g_variant_builder_add (&builder, "{s@v}", key, old_value);
+			g_variant_unref (old_value);
+		}
+	}
+	g_variant_builder_add (&builder, "{sv}", section, value);
+	sections = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+	g_clear_pointer (&cache->sections, g_variant_unref);
+	cache->sections = sections;
+
+	variant = g_variant_ref_sink (g_variant_new ("(us@a{sv})",
+						     CACHE_FORMAT_VERSION,
+						     cache->identity,
+						     sections));
+
+	dirname = g_path_get_dirname (cache->filename);
+	if (g_mkdir_with_parents (dirname, 0700) == 0) {
+		g_file_set_contents (cache->filename,
+				     g_variant_get_data (variant),
+				     g_variant_get_size (variant),
+				     NULL);
+		ev_document_cache_trim (cache, dirname);
+	}
+	g_free (dirname);
+
+	g_mutex_unlock (&cache->mutex);
+
+	g_variant_unref (variant);
+	g_variant_unref (value);
+}
+
+/* Outline */
+static GVariant *
+serialize_link_dest (EvLinkDest *dest)
+{
+	gboolean     change_left, change_top, change_zoom;
+	gdouble      left, top, zoom;
+	const gchar *named = ev_link_dest_get_named_dest (dest);
+	const gchar *label = ev_link_dest_get_page_label (dest);
+
+	left = ev_link_dest_get_left (dest, &change_left);
+	top = ev_link_dest_get_top (dest, &change_top);
+	zoom = ev_link_dest_get_zoom (dest, &change_zoom);
+
+	return g_variant_new ("(uiddddd(bbb)ss)",
+			      ev_link_dest_get_dest_type (dest),
+			      ev_link_dest_get_page (dest),
+			      left, top,
+			      ev_link_dest_get_right (dest),
+			      ev_link_dest_get_bottom (dest),
+			      zoom,
+			      change_left != FALSE,
+			      change_top != FALSE,
+			      change_zoom != FALSE,
+			      named ? named : "",
+			      label ? label : "");
+}
+
+static EvLinkDest *
+deserialize_link_dest (GVariant *variant)
+{
+	guint32      type;
+	gint32       page;
+	gdouble      left, top, right, bottom, zoom;
+	gboolean     change_left, change_top, change_zoom;
+	const gchar *named, *label;
+
+	g_variant_get (variant, "(uiddddd(bbb)&s&s)",
+		       &type, &page, &left, &top, &right, &bottom, &zoom,
+		       &change_left, &change_top, &change_zoom,
+		       &named, &label);
+
+	switch (type) {
+	case EV_LINK_DEST_TYPE_PAGE:
+		return ev_link_dest_new_page (page);
+	case EV_LINK_DEST_TYPE_XYZ:
+		return ev_link_dest_new_xyz (page, left, top, zoom,
+					     change_left, change_top, change_zoom);
+	case EV_LINK_DEST_TYPE_FIT:
+		return ev_link_dest_new_fit (page);
+	case EV_LINK_DEST_TYPE_FITH:
+		return ev_link_dest_new_fith (page, top, change_top);
+	case EV_LINK_DEST_TYPE_FITV:
+		return ev_link_dest_new_fitv (page, left, change_left);
+	case EV_LINK_DEST_TYPE_FITR:
+		return ev_link_dest_new_fitr (page, left, bottom, right, top);
+	case EV_LINK_DEST_TYPE_NAMED:
+		return ev_link_dest_new_named (named);
+	case EV_LINK_DEST_TYPE_PAGE_LABEL:
+		return ev_link_dest_new_page_label (label);
+	default:
+		return NULL;
+	}
+}
+
+/* Actions are stored as (type, dest, string, string); only the action
+ * types that can appear in an outline are supported, any other one makes
+ * the whole outline uncacheable.
+ */
+static GVariant *
+serialize_link_action (EvLinkAction *action)
+{
+	EvLinkActionType type;
+	EvLinkDest      *dest;
+	const gchar     *str1 = NULL;
+	const gchar     *str2 = NULL;
+
+	if (!action)
+		return g_variant_new ("mv", NULL);
+
+	type = ev_link_action_get_action_type (action);
+	dest = ev_link_action_get_dest (action);
+
+	switch (type) {
+	case EV_LINK_ACTION_TYPE_GOTO_DEST:
+		break;
+	case EV_LINK_ACTION_TYPE_GOTO_REMOTE:
+		str1 = ev_link_action_get_filename (action);
+		break;
+	case EV_LINK_ACTION_TYPE_EXTERNAL_URI:
+		str1 = ev_link_action_get_uri (action);
+		break;
+	case EV_LINK_ACTION_TYPE_LAUNCH:
+		str1 = ev_link_action_get_filename (action);
+		str2 = ev_link_action_get_params (action);
+		break;
+	case EV_LINK_ACTION_TYPE_NAMED:
+		str1 = ev_link_action_get_name (action);
+		break;
+	default:
+		return NULL;
+	}
+
+	return g_variant_new ("mv",
+			      g_variant_new ("(umvss)", type,
+					     dest ? serialize_link_dest (dest) : NULL,
+					     str1 ? str1 : "",
+					     str2 ? str2 : ""));
+}
+
+static EvLinkAction *
+deserialize_link_action (GVariant *variant)
+{
+	GVariant     *action_variant;
+	GVariant     *dest_variant = NULL;
+	EvLinkDest   *dest = NULL;
+	EvLinkAction *action = NULL;
+	guint32       type;
+	const gchar  *str1, *str2;
+
+	g_variant_get (variant, "mv", &action_variant);
+	if (!action_variant)
+		return NULL;
+
+	g_variant_get (action_variant, "(umv&s&s)", &type, &dest_variant, &str1, &str2);
+	if (dest_variant) {
+		dest = deserialize_link_dest (dest_variant);
+		g_variant_unref (dest_variant);
+	}
+
+	switch (type) {
+	case EV_LINK_ACTION_TYPE_GOTO_DEST:
+		if (dest)
+			action = ev_link_action_new_dest (dest);
+		break;
+	case EV_LINK_ACTION_TYPE_GOTO_REMOTE:
+		if (dest)
+			action = ev_link_action_new_remote (dest, str1);
+		break;
+	case EV_LINK_ACTION_TYPE_EXTERNAL_URI:
+		action = ev_link_action_new_external_uri (str1);
+		break;
+	case EV_LINK_ACTION_TYPE_LAUNCH:
+		action = ev_link_action_new_launch (str1, str2);
+		break;
+	case EV_LINK_ACTION_TYPE_NAMED:
+		action = ev_link_action_new_named (str1);
+		break;
+	}
+
+	g_clear_object (&dest);
+	g_variant_unref (action_variant);
+
+	return action;
+}
+
+static gboolean
+serialize_outline (GtkTreeModel    *model,
+		   GtkTreeIter     *parent,
+		   guint            depth,
+		   GVariantBuilder *builder)
+{
+	GtkTreeIter iter;
+
+	if (!gtk_tree_model_iter_children (model, &iter, parent))
+		return TRUE;
+
+	do {
+		gchar    *markup = NULL;
+		gchar    *page_label = NULL;
+		gboolean  expand = FALSE;
+		EvLink   *link = NULL;
+		GVariant *action = NULL;
+
+		gtk_tree_model_get (model, &iter,
+				    EV_DOCUMENT_LINKS_COLUMN_MARKUP, &markup,
+				    EV_DOCUMENT_LINKS_COLUMN_LINK, &link,
+				    EV_DOCUMENT_LINKS_COLUMN_EXPAND, &expand,
+				    EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL, &page_label,
+				    -1);
+		if (link)
+			action = serialize_link_action (ev_link_get_action (link));
+
+		if (link && action) {
+			const gchar *title = ev_link_get_title (link);
+
+			g_variant_builder_add (builder, OUTLINE_ENTRY_FORMAT,
+					       depth,
+					       markup ? markup : "",
+					       page_label ? page_label : "",
+					       expand,
+					       title ? title : "",
+					       action);
+		}
+
+		g_free (markup);
+		g_free (page_label);
+		g_clear_object (&link);
+
+		if (!action)
+			return FALSE;
+
+		if (!serialize_outline (model, &iter, depth + 1, builder))
+			return FALSE;
+	} while (gtk_tree_model_iter_next (model, &iter));
+
+	return TRUE;
+}
+
+/**
+ * ev_document_cache_get_outline:
+ * @cache: an #EvDocumentCache
+ *
+ * Rebuilds the document outline stored with ev_document_cache_set_outline(),
+ * including the page labels of every entry.
+ *
+ * Returns: (transfer full) (nullable): a #GtkTreeModel with the columns of
+ *   ev_document_links_get_links_model(), or %NULL if it is not cached
+ */
+GtkTreeModel *
+ev_document_cache_get_outline (EvDocumentCache *cache)
+{
+	GVariant     *outline;
+	GVariantIter  iter;
+	GtkTreeStore *model;
+	GtkTreeIter  *parents;
+	guint         n_parents;
+	guint32       depth;
+	guint32       max_depth = 0;
+	const gchar  *markup, *page_label, *title;
+	gboolean      expand;
+	GVariant     *action_variant;
+
+	g_return_val_if_fail (cache != NULL, NULL);
+
+	outline = ev_document_cache_lookup (cache, OUTLINE_SECTION);
+	if (!outline)
+		return NULL;
+
+	if (!g_variant_is_of_type (outline, G_VARIANT_TYPE ("a" OUTLINE_ENTRY_FORMAT))) {
+		g_variant_unref (outline);
+		return NULL;
+	}
+
+	model = gtk_tree_store_new (EV_DOCUMENT_LINKS_COLUMN_NUM_COLUMNS,
+				    G_TYPE_STRING,
+				    G_TYPE_OBJECT,
+				    G_TYPE_BOOLEAN,
+				    G_TYPE_STRING);
+
+	/* Entries are stored in depth-first order with their depth, so
+	 * the parent of every entry is the last one seen at depth - 1.
+	 * An entry can't be deeper than the one before plus one, otherwise
+	 * the file is broken and the outline is taken from the document.
+	 */
+	n_parents = 16;
+	parents = g_new (GtkTreeIter, n_parents + 1);
+
+	g_variant_iter_init (&iter, outline);
+	while (g_variant_iter_next (&iter, "(u&s&sb&s@v)", &depth, &markup, &page_label,
+				    &expand, &title, &action_variant)) {
+		EvLinkAction *action;
+		EvLink       *link;
+
+		if (depth > max_depth) {
+			g_variant_unref (action_variant);
+			g_clear_object (&model);
+			break;
+		}
+		max_depth = depth + 1;
+
+		if (depth >= n_parents) {
+			n_parents = depth * 2;
+			parents = g_renew (GtkTreeIter, parents, n_parents + 1);
+		}
+
+		action = deserialize_link_action (action_variant);
+		g_variant_unref (action_variant);
+
+		link = ev_link_new (title, action);
+		g_clear_object (&action);
+
+		gtk_tree_store_append (model, &parents[depth],
+				       depth > 0 ? &parents[depth - 1] : NULL);
+		gtk_tree_store_set (model, &parents[depth],
+				    EV_DOCUMENT_LINKS_COLUMN_MARKUP, markup,
+				    EV_DOCUMENT_LINKS_COLUMN_LINK, link,
+				    EV_DOCUMENT_LINKS_COLUMN_EXPAND, expand,
+				    EV_DOCUMENT_LINKS_COLUMN_PAGE_LABEL, *page_label ? page_label : NULL,
+				    -1);
+		g_object_unref (link);
+	}
+
+	g_free (parents);
+	g_variant_unref (outline);
+
+	return model ? GTK_TREE_MODEL (model) : NULL;
+}
+
+/**
+ * ev_document_cache_set_outline:
+ * @cache: an #EvDocumentCache
+ * @model: a #GtkTreeModel as returned by ev_document_links_get_links_model()
+ *
+ * Stores the document outline in @cache. Outlines containing link actions
+ * that cannot be serialized are not cached.
+ */
+void
+ev_document_cache_set_outline (EvDocumentCache *cache,
+			       GtkTreeModel    *model)
+{
+	GVariantBuilder builder;
+
+	g_return_if_fail (cache != NULL);
+	g_return_if_fail (GTK_IS_TREE_MODEL (model));
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" OUTLINE_ENTRY_FORMAT));
+	if (!serialize_outline (model, NULL, 0, &builder)) {
+		g_variant_builder_clear (&builder);
+		return;
+	}
+
+	ev_document_cache_store (cache, OUTLINE_SECTION, g_variant_builder_end (&builder));
+}
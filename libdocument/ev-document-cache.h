@@ -0,0 +1,53 @@
+/* ev-document-cache.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (__EV_EVINCE_DOCUMENT_H_INSIDE__) && !defined (EVINCE_COMPILATION)
+#error "Only <evince-document.h> can be included directly."
+#endif
+
+#ifndef EV_DOCUMENT_CACHE_H
+#define EV_DOCUMENT_CACHE_H
+
+#include <glib-object.h>
+#include <gio/gio.h>
+#include <gtk/gtk.h>
+
+G_BEGIN_DECLS
+
+typedef struct _EvDocumentCache EvDocumentCache;
+
+#define          EV_TYPE_DOCUMENT_CACHE         (ev_document_cache_get_type())
+GType            ev_document_cache_get_type     (void) G_GNUC_CONST;
+
+EvDocumentCache *ev_document_cache_new          (GFile           *file);
+EvDocumentCache *ev_document_cache_ref          (EvDocumentCache *cache);
+void             ev_document_cache_unref        (EvDocumentCache *cache);
+
+GVariant        *ev_document_cache_lookup       (EvDocumentCache *cache,
+						 const gchar     *section);
+void             ev_document_cache_store        (EvDocumentCache *cache,
+						 const gchar     *section,
+						 GVariant        *value);
+
+GtkTreeModel    *ev_document_cache_get_outline  (EvDocumentCache *cache);
+void             ev_document_cache_set_outline  (EvDocumentCache *cache,
+						 GtkTreeModel    *model);
+
+G_END_DECLS
+
+#endif /* EV_DOCUMENT_CACHE_H */
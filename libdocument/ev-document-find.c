@@ -81,3 +81,65 @@ ev_document_find_get_supported_options (EvDocumentFind *document_find)
 		return iface->get_supported_options (document_find);
 	return 0;
 }
+
+/**
+ * ev_document_find_has_text_index:
+ * @document_find: an #EvDocumentFind
+ *
+ * Whether the text of the document pages has to be indexed with
+ * ev_document_find_index_page() before searching it. Indexing is slow
+ * and is meant to be done in a thread, while searching the index is fast
+ * enough for the main loop.
+ *
+ * Returns: %TRUE if @document_find searches a text index
+ *
+ * Since: 3.40
+ */
+gboolean
+ev_document_find_has_text_index (EvDocumentFind *document_find)
+{
+	EvDocumentFindInterface *iface = EV_DOCUMENT_FIND_GET_IFACE (document_find);
+
+	return iface->index_page != NULL;
+}
+
+/**
+ * ev_document_find_is_page_indexed:
+ * @document_find: an #EvDocumentFind
+ * @page: the index of the page
+ *
+ * Returns: %TRUE if @page has already been indexed, or if
+ *   @document_find doesn't have a text index
+ *
+ * Since: 3.40
+ */
+gboolean
+ev_document_find_is_page_indexed (EvDocumentFind *document_find,
+				  gint            page)
+{
+	EvDocumentFindInterface *iface = EV_DOCUMENT_FIND_GET_IFACE (document_find);
+
+	if (iface->is_page_indexed)
+		return iface->is_page_indexed (document_find, page);
+	return TRUE;
+}
+
+/**
+ * ev_document_find_index_page:
+ * @document_find: an #EvDocumentFind
+ * @page: an #EvPage
+ *
+ * Extracts the text of @page into the text index of @document_find.
+ * It does nothing if @page is already indexed.
+ *
+ * Since: 3.40
+ */
+void
+ev_document_find_index_page (EvDocumentFind *document_find,
+			     EvPage         *page)
+{
+	EvDocumentFindInterface *iface = EV_DOCUMENT_FIND_GET_IFACE (document_find);
+
+	if (iface->index_page)
+		iface->index_page (document_find, page);
+}
@@ -63,6 +63,12 @@ struct _EvDocumentFindInterface
 						  const gchar    *text,
 						  EvFindOptions   options);
 	EvFindOptions (*get_supported_options)   (EvDocumentFind *document_find);
+
+	/* Text index, optional */
+	gboolean      (* is_page_indexed)        (EvDocumentFind *document_find,
+						  gint            page);
+	void          (* index_page)             (EvDocumentFind *document_find,
+						  EvPage         *page);
 };
 
 GType         ev_document_find_get_type               (void) G_GNUC_CONST;
@@ -75,6 +81,11 @@ GList        *ev_document_find_find_text_with_options (EvDocumentFind *document_
 						       const gchar    *text,
 						       EvFindOptions   options);
 EvFindOptions ev_document_find_get_supported_options  (EvDocumentFind *document_find);
+gboolean      ev_document_find_has_text_index         (EvDocumentFind *document_find);
+gboolean      ev_document_find_is_page_indexed        (EvDocumentFind *document_find,
+						       gint            page);
+void          ev_document_find_index_page             (EvDocumentFind *document_find,
+						       EvPage         *page);
 
 G_END_DECLS
 
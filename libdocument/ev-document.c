@@ -25,8 +25,10 @@
 #include <string.h>
 
 #include "ev-document.h"
+#include "ev-document-cache.h"
 #include "ev-document-misc.h"
-#include "synctex_parser.h"
+#include "ev-document-security.h"
+#include "ev-synctex.h"
 
 enum {
 	PROP_0,
@@ -60,9 +62,16 @@ struct _EvDocumentPrivate
 
 	gchar         **page_labels;
 	EvPageSize     *page_sizes;
+	GVariant       *page_sizes_variant;
 	EvDocumentInfo *info;
 
-	synctex_scanner_p synctex_scanner;
+	EvDocumentCache *cache;
+
+	/* SyncTeX data is parsed on demand, see ev_document_load_synctex() */
+	GMutex          synctex_mutex;
+	gchar          *synctex_filename;
+	gboolean        synctex_loaded;
+	EvSynctex      *synctex;
 };
 
 static guint64         _ev_document_get_size_gfile  (GFile      *file);
@@ -79,6 +88,7 @@ static gboolean        _ev_document_support_synctex (EvDocument *document);
 
 static GMutex ev_doc_mutex;
 static GMutex ev_fc_mutex;
+static guint  ev_max_render_threads = 0;
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (EvDocument, ev_document, G_TYPE_OBJECT)
 
@@ -115,11 +125,18 @@ ev_document_finalize (GObject *object)
 		document->priv->uri = NULL;
 	}
 
-	if (document->priv->page_sizes) {
+	if (document->priv->page_sizes_variant) {
+		/* page_sizes points into the mapped cache file */
+		g_variant_unref (document->priv->page_sizes_variant);
+		document->priv->page_sizes_variant = NULL;
+		document->priv->page_sizes = NULL;
+	} else if (document->priv->page_sizes) {
 		g_free (document->priv->page_sizes);
 		document->priv->page_sizes = NULL;
 	}
 
+	g_clear_pointer (&document->priv->cache, ev_document_cache_unref);
+
 	g_clear_pointer (&document->priv->page_labels, g_strfreev);
 
 	if (document->priv->info) {
@@ -127,10 +144,9 @@ ev_document_finalize (GObject *object)
 		document->priv->info = NULL;
 	}
 
-	if (document->priv->synctex_scanner) {
-		synctex_scanner_free (document->priv->synctex_scanner);
-		document->priv->synctex_scanner = NULL;
-	}
+	g_clear_pointer (&document->priv->synctex, _ev_synctex_release);
+	g_clear_pointer (&document->priv->synctex_filename, g_free);
+	g_mutex_clear (&document->priv->synctex_mutex);
 
 	G_OBJECT_CLASS (ev_document_parent_class)->finalize (object);
 }
@@ -177,6 +193,8 @@ ev_document_init (EvDocument *document)
 
 	/* Assume all pages are the same size until proven otherwise */
 	document->priv->uniform = TRUE;
+
+	g_mutex_init (&document->priv->synctex_mutex);
 }
 
 static void
@@ -278,11 +296,259 @@ ev_document_fc_mutex_trylock (void)
 	return g_mutex_trylock (&ev_fc_mutex);
 }
 
+/**
+ * ev_document_get_max_render_threads:
+ *
+ * Returns the maximum number of threads that can render the same document
+ * concurrently, on backends supporting it. See
+ * ev_document_set_max_render_threads().
+ *
+ * Returns: the maximum number of rendering threads
+ *
+ * Since: 3.40
+ */
+guint
+ev_document_get_max_render_threads (void)
+{
+	guint n_threads = g_atomic_int_get (&ev_max_render_threads);
+
+	if (n_threads == 0)
+		n_threads = CLAMP (g_get_num_processors (), 1, 4);
+
+	return n_threads;
+}
+
+/**
+ * ev_document_set_max_render_threads:
+ * @n_threads: the maximum number of rendering threads, or 0 for the default
+ *
+ * Sets the maximum number of threads that can render the same document
+ * concurrently. Backends supporting it open an independent copy of the
+ * document for every thread rendering at the same time, so this also
+ * bounds the memory used by those copies. A value of 1 disables concurrent
+ * rendering; the default depends on the number of processors.
+ *
+ * Since: 3.40
+ */
+void
+ev_document_set_max_render_threads (guint n_threads)
+{
+	g_atomic_int_set (&ev_max_render_threads, n_threads);
+}
+
+#define GEOMETRY_SECTION "geometry"
+#define GEOMETRY_FORMAT  "(ib(dd)(dd)(dd)a(dd)ias)"
+
+static gboolean
+ev_document_load_disk_cache (EvDocument *document)
+{
+	EvDocumentPrivate *priv = document->priv;
+	GVariant          *geometry;
+	GVariant          *page_sizes;
+	GVariant          *page_labels;
+	gint32             n_pages;
+	gint32             max_label;
+	gsize              n_sizes = 0;
+	gint               i;
+
+	geometry = ev_document_cache_lookup (priv->cache, GEOMETRY_SECTION);
+	if (!geometry)
+		return FALSE;
+
+	if (!g_variant_is_of_type (geometry, G_VARIANT_TYPE (GEOMETRY_FORMAT))) {
+		g_variant_unref (geometry);
+		return FALSE;
+	}
+
+	g_variant_get (geometry, "(ib(dd)(dd)(dd)@a(dd)i@as)",
+		       &n_pages, &priv->uniform,
+		       &priv->uniform_width, &priv->uniform_height,
+		       &priv->min_width, &priv->min_height,
+		       &priv->max_width, &priv->max_height,
+		       &page_sizes, &max_label, &page_labels);
+	g_variant_unref (geometry);
+
+	if (!priv->uniform) {
+		/* EvPageSize has the layout of (dd), so the sizes are
+		 * used in place from the mapped cache file.
+		 */
+		priv->page_sizes = (EvPageSize *) g_variant_get_fixed_array (page_sizes, &n_sizes,
+									     sizeof (EvPageSize));
+	}
+
+	if (n_pages != priv->n_pages || (!priv->uniform && n_sizes != (gsize) n_pages)) {
+		priv->page_sizes = NULL;
+		priv->uniform = TRUE;
+		g_variant_unref (page_sizes);
+		g_variant_unref (page_labels);
+
+		return FALSE;
+	}
+
+	if (priv->page_sizes)
+		priv->page_sizes_variant = page_sizes;
+	else
+		g_variant_unref (page_sizes);
+
+	if (g_variant_n_children (page_labels) == (gsize) n_pages) {
+		GVariantIter iter;
+		const gchar *label;
+
+		priv->page_labels = g_new0 (gchar *, priv->n_pages + 1);
+		g_variant_iter_init (&iter, page_labels);
+		for (i = 0; g_variant_iter_next (&iter, "&s", &label); i++) {
+			if (*label)
+				priv->page_labels[i] = g_strdup (label);
+		}
+		priv->max_label = max_label;
+	}
+	g_variant_unref (page_labels);
+
+	return TRUE;
+}
+
+static void
+ev_document_store_disk_cache (EvDocument *document)
+{
+	EvDocumentPrivate *priv = document->priv;
+	GVariantBuilder    page_sizes;
+	GVariantBuilder    page_labels;
+	gint               i;
+
+	g_variant_builder_init (&page_sizes, G_VARIANT_TYPE ("a(dd)"));
+	for (i = 0; !priv->uniform && i < priv->n_pages; i++) {
+		g_variant_builder_add (&page_sizes, "(dd)",
+				       priv->page_sizes[i].width,
+				       priv->page_sizes[i].height);
+	}
+
+	g_variant_builder_init (&page_labels, G_VARIANT_TYPE_STRING_ARRAY);
+	for (i = 0; priv->page_labels && i < priv->n_pages; i++) {
+		g_variant_builder_add (&page_labels, "s",
+				       priv->page_labels[i] ? priv->page_labels[i] : "");
+	}
+
+	ev_document_cache_store (priv->cache, GEOMETRY_SECTION,
+				 g_variant_new (GEOMETRY_FORMAT,
+						priv->n_pages, priv->uniform,
+						priv->uniform_width, priv->uniform_height,
+						priv->min_width, priv->min_height,
+						priv->max_width, priv->max_height,
+						&page_sizes, priv->max_label, &page_labels));
+}
+
+/* Minimum number of pages scanned by a worker when page sizes
+ * are scanned in parallel on independent document handles.
+ */
+#define PAGE_SCAN_MIN_PAGES   256
+#define PAGE_SCAN_MAX_WORKERS 8
+
+typedef struct {
+	EvDocument *document;
+	EvDocument *handle;
+	gint        first;
+	gint        last;
+
+	EvPageSize *page_sizes;
+	gchar     **page_labels;
+
+	/* Partial results, merged by ev_document_setup_cache() */
+	gboolean    scanned;
+	gboolean    uniform;
+	gboolean    custom_page_labels;
+	gdouble     max_width;
+	gdouble     max_height;
+	gdouble     min_width;
+	gdouble     min_height;
+	gint        max_label;
+} EvPageScan;
+
+static void
+ev_page_scan_run (EvPageScan *scan)
+{
+	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (scan->handle);
+	gint             i;
+
+	scan->uniform = TRUE;
+
+	for (i = scan->first; i < scan->last; i++) {
+		EvPage     *page = klass->get_page (scan->handle, i);
+		EvPageSize *page_size = &(scan->page_sizes[i]);
+		gchar      *page_label;
+
+		klass->get_page_size (scan->handle, page, &page_size->width, &page_size->height);
+
+		if (i == scan->first) {
+			scan->max_width = scan->min_width = page_size->width;
+			scan->max_height = scan->min_height = page_size->height;
+		} else {
+			if (page_size->width != scan->page_sizes[scan->first].width ||
+			    page_size->height != scan->page_sizes[scan->first].height)
+				scan->uniform = FALSE;
+
+			scan->max_width = MAX (scan->max_width, page_size->width);
+			scan->min_width = MIN (scan->min_width, page_size->width);
+			scan->max_height = MAX (scan->max_height, page_size->height);
+			scan->min_height = MIN (scan->min_height, page_size->height);
+		}
+
+		page_label = klass->get_page_label ? klass->get_page_label (scan->handle, page) : NULL;
+		if (page_label) {
+			if (!scan->custom_page_labels) {
+				gchar *real_page_label;
+
+				real_page_label = g_strdup_printf ("%d", i + 1);
+				scan->custom_page_labels = g_strcmp0 (real_page_label, page_label) != 0;
+				g_free (real_page_label);
+			}
+
+			scan->page_labels[i] = page_label;
+			scan->max_label = MAX (scan->max_label,
+					       g_utf8_strlen (page_label, 256));
+		}
+
+		g_object_unref (page);
+	}
+
+	scan->scanned = TRUE;
+}
+
+static gpointer
+ev_page_scan_thread (EvPageScan *scan)
+{
+	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (scan->document);
+
+	scan->handle = klass->clone (scan->document);
+	if (scan->handle)
+		ev_page_scan_run (scan);
+
+	return NULL;
+}
+
+static gint
+ev_document_get_n_page_scans (EvDocument *document)
+{
+	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (document);
+	gint             n_scans;
+
+	if (!klass->clone || !document->priv->uri)
+		return 1;
+
+	n_scans = document->priv->n_pages / PAGE_SCAN_MIN_PAGES;
+
+	return CLAMP (n_scans, 1, MIN (g_get_num_processors (), PAGE_SCAN_MAX_WORKERS));
+}
+
 static void
 ev_document_setup_cache (EvDocument *document)
 {
         EvDocumentPrivate *priv = document->priv;
         gboolean custom_page_labels = FALSE;
+	EvPageSize *page_sizes;
+	gchar     **page_labels;
+	EvPageScan *scans;
+	GThread   **threads;
+	gint        n_scans;
         gint i;
 
         /* Cache some info about the document to avoid
@@ -290,94 +556,152 @@ ev_document_setup_cache (EvDocument *document)
          */
 	priv->cache_loaded = TRUE;
 
-        for (i = 0; i < priv->n_pages; i++) {
-                EvPage     *page = ev_document_get_page (document, i);
-                gdouble     page_width = 0;
-                gdouble     page_height = 0;
-                EvPageSize *page_size;
-                gchar      *page_label;
-
-                _ev_document_get_page_size (document, page, &page_width, &page_height);
-
-                if (i == 0) {
-                        priv->uniform_width = page_width;
-                        priv->uniform_height = page_height;
-                        priv->max_width = priv->uniform_width;
-                        priv->max_height = priv->uniform_height;
-                        priv->min_width = priv->uniform_width;
-                        priv->min_height = priv->uniform_height;
-                } else if (priv->uniform &&
-                            (priv->uniform_width != page_width ||
-                            priv->uniform_height != page_height)) {
-                        /* It's a different page size.  Backfill the array. */
-                        int j;
-
-                        priv->page_sizes = g_new0 (EvPageSize, priv->n_pages);
-
-                        for (j = 0; j < i; j++) {
-                                page_size = &(priv->page_sizes[j]);
-                                page_size->width = priv->uniform_width;
-                                page_size->height = priv->uniform_height;
-                        }
-                        priv->uniform = FALSE;
-                }
-                if (!priv->uniform) {
-                        page_size = &(priv->page_sizes[i]);
-
-                        page_size->width = page_width;
-                        page_size->height = page_height;
-
-                        if (page_width > priv->max_width)
-                                priv->max_width = page_width;
-                        if (page_width < priv->min_width)
-                                priv->min_width = page_width;
-
-                        if (page_height > priv->max_height)
-                                priv->max_height = page_height;
-                        if (page_height < priv->min_height)
-                                priv->min_height = page_height;
-                }
-
-                page_label = _ev_document_get_page_label (document, page);
-                if (page_label) {
-                        if (!priv->page_labels)
-                                priv->page_labels = g_new0 (gchar *, priv->n_pages + 1);
-
-                        if (!custom_page_labels) {
-                                gchar *real_page_label;
-
-                                real_page_label = g_strdup_printf ("%d", i + 1);
-                                custom_page_labels = g_strcmp0 (real_page_label, page_label) != 0;
-                                g_free (real_page_label);
-                        }
-
-                        priv->page_labels[i] = page_label;
-                        priv->max_label = MAX (priv->max_label,
-                                                g_utf8_strlen (page_label, 256));
-                }
-
-                g_object_unref (page);
-        }
+	if (priv->cache && ev_document_load_disk_cache (document))
+		return;
+
+	page_sizes = g_new0 (EvPageSize, MAX (priv->n_pages, 1));
+	page_labels = g_new0 (gchar *, priv->n_pages + 1);
+
+	/* Large documents are split in ranges scanned concurrently, the
+	 * first one with @document on this thread and the others with
+	 * independent handles opened by the backend on worker threads.
+	 */
+	n_scans = ev_document_get_n_page_scans (document);
+	scans = g_new0 (EvPageScan, n_scans);
+	threads = g_new0 (GThread *, n_scans);
+
+	for (i = 0; i < n_scans; i++) {
+		scans[i].document = document;
+		scans[i].first = (gint) ((gint64) priv->n_pages * i / n_scans);
+		scans[i].last = (gint) ((gint64) priv->n_pages * (i + 1) / n_scans);
+		scans[i].page_sizes = page_sizes;
+		scans[i].page_labels = page_labels;
+
+		if (i > 0) {
+			threads[i] = g_thread_new ("EvPageScan",
+						   (GThreadFunc) ev_page_scan_thread,
+						   &scans[i]);
+		}
+	}
+
+	scans[0].handle = document;
+	ev_page_scan_run (&scans[0]);
+
+	for (i = 1; i < n_scans; i++) {
+		g_thread_join (threads[i]);
+		g_clear_object (&scans[i].handle);
+
+		/* The backend could not open a new handle, fall back to
+		 * scanning the range with @document.
+		 */
+		if (!scans[i].scanned) {
+			scans[i].handle = document;
+			ev_page_scan_run (&scans[i]);
+			scans[i].handle = NULL;
+		}
+	}
+
+	/* Merge the partial results */
+	priv->uniform_width = page_sizes[0].width;
+	priv->uniform_height = page_sizes[0].height;
+	priv->max_width = priv->min_width = priv->uniform_width;
+	priv->max_height = priv->min_height = priv->uniform_height;
+
+	for (i = 0; i < n_scans; i++) {
+		EvPageScan *scan = &scans[i];
+
+		if (scan->first == scan->last)
+			continue;
+
+		if (!scan->uniform ||
+		    page_sizes[scan->first].width != priv->uniform_width ||
+		    page_sizes[scan->first].height != priv->uniform_height)
+			priv->uniform = FALSE;
+
+		priv->max_width = MAX (priv->max_width, scan->max_width);
+		priv->min_width = MIN (priv->min_width, scan->min_width);
+		priv->max_height = MAX (priv->max_height, scan->max_height);
+		priv->min_height = MIN (priv->min_height, scan->min_height);
+
+		priv->max_label = MAX (priv->max_label, scan->max_label);
+		custom_page_labels |= scan->custom_page_labels;
+	}
+
+	g_free (threads);
+	g_free (scans);
+
+	if (priv->uniform)
+		g_free (page_sizes);
+	else
+		priv->page_sizes = page_sizes;
+
+	if (custom_page_labels) {
+		priv->page_labels = page_labels;
+	} else {
+		for (i = 0; i < priv->n_pages; i++)
+			g_free (page_labels[i]);
+		g_free (page_labels);
+	}
+
+	if (priv->cache)
+		ev_document_store_disk_cache (document);
+}
+
+static void
+ev_document_open_disk_cache (EvDocument          *document,
+			     GFile               *file,
+			     EvDocumentLoadFlags  flags)
+{
+	g_clear_pointer (&document->priv->cache, ev_document_cache_unref);
+
+	if (flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE)
+		return;
+
+	/* The cache isn't encrypted, so don't leak the outline and
+	 * page labels of password protected documents to the disk.
+	 */
+	if (EV_IS_DOCUMENT_SECURITY (document) &&
+	    ev_document_security_has_document_security (EV_DOCUMENT_SECURITY (document)))
+		return;
 
-	if (!custom_page_labels)
-		g_clear_pointer (&priv->page_labels, g_strfreev);
+	document->priv->cache = ev_document_cache_new (file);
 }
 
+/* Parsing the SyncTeX file can take longer than loading the document,
+ * so only check here whether there is one, the scanner is loaded later
+ * by ev_document_load_synctex(). The scanner of a previous load of the
+ * file is taken now if it's up to date, before that document is closed.
+ */
 static void
 ev_document_initialize_synctex (EvDocument  *document,
 				const gchar *uri)
 {
 	EvDocumentPrivate *priv = document->priv;
+	gchar             *filename;
+	gchar             *synctex_file;
 
-	if (_ev_document_support_synctex (document)) {
-		gchar *filename;
+	if (!_ev_document_support_synctex (document))
+		return;
 
-		filename = g_filename_from_uri (uri, NULL, NULL);
-		if (filename != NULL) {
-			priv->synctex_scanner =
-				synctex_scanner_new_with_output_file (filename, NULL, 1);
-			g_free (filename);
-		}
+	filename = g_filename_from_uri (uri, NULL, NULL);
+	if (filename == NULL)
+		return;
+
+	synctex_file = _ev_synctex_find_file (filename);
+	if (synctex_file) {
+		EvSynctex *synctex = _ev_synctex_lookup (filename);
+
+		g_mutex_lock (&priv->synctex_mutex);
+		g_clear_pointer (&priv->synctex, _ev_synctex_release);
+		g_free (priv->synctex_filename);
+		priv->synctex_filename = filename;
+		priv->synctex = synctex;
+		priv->synctex_loaded = synctex != NULL;
+		g_mutex_unlock (&priv->synctex_mutex);
+
+		g_free (synctex_file);
+	} else {
+		g_free (filename);
 	}
 }
 
@@ -424,11 +748,16 @@ ev_document_load_full (EvDocument           *document,
 					     "Internal error in backend");
 		}
 	} else {
+		GFile *file = g_file_new_for_uri (uri);
+
 		document->priv->info = _ev_document_get_info (document);
 		document->priv->n_pages = _ev_document_get_n_pages (document);
+		g_free (document->priv->uri);
+		document->priv->uri = g_strdup (uri);
+		ev_document_open_disk_cache (document, file, flags);
 		if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
 			ev_document_setup_cache (document);
-		document->priv->uri = g_strdup (uri);
+		g_object_unref (file);
 		document->priv->file_size = _ev_document_get_size (uri);
 		ev_document_initialize_synctex (document, uri);
         }
@@ -552,11 +881,13 @@ ev_document_load_gfile (EvDocument         *document,
 
 	document->priv->info = _ev_document_get_info (document);
 	document->priv->n_pages = _ev_document_get_n_pages (document);
+	g_free (document->priv->uri);
+	document->priv->uri = g_file_get_uri (file);
+	ev_document_open_disk_cache (document, file, flags);
 
         if (!(flags & EV_DOCUMENT_LOAD_FLAG_NO_CACHE))
                 ev_document_setup_cache (document);
 
-	document->priv->uri = g_file_get_uri (file);
 	document->priv->file_size = _ev_document_get_size_gfile (file);
 	ev_document_initialize_synctex (document, document->priv->uri);
 
@@ -607,12 +938,114 @@ _ev_document_support_synctex (EvDocument *document)
 	return klass->support_synctex ? klass->support_synctex (document) : FALSE;
 }
 
+/**
+ * ev_document_has_synctex:
+ * @document: a #EvDocument
+ *
+ * Returns: %TRUE if @document has SyncTeX data. The data might not have been
+ * loaded yet, see ev_document_synctex_is_loaded().
+ */
 gboolean
 ev_document_has_synctex (EvDocument *document)
 {
+	EvDocumentPrivate *priv;
+	gboolean           retval;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	priv = document->priv;
+
+	g_mutex_lock (&priv->synctex_mutex);
+	if (priv->synctex_loaded)
+		retval = priv->synctex != NULL;
+	else
+		retval = priv->synctex_filename != NULL;
+	g_mutex_unlock (&priv->synctex_mutex);
+
+	return retval;
+}
+
+/**
+ * ev_document_synctex_is_loaded:
+ * @document: a #EvDocument
+ *
+ * Returns: %TRUE if SyncTeX searches on @document won't block
+ * to load the SyncTeX data.
+ *
+ * Since: 3.40
+ */
+gboolean
+ev_document_synctex_is_loaded (EvDocument *document)
+{
+	EvDocumentPrivate *priv;
+	gboolean           retval;
+
 	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
 
-	return document->priv->synctex_scanner != NULL;
+	priv = document->priv;
+
+	g_mutex_lock (&priv->synctex_mutex);
+	retval = priv->synctex_loaded || priv->synctex_filename == NULL;
+	g_mutex_unlock (&priv->synctex_mutex);
+
+	return retval;
+}
+
+/**
+ * ev_document_load_synctex:
+ * @document: a #EvDocument
+ *
+ * Loads the SyncTeX data of @document, if it has any and it hasn't been
+ * loaded yet. A scanner already parsed for an unmodified SyncTeX file is
+ * reused. This can take a long time for big documents, so it should be
+ * called from a thread; SyncTeX searches call it when needed.
+ *
+ * Since: 3.40
+ */
+void
+ev_document_load_synctex (EvDocument *document)
+{
+	EvDocumentPrivate *priv;
+	EvSynctex         *synctex;
+	gchar             *filename = NULL;
+
+	g_return_if_fail (EV_IS_DOCUMENT (document));
+
+	priv = document->priv;
+
+	g_mutex_lock (&priv->synctex_mutex);
+	if (!priv->synctex_loaded)
+		filename = g_strdup (priv->synctex_filename);
+	g_mutex_unlock (&priv->synctex_mutex);
+
+	if (!filename)
+		return;
+
+	/* Parse without holding the lock, the main thread takes it to
+	 * check whether the document has SyncTeX data.
+	 */
+	synctex = _ev_synctex_get (filename);
+
+	g_mutex_lock (&priv->synctex_mutex);
+	if (!priv->synctex_loaded &&
+	    g_strcmp0 (priv->synctex_filename, filename) == 0) {
+		priv->synctex = synctex;
+		priv->synctex_loaded = TRUE;
+		synctex = NULL;
+	}
+	g_mutex_unlock (&priv->synctex_mutex);
+
+	if (synctex)
+		_ev_synctex_release (synctex);
+	g_free (filename);
+}
+
+static EvSynctex *
+ev_document_get_synctex (EvDocument *document)
+{
+	ev_document_load_synctex (document);
+
+	return document->priv->synctex;
 }
 
 /**
@@ -636,34 +1069,15 @@ ev_document_synctex_backward_search (EvDocument *document,
                                      gfloat      x,
                                      gfloat      y)
 {
-        EvSourceLink *result = NULL;
-        synctex_scanner_p scanner;
+        EvSynctex *synctex;
 
         g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
 
-        scanner = document->priv->synctex_scanner;
-        if (!scanner)
+        synctex = ev_document_get_synctex (document);
+        if (!synctex)
                 return NULL;
 
-        if (synctex_edit_query (scanner, page_index + 1, x, y) > 0) {
-                synctex_node_p node;
-
-                /* We assume that a backward search returns either zero or one result_node */
-                node = synctex_scanner_next_result (scanner);
-                if (node != NULL) {
-			const gchar *filename;
-
-			filename = synctex_scanner_get_name (scanner, synctex_node_tag (node));
-			
-			if (filename) {
-				result = ev_source_link_new (filename,
-							     synctex_node_line (node),
-							     synctex_node_column (node));
-			}
-                }
-        }
-
-        return result;
+        return _ev_synctex_backward_search (synctex, page_index, x, y);
 }
 
 /**
@@ -682,40 +1096,15 @@ EvMapping *
 ev_document_synctex_forward_search (EvDocument   *document,
 				    EvSourceLink *link)
 {
-        EvMapping        *result = NULL;
-        synctex_scanner_p scanner;
+        EvSynctex *synctex;
 
         g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
 
-        scanner = document->priv->synctex_scanner;
-        if (!scanner)
+        synctex = ev_document_get_synctex (document);
+        if (!synctex)
                 return NULL;
 
-	/* Since 1.19, synctex_display_query has a fourth parameter,
-	 * page-hint, which we set into a dummy number to not break the
-	 * API. In synctex it is used to set the best results first
-	 * given the page-hint
-	 */
-        if (synctex_display_query (scanner, link->filename, link->line, link->col, 0) > 0) {
-                synctex_node_p node;
-                gint           page;
-
-                if ((node = synctex_scanner_next_result (scanner))) {
-                        result = g_new (EvMapping, 1);
-
-                        page = synctex_node_page (node) - 1;
-                        result->data = GINT_TO_POINTER (page);
-
-                        result->area.x1 = synctex_node_box_visible_h (node);
-                        result->area.y1 = synctex_node_box_visible_v (node) -
-                                synctex_node_box_visible_height (node);
-                        result->area.x2 = synctex_node_box_visible_width (node) + result->area.x1;
-                        result->area.y2 = synctex_node_box_visible_depth (node) +
-                                synctex_node_box_visible_height (node) + result->area.y1;
-                }
-        }
-
-        return result;
+        return _ev_synctex_forward_search (synctex, link);
 }
 
 static guint64
@@ -884,13 +1273,105 @@ ev_document_get_backend_info (EvDocument *document, EvDocumentBackendInfo *info)
 	return klass->get_backend_info (document, info);
 }
 
+static cairo_surface_t *
+ev_document_crop_surface (cairo_surface_t             *surface,
+			  const cairo_rectangle_int_t *region)
+{
+	cairo_surface_t *cropped;
+	cairo_t         *cr;
+
+	cropped = cairo_surface_create_similar_image (surface,
+						      cairo_image_surface_get_format (surface),
+						      region->width, region->height);
+	cr = cairo_create (cropped);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_surface (cr, surface, -region->x, -region->y);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+
+	cairo_surface_destroy (surface);
+
+	return cropped;
+}
+
 cairo_surface_t *
 ev_document_render (EvDocument      *document,
 		    EvRenderContext *rc)
 {
 	EvDocumentClass *klass = EV_DOCUMENT_GET_CLASS (document);
+	cairo_surface_t *surface;
+
+	/* Documents that can't render the layers separately draw the
+	 * annotations together with the content, there's nothing to
+	 * render for the annotations alone.
+	 */
+	if (!(rc->layers & EV_RENDER_LAYER_CONTENT) &&
+	    !ev_document_can_render_layers (document))
+		return NULL;
 
-	return klass->render (document, rc);
+	surface = klass->render (document, rc);
+
+	/* Backends rendering the whole page when a region is requested */
+	if (surface && rc->has_region &&
+	    cairo_surface_get_type (surface) == CAIRO_SURFACE_TYPE_IMAGE &&
+	    (cairo_image_surface_get_width (surface) != rc->region.width ||
+	     cairo_image_surface_get_height (surface) != rc->region.height))
+		surface = ev_document_crop_surface (surface, &rc->region);
+
+	return surface;
+}
+
+/**
+ * ev_document_can_render_layers:
+ * @document: an #EvDocument
+ *
+ * Returns whether @document renders the content of the pages and their
+ * annotations separately when asked to with ev_render_context_set_layers().
+ * Otherwise the annotations are always rendered along with the content.
+ *
+ * Returns: %TRUE if the layers of the pages can be rendered separately
+ *
+ * Since: 3.40
+ */
+gboolean
+ev_document_can_render_layers (EvDocument *document)
+{
+	EvDocumentClass *klass;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	klass = EV_DOCUMENT_GET_CLASS (document);
+	if (klass->can_render_layers == NULL)
+		return FALSE;
+
+	return klass->can_render_layers (document);
+}
+
+/**
+ * ev_document_can_render_regions:
+ * @document: an #EvDocument
+ *
+ * Returns whether @document only renders the region of the page set
+ * with ev_render_context_set_region(), so that rendering a small region
+ * of a large page costs less than rendering the whole page. Other
+ * documents render the whole page and crop the result.
+ *
+ * Returns: %TRUE if regions of the pages are rendered on their own
+ *
+ * Since: 3.40
+ */
+gboolean
+ev_document_can_render_regions (EvDocument *document)
+{
+	EvDocumentClass *klass;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), FALSE);
+
+	klass = EV_DOCUMENT_GET_CLASS (document);
+	if (klass->can_render_regions == NULL)
+		return FALSE;
+
+	return klass->can_render_regions (document);
 }
 
 static GdkPixbuf *
@@ -967,6 +1448,25 @@ ev_document_get_title (EvDocument *document)
 		document->priv->info->title : NULL;
 }
 
+/**
+ * ev_document_get_cache:
+ * @document: an #EvDocument
+ *
+ * Returns the persistent on-disk cache of @document. It is only available
+ * for local documents loaded without %EV_DOCUMENT_LOAD_FLAG_NO_CACHE.
+ *
+ * Returns: (transfer none) (nullable): the #EvDocumentCache of @document
+ *
+ * Since: 3.40
+ */
+EvDocumentCache *
+ev_document_get_cache (EvDocument *document)
+{
+	g_return_val_if_fail (EV_IS_DOCUMENT (document), NULL);
+
+	return document->priv->cache;
+}
+
 gboolean
 ev_document_is_page_size_uniform (EvDocument *document)
 {
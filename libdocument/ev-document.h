@@ -33,6 +33,7 @@
 #include <gdk/gdk.h>
 #include <cairo.h>
 
+#include "ev-document-cache.h"
 #include "ev-document-info.h"
 #include "ev-page.h"
 #include "ev-render-context.h"
@@ -132,6 +133,22 @@ struct _EvDocumentClass
 						     GError             **error);
 	cairo_surface_t * (* get_thumbnail_surface) (EvDocument          *document,
 						     EvRenderContext     *rc);
+
+	/* Returns a new, independently loaded instance of the same
+	 * document, so that it can be used from another thread
+	 * concurrently with @document. Optional.
+	 */
+	EvDocument      * (* clone)                 (EvDocument          *document);
+
+	/* Whether render() draws the layers of the render context
+	 * separately, see ev_render_context_set_layers(). Optional.
+	 */
+	gboolean          (* can_render_layers)     (EvDocument          *document);
+
+	/* Whether render() only draws the region of the render context,
+	 * see ev_render_context_set_region(). Optional.
+	 */
+	gboolean          (* can_render_regions)    (EvDocument          *document);
 };
 
 GType            ev_document_get_type             (void) G_GNUC_CONST;
@@ -149,6 +166,10 @@ void             ev_document_fc_mutex_lock        (void);
 void             ev_document_fc_mutex_unlock      (void);
 gboolean         ev_document_fc_mutex_trylock     (void);
 
+/* Concurrent rendering */
+guint            ev_document_get_max_render_threads (void);
+void             ev_document_set_max_render_threads (guint          n_threads);
+
 EvDocumentInfo  *ev_document_get_info             (EvDocument      *document);
 gboolean         ev_document_get_backend_info     (EvDocument      *document,
 						   EvDocumentBackendInfo *info);
@@ -186,6 +207,8 @@ gchar           *ev_document_get_page_label       (EvDocument      *document,
 						   gint             page_index);
 cairo_surface_t *ev_document_render               (EvDocument      *document,
 						   EvRenderContext *rc);
+gboolean         ev_document_can_render_layers    (EvDocument      *document);
+gboolean         ev_document_can_render_regions   (EvDocument      *document);
 GdkPixbuf       *ev_document_get_thumbnail        (EvDocument      *document,
 						   EvRenderContext *rc);
 cairo_surface_t *ev_document_get_thumbnail_surface (EvDocument      *document,
@@ -193,6 +216,7 @@ cairo_surface_t *ev_document_get_thumbnail_surface (EvDocument      *document,
 guint64          ev_document_get_size             (EvDocument      *document);
 const gchar     *ev_document_get_uri              (EvDocument      *document);
 const gchar     *ev_document_get_title            (EvDocument      *document);
+EvDocumentCache *ev_document_get_cache            (EvDocument      *document);
 gboolean         ev_document_is_page_size_uniform (EvDocument      *document);
 void             ev_document_get_max_page_size    (EvDocument      *document,
 						   gdouble         *width,
@@ -207,6 +231,8 @@ gboolean         ev_document_find_page_by_label   (EvDocument      *document,
 						   const gchar     *page_label,
 						   gint            *page_index);
 gboolean	 ev_document_has_synctex 	  (EvDocument      *document);
+gboolean         ev_document_synctex_is_loaded    (EvDocument      *document);
+void             ev_document_load_synctex         (EvDocument      *document);
 
 EvSourceLink    *ev_document_synctex_backward_search
                                                   (EvDocument      *document,
@@ -82,3 +82,92 @@ ev_file_exporter_get_capabilities (EvFileExporter *exporter)
 
 	return iface->get_capabilities (exporter);
 }
+
+/**
+ * ev_file_exporter_can_record_pages:
+ * @exporter: an #EvFileExporter
+ *
+ * Returns: whether @exporter can record pages with
+ *   ev_file_exporter_record_page()
+ *
+ * Since: 3.40
+ */
+gboolean
+ev_file_exporter_can_record_pages (EvFileExporter *exporter)
+{
+	EvFileExporterInterface *iface = EV_FILE_EXPORTER_GET_IFACE (exporter);
+
+	return iface->record_page != NULL && iface->do_recorded_page != NULL;
+}
+
+/**
+ * ev_file_exporter_record_page:
+ * @exporter: an #EvFileExporter
+ * @page: the index of the page
+ *
+ * Renders @page for printing into a recording surface, which is exported
+ * later with ev_file_exporter_do_recorded_page(). Unlike the other
+ * functions of the exporter, this can be called from several threads at
+ * the same time, without the document lock, while the pages recorded
+ * before are exported.
+ *
+ * Returns: (transfer full) (nullable): a recording surface of the size of
+ *   the page, or %NULL if the page must be exported with
+ *   ev_file_exporter_do_page()
+ *
+ * Since: 3.40
+ */
+cairo_surface_t *
+ev_file_exporter_record_page (EvFileExporter *exporter,
+			      gint            page)
+{
+	EvFileExporterInterface *iface = EV_FILE_EXPORTER_GET_IFACE (exporter);
+
+	if (!iface->record_page)
+		return NULL;
+
+	return iface->record_page (exporter, page);
+}
+
+/**
+ * ev_file_exporter_do_recorded_page:
+ * @exporter: an #EvFileExporter
+ * @recording: a page recorded by ev_file_exporter_record_page()
+ *
+ * Exports a recorded page, like ev_file_exporter_do_page() does.
+ *
+ * Since: 3.40
+ */
+void
+ev_file_exporter_do_recorded_page (EvFileExporter  *exporter,
+				   cairo_surface_t *recording)
+{
+	EvFileExporterInterface *iface = EV_FILE_EXPORTER_GET_IFACE (exporter);
+
+	iface->do_recorded_page (exporter, recording);
+}
+
+/**
+ * ev_file_exporter_get_source_file:
+ * @exporter: an #EvFileExporter
+ * @format: the format of the export
+ *
+ * Returns the file the document was loaded from when exporting all of its
+ * pages to @format, unscaled and one page per sheet, would give the same
+ * document. The file can then be printed as it is, without rendering it.
+ *
+ * Returns: (transfer full) (nullable): a #GFile, or %NULL
+ *
+ * Since: 3.40
+ */
+GFile *
+ev_file_exporter_get_source_file (EvFileExporter       *exporter,
+				  EvFileExporterFormat  format)
+{
+	EvFileExporterInterface *iface = EV_FILE_EXPORTER_GET_IFACE (exporter);
+
+	if (!iface->get_source_file)
+		return NULL;
+
+	return iface->get_source_file (exporter, format);
+}
@@ -28,6 +28,8 @@
 #define EV_FILE_EXPORTER_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
+#include <cairo.h>
 
 #include "ev-render-context.h"
 
@@ -86,6 +88,17 @@ struct _EvFileExporterInterface {
 	void                       (* end_page)         (EvFileExporter        *exporter);
         void                       (* end)              (EvFileExporter        *exporter);
 	EvFileExporterCapabilities (* get_capabilities) (EvFileExporter        *exporter);
+
+	/* Optional: pages are recorded in other threads, without the
+	 * document lock, and exported in order with do_recorded_page */
+	cairo_surface_t *          (* record_page)      (EvFileExporter        *exporter,
+							 gint                   page);
+	void                       (* do_recorded_page) (EvFileExporter        *exporter,
+							 cairo_surface_t       *recording);
+
+	/* Optional */
+	GFile *                    (* get_source_file)  (EvFileExporter        *exporter,
+							 EvFileExporterFormat   format);
 };
 
 GType                      ev_file_exporter_get_type         (void) G_GNUC_CONST;
@@ -97,6 +110,13 @@ void                       ev_file_exporter_do_page          (EvFileExporter
 void                       ev_file_exporter_end_page         (EvFileExporter        *exporter);
 void                       ev_file_exporter_end              (EvFileExporter        *exporter);
 EvFileExporterCapabilities ev_file_exporter_get_capabilities (EvFileExporter        *exporter);
+gboolean                   ev_file_exporter_can_record_pages (EvFileExporter        *exporter);
+cairo_surface_t           *ev_file_exporter_record_page      (EvFileExporter        *exporter,
+							      gint                   page);
+void                       ev_file_exporter_do_recorded_page (EvFileExporter        *exporter,
+							      cairo_surface_t       *recording);
+GFile                     *ev_file_exporter_get_source_file  (EvFileExporter        *exporter,
+							      EvFileExporterFormat   format);
 
 G_END_DECLS
 
@@ -31,6 +31,14 @@
 #include <glib/gstdio.h>
 #include <glib/gi18n-lib.h>
 
+#include <zlib.h>
+#ifdef HAVE_BZIP2
+#include <bzlib.h>
+#endif
+#ifdef HAVE_LZMA
+#include <lzma.h>
+#endif
+
 #include "ev-file-helpers.h"
 
 static gchar *tmp_dir = NULL;
@@ -510,6 +518,9 @@ static const char *compressor_cmds[] = {
 #define N_ARGS      4
 #define BUFFER_SIZE 1024
 
+/* Size of the buffers used to (de)compress in process */
+#define CODEC_BUFFER_SIZE (256 * 1024)
+
 static void
 compression_child_setup_cb (gpointer fd_ptr)
 {
@@ -523,21 +534,17 @@ compression_child_setup_cb (gpointer fd_ptr)
         }
 }
 
-static gchar *
-compression_run (const gchar       *uri,
-		 EvCompressionType  type,
-		 gboolean           compress, 
-		 GError           **error)
+static gboolean
+compression_spawn (const gchar       *filename,
+		   gint               fd,
+		   EvCompressionType  type,
+		   gboolean           compress,
+		   GError           **error)
 {
 	gchar *argv[N_ARGS];
-	gchar *uri_dst = NULL;
-	gchar *filename, *filename_dst = NULL;
 	gchar *cmd;
-	gint   fd, pout;
-	GError *err = NULL;
-
-	if (type == EV_COMPRESSION_NONE)
-		return NULL;
+	gint   pout;
+	gboolean retval = TRUE;
 
 	cmd = g_find_program_in_path (compressor_cmds[type]);
 	if (!cmd) {
@@ -546,33 +553,19 @@ compression_run (const gchar       *uri,
 		g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
 			     "Failed to find the \"%s\" command in the search path.",
                              compressor_cmds[type]);
-		return NULL;
-	}
-
-	filename = g_filename_from_uri (uri, NULL, error);
-	if (!filename) {
-		g_free (cmd);
-		return NULL;
-	}
-
-        fd = ev_mkstemp ("comp.XXXXXX", &filename_dst, error);
-	if (fd == -1) {
-		g_free (cmd);
-		g_free (filename);
-
-		return NULL;
+		return FALSE;
 	}
 
 	argv[0] = cmd;
 	argv[1] = compress ? (char *) "-c" : (char *) "-cd";
-	argv[2] = filename;
+	argv[2] = (char *) filename;
 	argv[3] = NULL;
 
 	if (g_spawn_async_with_pipes (NULL, argv, NULL,
 				      G_SPAWN_STDERR_TO_DEV_NULL,
                                       compression_child_setup_cb, GINT_TO_POINTER (fd),
                                       NULL,
-				      NULL, &pout, NULL, &err)) {
+				      NULL, &pout, NULL, error)) {
 		GIOChannel *in, *out;
 		gchar buf[BUFFER_SIZE];
 		GIOStatus read_st, write_st;
@@ -593,26 +586,438 @@ compression_run (const gchar       *uri,
 								     bytes_read,
 								     &bytes_written,
 								     error);
-				if (write_st == G_IO_STATUS_ERROR)
+				if (write_st == G_IO_STATUS_ERROR) {
+					retval = FALSE;
 					break;
+				}
 			} else if (read_st == G_IO_STATUS_ERROR) {
+				retval = FALSE;
 				break;
 			}
 		} while (bytes_read > 0);
 
 		g_io_channel_unref (in);
 		g_io_channel_unref (out);
+	} else {
+		retval = FALSE;
 	}
 
+	g_free (cmd);
+
+	return retval;
+}
+
+/* In process (de)compression. Every codec reads the source file and
+ * writes the result straight to the destination file, with no helper
+ * process and no intermediate copies.
+ */
+typedef struct {
+	gint     in_fd;
+	gint     out_fd;
+	gboolean eof;
+	guint8  *in_buf;
+	guint8  *out_buf;
+} EvCodecFiles;
+
+static void
+codec_set_io_error (GError     **error,
+		    gint         errsv,
+		    const gchar *message)
+{
+	g_set_error (error, G_FILE_ERROR,
+		     g_file_error_from_errno (errsv),
+		     "%s: %s", message, g_strerror (errsv));
+}
+
+static void
+codec_set_data_error (GError **error)
+{
+	g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+			     _("The compressed file is corrupted"));
+}
+
+/* Reads the next chunk of input into files->in_buf, returns the number
+ * of bytes read, 0 at the end of the file, or -1 on error.
+ */
+static gssize
+codec_read (EvCodecFiles *files,
+	    GError      **error)
+{
+	gssize n;
+
+	do {
+		n = read (files->in_fd, files->in_buf, CODEC_BUFFER_SIZE);
+	} while (n < 0 && errno == EINTR);
+
+	if (n < 0)
+		codec_set_io_error (error, errno, _("Failed to read the compressed file"));
+	else if (n == 0)
+		files->eof = TRUE;
+
+	return n;
+}
+
+static gboolean
+codec_write (EvCodecFiles *files,
+	     gsize         len,
+	     GError      **error)
+{
+	const guint8 *buf = files->out_buf;
+
+	while (len > 0) {
+		gssize n = write (files->out_fd, buf, len);
+
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			codec_set_io_error (error, errno, _("Failed to write the uncompressed file"));
+			return FALSE;
+		}
+
+		buf += n;
+		len -= n;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+codec_run_gzip (EvCodecFiles *files,
+		gboolean      compress,
+		GError      **error)
+{
+	z_stream stream;
+	gssize   n_read;
+	gint     ret;
+	gboolean retval = FALSE;
+
+	memset (&stream, 0, sizeof (stream));
+
+	/* 16 + MAX_WBITS writes a gzip header, 32 + MAX_WBITS
+	 * reads both gzip and zlib headers.
+	 */
+	if (compress)
+		ret = deflateInit2 (&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED,
+				    16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+	else
+		ret = inflateInit2 (&stream, 32 + MAX_WBITS);
+	if (ret != Z_OK) {
+		codec_set_data_error (error);
+		return FALSE;
+	}
+
+	for (;;) {
+		gsize n_out;
+
+		if (stream.avail_in == 0 && !files->eof) {
+			if ((n_read = codec_read (files, error)) < 0)
+				break;
+			stream.next_in = files->in_buf;
+			stream.avail_in = n_read;
+		}
+
+		stream.next_out = files->out_buf;
+		stream.avail_out = CODEC_BUFFER_SIZE;
+
+		if (compress)
+			ret = deflate (&stream, files->eof ? Z_FINISH : Z_NO_FLUSH);
+		else
+			ret = inflate (&stream, Z_NO_FLUSH);
+
+		if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+			codec_set_data_error (error);
+			break;
+		}
+
+		n_out = CODEC_BUFFER_SIZE - stream.avail_out;
+		if (n_out > 0 && !codec_write (files, n_out, error))
+			break;
+
+		if (ret == Z_STREAM_END) {
+			if (compress) {
+				retval = TRUE;
+				break;
+			}
+
+			/* Like gzip -d, handle concatenated members
+			 * and ignore trailing garbage.
+			 */
+			if (stream.avail_in == 0 && !files->eof) {
+				if ((n_read = codec_read (files, error)) < 0)
+					break;
+				stream.next_in = files->in_buf;
+				stream.avail_in = n_read;
+			}
+			if (stream.avail_in == 0 || stream.next_in[0] != 0x1f) {
+				retval = TRUE;
+				break;
+			}
+			inflateReset (&stream);
+		} else if (ret == Z_BUF_ERROR && files->eof && stream.avail_in == 0 && n_out == 0) {
+			/* Truncated file */
+			codec_set_data_error (error);
+			break;
+		}
+	}
+
+	if (compress)
+		deflateEnd (&stream);
+	else
+		inflateEnd (&stream);
+
+	return retval;
+}
+
+#ifdef HAVE_BZIP2
+static gboolean
+codec_run_bzip2 (EvCodecFiles *files,
+		 gboolean      compress,
+		 GError      **error)
+{
+	bz_stream stream;
+	gssize    n_read;
+	gint      ret;
+	gboolean  retval = FALSE;
+
+	memset (&stream, 0, sizeof (stream));
+
+	if (compress)
+		ret = BZ2_bzCompressInit (&stream, 9, 0, 0);
+	else
+		ret = BZ2_bzDecompressInit (&stream, 0, 0);
+	if (ret != BZ_OK) {
+		codec_set_data_error (error);
+		return FALSE;
+	}
+
+	for (;;) {
+		gsize n_out;
+
+		if (stream.avail_in == 0 && !files->eof) {
+			if ((n_read = codec_read (files, error)) < 0)
+				break;
+			stream.next_in = (char *) files->in_buf;
+			stream.avail_in = n_read;
+		}
+
+		stream.next_out = (char *) files->out_buf;
+		stream.avail_out = CODEC_BUFFER_SIZE;
+
+		if (compress)
+			ret = BZ2_bzCompress (&stream, files->eof ? BZ_FINISH : BZ_RUN);
+		else
+			ret = BZ2_bzDecompress (&stream);
+
+		if (ret != BZ_OK && ret != BZ_RUN_OK && ret != BZ_FINISH_OK && ret != BZ_STREAM_END) {
+			codec_set_data_error (error);
+			break;
+		}
+
+		n_out = CODEC_BUFFER_SIZE - stream.avail_out;
+		if (n_out > 0 && !codec_write (files, n_out, error))
+			break;
+
+		if (ret == BZ_STREAM_END) {
+			if (compress) {
+				retval = TRUE;
+				break;
+			}
+
+			/* Concatenated streams, as written by parallel bzip2 */
+			if (stream.avail_in == 0 && !files->eof) {
+				if ((n_read = codec_read (files, error)) < 0)
+					break;
+				stream.next_in = (char *) files->in_buf;
+				stream.avail_in = n_read;
+			}
+			if (stream.avail_in == 0 || stream.next_in[0] != 'B') {
+				retval = TRUE;
+				break;
+			}
+
+			{
+				char        *next_in = stream.next_in;
+				unsigned int avail_in = stream.avail_in;
+
+				BZ2_bzDecompressEnd (&stream);
+				memset (&stream, 0, sizeof (stream));
+				if (BZ2_bzDecompressInit (&stream, 0, 0) != BZ_OK) {
+					codec_set_data_error (error);
+					return FALSE;
+				}
+				stream.next_in = next_in;
+				stream.avail_in = avail_in;
+			}
+		} else if (!compress && files->eof && stream.avail_in == 0 && n_out == 0) {
+			/* Truncated file */
+			codec_set_data_error (error);
+			break;
+		}
+	}
+
+	if (compress)
+		BZ2_bzCompressEnd (&stream);
+	else
+		BZ2_bzDecompressEnd (&stream);
+
+	return retval;
+}
+#endif /* HAVE_BZIP2 */
+
+#ifdef HAVE_LZMA
+static gboolean
+codec_run_lzma (EvCodecFiles *files,
+		gboolean      compress,
+		GError      **error)
+{
+	lzma_stream stream = LZMA_STREAM_INIT;
+	lzma_ret    ret;
+	gssize      n_read;
+	gboolean    retval = FALSE;
+
+	if (compress)
+		ret = lzma_easy_encoder (&stream, 6, LZMA_CHECK_CRC64);
+	else
+		ret = lzma_stream_decoder (&stream, UINT64_MAX, LZMA_CONCATENATED);
+	if (ret != LZMA_OK) {
+		codec_set_data_error (error);
+		return FALSE;
+	}
+
+	for (;;) {
+		gsize n_out;
+
+		if (stream.avail_in == 0 && !files->eof) {
+			if ((n_read = codec_read (files, error)) < 0)
+				break;
+			stream.next_in = files->in_buf;
+			stream.avail_in = n_read;
+		}
+
+		stream.next_out = files->out_buf;
+		stream.avail_out = CODEC_BUFFER_SIZE;
+
+		ret = lzma_code (&stream, files->eof ? LZMA_FINISH : LZMA_RUN);
+		if (ret != LZMA_OK && ret != LZMA_STREAM_END) {
+			codec_set_data_error (error);
+			break;
+		}
+
+		n_out = CODEC_BUFFER_SIZE - stream.avail_out;
+		if (n_out > 0 && !codec_write (files, n_out, error))
+			break;
+
+		if (ret == LZMA_STREAM_END) {
+			retval = TRUE;
+			break;
+		}
+	}
+
+	lzma_end (&stream);
+
+	return retval;
+}
+#endif /* HAVE_LZMA */
+
+/* Returns %FALSE with @error unset if @type can't be handled in process */
+static gboolean
+compression_run_codec (const gchar       *filename,
+		       gint               fd,
+		       EvCompressionType  type,
+		       gboolean           compress,
+		       GError           **error)
+{
+	EvCodecFiles files;
+	gboolean     retval;
+
+	switch (type) {
+	case EV_COMPRESSION_GZIP:
+#ifdef HAVE_BZIP2
+	case EV_COMPRESSION_BZIP2:
+#endif
+#ifdef HAVE_LZMA
+	case EV_COMPRESSION_LZMA:
+#endif
+		break;
+	default:
+		return FALSE;
+	}
+
+	files.in_fd = g_open (filename, O_RDONLY | O_BINARY, 0);
+	if (files.in_fd == -1) {
+		codec_set_io_error (error, errno, _("Failed to open the compressed file"));
+		return FALSE;
+	}
+	files.out_fd = fd;
+	files.eof = FALSE;
+	files.in_buf = g_malloc (CODEC_BUFFER_SIZE);
+	files.out_buf = g_malloc (CODEC_BUFFER_SIZE);
+
+	switch (type) {
+#ifdef HAVE_BZIP2
+	case EV_COMPRESSION_BZIP2:
+		retval = codec_run_bzip2 (&files, compress, error);
+		break;
+#endif
+#ifdef HAVE_LZMA
+	case EV_COMPRESSION_LZMA:
+		retval = codec_run_lzma (&files, compress, error);
+		break;
+#endif
+	default:
+		retval = codec_run_gzip (&files, compress, error);
+		break;
+	}
+
+	close (files.in_fd);
+	g_free (files.in_buf);
+	g_free (files.out_buf);
+
+	return retval;
+}
+
+static gchar *
+compression_run (const gchar       *uri,
+		 EvCompressionType  type,
+		 gboolean           compress, 
+		 GError           **error)
+{
+	gchar *uri_dst = NULL;
+	gchar *filename, *filename_dst = NULL;
+	gint   fd;
+	gboolean retval;
+	GError *err = NULL;
+
+	if (type == EV_COMPRESSION_NONE)
+		return NULL;
+
+	filename = g_filename_from_uri (uri, NULL, error);
+	if (!filename)
+		return NULL;
+
+	/* Backends open documents by file name, so the result
+	 * still goes to a temporary file.
+	 */
+        fd = ev_mkstemp ("comp.XXXXXX", &filename_dst, error);
+	if (fd == -1) {
+		g_free (filename);
+
+		return NULL;
+	}
+
+	retval = compression_run_codec (filename, fd, type, compress, &err);
+	if (!retval && !err)
+		retval = compression_spawn (filename, fd, type, compress, &err);
+
 	close (fd);
 
-	if (err) {
+	if (!retval) {
+		g_unlink (filename_dst);
 		g_propagate_error (error, err);
 	} else {
 		uri_dst = g_filename_to_uri (filename_dst, NULL, error);
 	}
 
-	g_free (cmd);
 	g_free (filename);
 	g_free (filename_dst);
 
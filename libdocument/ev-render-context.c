@@ -68,6 +68,7 @@ ev_render_context_new (EvPage *page,
 	rc->scale = scale;
 	rc->target_width = -1;
 	rc->target_height = -1;
+	rc->layers = EV_RENDER_LAYER_ALL;
 
 	return rc;
 }
@@ -113,6 +114,51 @@ ev_render_context_set_target_size (EvRenderContext *rc,
 	rc->target_height = target_height;
 }
 
+/**
+ * ev_render_context_set_layers:
+ * @rc: an #EvRenderContext
+ * @layers: the #EvRenderLayers to render
+ *
+ * Sets the layers of the page to render, all of them by default.
+ * Rendering the annotations alone gives a surface that is transparent
+ * where the page has no annotations or form fields, so that it can be
+ * drawn over the content of the page rendered without them. Only
+ * documents for which ev_document_can_render_layers() returns %TRUE
+ * render the layers separately.
+ *
+ * Since: 3.40
+ */
+void
+ev_render_context_set_layers (EvRenderContext *rc,
+			      EvRenderLayers   layers)
+{
+	g_return_if_fail (rc != NULL);
+
+	rc->layers = layers;
+}
+
+/**
+ * ev_render_context_set_region:
+ * @rc: an #EvRenderContext
+ * @region: (allow-none): the area of the page to render, or %NULL
+ *
+ * Restricts rendering to @region, given in pixels of the page once it
+ * is scaled and rotated. The rendered surface then has the size of
+ * @region instead of the size of the whole page.
+ *
+ * Since: 3.40
+ */
+void
+ev_render_context_set_region (EvRenderContext             *rc,
+			      const cairo_rectangle_int_t *region)
+{
+	g_return_if_fail (rc != NULL);
+
+	rc->has_region = region != NULL;
+	if (region)
+		rc->region = *region;
+}
+
 void
 ev_render_context_compute_scaled_size (EvRenderContext *rc,
 				       double		width_points,
@@ -25,6 +25,7 @@
 #define EV_RENDER_CONTEXT_H
 
 #include <glib-object.h>
+#include <cairo.h>
 
 #include "ev-page.h"
 
@@ -38,6 +39,12 @@ typedef struct _EvRenderContextClass EvRenderContextClass;
 #define EV_RENDER_CONTEXT_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST((klass), EV_TYPE_RENDER_CONTEXT, EvRenderContextClass))
 #define EV_IS_RENDER_CONTEXT(object)	(G_TYPE_CHECK_INSTANCE_TYPE((object), EV_TYPE_RENDER_CONTEXT))
 
+typedef enum {
+	EV_RENDER_LAYER_CONTENT     = 1 << 0,
+	EV_RENDER_LAYER_ANNOTATIONS = 1 << 1,
+	EV_RENDER_LAYER_ALL         = EV_RENDER_LAYER_CONTENT | EV_RENDER_LAYER_ANNOTATIONS
+} EvRenderLayers;
+
 struct _EvRenderContextClass
 {
 	GObjectClass klass;
@@ -52,6 +59,10 @@ struct _EvRenderContext
 	gdouble scale;
 	gint	target_width;
 	gint	target_height;
+
+	EvRenderLayers        layers;
+	gboolean              has_region;
+	cairo_rectangle_int_t region;
 };
 
 
@@ -68,6 +79,10 @@ void             ev_render_context_set_scale       (EvRenderContext *rc,
 void             ev_render_context_set_target_size (EvRenderContext *rc,
                                                     int              target_width,
                                                     int              target_height);
+void             ev_render_context_set_layers      (EvRenderContext *rc,
+						    EvRenderLayers   layers);
+void             ev_render_context_set_region      (EvRenderContext *rc,
+						    const cairo_rectangle_int_t *region);
 void             ev_render_context_compute_scaled_size      (EvRenderContext *rc,
                                                              double           width_points,
                                                              double           height_points,
@@ -0,0 +1,206 @@
+/* ev-surface-pool.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include "ev-surface-pool.h"
+
+/**
+ * SECTION: ev-surface-pool
+ * @short_description: a pool of pixel buffers for rendered pages
+ *
+ * Rendering a page at a big size allocates a big image surface that the
+ * kernel has to map and zero before it is painted, and it's freed again
+ * as soon as the page scrolls out of view. Surfaces created with
+ * ev_surface_pool_create_surface() keep their pixel buffer in a pool
+ * when they are destroyed, and new surfaces of a similar size reuse it.
+ *
+ * Buffers are grouped in buckets of sizes, so that surfaces rendered at
+ * slightly different sizes share them. The pool keeps at most
+ * %POOL_MAX_SIZE bytes of unused buffers, and drops the buffers that have
+ * not been used for %POOL_MAX_AGE.
+ */
+
+#define POOL_MAX_SIZE (128 * 1024 * 1024)
+#define POOL_MAX_AGE  (10 * G_USEC_PER_SEC)
+
+typedef struct {
+	guchar *data;
+	gsize   size;
+	gint64  released;
+} EvPoolBuffer;
+
+/* Unused buffers, the most recently released first */
+static GQueue idle_buffers = G_QUEUE_INIT;
+static gsize  idle_size = 0;
+G_LOCK_DEFINE_STATIC (idle_buffers);
+
+static const cairo_user_data_key_t pool_buffer_key;
+
+static gsize
+ev_surface_pool_bucket_size (gsize size)
+{
+	gsize step;
+
+	if (size <= 64 * 1024)
+		return (size + 4095) & ~(gsize)4095;
+
+	/* Buckets are an eighth of the previous power of two wide,
+	 * so less than 12.5% of a buffer is ever unused.
+	 */
+	step = (gsize)1 << (g_bit_storage (size) - 4);
+
+	return (size + step - 1) & ~(step - 1);
+}
+
+static void
+ev_pool_buffer_free (EvPoolBuffer *buffer)
+{
+	g_free (buffer->data);
+	g_free (buffer);
+}
+
+static void
+ev_surface_pool_trim_unlocked (gsize max_size)
+{
+	gint64 now = g_get_monotonic_time ();
+
+	while (idle_buffers.tail) {
+		EvPoolBuffer *buffer = (EvPoolBuffer *)idle_buffers.tail->data;
+
+		if (idle_size <= max_size && now - buffer->released < POOL_MAX_AGE)
+			break;
+
+		g_queue_pop_tail (&idle_buffers);
+		idle_size -= buffer->size;
+		ev_pool_buffer_free (buffer);
+	}
+}
+
+static void
+ev_pool_buffer_release (gpointer data)
+{
+	EvPoolBuffer *buffer = (EvPoolBuffer *)data;
+
+	if (buffer->size > POOL_MAX_SIZE) {
+		ev_pool_buffer_free (buffer);
+		return;
+	}
+
+	buffer->released = g_get_monotonic_time ();
+
+	G_LOCK (idle_buffers);
+	g_queue_push_head (&idle_buffers, buffer);
+	idle_size += buffer->size;
+	ev_surface_pool_trim_unlocked (POOL_MAX_SIZE);
+	G_UNLOCK (idle_buffers);
+}
+
+static EvPoolBuffer *
+ev_surface_pool_take_buffer (gsize size)
+{
+	EvPoolBuffer *buffer = NULL;
+	GList        *l;
+
+	G_LOCK (idle_buffers);
+	for (l = idle_buffers.head; l; l = l->next) {
+		if (((EvPoolBuffer *)l->data)->size == size) {
+			buffer = (EvPoolBuffer *)l->data;
+			g_queue_delete_link (&idle_buffers, l);
+			idle_size -= size;
+			break;
+		}
+	}
+	ev_surface_pool_trim_unlocked (POOL_MAX_SIZE);
+	G_UNLOCK (idle_buffers);
+
+	if (buffer)
+		return buffer;
+
+	buffer = g_new (EvPoolBuffer, 1);
+	buffer->size = size;
+	buffer->data = g_try_malloc (size);
+	if (!buffer->data) {
+		g_free (buffer);
+		return NULL;
+	}
+
+	return buffer;
+}
+
+/**
+ * ev_surface_pool_create_surface:
+ * @format: the format of the surface
+ * @width: the width of the surface
+ * @height: the height of the surface
+ *
+ * Creates an image surface like cairo_image_surface_create() does, but
+ * reusing the pixel buffer of a destroyed surface of a similar size when
+ * there is any. Unlike cairo_image_surface_create(), the contents of the
+ * surface are undefined, it must be completely painted before it is used.
+ * The buffer goes back to the pool when the surface is destroyed.
+ *
+ * Returns: (transfer full): a new #cairo_surface_t
+ *
+ * Since: 3.40
+ */
+cairo_surface_t *
+ev_surface_pool_create_surface (cairo_format_t format,
+				gint           width,
+				gint           height)
+{
+	cairo_surface_t *surface;
+	EvPoolBuffer    *buffer;
+	gint             stride;
+
+	stride = cairo_format_stride_for_width (format, width);
+	if (stride <= 0 || height <= 0)
+		return cairo_image_surface_create (format, width, height);
+
+	buffer = ev_surface_pool_take_buffer (ev_surface_pool_bucket_size ((gsize)stride * height));
+	if (!buffer)
+		return cairo_image_surface_create (format, width, height);
+
+	surface = cairo_image_surface_create_for_data (buffer->data, format,
+						       width, height, stride);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS ||
+	    cairo_surface_set_user_data (surface, &pool_buffer_key, buffer,
+					 ev_pool_buffer_release) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy (surface);
+		ev_pool_buffer_free (buffer);
+
+		return cairo_image_surface_create (format, width, height);
+	}
+
+	return surface;
+}
+
+/**
+ * ev_surface_pool_trim:
+ *
+ * Frees all the unused buffers of the pool.
+ *
+ * Since: 3.40
+ */
+void
+ev_surface_pool_trim (void)
+{
+	G_LOCK (idle_buffers);
+	ev_surface_pool_trim_unlocked (0);
+	G_UNLOCK (idle_buffers);
+}
@@ -0,0 +1,467 @@
+/* ev-synctex.c
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <config.h>
+
+#include <string.h>
+#include <gio/gio.h>
+
+#include "ev-synctex.h"
+#include "synctex_parser.h"
+
+/* Parsed scanners are shared in a process wide table keyed by the
+ * name of the output file. Reloading a document whose SyncTeX file
+ * has not been modified since the previous load reuses the scanner
+ * instead of parsing the file again. Entries are dropped when the last
+ * document using them releases them, and entries only referenced by
+ * the table when it grows beyond SYNCTEX_CACHE_SIZE.
+ */
+#define SYNCTEX_CACHE_SIZE 4
+
+/* Memo of the answers of forward searches, keyed by input tag and line.
+ * Editors send a forward search on every cursor move, mostly on lines
+ * already looked up, and the parser walks the lists of nodes of the line
+ * again every time. This is not an index of the scanner: answers are only
+ * added when the parser is queried for a line the first time, so they
+ * are always the same the parser would give.
+ */
+typedef struct {
+	gint64      key;
+	gboolean    found;
+	gint        page;
+	EvRectangle area;
+} EvSynctexAnswer;
+
+struct _EvSynctex {
+	volatile gint     ref_count;
+
+	gchar            *filename;
+	gchar            *synctex_file;
+	guint64           mtime;
+	guint32           mtime_usec;
+	goffset           size;
+
+	/* The scanner keeps the results of the last query,
+	 * so queries are serialized.
+	 */
+	GMutex            mutex;
+	synctex_scanner_p scanner;
+
+	GHashTable       *tags;
+	GHashTable       *answers;
+};
+
+static GHashTable *scanners = NULL;
+G_LOCK_DEFINE_STATIC (scanners);
+
+/*
+ * _ev_synctex_find_file:
+ * @filename: the output file name
+ *
+ * Looks for the SyncTeX file next to @filename, with the same
+ * candidate names the SyncTeX parser tries.
+ *
+ * Returns: the SyncTeX file name or %NULL if there isn't any.
+ */
+gchar *
+_ev_synctex_find_file (const gchar *filename)
+{
+	static const gchar *extensions[] = { ".synctex.gz", ".synctex" };
+	gchar *dirname;
+	gchar *basename;
+	gchar *dot;
+	gchar *path = NULL;
+	guint  i;
+
+	dirname = g_path_get_dirname (filename);
+	basename = g_path_get_basename (filename);
+	dot = strrchr (basename, '.');
+	if (dot)
+		*dot = '\0';
+
+	for (i = 0; i < G_N_ELEMENTS (extensions) * 2 && !path; i++) {
+		const gchar *extension = extensions[i % G_N_ELEMENTS (extensions)];
+		gchar       *name;
+
+		/* Names with spaces can be quoted by TeX */
+		if (i < G_N_ELEMENTS (extensions))
+			name = g_strconcat (basename, extension, NULL);
+		else
+			name = g_strconcat ("\"", basename, "\"", extension, NULL);
+
+		path = g_build_filename (dirname, name, NULL);
+		g_free (name);
+
+		if (!g_file_test (path, G_FILE_TEST_IS_REGULAR))
+			g_clear_pointer (&path, g_free);
+	}
+
+	g_free (dirname);
+	g_free (basename);
+
+	return path;
+}
+
+static gboolean
+ev_synctex_query_file (EvSynctex *synctex)
+{
+	GFile     *file;
+	GFileInfo *info;
+
+	file = g_file_new_for_path (synctex->synctex_file);
+	info = g_file_query_info (file,
+				  G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+				  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+				  G_FILE_QUERY_INFO_NONE, NULL, NULL);
+	g_object_unref (file);
+	if (!info)
+		return FALSE;
+
+	synctex->size = g_file_info_get_size (info);
+	synctex->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+	synctex->mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+	g_object_unref (info);
+
+	return TRUE;
+}
+
+static gboolean
+ev_synctex_is_up_to_date (EvSynctex *cached,
+			  EvSynctex *synctex)
+{
+	return cached->mtime == synctex->mtime &&
+		cached->mtime_usec == synctex->mtime_usec &&
+		cached->size == synctex->size &&
+		g_strcmp0 (cached->synctex_file, synctex->synctex_file) == 0;
+}
+
+static void
+ev_synctex_trim_cache (EvSynctex *keep)
+{
+	GHashTableIter iter;
+	EvSynctex     *synctex;
+
+	if (g_hash_table_size (scanners) <= SYNCTEX_CACHE_SIZE)
+		return;
+
+	g_hash_table_iter_init (&iter, scanners);
+	while (g_hash_table_iter_next (&iter, NULL, (gpointer *)&synctex)) {
+		if (synctex != keep && g_atomic_int_get (&synctex->ref_count) == 1)
+			g_hash_table_iter_remove (&iter);
+	}
+}
+
+/* Returns new, not parsed yet, SyncTeX data for @filename,
+ * or %NULL if it has no SyncTeX file.
+ */
+static EvSynctex *
+ev_synctex_new (const gchar *filename)
+{
+	EvSynctex *synctex;
+
+	synctex = g_new0 (EvSynctex, 1);
+	synctex->ref_count = 1;
+	synctex->filename = g_strdup (filename);
+	synctex->synctex_file = _ev_synctex_find_file (filename);
+	g_mutex_init (&synctex->mutex);
+
+	if (!synctex->synctex_file || !ev_synctex_query_file (synctex)) {
+		_ev_synctex_unref (synctex);
+		return NULL;
+	}
+
+	return synctex;
+}
+
+static EvSynctex *
+ev_synctex_lookup (EvSynctex *synctex)
+{
+	EvSynctex *cached = NULL;
+
+	G_LOCK (scanners);
+	if (scanners)
+		cached = g_hash_table_lookup (scanners, synctex->filename);
+	if (cached && ev_synctex_is_up_to_date (cached, synctex))
+		_ev_synctex_ref (cached);
+	else
+		cached = NULL;
+	G_UNLOCK (scanners);
+
+	return cached;
+}
+
+/*
+ * _ev_synctex_lookup:
+ * @filename: the output file name
+ *
+ * Returns the parsed SyncTeX data of @filename if a scanner for the
+ * same, unmodified, SyncTeX file is still around. It never parses the
+ * file, so documents can take the scanner of the previous load of the
+ * same file while it's still in use.
+ *
+ * Returns: (transfer full): a new reference or %NULL
+ */
+EvSynctex *
+_ev_synctex_lookup (const gchar *filename)
+{
+	EvSynctex *synctex;
+	EvSynctex *cached;
+
+	synctex = ev_synctex_new (filename);
+	if (!synctex)
+		return NULL;
+
+	cached = ev_synctex_lookup (synctex);
+	_ev_synctex_unref (synctex);
+
+	return cached;
+}
+
+/*
+ * _ev_synctex_get:
+ * @filename: the output file name
+ *
+ * Returns the parsed SyncTeX data of @filename, parsing the SyncTeX
+ * file unless a scanner for the same, unmodified, file is still around.
+ * This can block for a long time, it should not be called from the
+ * main thread.
+ *
+ * Returns: (transfer full): a new reference or %NULL
+ */
+EvSynctex *
+_ev_synctex_get (const gchar *filename)
+{
+	EvSynctex *synctex;
+	EvSynctex *cached;
+
+	synctex = ev_synctex_new (filename);
+	if (!synctex)
+		return NULL;
+
+	cached = ev_synctex_lookup (synctex);
+	if (cached) {
+		_ev_synctex_unref (synctex);
+		return cached;
+	}
+
+	/* Parse without holding the lock, other documents can be loading */
+	synctex->scanner = synctex_scanner_new_with_output_file (filename, NULL, 1);
+	if (!synctex->scanner) {
+		_ev_synctex_unref (synctex);
+		return NULL;
+	}
+
+	synctex->tags = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	synctex->answers = g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL, g_free);
+
+	G_LOCK (scanners);
+	if (!scanners) {
+		/* Keys are owned by the values */
+		scanners = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+						  (GDestroyNotify)_ev_synctex_unref);
+	}
+	g_hash_table_replace (scanners, synctex->filename, _ev_synctex_ref (synctex));
+	ev_synctex_trim_cache (synctex);
+	G_UNLOCK (scanners);
+
+	return synctex;
+}
+
+EvSynctex *
+_ev_synctex_ref (EvSynctex *synctex)
+{
+	g_return_val_if_fail (synctex != NULL, NULL);
+
+	g_atomic_int_inc (&synctex->ref_count);
+
+	return synctex;
+}
+
+/*
+ * _ev_synctex_release:
+ * @synctex: a #EvSynctex
+ *
+ * Drops the reference of a document to @synctex, and the scanner from
+ * the table of shared scanners when no other document uses it.
+ */
+void
+_ev_synctex_release (EvSynctex *synctex)
+{
+	g_return_if_fail (synctex != NULL);
+
+	G_LOCK (scanners);
+	/* References are only taken from the table with the lock held */
+	if (scanners &&
+	    g_hash_table_lookup (scanners, synctex->filename) == synctex &&
+	    g_atomic_int_get (&synctex->ref_count) == 2)
+		g_hash_table_remove (scanners, synctex->filename);
+	G_UNLOCK (scanners);
+
+	_ev_synctex_unref (synctex);
+}
+
+void
+_ev_synctex_unref (EvSynctex *synctex)
+{
+	g_return_if_fail (synctex != NULL);
+
+	if (!g_atomic_int_dec_and_test (&synctex->ref_count))
+		return;
+
+	if (synctex->scanner)
+		synctex_scanner_free (synctex->scanner);
+	if (synctex->tags)
+		g_hash_table_destroy (synctex->tags);
+	if (synctex->answers)
+		g_hash_table_destroy (synctex->answers);
+	g_mutex_clear (&synctex->mutex);
+	g_free (synctex->synctex_file);
+	g_free (synctex->filename);
+	g_free (synctex);
+}
+
+/* Backward searches are not indexed, each one is answered by the parser.
+ * It looks for the smallest box of the page containing the point and
+ * then picks between the nodes closest to it with its own distances,
+ * which weigh kerns and the lines of the nodes and follow the proxies of
+ * reused boxes. None of that is in the public API, so an index outside
+ * the parser could only find the candidate boxes and would still need
+ * the parser for the answer. The query only walks the boxes of one page
+ * and comes from a click, not from every cursor move.
+ */
+EvSourceLink *
+_ev_synctex_backward_search (EvSynctex *synctex,
+			     gint       page_index,
+			     gfloat     x,
+			     gfloat     y)
+{
+        EvSourceLink     *result = NULL;
+        synctex_scanner_p scanner = synctex->scanner;
+
+	g_mutex_lock (&synctex->mutex);
+
+        if (synctex_edit_query (scanner, page_index + 1, x, y) > 0) {
+                synctex_node_p node;
+
+                /* We assume that a backward search returns either zero or one result_node */
+                node = synctex_scanner_next_result (scanner);
+                if (node != NULL) {
+			const gchar *filename;
+
+			filename = synctex_scanner_get_name (scanner, synctex_node_tag (node));
+
+			if (filename) {
+				result = ev_source_link_new (filename,
+							     synctex_node_line (node),
+							     synctex_node_column (node));
+			}
+                }
+        }
+
+	g_mutex_unlock (&synctex->mutex);
+
+        return result;
+}
+
+static gint
+ev_synctex_get_tag (EvSynctex   *synctex,
+		    const gchar *name)
+{
+	gpointer tag;
+
+	if (!g_hash_table_lookup_extended (synctex->tags, name, NULL, &tag)) {
+		tag = GINT_TO_POINTER (synctex_scanner_get_tag (synctex->scanner, name));
+		g_hash_table_insert (synctex->tags, g_strdup (name), tag);
+	}
+
+	return GPOINTER_TO_INT (tag);
+}
+
+static EvSynctexAnswer *
+ev_synctex_display_query (EvSynctex    *synctex,
+			  EvSourceLink *link,
+			  gint64        key)
+{
+        EvSynctexAnswer  *line;
+        synctex_scanner_p scanner = synctex->scanner;
+
+	line = g_new0 (EvSynctexAnswer, 1);
+	line->key = key;
+
+	/* Since 1.19, synctex_display_query has a fourth parameter,
+	 * page-hint, which we set into a dummy number to not break the
+	 * API. In synctex it is used to set the best results first
+	 * given the page-hint
+	 */
+        if (synctex_display_query (scanner, link->filename, link->line, link->col, 0) > 0) {
+                synctex_node_p node;
+
+                if ((node = synctex_scanner_next_result (scanner))) {
+                        line->found = TRUE;
+                        line->page = synctex_node_page (node) - 1;
+
+                        line->area.x1 = synctex_node_box_visible_h (node);
+                        line->area.y1 = synctex_node_box_visible_v (node) -
+                                synctex_node_box_visible_height (node);
+                        line->area.x2 = synctex_node_box_visible_width (node) + line->area.x1;
+                        line->area.y2 = synctex_node_box_visible_depth (node) +
+                                synctex_node_box_visible_height (node) + line->area.y1;
+                }
+        }
+
+	return line;
+}
+
+EvMapping *
+_ev_synctex_forward_search (EvSynctex    *synctex,
+			    EvSourceLink *link)
+{
+        EvMapping       *result = NULL;
+        EvSynctexAnswer *line;
+        gint64           key;
+        gint             tag;
+
+	g_mutex_lock (&synctex->mutex);
+
+	/* The column is ignored by the parser, the answer
+	 * only depends on the input tag and the line.
+	 */
+	tag = ev_synctex_get_tag (synctex, link->filename);
+	if (tag == 0) {
+		g_mutex_unlock (&synctex->mutex);
+		return NULL;
+	}
+
+	key = ((gint64) tag << 32) | (guint32) link->line;
+	line = g_hash_table_lookup (synctex->answers, &key);
+	if (!line) {
+		line = ev_synctex_display_query (synctex, link, key);
+		g_hash_table_insert (synctex->answers, &line->key, line);
+	}
+
+	if (line->found) {
+		result = g_new (EvMapping, 1);
+		result->data = GINT_TO_POINTER (line->page);
+		result->area = line->area;
+	}
+
+	g_mutex_unlock (&synctex->mutex);
+
+        return result;
+}
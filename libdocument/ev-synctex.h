@@ -0,0 +1,51 @@
+/* ev-synctex.h
+ *  this file is part of evince, a gnome document viewer
+ *
+ * Evince is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Evince is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#if !defined (EVINCE_COMPILATION)
+#error "This is a private header."
+#endif
+
+#ifndef EV_SYNCTEX_H
+#define EV_SYNCTEX_H
+
+#include <glib.h>
+
+#include "ev-document.h"
+
+G_BEGIN_DECLS
+
+typedef struct _EvSynctex EvSynctex;
+
+gchar        *_ev_synctex_find_file        (const gchar  *filename);
+
+EvSynctex    *_ev_synctex_lookup           (const gchar  *filename);
+EvSynctex    *_ev_synctex_get              (const gchar  *filename);
+EvSynctex    *_ev_synctex_ref              (EvSynctex    *synctex);
+void          _ev_synctex_unref            (EvSynctex    *synctex);
+void          _ev_synctex_release          (EvSynctex    *synctex);
+
+EvSourceLink *_ev_synctex_backward_search  (EvSynctex    *synctex,
+					    gint          page_index,
+					    gfloat        x,
+					    gfloat        y);
+EvMapping    *_ev_synctex_forward_search   (EvSynctex    *synctex,
+					    EvSourceLink *link);
+
+G_END_DECLS
+
+#endif /* EV_SYNCTEX_H */
@@ -0,0 +1,343 @@
+/* -*- Mode: C; tab-width: 8; indent-tabs-mode: t; c-basic-offset: 8; c-indent-level: 8 -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <glib/gstdio.h>
+
+#include "ev-synctex.h"
+#include "synctex_parser.h"
+
+/* Generates a large SyncTeX file, checks that the memoized forward
+ * search and the backward search give the same answers as the parser
+ * and compares the time they take.
+ */
+
+#define N_INPUTS        20
+#define LINES_PER_PAGE  45
+#define WORDS_PER_LINE  8
+
+static void
+usage (const char *prog)
+{
+	g_print ("- Benchmarks SyncTeX searches on a generated document\n");
+	g_print ("Usage: %s [n-pages [n-queries]]\n", prog);
+}
+
+static gint
+page_input_tag (gint page,
+		gint n_pages)
+{
+	return 2 + (page * N_INPUTS / (n_pages + 1));
+}
+
+static gint
+page_first_line (gint page)
+{
+	/* Pages of the same input share lines, like in
+	 * documents with repeated or floating material.
+	 */
+	return (page % 50) * 40 + 1;
+}
+
+static gchar *
+generate_synctex (gint n_pages)
+{
+	GString *str;
+	gint     page, i;
+
+	str = g_string_new ("SyncTeX Version:1\n");
+	g_string_append (str, "Input:1:./main.tex\n");
+	for (i = 1; i <= N_INPUTS; i++)
+		g_string_append_printf (str, "Input:%d:./chapters/ch%02d.tex\n", i + 1, i);
+	g_string_append (str, "Output:pdf\nMagnification:1000\nUnit:1\nX Offset:0\nY Offset:0\nContent:\n");
+
+	for (page = 1; page <= n_pages; page++) {
+		gint tag = page_input_tag (page, n_pages);
+		gint v = 6000000;
+
+		g_string_append_printf (str, "{%d\n", page);
+		g_string_append (str, "[1,1:4736286,50644704:25641062,47972352,0\n");
+		for (i = 0; i < LINES_PER_PAGE; i++) {
+			gint line = page_first_line (page) + i;
+			gint h = 4736286;
+			gint w;
+
+			g_string_append_printf (str, "(%d,%d:%d,%d:25641062,786432,180000\n",
+						tag, line, h, v);
+			for (w = 0; w < WORDS_PER_LINE; w++) {
+				g_string_append_printf (str, "g%d,%d:%d,%d\n", tag, line, h, v);
+				h += 3000000;
+				g_string_append_printf (str, "k%d,%d:%d,%d:200000\n", tag, line, h, v);
+			}
+			g_string_append_printf (str, "$%d,%d:%d,%d\n", tag, line, h, v);
+			g_string_append (str, ")\n");
+			v += 950000;
+		}
+		g_string_append (str, "]\n");
+		g_string_append_printf (str, "}%d\n", page);
+	}
+	g_string_append (str, "Postamble:\nCount:0\nPost scriptum:\n");
+
+	return g_string_free (str, FALSE);
+}
+
+static EvMapping *
+parser_forward_search (synctex_scanner_p scanner,
+		       EvSourceLink     *link)
+{
+	EvMapping     *result = NULL;
+	synctex_node_p node;
+
+	if (synctex_display_query (scanner, link->filename, link->line, link->col, 0) > 0 &&
+	    (node = synctex_scanner_next_result (scanner))) {
+		result = g_new (EvMapping, 1);
+		result->data = GINT_TO_POINTER (synctex_node_page (node) - 1);
+		result->area.x1 = synctex_node_box_visible_h (node);
+		result->area.y1 = synctex_node_box_visible_v (node) -
+			synctex_node_box_visible_height (node);
+		result->area.x2 = synctex_node_box_visible_width (node) + result->area.x1;
+		result->area.y2 = synctex_node_box_visible_depth (node) +
+			synctex_node_box_visible_height (node) + result->area.y1;
+	}
+
+	return result;
+}
+
+static EvSourceLink *
+parser_backward_search (synctex_scanner_p scanner,
+			gint              page,
+			gfloat            x,
+			gfloat            y)
+{
+	synctex_node_p node;
+	const gchar   *filename;
+
+	if (synctex_edit_query (scanner, page + 1, x, y) <= 0 ||
+	    !(node = synctex_scanner_next_result (scanner)))
+		return NULL;
+
+	filename = synctex_scanner_get_name (scanner, synctex_node_tag (node));
+	if (!filename)
+		return NULL;
+
+	return ev_source_link_new (filename,
+				   synctex_node_line (node),
+				   synctex_node_column (node));
+}
+
+static gboolean
+source_links_equal (EvSourceLink *a,
+		    EvSourceLink *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	return g_strcmp0 (a->filename, b->filename) == 0 &&
+		a->line == b->line && a->col == b->col;
+}
+
+static gboolean
+mappings_equal (EvMapping *a,
+		EvMapping *b)
+{
+	if (!a || !b)
+		return a == b;
+
+	return a->data == b->data &&
+		a->area.x1 == b->area.x1 && a->area.y1 == b->area.y1 &&
+		a->area.x2 == b->area.x2 && a->area.y2 == b->area.y2;
+}
+
+int
+main (int argc, char **argv)
+{
+	gint               n_pages = 1000;
+	gint               n_queries = 20000;
+	gchar             *dir;
+	gchar             *pdf;
+	gchar             *synctex_file;
+	gchar             *contents;
+	EvSynctex         *synctex;
+	synctex_scanner_p  scanner;
+	EvSourceLink     **links;
+	EvPoint           *points;
+	gint              *pages;
+	GRand             *rand;
+	gint64             start;
+	gint64             parser_time, cold_time = 0, warm_time = 0;
+	gint               i, pass;
+	gint               mismatches = 0;
+	gint               found = 0;
+	GError            *error = NULL;
+
+	if (argc > 3) {
+		usage (argv[0]);
+		return 1;
+	}
+	if (argc > 1)
+		n_pages = MAX (atoi (argv[1]), 1);
+	if (argc > 2)
+		n_queries = MAX (atoi (argv[2]), 1);
+
+	dir = g_dir_make_tmp ("evince-synctex-XXXXXX", &error);
+	if (!dir) {
+		g_warning ("Failed to create temporary directory: %s", error->message);
+		g_error_free (error);
+		return 1;
+	}
+
+	pdf = g_build_filename (dir, "document.pdf", NULL);
+	synctex_file = g_build_filename (dir, "document.synctex", NULL);
+	contents = generate_synctex (n_pages);
+	if (!g_file_set_contents (pdf, "", 0, &error) ||
+	    !g_file_set_contents (synctex_file, contents, -1, &error)) {
+		g_warning ("Failed to write SyncTeX file: %s", error->message);
+		g_error_free (error);
+		return 1;
+	}
+	g_free (contents);
+
+	start = g_get_monotonic_time ();
+	synctex = _ev_synctex_get (pdf);
+	g_print ("Parsed %d pages in %.3f s\n", n_pages,
+		 (g_get_monotonic_time () - start) / (gdouble) G_USEC_PER_SEC);
+	scanner = synctex_scanner_new_with_output_file (pdf, NULL, 1);
+	if (!synctex || !scanner) {
+		g_warning ("Failed to parse the generated SyncTeX file");
+		return 1;
+	}
+
+	/* Random lines of every input, some of them past the
+	 * last line, so the parser has to look for neighbours.
+	 */
+	rand = g_rand_new_with_seed (42);
+	links = g_new (EvSourceLink *, n_queries);
+	for (i = 0; i < n_queries; i++) {
+		gchar *name;
+		gint   tag = g_rand_int_range (rand, 1, N_INPUTS + 1);
+
+		name = g_strdup_printf ("./chapters/ch%02d.tex", tag);
+		links[i] = ev_source_link_new (name, g_rand_int_range (rand, 1, 2200), 0);
+		g_free (name);
+	}
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < n_queries; i++)
+		g_free (parser_forward_search (scanner, links[i]));
+	parser_time = g_get_monotonic_time () - start;
+
+	for (pass = 0; pass < 2; pass++) {
+		start = g_get_monotonic_time ();
+		for (i = 0; i < n_queries; i++)
+			g_free (_ev_synctex_forward_search (synctex, links[i]));
+		if (pass == 0)
+			cold_time = g_get_monotonic_time () - start;
+		else
+			warm_time = g_get_monotonic_time () - start;
+	}
+
+	for (i = 0; i < n_queries; i++) {
+		EvMapping *expected = parser_forward_search (scanner, links[i]);
+		EvMapping *mapping = _ev_synctex_forward_search (synctex, links[i]);
+
+		if (!mappings_equal (expected, mapping)) {
+			g_warning ("Forward search mismatch for %s:%d",
+				   links[i]->filename, links[i]->line);
+			mismatches++;
+		}
+		g_free (expected);
+		g_free (mapping);
+	}
+
+	g_print ("Forward search, %d queries:\n", n_queries);
+	g_print ("\tparser\t\t%.2f us/query\n", parser_time / (gdouble) n_queries);
+	g_print ("\tmemo (cold)\t%.2f us/query\n", cold_time / (gdouble) n_queries);
+	g_print ("\tmemo (warm)\t%.2f us/query\n", warm_time / (gdouble) n_queries);
+
+	/* Points all over the pages, in the margins too */
+	pages = g_new (gint, n_queries);
+	points = g_new (EvPoint, n_queries);
+	for (i = 0; i < n_queries; i++) {
+		pages[i] = g_rand_int_range (rand, 0, n_pages);
+		points[i].x = g_rand_double_range (rand, 0, 612);
+		points[i].y = g_rand_double_range (rand, 0, 792);
+	}
+
+	start = g_get_monotonic_time ();
+	for (i = 0; i < n_queries; i++) {
+		EvSourceLink *link;
+
+		link = _ev_synctex_backward_search (synctex, pages[i],
+						    points[i].x, points[i].y);
+		if (link)
+			ev_source_link_free (link);
+	}
+	g_print ("Backward search, %d queries:\n\tparser\t\t%.2f us/query\n", n_queries,
+		 (g_get_monotonic_time () - start) / (gdouble) n_queries);
+
+	for (i = 0; i < n_queries; i++) {
+		EvSourceLink *expected;
+		EvSourceLink *link;
+
+		expected = parser_backward_search (scanner, pages[i],
+						   points[i].x, points[i].y);
+		link = _ev_synctex_backward_search (synctex, pages[i],
+						    points[i].x, points[i].y);
+		if (!source_links_equal (expected, link)) {
+			g_warning ("Backward search mismatch for page %d at %.2f, %.2f",
+				   pages[i], points[i].x, points[i].y);
+			mismatches++;
+		}
+		if (link) {
+			found++;
+			ev_source_link_free (link);
+		}
+		if (expected)
+			ev_source_link_free (expected);
+	}
+
+	/* The generated pages are full of text */
+	if (found == 0) {
+		g_warning ("Backward search found no source");
+		mismatches++;
+	}
+
+	for (i = 0; i < n_queries; i++)
+		ev_source_link_free (links[i]);
+	g_free (links);
+	g_free (points);
+	g_free (pages);
+	g_rand_free (rand);
+	synctex_scanner_free (scanner);
+	_ev_synctex_unref (synctex);
+
+	g_unlink (synctex_file);
+	g_unlink (pdf);
+	g_rmdir (dir);
+	g_free (synctex_file);
+	g_free (pdf);
+	g_free (dir);
+
+	if (mismatches > 0) {
+		g_print ("%d mismatches\n", mismatches);
+		return 1;
+	}
+
+	return 0;
+}
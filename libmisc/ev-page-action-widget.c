@@ -31,6 +31,7 @@
 /* Widget we pass back */
 static void  ev_page_action_widget_init       (EvPageActionWidget      *action_widget);
 static void  ev_page_action_widget_class_init (EvPageActionWidgetClass *action_widget);
+static void  ev_page_action_widget_setup_completion (EvPageActionWidget *proxy);
 
 enum
 {
@@ -198,6 +199,16 @@ activate_cb (EvPageActionWidget *action_widget)
 		ev_page_action_widget_set_current_page (action_widget, current_page);
 }
 
+static gboolean
+focus_in_cb (EvPageActionWidget *action_widget)
+{
+	if (action_widget->model &&
+	    !gtk_entry_get_completion (GTK_ENTRY (action_widget->entry)))
+		ev_page_action_widget_setup_completion (action_widget);
+
+	return FALSE;
+}
+
 static gboolean
 focus_out_cb (EvPageActionWidget *action_widget)
 {
@@ -230,6 +241,9 @@ ev_page_action_widget_init (EvPageActionWidget *action_widget)
 	g_signal_connect_swapped (action_widget->entry, "activate",
 				  G_CALLBACK (activate_cb),
 				  action_widget);
+	g_signal_connect_swapped (action_widget->entry, "focus-in-event",
+				  G_CALLBACK (focus_in_cb),
+				  action_widget);
         g_signal_connect_swapped (action_widget->entry, "focus-out-event",
                                   G_CALLBACK (focus_out_cb),
                                   action_widget);
@@ -548,19 +562,15 @@ get_filter_model_from_model (GtkTreeModel *model)
 }
 
 
-void
-ev_page_action_widget_update_links_model (EvPageActionWidget *proxy, GtkTreeModel *model)
+static void
+ev_page_action_widget_setup_completion (EvPageActionWidget *proxy)
 {
 	GtkTreeModel *filter_model;
 	GtkEntryCompletion *completion;
 	GtkCellRenderer *renderer;
 
-	if (!model || model == proxy->model)
-		return;
-
 	/* Magik */
-	proxy->model = model;
-	filter_model = get_filter_model_from_model (model);
+	filter_model = get_filter_model_from_model (proxy->model);
 
 	completion = gtk_entry_completion_new ();
 	g_object_set (G_OBJECT (completion),
@@ -589,6 +599,21 @@ ev_page_action_widget_update_links_model (EvPageActionWidget *proxy, GtkTreeMode
 	g_object_unref (completion);
 }
 
+void
+ev_page_action_widget_update_links_model (EvPageActionWidget *proxy, GtkTreeModel *model)
+{
+	if (!model || model == proxy->model)
+		return;
+
+	proxy->model = model;
+
+	/* Building the completion reads the whole outline, which can be
+	 * huge, so it's only done when the entry is focused. */
+	gtk_entry_set_completion (GTK_ENTRY (proxy->entry), NULL);
+	if (gtk_widget_has_focus (proxy->entry))
+		ev_page_action_widget_setup_completion (proxy);
+}
+
 void
 ev_page_action_widget_grab_focus (EvPageActionWidget *proxy)
 {
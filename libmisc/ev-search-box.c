@@ -46,6 +46,8 @@ enum
 typedef struct {
         EvDocumentModel *model;
         EvJob           *job;
+        /* Refined by the next search when its text is longer */
+        EvJob           *previous_job;
         EvFindOptions    options;
         EvFindOptions    supported_options;
 
@@ -86,7 +88,8 @@ ev_search_box_clear_job (EvSearchBox *box)
                 ev_job_cancel (priv->job);
 
         g_signal_handlers_disconnect_matched (priv->job, G_SIGNAL_MATCH_DATA, 0, 0, NULL, NULL, box);
-        g_object_unref (priv->job);
+        g_clear_object (&priv->previous_job);
+        priv->previous_job = priv->job;
         priv->job = NULL;
 }
 
@@ -145,7 +148,8 @@ find_job_updated_cb (EvJobFind   *job,
 {
         EvSearchBoxPrivate *priv = GET_PRIVATE (box);
 
-        priv->pages_searched++;
+        /* Refined searches skip the pages that can't have results */
+        priv->pages_searched = (page - job->start_page + job->n_pages) % job->n_pages + 1;
 
         /* Adjust the status update when searching for a term according
          * to the document size in pages. For documents smaller (or equal)
@@ -196,6 +200,8 @@ search_changed_cb (GtkSearchEntry *entry,
                                              search_string,
                                              FALSE);
                 ev_job_find_set_options (EV_JOB_FIND (priv->job), priv->options);
+                if (priv->previous_job)
+                        ev_job_find_refine (EV_JOB_FIND (priv->job), EV_JOB_FIND (priv->previous_job));
                 g_signal_connect (priv->job, "finished",
                                   G_CALLBACK (find_job_finished_cb),
                                   box);
@@ -247,6 +253,10 @@ static void
 ev_search_box_setup_document (EvSearchBox *box,
                               EvDocument  *document)
 {
+        EvSearchBoxPrivate *priv = GET_PRIVATE (box);
+
+        g_clear_object (&priv->previous_job);
+
         if (!document || !EV_IS_DOCUMENT_FIND (document)) {
                 ev_search_box_set_supported_options (box, EV_FIND_DEFAULT);
                 gtk_widget_set_sensitive (GTK_WIDGET (box), FALSE);
@@ -419,8 +429,10 @@ static void
 ev_search_box_dispose (GObject *object)
 {
         EvSearchBox *box = EV_SEARCH_BOX (object);
+        EvSearchBoxPrivate *priv = GET_PRIVATE (box);
 
         ev_search_box_clear_job (box);
+        g_clear_object (&priv->previous_job);
 
         G_OBJECT_CLASS (ev_search_box_parent_class)->dispose (object);
 }
@@ -82,6 +82,20 @@ ev_job_queue_get_next_unlocked (void)
 	return job;
 }
 
+static gboolean
+ev_job_queue_is_empty (void)
+{
+	gboolean is_empty = TRUE;
+	gint     i;
+
+	g_mutex_lock (&job_queue_mutex);
+	for (i = EV_JOB_PRIORITY_URGENT; i < EV_JOB_N_PRIORITIES && is_empty; i++)
+		is_empty = g_queue_is_empty (job_queue[i]);
+	g_mutex_unlock (&job_queue_mutex);
+
+	return is_empty;
+}
+
 static gpointer
 ev_job_scheduler_init (gpointer data)
 {
@@ -169,7 +183,10 @@ ev_scheduler_thread_job_cancelled (EvSchedulerJob *job,
 	}
 }
 
-static void
+/* Runs the job until it's done, or until other jobs are waiting
+ * and it has to yield to them. Returns whether the job is not done.
+ */
+static gboolean
 ev_job_thread (EvJob *job)
 {
 	gboolean result;
@@ -183,9 +200,11 @@ ev_job_thread (EvJob *job)
                         g_atomic_pointer_set (&running_job, job);
 			result = ev_job_run (job);
                 }
-	} while (result);
+	} while (result && ev_job_queue_is_empty ());
 
         g_atomic_pointer_set (&running_job, NULL);
+
+	return result;
 }
 
 static gboolean
@@ -214,8 +233,13 @@ ev_job_thread_proxy (gpointer data)
 		}
 		g_mutex_unlock (&job_queue_mutex);
 		
-		ev_job_thread (job->job);
-		ev_scheduler_job_destroy (job);
+		/* Jobs that run in steps go back to the queue
+		 * so that they don't delay the other jobs.
+		 */
+		if (ev_job_thread (job->job))
+			ev_job_queue_push (job, job->priority);
+		else
+			ev_scheduler_job_destroy (job);
 	}
 
 	return NULL;
@@ -21,6 +21,7 @@
 #include <config.h>
 
 #include "ev-jobs.h"
+#include "ev-job-scheduler.h"
 #include "ev-document-links.h"
 #include "ev-document-images.h"
 #include "ev-document-forms.h"
@@ -70,6 +71,8 @@ static void ev_job_export_init            (EvJobExport           *job);
 static void ev_job_export_class_init      (EvJobExportClass      *class);
 static void ev_job_print_init             (EvJobPrint            *job);
 static void ev_job_print_class_init       (EvJobPrintClass       *class);
+static void ev_job_load_synctex_init      (EvJobLoadSynctex      *job);
+static void ev_job_load_synctex_class_init (EvJobLoadSynctexClass *class);
 
 enum {
 	CANCELLED,
@@ -77,6 +80,11 @@ enum {
 	LAST_SIGNAL
 };
 
+enum {
+	ANNOTS_UPDATED,
+	ANNOTS_LAST_SIGNAL
+};
+
 enum {
 	FONTS_UPDATED,
 	FONTS_LAST_SIGNAL
@@ -87,9 +95,16 @@ enum {
 	FIND_LAST_SIGNAL
 };
 
+enum {
+	FIND_INDEX_UPDATED,
+	FIND_INDEX_LAST_SIGNAL
+};
+
 static guint job_signals[LAST_SIGNAL] = { 0 };
+static guint job_annots_signals[ANNOTS_LAST_SIGNAL] = { 0 };
 static guint job_fonts_signals[FONTS_LAST_SIGNAL] = { 0 };
 static guint job_find_signals[FIND_LAST_SIGNAL] = { 0 };
+static guint job_find_index_signals[FIND_INDEX_LAST_SIGNAL] = { 0 };
 
 G_DEFINE_ABSTRACT_TYPE (EvJob, ev_job, G_TYPE_OBJECT)
 G_DEFINE_TYPE (EvJobLinks, ev_job_links, EV_TYPE_JOB)
@@ -104,9 +119,11 @@ G_DEFINE_TYPE (EvJobLoadStream, ev_job_load_stream, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLoadGFile, ev_job_load_gfile, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobSave, ev_job_save, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobFind, ev_job_find, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobFindIndex, ev_job_find_index, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobLayers, ev_job_layers, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobExport, ev_job_export, EV_TYPE_JOB)
 G_DEFINE_TYPE (EvJobPrint, ev_job_print, EV_TYPE_JOB)
+G_DEFINE_TYPE (EvJobLoadSynctex, ev_job_load_synctex, EV_TYPE_JOB)
 
 /* EvJob */
 static void
@@ -380,16 +397,37 @@ fill_page_labels (GtkTreeModel   *tree_model,
 static gboolean
 ev_job_links_run (EvJob *job)
 {
-	EvJobLinks *job_links = EV_JOB_LINKS (job);
+	EvJobLinks      *job_links = EV_JOB_LINKS (job);
+	EvDocumentCache *cache;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
 	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
-	
+
+	/* The cached outline already has the page labels filled in */
+	cache = ev_document_get_cache (job->document);
+	if (cache) {
+		job_links->model = ev_document_cache_get_outline (cache);
+		if (job_links->model) {
+			ev_job_succeeded (job);
+
+			return FALSE;
+		}
+	}
+
 	ev_document_doc_mutex_lock ();
 	job_links->model = ev_document_links_get_links_model (EV_DOCUMENT_LINKS (job->document));
 	ev_document_doc_mutex_unlock ();
 
-	gtk_tree_model_foreach (job_links->model, (GtkTreeModelForeachFunc)fill_page_labels, job);
+	/* Backends returning their own model, like the lazy PDF outline,
+	 * resolve the page labels when they are shown. Filling them in here,
+	 * or caching the outline, would read the whole outline.
+	 */
+	if (GTK_IS_TREE_STORE (job_links->model)) {
+		gtk_tree_model_foreach (job_links->model, (GtkTreeModelForeachFunc)fill_page_labels, job);
+
+		if (cache)
+			ev_document_cache_set_outline (cache, job_links->model);
+	}
 
 	ev_job_succeeded (job);
 	
@@ -526,17 +564,58 @@ ev_job_annots_dispose (GObject *object)
 	G_OBJECT_CLASS (ev_job_annots_parent_class)->dispose (object);
 }
 
+typedef struct {
+	EvJobAnnots *job;
+	GList       *annots;
+} EvJobAnnotsBatch;
+
+static gboolean
+ev_job_annots_emit_updated (EvJobAnnotsBatch *batch)
+{
+	EvJobAnnots *job = batch->job;
+	GList       *annots = batch->annots;
+
+	/* The annotations found so far are always in job->annots */
+	job->annots = g_list_concat (job->annots, annots);
+	batch->annots = NULL;
+
+	if (!g_cancellable_is_cancelled (EV_JOB (job)->cancellable))
+		g_signal_emit (job, job_annots_signals[ANNOTS_UPDATED], 0, annots);
+
+	return FALSE;
+}
+
+static void
+ev_job_annots_batch_free (EvJobAnnotsBatch *batch)
+{
+	g_list_free_full (batch->annots, (GDestroyNotify)ev_mapping_list_unref);
+	g_object_unref (batch->job);
+	g_free (batch);
+}
+
 static gboolean
 ev_job_annots_run (EvJob *job)
 {
 	EvJobAnnots *job_annots = EV_JOB_ANNOTS (job);
+	GList       *annots = NULL;
+	gint         n_pages, last_page;
 	gint         i;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 
+#ifdef EV_ENABLE_DEBUG
+	/* We use the #ifdef in this case because of the if */
+	if (job_annots->current_page == 0)
+		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+#endif
+
+	/* The annotations are sent to the main loop a chunk of
+	 * pages at a time, so they can be shown as they are found.
+	 */
 	ev_document_doc_mutex_lock ();
-	for (i = 0; i < ev_document_get_n_pages (job->document); i++) {
+	n_pages = ev_document_get_n_pages (job->document);
+	last_page = MIN (job_annots->current_page + 20, n_pages);
+	for (i = job_annots->current_page; i < last_page; i++) {
 		EvMappingList *mapping_list;
 		EvPage        *page;
 
@@ -546,11 +625,26 @@ ev_job_annots_run (EvJob *job)
 		g_object_unref (page);
 
 		if (mapping_list)
-			job_annots->annots = g_list_prepend (job_annots->annots, mapping_list);
+			annots = g_list_prepend (annots, mapping_list);
 	}
 	ev_document_doc_mutex_unlock ();
 
-	job_annots->annots = g_list_reverse (job_annots->annots);
+	job_annots->current_page = last_page;
+
+	if (annots) {
+		EvJobAnnotsBatch *batch;
+
+		batch = g_new (EvJobAnnotsBatch, 1);
+		batch->job = EV_JOB_ANNOTS (g_object_ref (job));
+		batch->annots = g_list_reverse (annots);
+		g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+				 (GSourceFunc)ev_job_annots_emit_updated,
+				 batch,
+				 (GDestroyNotify)ev_job_annots_batch_free);
+	}
+
+	if (last_page < n_pages)
+		return TRUE;
 
 	ev_job_succeeded (job);
 
@@ -565,6 +659,16 @@ ev_job_annots_class_init (EvJobAnnotsClass *class)
 
 	oclass->dispose = ev_job_annots_dispose;
 	job_class->run = ev_job_annots_run;
+
+	job_annots_signals[ANNOTS_UPDATED] =
+		g_signal_new ("updated",
+			      EV_TYPE_JOB_ANNOTS,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EvJobAnnotsClass, updated),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__POINTER,
+			      G_TYPE_NONE,
+			      1, G_TYPE_POINTER);
 }
 
 EvJob *
@@ -601,6 +705,11 @@ ev_job_render_dispose (GObject *object)
 		job->surface = NULL;
 	}
 
+	if (job->annots) {
+		cairo_surface_destroy (job->annots);
+		job->annots = NULL;
+	}
+
 	if (job->selection) {
 		cairo_surface_destroy (job->selection);
 		job->selection = NULL;
@@ -636,9 +745,27 @@ ev_job_render_run (EvJob *job)
 					   job_render->target_width, job_render->target_height);
 	g_object_unref (ev_page);
 
-	job_render->surface = ev_document_render (job->document, rc);
+	ev_render_context_set_region (rc, job_render->has_area ? &job_render->area : NULL);
+	if (job_render->layered) {
+		if (job_render->layers & EV_RENDER_LAYER_CONTENT) {
+			ev_render_context_set_layers (rc, EV_RENDER_LAYER_CONTENT);
+			job_render->surface = ev_document_render (job->document, rc);
+		}
+		/* A page without annotations has no surface for them */
+		if ((job_render->layers & EV_RENDER_LAYER_ANNOTATIONS) &&
+		    !g_cancellable_is_cancelled (job->cancellable)) {
+			ev_render_context_set_layers (rc, EV_RENDER_LAYER_ANNOTATIONS);
+			job_render->annots = ev_document_render (job->document, rc);
+		}
+		ev_render_context_set_layers (rc, EV_RENDER_LAYER_ALL);
+	} else {
+		job_render->surface = ev_document_render (job->document, rc);
+	}
+	/* The selection is rendered for the whole page */
+	ev_render_context_set_region (rc, NULL);
 
-	if (job_render->surface == NULL) {
+	if (job_render->surface == NULL &&
+	    (!job_render->layered || (job_render->layers & EV_RENDER_LAYER_CONTENT))) {
 		ev_document_fc_mutex_unlock ();
 		ev_document_doc_mutex_unlock ();
 		g_object_unref (rc);
@@ -737,6 +864,49 @@ ev_job_render_set_selection_info (EvJobRender     *job,
 	job->base = *base;
 }
 
+/**
+ * ev_job_render_set_layers:
+ * @job: an #EvJobRender
+ * @layers: the #EvRenderLayers to render
+ * @area: (allow-none): the area of the page to render, or %NULL
+ *
+ * Makes @job render the content of the page in its surface and the
+ * annotations in a separate surface, only for the given @layers. The
+ * document must be able to render layers, see
+ * ev_document_can_render_layers().
+ *
+ * Since: 3.40
+ */
+void
+ev_job_render_set_layers (EvJobRender                 *job,
+			  EvRenderLayers               layers,
+			  const cairo_rectangle_int_t *area)
+{
+	job->layered = TRUE;
+	job->layers = layers;
+	ev_job_render_set_area (job, area);
+}
+
+/**
+ * ev_job_render_set_area:
+ * @job: an #EvJobRender
+ * @area: (allow-none): the area of the page to render, or %NULL
+ *
+ * Makes @job render only @area of the page, given in pixels of the
+ * page at the size of the job. The surfaces of @job then have the size
+ * of @area. The whole page is rendered by default.
+ *
+ * Since: 3.40
+ */
+void
+ev_job_render_set_area (EvJobRender                 *job,
+			const cairo_rectangle_int_t *area)
+{
+	job->has_area = area != NULL;
+	if (area)
+		job->area = *area;
+}
+
 /* EvJobPageData */
 static void
 ev_job_page_data_init (EvJobPageData *job)
@@ -991,23 +1161,42 @@ ev_job_thumbnail_set_output_format (EvJobThumbnail      *job,
 static void
 ev_job_fonts_init (EvJobFonts *job)
 {
-	EV_JOB (job)->run_mode = EV_JOB_RUN_MAIN_LOOP;
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+typedef struct {
+	EvJobFonts *job;
+	gdouble     progress;
+} EvJobFontsUpdate;
+
+static gboolean
+ev_job_fonts_emit_updated (EvJobFontsUpdate *update)
+{
+	if (!g_cancellable_is_cancelled (EV_JOB (update->job)->cancellable))
+		g_signal_emit (update->job, job_fonts_signals[FONTS_UPDATED], 0,
+			       update->progress);
+
+	return FALSE;
+}
+
+static void
+ev_job_fonts_update_free (EvJobFontsUpdate *update)
+{
+	g_object_unref (update->job);
+	g_free (update);
 }
 
 static gboolean
 ev_job_fonts_run (EvJob *job)
 {
-	EvJobFonts      *job_fonts = EV_JOB_FONTS (job);
-	EvDocumentFonts *fonts = EV_DOCUMENT_FONTS (job->document);
+	EvJobFonts       *job_fonts = EV_JOB_FONTS (job);
+	EvDocumentFonts  *fonts = EV_DOCUMENT_FONTS (job->document);
+	EvJobFontsUpdate *update;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	
-	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
-		return TRUE;
-	
-	if (!ev_document_fc_mutex_trylock ())
-		return TRUE;
+
+	ev_document_doc_mutex_lock ();
+	ev_document_fc_mutex_lock ();
 
 #ifdef EV_ENABLE_DEBUG
 	/* We use the #ifdef in this case because of the if */
@@ -1015,16 +1204,27 @@ ev_job_fonts_run (EvJob *job)
 		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 #endif
 
+	/* The job runs a chunk of pages at a time, so that the
+	 * scheduler can run other jobs before the next one.
+	 */
 	job_fonts->scan_completed = !ev_document_fonts_scan (fonts, 20);
-	g_signal_emit (job_fonts, job_fonts_signals[FONTS_UPDATED], 0,
-		       ev_document_fonts_get_progress (fonts));
+
+	update = g_new (EvJobFontsUpdate, 1);
+	update->job = EV_JOB_FONTS (g_object_ref (job));
+	update->progress = ev_document_fonts_get_progress (fonts);
 
 	ev_document_fc_mutex_unlock ();
 	ev_document_doc_mutex_unlock ();
 
+	/* Scanned fonts are added to the model in the main thread */
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+			 (GSourceFunc)ev_job_fonts_emit_updated,
+			 update,
+			 (GDestroyNotify)ev_job_fonts_update_free);
+
 	if (job_fonts->scan_completed)
 		ev_job_succeeded (job);
-	
+
 	return !job_fonts->scan_completed;
 }
 
@@ -1647,10 +1847,63 @@ ev_job_find_dispose (GObject *object)
 		g_free (job->pages);
 		job->pages = NULL;
 	}
+
+	g_clear_pointer (&job->refine_pages, g_free);
+
+	if (job->index_job) {
+		g_signal_handlers_disconnect_by_data (job->index_job, job);
+		ev_job_cancel (job->index_job);
+		g_clear_object (&job->index_job);
+	}
 	
 	(* G_OBJECT_CLASS (ev_job_find_parent_class)->dispose) (object);
 }
 
+static gboolean
+ev_job_find_resume (EvJob *job)
+{
+	if (g_cancellable_is_cancelled (job->cancellable))
+		return FALSE;
+
+	return ev_job_run (job);
+}
+
+static void
+ev_job_find_index_updated (EvJobFindIndex *index_job,
+			   gint            page,
+			   EvJobFind      *job)
+{
+	EvDocumentFind *find = EV_DOCUMENT_FIND (EV_JOB (job)->document);
+
+	if (!job->waiting_index ||
+	    !ev_document_find_is_page_indexed (find, job->current_page))
+		return;
+
+	/* The run of the job was stopped until the page was indexed */
+	job->waiting_index = FALSE;
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+			 (GSourceFunc)ev_job_find_resume,
+			 g_object_ref (job),
+			 (GDestroyNotify)g_object_unref);
+}
+
+static void
+ev_job_find_start_index (EvJobFind *job)
+{
+	EvDocumentFind *find = EV_DOCUMENT_FIND (EV_JOB (job)->document);
+
+	if (job->index_job || !ev_document_find_has_text_index (find))
+		return;
+
+	/* Pages are indexed in the order they are searched */
+	job->index_job = ev_job_find_index_new (EV_JOB (job)->document,
+						job->current_page, job->n_pages);
+	g_signal_connect (job->index_job, "updated",
+			  G_CALLBACK (ev_job_find_index_updated),
+			  job);
+	ev_job_scheduler_push_job (job->index_job, EV_JOB_PRIORITY_NONE);
+}
+
 static gboolean
 ev_job_find_run (EvJob *job)
 {
@@ -1660,23 +1913,47 @@ ev_job_find_run (EvJob *job)
 	GList          *matches;
 
 	ev_debug_message (DEBUG_JOBS, NULL);
-	
-	/* Do not block the main loop */
-	if (!ev_document_doc_mutex_trylock ())
-		return TRUE;
-	
+
+	/* Pages without results for the refined search can't have any, skip
+	 * them but the last one, which tells that the search is complete.
+	 */
+	if (job_find->refine_pages) {
+		while (!job_find->refine_pages[job_find->current_page] &&
+		       (job_find->current_page + 1) % job_find->n_pages != job_find->start_page)
+			job_find->current_page = (job_find->current_page + 1) % job_find->n_pages;
+	}
+
+	if (job_find->refine_pages && !job_find->refine_pages[job_find->current_page]) {
+		matches = NULL;
+	} else {
+		/* The text of the pages is extracted by the index job, in
+		 * its thread, and searched here, in the main loop, once the
+		 * page is indexed.
+		 */
+		ev_job_find_start_index (job_find);
+		if (!ev_document_find_is_page_indexed (find, job_find->current_page)) {
+			job_find->waiting_index = TRUE;
+
+			return FALSE;
+		}
+
+		/* Do not block the main loop */
+		if (!ev_document_doc_mutex_trylock ())
+			return TRUE;
+
 #ifdef EV_ENABLE_DEBUG
-	/* We use the #ifdef in this case because of the if */
-	if (job_find->current_page == job_find->start_page)
-		ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+		/* We use the #ifdef in this case because of the if */
+		if (job_find->current_page == job_find->start_page)
+			ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
 #endif
 
-	ev_page = ev_document_get_page (job->document, job_find->current_page);
-	matches = ev_document_find_find_text_with_options (find, ev_page, job_find->text,
-                                                           job_find->options);
-	g_object_unref (ev_page);
-	
-	ev_document_doc_mutex_unlock ();
+		ev_page = ev_document_get_page (job->document, job_find->current_page);
+		matches = ev_document_find_find_text_with_options (find, ev_page, job_find->text,
+		                                                   job_find->options);
+		g_object_unref (ev_page);
+
+		ev_document_doc_mutex_unlock ();
+	}
 
 	if (!job_find->has_results)
 		job_find->has_results = (matches != NULL);
@@ -1772,6 +2049,69 @@ ev_job_find_get_options (EvJobFind *job)
         return job->options;
 }
 
+static gboolean
+ev_job_find_page_is_searched (EvJobFind *job,
+			      gint       page)
+{
+	if (ev_job_is_finished (EV_JOB (job)))
+		return !ev_job_is_failed (EV_JOB (job));
+
+	/* Pages are searched from start_page, wrapping around */
+	return (page - job->start_page + job->n_pages) % job->n_pages <
+		(job->current_page - job->start_page + job->n_pages) % job->n_pages;
+}
+
+/**
+ * ev_job_find_refine:
+ * @job: an #EvJobFind that hasn't been scheduled yet
+ * @previous: the #EvJobFind of the previous search
+ *
+ * Makes @job search only the pages where the search of @previous found
+ * results, or that it didn't get to search before it was cancelled. This
+ * is only possible when the text of @job starts with the text of
+ * @previous, since every match of the text of @job is also a match of the
+ * text of @previous then, and both are searched on the same document and
+ * with the same options. Otherwise, @job searches all pages as usual.
+ *
+ * The options of @job must be set before calling this function.
+ *
+ * Returns: %TRUE if @job will only search the pages that can have results
+ *
+ * Since: 3.40
+ */
+gboolean
+ev_job_find_refine (EvJobFind *job,
+		    EvJobFind *previous)
+{
+	gint i;
+
+	g_return_val_if_fail (EV_IS_JOB_FIND (job), FALSE);
+	g_return_val_if_fail (EV_IS_JOB_FIND (previous), FALSE);
+
+	if (EV_JOB (job)->document != EV_JOB (previous)->document ||
+	    job->n_pages != previous->n_pages ||
+	    job->options != previous->options)
+		return FALSE;
+
+	/* Whole words of the previous text are not
+	 * part of the whole words of a longer text.
+	 */
+	if (job->options & EV_FIND_WHOLE_WORDS_ONLY)
+		return FALSE;
+
+	if (!g_str_has_prefix (job->text, previous->text))
+		return FALSE;
+
+	g_clear_pointer (&job->refine_pages, g_free);
+	job->refine_pages = g_new (gboolean, job->n_pages);
+	for (i = 0; i < job->n_pages; i++) {
+		job->refine_pages[i] = previous->pages[i] != NULL ||
+			!ev_job_find_page_is_searched (previous, i);
+	}
+
+	return TRUE;
+}
+
 gint
 ev_job_find_get_n_results (EvJobFind *job,
 			   gint       page)
@@ -1816,6 +2156,144 @@ ev_job_find_get_results (EvJobFind *job)
 	return job->pages;
 }
 
+/* EvJobFindIndex */
+static void
+ev_job_find_index_init (EvJobFindIndex *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+typedef struct {
+	EvJobFindIndex *job;
+	gint            page;
+} EvJobFindIndexUpdate;
+
+static gboolean
+ev_job_find_index_emit_updated (EvJobFindIndexUpdate *update)
+{
+	if (!g_cancellable_is_cancelled (EV_JOB (update->job)->cancellable))
+		g_signal_emit (update->job, job_find_index_signals[FIND_INDEX_UPDATED], 0,
+			       update->page);
+
+	return FALSE;
+}
+
+static void
+ev_job_find_index_update_free (EvJobFindIndexUpdate *update)
+{
+	g_object_unref (update->job);
+	g_free (update);
+}
+
+static gboolean
+ev_job_find_index_run (EvJob *job)
+{
+	EvJobFindIndex       *job_index = EV_JOB_FIND_INDEX (job);
+	EvDocumentFind       *find = EV_DOCUMENT_FIND (job->document);
+	EvJobFindIndexUpdate *update;
+	gboolean              completed = FALSE;
+
+	ev_debug_message (DEBUG_JOBS, "page: %d", job_index->current_page);
+
+	/* The job indexes a page at a time, so that the
+	 * scheduler can run other jobs before the next one.
+	 */
+	while (!completed &&
+	       ev_document_find_is_page_indexed (find, job_index->current_page)) {
+		job_index->current_page = (job_index->current_page + 1) % job_index->n_pages;
+		completed = job_index->current_page == job_index->start_page;
+	}
+
+	if (!completed) {
+		EvPage *ev_page;
+
+		ev_document_doc_mutex_lock ();
+		ev_page = ev_document_get_page (job->document, job_index->current_page);
+		ev_document_find_index_page (find, ev_page);
+		g_object_unref (ev_page);
+		ev_document_doc_mutex_unlock ();
+	}
+
+	/* Searches waiting for the page go on in the main thread. Also
+	 * when the page was indexed by another job, since the search could
+	 * have started waiting for it before.
+	 */
+	update = g_new (EvJobFindIndexUpdate, 1);
+	update->job = EV_JOB_FIND_INDEX (g_object_ref (job));
+	update->page = job_index->current_page;
+	g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+			 (GSourceFunc)ev_job_find_index_emit_updated,
+			 update,
+			 (GDestroyNotify)ev_job_find_index_update_free);
+
+	if (!completed) {
+		job_index->current_page = (job_index->current_page + 1) % job_index->n_pages;
+		completed = job_index->current_page == job_index->start_page;
+	}
+
+	if (completed)
+		ev_job_succeeded (job);
+
+	return !completed;
+}
+
+static void
+ev_job_find_index_class_init (EvJobFindIndexClass *class)
+{
+	EvJobClass *job_class = EV_JOB_CLASS (class);
+
+	job_class->run = ev_job_find_index_run;
+
+	job_find_index_signals[FIND_INDEX_UPDATED] =
+		g_signal_new ("updated",
+			      EV_TYPE_JOB_FIND_INDEX,
+			      G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (EvJobFindIndexClass, updated),
+			      NULL, NULL,
+			      g_cclosure_marshal_VOID__INT,
+			      G_TYPE_NONE,
+			      1, G_TYPE_INT);
+}
+
+/**
+ * ev_job_find_index_new:
+ * @document: an #EvDocument implementing #EvDocumentFind
+ * @start_page: the first page to index
+ * @n_pages: the number of pages of @document
+ *
+ * Creates a job that extracts the text of the pages of @document
+ * into its text index, in a thread, from @start_page and wrapping
+ * around. Pages already indexed are skipped. The #EvJobFindIndex::updated
+ * signal is emitted in the main thread after every indexed page.
+ *
+ * #EvJobFind runs one of these itself when the document has a text
+ * index, see ev_document_find_has_text_index().
+ *
+ * Returns: (transfer full): the new #EvJobFindIndex
+ *
+ * Since: 3.40
+ */
+EvJob *
+ev_job_find_index_new (EvDocument *document,
+		       gint        start_page,
+		       gint        n_pages)
+{
+	EvJobFindIndex *job;
+
+	g_return_val_if_fail (EV_IS_DOCUMENT_FIND (document), NULL);
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = g_object_new (EV_TYPE_JOB_FIND_INDEX, NULL);
+
+	EV_JOB (job)->document = g_object_ref (document);
+	job->start_page = start_page;
+	job->current_page = start_page;
+	job->n_pages = n_pages;
+
+	return EV_JOB (job);
+}
+
 /* EvJobLayers */
 static void
 ev_job_layers_init (EvJobLayers *job)
@@ -2079,3 +2557,57 @@ ev_job_print_set_cairo (EvJobPrint *job,
 		cairo_destroy (job->cr);
 	job->cr = cr ? cairo_reference (cr) : NULL;
 }
+
+/* EvJobLoadSynctex */
+static void
+ev_job_load_synctex_init (EvJobLoadSynctex *job)
+{
+	EV_JOB (job)->run_mode = EV_JOB_RUN_THREAD;
+}
+
+static gboolean
+ev_job_load_synctex_run (EvJob *job)
+{
+	ev_debug_message (DEBUG_JOBS, NULL);
+	ev_profiler_start (EV_PROFILE_JOBS, "%s (%p)", EV_GET_TYPE_NAME (job), job);
+
+	/* SyncTeX data doesn't depend on the backend, no need to
+	 * hold the doc mutex while parsing.
+	 */
+	ev_document_load_synctex (job->document);
+
+	ev_job_succeeded (job);
+
+	return FALSE;
+}
+
+static void
+ev_job_load_synctex_class_init (EvJobLoadSynctexClass *class)
+{
+	EvJobClass *job_class = EV_JOB_CLASS (class);
+
+	job_class->run = ev_job_load_synctex_run;
+}
+
+/**
+ * ev_job_load_synctex_new:
+ * @document: an #EvDocument
+ *
+ * Creates a job that loads the SyncTeX data of @document.
+ *
+ * Returns: (transfer full): the new #EvJob
+ *
+ * Since: 3.40
+ */
+EvJob *
+ev_job_load_synctex_new (EvDocument *document)
+{
+	EvJob *job;
+
+	ev_debug_message (DEBUG_JOBS, NULL);
+
+	job = g_object_new (EV_TYPE_JOB_LOAD_SYNCTEX, NULL);
+	job->document = g_object_ref (document);
+
+	return job;
+}
@@ -72,6 +72,9 @@ typedef struct _EvJobSaveClass EvJobSaveClass;
 typedef struct _EvJobFind EvJobFind;
 typedef struct _EvJobFindClass EvJobFindClass;
 
+typedef struct _EvJobFindIndex EvJobFindIndex;
+typedef struct _EvJobFindIndexClass EvJobFindIndexClass;
+
 typedef struct _EvJobLayers EvJobLayers;
 typedef struct _EvJobLayersClass EvJobLayersClass;
 
@@ -81,6 +84,9 @@ typedef struct _EvJobExportClass EvJobExportClass;
 typedef struct _EvJobPrint EvJobPrint;
 typedef struct _EvJobPrintClass EvJobPrintClass;
 
+typedef struct _EvJobLoadSynctex EvJobLoadSynctex;
+typedef struct _EvJobLoadSynctexClass EvJobLoadSynctexClass;
+
 #define EV_TYPE_JOB            (ev_job_get_type())
 #define EV_JOB(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB, EvJob))
 #define EV_IS_JOB(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB))
@@ -173,6 +179,13 @@ typedef struct _EvJobPrintClass EvJobPrintClass;
 #define EV_IS_JOB_FIND_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_FIND))
 #define EV_JOB_FIND_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_FIND, EvJobFindClass))
 
+#define EV_TYPE_JOB_FIND_INDEX            (ev_job_find_index_get_type())
+#define EV_JOB_FIND_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_FIND_INDEX, EvJobFindIndex))
+#define EV_IS_JOB_FIND_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_FIND_INDEX))
+#define EV_JOB_FIND_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_FIND_INDEX, EvJobFindIndexClass))
+#define EV_IS_JOB_FIND_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_FIND_INDEX))
+#define EV_JOB_FIND_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_FIND_INDEX, EvJobFindIndexClass))
+
 #define EV_TYPE_JOB_LAYERS            (ev_job_layers_get_type())
 #define EV_JOB_LAYERS(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_LAYERS, EvJobLayers))
 #define EV_IS_JOB_LAYERS(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_LAYERS))
@@ -194,6 +207,13 @@ typedef struct _EvJobPrintClass EvJobPrintClass;
 #define EV_IS_JOB_PRINT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_PRINT))
 #define EV_JOB_PRINT_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_PRINT, EvJobPrintClass))
 
+#define EV_TYPE_JOB_LOAD_SYNCTEX            (ev_job_load_synctex_get_type())
+#define EV_JOB_LOAD_SYNCTEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), EV_TYPE_JOB_LOAD_SYNCTEX, EvJobLoadSynctex))
+#define EV_IS_JOB_LOAD_SYNCTEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), EV_TYPE_JOB_LOAD_SYNCTEX))
+#define EV_JOB_LOAD_SYNCTEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), EV_TYPE_JOB_LOAD_SYNCTEX, EvJobLoadSynctexClass))
+#define EV_IS_JOB_LOAD_SYNCTEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), EV_TYPE_JOB_LOAD_SYNCTEX))
+#define EV_JOB_LOAD_SYNCTEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), EV_TYPE_JOB_LOAD_SYNCTEX, EvJobLoadSynctexClass))
+
 typedef enum {
 	EV_JOB_RUN_THREAD,
 	EV_JOB_RUN_MAIN_LOOP
@@ -258,11 +278,16 @@ struct _EvJobAnnots
 	EvJob parent;
 
 	GList *annots;
+	gint   current_page;
 };
 
 struct _EvJobAnnotsClass
 {
 	EvJobClass parent_class;
+
+	/* Signals */
+	void (* updated) (EvJobAnnots *job,
+			  GList       *annots);
 };
 
 struct _EvJobRender
@@ -278,6 +303,12 @@ struct _EvJobRender
 	gint target_height;
 	cairo_surface_t *surface;
 
+	gboolean layered;
+	EvRenderLayers layers;
+	gboolean has_area;
+	cairo_rectangle_int_t area;
+	cairo_surface_t *annots;
+
 	gboolean include_selection;
 	cairo_surface_t *selection;
 	cairo_region_t *selection_region;
@@ -441,6 +472,13 @@ struct _EvJobFind
 	gboolean case_sensitive;
 	gboolean has_results;
         EvFindOptions options;
+
+	/* Pages that can have results, NULL if all of them can */
+	gboolean *refine_pages;
+
+	/* Indexes the text of the pages when the document has a text index */
+	EvJob *index_job;
+	gboolean waiting_index;
 };
 
 struct _EvJobFindClass
@@ -452,6 +490,24 @@ struct _EvJobFindClass
 			   gint       page);
 };
 
+struct _EvJobFindIndex
+{
+	EvJob parent;
+
+	gint start_page;
+	gint current_page;
+	gint n_pages;
+};
+
+struct _EvJobFindIndexClass
+{
+	EvJobClass parent_class;
+
+	/* Signals */
+	void (* updated)  (EvJobFindIndex *job,
+			   gint            page);
+};
+
 struct _EvJobLayers
 {
 	EvJob parent;
@@ -490,6 +546,16 @@ struct _EvJobPrintClass
 	EvJobClass parent_class;
 };
 
+struct _EvJobLoadSynctex
+{
+	EvJob parent;
+};
+
+struct _EvJobLoadSynctexClass
+{
+	EvJobClass parent_class;
+};
+
 /* Base job class */
 GType           ev_job_get_type           (void) G_GNUC_CONST;
 gboolean        ev_job_run                (EvJob          *job);
@@ -534,6 +600,11 @@ void     ev_job_render_set_selection_info (EvJobRender     *job,
 					   EvSelectionStyle selection_style,
 					   GdkColor        *text,
 					   GdkColor        *base);
+void     ev_job_render_set_layers         (EvJobRender     *job,
+					   EvRenderLayers   layers,
+					   const cairo_rectangle_int_t *area);
+void     ev_job_render_set_area           (EvJobRender     *job,
+					   const cairo_rectangle_int_t *area);
 /* EvJobPageData */
 GType           ev_job_page_data_get_type (void) G_GNUC_CONST;
 EvJob          *ev_job_page_data_new      (EvDocument      *document,
@@ -604,12 +675,20 @@ EvJob          *ev_job_find_new           (EvDocument      *document,
 void            ev_job_find_set_options   (EvJobFind       *job,
                                            EvFindOptions    options);
 EvFindOptions   ev_job_find_get_options   (EvJobFind       *job);
+gboolean        ev_job_find_refine        (EvJobFind       *job,
+					   EvJobFind       *previous);
 gint            ev_job_find_get_n_results (EvJobFind       *job,
 					   gint             pages);
 gdouble         ev_job_find_get_progress  (EvJobFind       *job);
 gboolean        ev_job_find_has_results   (EvJobFind       *job);
 GList         **ev_job_find_get_results   (EvJobFind       *job);
 
+/* EvJobFindIndex */
+GType           ev_job_find_index_get_type (void) G_GNUC_CONST;
+EvJob          *ev_job_find_index_new      (EvDocument      *document,
+					    gint             start_page,
+					    gint             n_pages);
+
 /* EvJobLayers */
 GType           ev_job_layers_get_type    (void) G_GNUC_CONST;
 EvJob          *ev_job_layers_new         (EvDocument     *document);
@@ -627,6 +706,10 @@ void            ev_job_print_set_page    (EvJobPrint     *job,
 void            ev_job_print_set_cairo   (EvJobPrint     *job,
 					  cairo_t        *cr);
 
+/* EvJobLoadSynctex */
+GType           ev_job_load_synctex_get_type (void) G_GNUC_CONST;
+EvJob          *ev_job_load_synctex_new      (EvDocument     *document);
+
 G_END_DECLS
 
 #endif /* __EV_JOBS_H__ */
@@ -19,6 +19,18 @@ typedef struct _CacheJobInfo
 	/* Data we get from rendering */
 	cairo_surface_t *surface;
 
+	/* Area of the page covered by the surface when only a region of
+	 * the page was rendered, in pixels of the page at page_width x
+	 * page_height */
+	gboolean              has_area;
+	cairo_rectangle_int_t area;
+	gint                  page_width;
+	gint                  page_height;
+
+	/* Annotations and form fields drawn over the surface when the
+	 * document renders them separately, NULL if there are none */
+	cairo_surface_t *annots;
+
 	/* Device scale factor of target widget */
 	int device_scale;
 
@@ -50,6 +62,8 @@ struct _EvPixbufCache
 	int end_page;
         ScrollDirection scroll_direction;
 	gboolean inverted_colors;
+	gboolean layered;
+	gboolean render_regions;
 
 	gsize max_size;
 
@@ -105,6 +119,13 @@ static gboolean      new_selection_surface_needed(EvPixbufCache      *pixbuf_cac
 
 #define MAX_PRELOADED_PAGES 3
 
+/* Visible pages larger than this many times the view only get the
+ * part of them around the visible area rendered, which is at most as
+ * large, so that their cost follows what is shown instead of the zoom
+ * level.
+ */
+#define RENDER_AREA_MIN_VIEWS 4
+
 G_DEFINE_TYPE (EvPixbufCache, ev_pixbuf_cache, G_TYPE_OBJECT)
 
 static void
@@ -189,6 +210,10 @@ dispose_cache_job_info (CacheJobInfo *job_info,
 		cairo_surface_destroy (job_info->surface);
 		job_info->surface = NULL;
 	}
+	if (job_info->annots) {
+		cairo_surface_destroy (job_info->annots);
+		job_info->annots = NULL;
+	}
 	if (job_info->region) {
 		cairo_region_destroy (job_info->region);
 		job_info->region = NULL;
@@ -222,6 +247,12 @@ ev_pixbuf_cache_dispose (GObject *object)
 		dispose_cache_job_info (pixbuf_cache->job_list + i, pixbuf_cache);
 	}
 
+	/* Surfaces rendered by the backends give their buffers back to
+	 * the surface pool when destroyed, don't keep them around once
+	 * the document is gone.
+	 */
+	ev_surface_pool_trim ();
+
 	G_OBJECT_CLASS (ev_pixbuf_cache_parent_class)->dispose (object);
 }
 
@@ -238,6 +269,9 @@ ev_pixbuf_cache_new (GtkWidget       *view,
 	pixbuf_cache->view = view;
 	pixbuf_cache->model = g_object_ref (model);
 	pixbuf_cache->document = ev_document_model_get_document (model);
+	pixbuf_cache->layered = ev_document_can_render_layers (pixbuf_cache->document);
+	pixbuf_cache->render_regions = !pixbuf_cache->layered &&
+		ev_document_can_render_regions (pixbuf_cache->document);
 	pixbuf_cache->max_size = max_size;
 
 	return pixbuf_cache;
@@ -276,20 +310,109 @@ set_device_scale_on_surface (cairo_surface_t *surface,
 #endif
 }
 
+/* Inverting the colors of a transparent surface with
+ * ev_document_misc_invert_surface() would make it opaque
+ */
+static void
+invert_annots_surface (cairo_surface_t *surface)
+{
+	cairo_t *cr;
+
+	cr = cairo_create (surface);
+
+	cairo_push_group (cr);
+	cairo_set_source_surface (cr, surface, 0, 0);
+	cairo_paint (cr);
+	cairo_set_operator (cr, CAIRO_OPERATOR_DIFFERENCE);
+	cairo_set_source_rgb (cr, 1., 1., 1.);
+	cairo_paint (cr);
+	cairo_pop_group_to_source (cr);
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_IN);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+}
+
+/* Replaces the area of the annotations surface rendered by an
+ * annotations only job, the rest of the page didn't change.
+ */
+static void
+update_annots_area (EvJobRender   *job_render,
+		    CacheJobInfo  *job_info,
+		    EvPixbufCache *pixbuf_cache)
+{
+	cairo_t *cr;
+
+	if (!job_info->surface)
+		return;
+
+	if (!job_info->annots) {
+		if (!job_render->annots)
+			return;
+
+		job_info->annots =
+			cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+						    cairo_image_surface_get_width (job_info->surface),
+						    cairo_image_surface_get_height (job_info->surface));
+		set_device_scale_on_surface (job_info->annots, job_info->device_scale);
+	}
+
+	cr = cairo_create (job_info->annots);
+	/* The area is in pixels */
+	cairo_scale (cr, 1. / job_info->device_scale, 1. / job_info->device_scale);
+	cairo_rectangle (cr, job_render->area.x, job_render->area.y,
+			 job_render->area.width, job_render->area.height);
+	if (job_render->annots) {
+		if (pixbuf_cache->inverted_colors)
+			invert_annots_surface (job_render->annots);
+		cairo_set_source_surface (cr, job_render->annots,
+					  job_render->area.x, job_render->area.y);
+		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	} else {
+		cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+	}
+	cairo_fill (cr);
+	cairo_destroy (cr);
+}
+
 static void
 copy_job_to_job_info (EvJobRender   *job_render,
 		      CacheJobInfo  *job_info,
 		      EvPixbufCache *pixbuf_cache)
 {
+	if (job_render->layered && !(job_render->layers & EV_RENDER_LAYER_CONTENT)) {
+		update_annots_area (job_render, job_info, pixbuf_cache);
+
+		if (job_info->job)
+			end_job (job_info, pixbuf_cache);
+
+		return;
+	}
+
 	if (job_info->surface) {
 		cairo_surface_destroy (job_info->surface);
 	}
 	job_info->surface = cairo_surface_reference (job_render->surface);
 	set_device_scale_on_surface (job_info->surface, job_info->device_scale);
+	job_info->has_area = job_render->has_area;
+	job_info->area = job_render->area;
+	job_info->page_width = job_render->target_width;
+	job_info->page_height = job_render->target_height;
 	if (pixbuf_cache->inverted_colors) {
 		ev_document_misc_invert_surface (job_info->surface);
 	}
 
+	if (job_info->annots) {
+		cairo_surface_destroy (job_info->annots);
+		job_info->annots = NULL;
+	}
+	if (job_render->annots) {
+		job_info->annots = cairo_surface_reference (job_render->annots);
+		set_device_scale_on_surface (job_info->annots, job_info->device_scale);
+		if (pixbuf_cache->inverted_colors)
+			invert_annots_surface (job_info->annots);
+	}
+
 	job_info->points_set = FALSE;
 	if (job_render->include_selection) {
 		if (job_info->selection) {
@@ -430,6 +553,7 @@ move_one_job (CacheJobInfo  *job_info,
 	job_info->job = NULL;
 	job_info->region = NULL;
 	job_info->surface = NULL;
+	job_info->annots = NULL;
 
 	if (new_priority != priority && target_page->job) {
 		ev_job_scheduler_update_job (target_page->job, new_priority);
@@ -450,6 +574,39 @@ ev_pixbuf_cache_get_page_size (EvPixbufCache *pixbuf_cache,
 	return height * cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
 }
 
+static gsize
+job_info_get_annots_size (CacheJobInfo *job_info)
+{
+	if (!job_info->annots)
+		return 0;
+
+	return cairo_image_surface_get_stride (job_info->annots) *
+		cairo_image_surface_get_height (job_info->annots);
+}
+
+/* Memory used by the annotations surfaces of the pages in the cache,
+ * which come on top of the page surfaces when the document renders
+ * its annotations separately.
+ */
+static gsize
+ev_pixbuf_cache_get_annots_size (EvPixbufCache *pixbuf_cache)
+{
+	gsize size = 0;
+	gint  i;
+
+	if (!pixbuf_cache->layered || !pixbuf_cache->job_list)
+		return 0;
+
+	for (i = 0; i < pixbuf_cache->preload_cache_size; i++) {
+		size += job_info_get_annots_size (pixbuf_cache->prev_job + i);
+		size += job_info_get_annots_size (pixbuf_cache->next_job + i);
+	}
+	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++)
+		size += job_info_get_annots_size (pixbuf_cache->job_list + i);
+
+	return size;
+}
+
 static gint
 ev_pixbuf_cache_get_preload_size (EvPixbufCache *pixbuf_cache,
 				  gint           start_page,
@@ -457,11 +614,13 @@ ev_pixbuf_cache_get_preload_size (EvPixbufCache *pixbuf_cache,
 				  gdouble        scale,
 				  gint           rotation)
 {
-	gsize range_size = 0;
+	gsize range_size;
 	gint  new_preload_cache_size = 0;
 	gint  i;
 	guint n_pages = ev_document_get_n_pages (pixbuf_cache->document);
 
+	range_size = ev_pixbuf_cache_get_annots_size (pixbuf_cache);
+
 	/* Get the size of the current range */
 	for (i = start_page; i <= end_page; i++) {
 		range_size += ev_pixbuf_cache_get_page_size (pixbuf_cache, i, scale, rotation);
@@ -668,15 +827,100 @@ get_selection_colors (EvView *view, GdkColor *text, GdkColor *base)
 }
 
 static void
-add_job (EvPixbufCache  *pixbuf_cache,
-	 CacheJobInfo   *job_info,
-	 cairo_region_t *region,
-	 gint            width,
-	 gint            height,
-	 gint            page,
-	 gint            rotation,
-	 gfloat          scale,
-	 EvJobPriority   priority)
+scale_area (cairo_rectangle_int_t *area,
+	    gint                   device_scale)
+{
+	area->x *= device_scale;
+	area->y *= device_scale;
+	area->width *= device_scale;
+	area->height *= device_scale;
+}
+
+static gboolean
+area_contains (const cairo_rectangle_int_t *area,
+	       const cairo_rectangle_int_t *rect)
+{
+	return rect->x >= area->x && rect->y >= area->y &&
+		rect->x + rect->width <= area->x + area->width &&
+		rect->y + rect->height <= area->y + area->height;
+}
+
+/* Gets the @visible part of @page and the @area around it to render
+ * when @page is much larger than the view, in pixels of the page at
+ * the device scale. Returns %FALSE if the whole page is rendered.
+ */
+static gboolean
+get_render_area (EvPixbufCache         *pixbuf_cache,
+		 gint                   page,
+		 gint                   width,
+		 gint                   height,
+		 gint                   device_scale,
+		 cairo_rectangle_int_t *visible,
+		 cairo_rectangle_int_t *area)
+{
+	GtkAllocation         allocation;
+	cairo_rectangle_int_t bounds;
+
+	if (!pixbuf_cache->render_regions)
+		return FALSE;
+
+	gtk_widget_get_allocation (pixbuf_cache->view, &allocation);
+	if ((gint64) width * height <=
+	    (gint64) allocation.width * allocation.height * RENDER_AREA_MIN_VIEWS)
+		return FALSE;
+
+	if (!_ev_view_get_page_visible_area (EV_VIEW (pixbuf_cache->view), page, visible))
+		return FALSE;
+
+	/* Half a view is kept around the visible area, so that
+	 * scrolling doesn't need a new render right away.
+	 */
+	area->x = visible->x - allocation.width / 2;
+	area->y = visible->y - allocation.height / 2;
+	area->width = visible->width + allocation.width;
+	area->height = visible->height + allocation.height;
+
+	bounds.x = bounds.y = 0;
+	bounds.width = width;
+	bounds.height = height;
+	gdk_rectangle_intersect (area, &bounds, area);
+
+	scale_area (visible, device_scale);
+	scale_area (area, device_scale);
+
+	return TRUE;
+}
+
+/* Whether the surface of @job_info has all of the page at @width x
+ * @height that is needed, the @visible area if given or the whole page.
+ */
+static gboolean
+job_info_surface_covers (CacheJobInfo                *job_info,
+			 gint                         width,
+			 gint                         height,
+			 const cairo_rectangle_int_t *visible)
+{
+	if (!job_info->has_area)
+		return cairo_image_surface_get_width (job_info->surface) == width &&
+			cairo_image_surface_get_height (job_info->surface) == height;
+
+	return visible != NULL &&
+		job_info->page_width == width &&
+		job_info->page_height == height &&
+		area_contains (&job_info->area, visible);
+}
+
+static void
+add_job (EvPixbufCache               *pixbuf_cache,
+	 CacheJobInfo                *job_info,
+	 cairo_region_t              *region,
+	 const cairo_rectangle_int_t *area,
+	 gint                         width,
+	 gint                         height,
+	 gint                         page,
+	 gint                         rotation,
+	 gfloat                       scale,
+	 EvJobPriority                priority)
 {
 	job_info->device_scale = get_device_scale (pixbuf_cache);
 	job_info->page_ready = FALSE;
@@ -693,6 +937,11 @@ add_job (EvPixbufCache  *pixbuf_cache,
                                            scale * job_info->device_scale,
 					   width * job_info->device_scale,
                                            height * job_info->device_scale);
+	if (pixbuf_cache->layered)
+		ev_job_render_set_layers (EV_JOB_RENDER (job_info->job),
+					  EV_RENDER_LAYER_ALL, NULL);
+	else if (area)
+		ev_job_render_set_area (EV_JOB_RENDER (job_info->job), area);
 
 	if (new_selection_surface_needed (pixbuf_cache, job_info, page, scale)) {
 		GdkColor text, base;
@@ -720,18 +969,32 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 {
 	gint device_scale = get_device_scale (pixbuf_cache);
 	gint width, height;
-
-	if (job_info->job)
-		return;
+	cairo_rectangle_int_t visible, area;
+	gboolean has_area = FALSE;
 
 	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
 					       page, scale, rotation,
 					       &width, &height);
 
+	if (priority == EV_JOB_PRIORITY_URGENT)
+		has_area = get_render_area (pixbuf_cache, page, width, height,
+					    device_scale, &visible, &area);
+
+	if (job_info->job) {
+		EvJobRender *job_render = EV_JOB_RENDER (job_info->job);
+
+		/* A region is rendered again once it's scrolled away */
+		if (job_render->layered || !job_render->has_area ||
+		    (has_area && area_contains (&job_render->area, &visible)))
+			return;
+
+		end_job (job_info, pixbuf_cache);
+	}
+
 	if (job_info->surface &&
 	    job_info->device_scale == device_scale &&
-	    cairo_image_surface_get_width (job_info->surface) == width * device_scale &&
-	    cairo_image_surface_get_height (job_info->surface) == height * device_scale)
+	    job_info_surface_covers (job_info, width * device_scale, height * device_scale,
+				     has_area ? &visible : NULL))
 		return;
 
 	/* Free old surfaces for non visible pages */
@@ -741,13 +1004,18 @@ add_job_if_needed (EvPixbufCache *pixbuf_cache,
 			job_info->surface = NULL;
 		}
 
+		if (job_info->annots) {
+			cairo_surface_destroy (job_info->annots);
+			job_info->annots = NULL;
+		}
+
 		if (job_info->selection) {
 			cairo_surface_destroy (job_info->selection);
 			job_info->selection = NULL;
 		}
 	}
 
-	add_job (pixbuf_cache, job_info, NULL,
+	add_job (pixbuf_cache, job_info, NULL, has_area ? &area : NULL,
 		 width, height, page, rotation, scale,
 		 priority);
 }
@@ -887,10 +1155,14 @@ ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 		job_info = pixbuf_cache->prev_job + i;
 		if (job_info && job_info->surface)
 			ev_document_misc_invert_surface (job_info->surface);
+		if (job_info && job_info->annots)
+			invert_annots_surface (job_info->annots);
 
 		job_info = pixbuf_cache->next_job + i;
 		if (job_info && job_info->surface)
 			ev_document_misc_invert_surface (job_info->surface);
+		if (job_info && job_info->annots)
+			invert_annots_surface (job_info->annots);
 	}
 
 	for (i = 0; i < PAGE_CACHE_LEN (pixbuf_cache); i++) {
@@ -899,6 +1171,8 @@ ev_pixbuf_cache_set_inverted_colors (EvPixbufCache *pixbuf_cache,
 		job_info = pixbuf_cache->job_list + i;
 		if (job_info && job_info->surface)
 			ev_document_misc_invert_surface (job_info->surface);
+		if (job_info && job_info->annots)
+			invert_annots_surface (job_info->annots);
 	}
 }
 
@@ -925,6 +1199,56 @@ ev_pixbuf_cache_get_surface (EvPixbufCache *pixbuf_cache,
 	return job_info->surface;
 }
 
+/* Gets the @area of @page covered by the surface returned by
+ * ev_pixbuf_cache_get_surface() when only a region of the page was
+ * rendered, in pixels of the page at the current scale. Returns %FALSE
+ * if the surface covers the whole page.
+ */
+gboolean
+ev_pixbuf_cache_get_surface_area (EvPixbufCache *pixbuf_cache,
+				  gint           page,
+				  GdkRectangle  *area)
+{
+	CacheJobInfo *job_info;
+	gint width, height;
+
+	job_info = find_job_cache (pixbuf_cache, page);
+	if (job_info == NULL || !job_info->surface || !job_info->has_area)
+		return FALSE;
+
+	if (area == NULL)
+		return TRUE;
+
+	/* The surface is scaled like the page until it's rendered again */
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document, page,
+					       ev_document_model_get_scale (pixbuf_cache->model),
+					       ev_document_model_get_rotation (pixbuf_cache->model),
+					       &width, &height);
+	area->x = (gint64) job_info->area.x * width / job_info->page_width;
+	area->y = (gint64) job_info->area.y * height / job_info->page_height;
+	area->width = (gint64) job_info->area.width * width / job_info->page_width;
+	area->height = (gint64) job_info->area.height * height / job_info->page_height;
+
+	return TRUE;
+}
+
+/* Returns the annotations and form fields of @page, to be drawn over
+ * the surface returned by ev_pixbuf_cache_get_surface(), if they were
+ * rendered separately.
+ */
+cairo_surface_t *
+ev_pixbuf_cache_get_annots_surface (EvPixbufCache *pixbuf_cache,
+				    gint           page)
+{
+	CacheJobInfo *job_info;
+
+	job_info = find_job_cache (pixbuf_cache, page);
+	if (job_info == NULL || !job_info->surface)
+		return NULL;
+
+	return job_info->annots;
+}
+
 static gboolean
 new_selection_surface_needed (EvPixbufCache *pixbuf_cache,
 			      CacheJobInfo  *job_info,
@@ -1366,6 +1690,8 @@ ev_pixbuf_cache_reload_page (EvPixbufCache  *pixbuf_cache,
 			     gdouble         scale)
 {
 	CacheJobInfo *job_info;
+	cairo_rectangle_int_t visible, area;
+	gboolean has_area;
         gint width, height;
 
 	job_info = find_job_cache (pixbuf_cache, page);
@@ -1375,9 +1701,86 @@ ev_pixbuf_cache_reload_page (EvPixbufCache  *pixbuf_cache,
 	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
 					       page, scale, rotation,
 					       &width, &height);
-        add_job (pixbuf_cache, job_info, region,
+	has_area = get_render_area (pixbuf_cache, page, width, height,
+				    get_device_scale (pixbuf_cache), &visible, &area);
+        add_job (pixbuf_cache, job_info, region, has_area ? &area : NULL,
 		 width, height, page, rotation, scale,
 		 EV_JOB_PRIORITY_URGENT);
 }
 
+/* Renders again the annotations and form fields in @area of @page, in
+ * pixels of the page at @scale, without rendering its content again.
+ * The whole page is rendered when the document doesn't render them
+ * separately or the page hasn't been rendered yet.
+ */
+void
+ev_pixbuf_cache_reload_annots (EvPixbufCache               *pixbuf_cache,
+			       cairo_region_t              *region,
+			       const cairo_rectangle_int_t *area,
+			       gint                         page,
+			       gint                         rotation,
+			       gdouble                      scale)
+{
+	CacheJobInfo *job_info;
+	cairo_rectangle_int_t job_area, bounds;
+	cairo_region_t *job_region;
+	gint width, height;
+
+	job_info = find_job_cache (pixbuf_cache, page);
+	if (job_info == NULL)
+		return;
+
+	_get_page_size_for_scale_and_rotation (pixbuf_cache->document,
+					       page, scale, rotation,
+					       &width, &height);
+
+	if (!pixbuf_cache->layered || !job_info->page_ready || !job_info->surface ||
+	    job_info->device_scale != get_device_scale (pixbuf_cache) ||
+	    cairo_image_surface_get_width (job_info->surface) != width * job_info->device_scale ||
+	    cairo_image_surface_get_height (job_info->surface) != height * job_info->device_scale ||
+	    (job_info->job && (!EV_JOB_RENDER (job_info->job)->layered ||
+			       (EV_JOB_RENDER (job_info->job)->layers & EV_RENDER_LAYER_CONTENT)))) {
+		ev_pixbuf_cache_reload_page (pixbuf_cache, region, page, rotation, scale);
+		return;
+	}
+
+	job_area.x = area->x * job_info->device_scale;
+	job_area.y = area->y * job_info->device_scale;
+	job_area.width = area->width * job_info->device_scale;
+	job_area.height = area->height * job_info->device_scale;
 
+	bounds.x = bounds.y = 0;
+	bounds.width = width * job_info->device_scale;
+	bounds.height = height * job_info->device_scale;
+	if (!gdk_rectangle_intersect (&job_area, &bounds, &job_area))
+		return;
+
+	job_region = region ? cairo_region_copy (region) : NULL;
+
+	/* A pending update of other annotations is replaced by this one */
+	if (job_info->job) {
+		EvJobRender *job_render = EV_JOB_RENDER (job_info->job);
+
+		gdk_rectangle_union (&job_area, &job_render->area, &job_area);
+		if (job_region && job_info->region)
+			cairo_region_union (job_region, job_info->region);
+		end_job (job_info, pixbuf_cache);
+	}
+
+	if (job_info->region)
+		cairo_region_destroy (job_info->region);
+	job_info->region = job_region;
+
+	job_info->job = ev_job_render_new (pixbuf_cache->document,
+					   page, rotation,
+					   scale * job_info->device_scale,
+					   width * job_info->device_scale,
+					   height * job_info->device_scale);
+	ev_job_render_set_layers (EV_JOB_RENDER (job_info->job),
+				  EV_RENDER_LAYER_ANNOTATIONS, &job_area);
+
+	g_signal_connect (job_info->job, "finished",
+			  G_CALLBACK (job_finished_cb),
+			  pixbuf_cache);
+	ev_job_scheduler_push_job (job_info->job, EV_JOB_PRIORITY_URGENT);
+}
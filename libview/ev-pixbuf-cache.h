@@ -68,6 +68,11 @@ void           ev_pixbuf_cache_set_page_range       (EvPixbufCache *pixbuf_cache
 						     GList          *selection_list);
 cairo_surface_t *ev_pixbuf_cache_get_surface        (EvPixbufCache *pixbuf_cache,
 						     gint           page);
+gboolean       ev_pixbuf_cache_get_surface_area     (EvPixbufCache *pixbuf_cache,
+						     gint           page,
+						     GdkRectangle  *area);
+cairo_surface_t *ev_pixbuf_cache_get_annots_surface (EvPixbufCache *pixbuf_cache,
+						     gint           page);
 void           ev_pixbuf_cache_clear                (EvPixbufCache *pixbuf_cache);
 void           ev_pixbuf_cache_style_changed        (EvPixbufCache *pixbuf_cache);
 void           ev_pixbuf_cache_reload_page 	    (EvPixbufCache  *pixbuf_cache,
@@ -75,6 +80,12 @@ void           ev_pixbuf_cache_reload_page 	    (EvPixbufCache  *pixbuf_cache,
                     				     gint            page,
 			                             gint            rotation,
 						     gdouble         scale);
+void           ev_pixbuf_cache_reload_annots        (EvPixbufCache  *pixbuf_cache,
+						     cairo_region_t *region,
+						     const cairo_rectangle_int_t *area,
+						     gint            page,
+						     gint            rotation,
+						     gdouble         scale);
 void           ev_pixbuf_cache_set_inverted_colors  (EvPixbufCache *pixbuf_cache,
 						     gboolean       inverted_colors);
 /* Selection */
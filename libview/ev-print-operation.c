@@ -388,6 +388,20 @@ static void     ev_print_operation_export_begin    (EvPrintOperationExport *expo
 static gboolean export_print_page                  (EvPrintOperationExport *export);
 static void     export_cancel                      (EvPrintOperationExport *export);
 
+/* A page of the output, or a blank sheet when page is -1 */
+typedef struct {
+	gint             page;
+	guint            begin_sheet : 1;
+	guint            end_sheet   : 1;
+	/* Same page as the previous one, for copies that aren't collated */
+	guint            repeat      : 1;
+	gint             total;
+
+	/* Set by the record workers */
+	gboolean         recorded;
+	cairo_surface_t *recording;
+} EvExportStep;
+
 struct _EvPrintOperationExport {
 	EvPrintOperation parent;
 
@@ -426,6 +440,25 @@ struct _EvPrintOperationExport {
 	GtkPageRange one_range;
 
 	gint page, start, end, inc;
+
+	/* The pages to export, in order. Pages are recorded ahead by
+	 * the record workers when the exporter supports it, and exported
+	 * in order by export_print_page().
+	 */
+	GArray *steps;
+	guint step;
+	GThreadPool *record_pool;
+	GMutex record_mutex;
+	gboolean record_stopped;
+	guint next_record;
+	guint n_recording;
+	guint max_recording;
+	gboolean waiting_record;
+	cairo_surface_t *last_recording;
+
+	/* The document file, when it's printed as it is */
+	GFile *source_file;
+	GCancellable *cancellable;
 };
 
 struct _EvPrintOperationExportClass {
@@ -711,13 +744,41 @@ get_first_and_last_page (EvPrintOperationExport *export,
 	*last = MIN (max_page, last_page);
 }
 
+static void
+export_add_step (EvPrintOperationExport *export,
+		 gint                    page,
+		 gboolean                begin_sheet,
+		 gboolean                end_sheet)
+{
+	EvExportStep step = { 0, };
+	gint         i;
+
+	step.page = page;
+	step.begin_sheet = begin_sheet;
+	step.end_sheet = end_sheet;
+	step.total = export->total;
+
+	if (page >= 0) {
+		for (i = (gint)export->steps->len - 1; i >= 0; i--) {
+			EvExportStep *previous = &g_array_index (export->steps, EvExportStep, i);
+
+			if (previous->page >= 0) {
+				step.repeat = previous->page == page;
+				break;
+			}
+		}
+	}
+
+	g_array_append_val (export->steps, step);
+}
+
 static gboolean
 export_print_inc_page (EvPrintOperationExport *export)
 {
 	do {
 		export->page += export->inc;
 
-		/* note: when NOT collating, page_count is increased in export_print_page */
+		/* note: when NOT collating, page_count is increased in export_plan_steps */
 		if (export->collate) {
 			export->page_count++;
 			export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
@@ -734,9 +795,6 @@ export_print_inc_page (EvPrintOperationExport *export)
 				if (export->pages_per_sheet > 1 && export->collate == 1 &&
 				    (export->page_count - 1) % export->pages_per_sheet != 0) {
 
-					EvPrintOperation *op = EV_PRINT_OPERATION (export);
-					ev_document_doc_mutex_lock ();
-
 					/* keep track of all blanks but only actualise those
 					 * which are in the current odd / even sheet set */
 
@@ -744,9 +802,8 @@ export_print_inc_page (EvPrintOperationExport *export)
 					if (export->page_set == GTK_PAGE_SET_ALL ||
 						(export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0) ||
 						(export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1) ) {
-						ev_file_exporter_end_page (EV_FILE_EXPORTER (op->document));
+						export_add_step (export, -1, FALSE, TRUE);
 					}
-					ev_document_doc_mutex_unlock ();
 					export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
 				}
 
@@ -836,6 +893,12 @@ export_print_done (EvPrintOperationExport *export)
 	 */
 	settings = gtk_print_settings_copy (export->print_settings);
 	capabilities = ev_file_exporter_get_capabilities (EV_FILE_EXPORTER (op->document));
+	/* The document file is printed as it is, copies, collation and
+	 * reverse order are left to the printer */
+	if (export->source_file)
+		capabilities &= ~(EV_FILE_EXPORTER_CAN_COPIES |
+				  EV_FILE_EXPORTER_CAN_COLLATE |
+				  EV_FILE_EXPORTER_CAN_REVERSE);
 
 	gtk_print_settings_set_page_ranges (settings, NULL, 0);
 	gtk_print_settings_set_print_pages (settings, GTK_PRINT_PAGES_ALL);
@@ -957,27 +1020,38 @@ export_print_page_idle_finished (EvPrintOperationExport *export)
 }
 
 static void
-export_job_finished (EvJobExport            *job,
-		     EvPrintOperationExport *export)
+export_schedule_print_page (EvPrintOperationExport *export)
 {
-	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	export->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+					   (GSourceFunc)export_print_page,
+					   export,
+					   (GDestroyNotify)export_print_page_idle_finished);
+}
 
-	if (export->pages_per_sheet == 1 ||
-	   ( export->page_count % export->pages_per_sheet == 0 &&
-	   ( export->page_set == GTK_PAGE_SET_ALL ||
-	   ( export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0 ) ||
-	   ( export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1 ) ) ) ) {
+static void
+export_step_done (EvPrintOperationExport *export)
+{
+	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	EvExportStep     *step;
 
+	step = &g_array_index (export->steps, EvExportStep, export->step);
+	if (step->end_sheet) {
 		ev_document_doc_mutex_lock ();
 		ev_file_exporter_end_page (EV_FILE_EXPORTER (op->document));
 		ev_document_doc_mutex_unlock ();
 	}
 
+	export->step++;
+}
+
+static void
+export_job_finished (EvJobExport            *job,
+		     EvPrintOperationExport *export)
+{
+	export_step_done (export);
+
 	/* Reschedule */
-	export->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-					   (GSourceFunc)export_print_page,
-					   export,
-					   (GDestroyNotify)export_print_page_idle_finished);
+	export_schedule_print_page (export);
 }
 
 static void
@@ -987,6 +1061,118 @@ export_job_cancelled (EvJobExport            *job,
 	export_cancel (export);
 }
 
+static gboolean
+export_page_recorded (EvPrintOperationExport *export)
+{
+	if (export->waiting_record && export->record_pool) {
+		export->waiting_record = FALSE;
+		export_schedule_print_page (export);
+	}
+
+	return G_SOURCE_REMOVE;
+}
+
+/* Runs in the record workers */
+static void
+export_record_page (gpointer                data,
+		    EvPrintOperationExport *export)
+{
+	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	EvExportStep     *step;
+	cairo_surface_t  *recording = NULL;
+	gboolean          stopped;
+
+	step = &g_array_index (export->steps, EvExportStep, GPOINTER_TO_UINT (data) - 1);
+
+	g_mutex_lock (&export->record_mutex);
+	stopped = export->record_stopped;
+	g_mutex_unlock (&export->record_mutex);
+
+	if (!stopped)
+		recording = ev_file_exporter_record_page (EV_FILE_EXPORTER (op->document), step->page);
+
+	g_mutex_lock (&export->record_mutex);
+	step->recording = recording;
+	step->recorded = TRUE;
+	if (!export->record_stopped) {
+		g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+				 (GSourceFunc)export_page_recorded,
+				 g_object_ref (export),
+				 (GDestroyNotify)g_object_unref);
+	}
+	g_mutex_unlock (&export->record_mutex);
+}
+
+/* Keeps max_recording pages recorded or being recorded ahead of the
+ * page being exported */
+static void
+export_record_pages (EvPrintOperationExport *export)
+{
+	while (export->n_recording < export->max_recording &&
+	       export->next_record < export->steps->len) {
+		EvExportStep *step;
+
+		step = &g_array_index (export->steps, EvExportStep, export->next_record);
+		export->next_record++;
+
+		if (step->page < 0 || step->repeat)
+			continue;
+
+		export->n_recording++;
+		g_thread_pool_push (export->record_pool,
+				    GUINT_TO_POINTER (export->next_record), NULL);
+	}
+}
+
+static void
+export_start_recording (EvPrintOperationExport *export)
+{
+	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	guint             n_threads;
+
+	if (!ev_file_exporter_can_record_pages (EV_FILE_EXPORTER (op->document)))
+		return;
+
+	/* The view keeps rendering with the loaded document */
+	n_threads = ev_document_get_max_render_threads ();
+	if (n_threads < 2)
+		return;
+
+	export->record_stopped = FALSE;
+	export->next_record = 0;
+	export->n_recording = 0;
+	export->max_recording = 2 * (n_threads - 1);
+	export->record_pool = g_thread_pool_new ((GFunc)export_record_page,
+						 export, n_threads - 1,
+						 FALSE, NULL);
+	export_record_pages (export);
+}
+
+static void
+export_stop_recording (EvPrintOperationExport *export)
+{
+	guint i;
+
+	if (!export->record_pool)
+		return;
+
+	g_mutex_lock (&export->record_mutex);
+	export->record_stopped = TRUE;
+	g_mutex_unlock (&export->record_mutex);
+
+	/* Drops the pages not being recorded yet, and waits for the others */
+	g_thread_pool_free (export->record_pool, TRUE, TRUE);
+	export->record_pool = NULL;
+	export->waiting_record = FALSE;
+
+	for (i = 0; i < export->steps->len; i++) {
+		EvExportStep *step = &g_array_index (export->steps, EvExportStep, i);
+
+		g_clear_pointer (&step->recording, cairo_surface_destroy);
+	}
+	g_clear_pointer (&export->last_recording, cairo_surface_destroy);
+}
+
 static void
 export_cancel (EvPrintOperationExport *export)
 {
@@ -996,6 +1182,8 @@ export_cancel (EvPrintOperationExport *export)
 		g_source_remove (export->idle_id);
 	export->idle_id = 0;
 
+	export_stop_recording (export);
+
 	if (export->job_export) {
 		g_signal_handlers_disconnect_by_func (export->job_export,
 						      export_job_finished,
@@ -1020,91 +1208,157 @@ export_cancel (EvPrintOperationExport *export)
 }
 
 static void
-update_progress (EvPrintOperationExport *export)
+update_progress (EvPrintOperationExport *export,
+		 gint                    total)
 {
 	EvPrintOperation *op = EV_PRINT_OPERATION (export);
 
-	ev_print_operation_update_status (op, export->total,
+	ev_print_operation_update_status (op, total,
 					  export->n_pages_to_print,
-					  export->total / (gdouble)export->n_pages_to_print);
+					  total / (gdouble)export->n_pages_to_print);
 }
 
-static gboolean
-export_print_page (EvPrintOperationExport *export)
+/* Computes the pages to export, and when sheets begin and end */
+static void
+export_plan_steps (EvPrintOperationExport *export)
 {
-	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	while (TRUE) {
+		gboolean begin_sheet, end_sheet;
 
-	if (!export->temp_file)
-		return FALSE; /* cancelled */
+		export->total++;
+		export->collated++;
 
-	export->total++;
-	export->collated++;
+		/* note: when collating, page_count is increased in export_print_inc_page */
+		if (!export->collate) {
+			export->page_count++;
+			export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
+		}
 
-	/* note: when collating, page_count is increased in export_print_inc_page */
-	if (!export->collate) {
-		export->page_count++;
-		export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
-	}
+		if (export->collated == export->collated_copies) {
+			export->collated = 0;
+			if (!export_print_inc_page (export))
+				return;
+		}
 
-	if (export->collated == export->collated_copies) {
-		export->collated = 0;
-		if (!export_print_inc_page (export)) {
-			ev_document_doc_mutex_lock ();
-			ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
-			ev_document_doc_mutex_unlock ();
+		/* we're not collating and we've reached a sheet from the wrong sheet set */
+		if (!export->collate &&
+		    ((export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 != 0) ||
+		    (export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 != 1))) {
 
-			close (export->fd);
-			export->fd = -1;
-			update_progress (export);
-			export_print_done (export);
+			do {
+				export->page_count++;
+				export->collated++;
+				export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
+
+				if (export->collated == export->collated_copies) {
+					export->collated = 0;
+
+					if (!export_print_inc_page (export))
+						return;
+				}
+
+			} while ((export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 != 0) ||
+			 	  (export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 != 1));
 
-			return FALSE;
 		}
+
+		begin_sheet = export->pages_per_sheet == 1 ||
+			(export->page_count % export->pages_per_sheet == 1 &&
+			(export->page_set == GTK_PAGE_SET_ALL ||
+			(export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0) ||
+			(export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1)));
+
+		end_sheet = export->pages_per_sheet == 1 ||
+			( export->page_count % export->pages_per_sheet == 0 &&
+			( export->page_set == GTK_PAGE_SET_ALL ||
+			( export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0 ) ||
+			( export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1 ) ) );
+
+		export_add_step (export, export->page, begin_sheet, end_sheet);
 	}
+}
 
-	/* we're not collating and we've reached a sheet from the wrong sheet set */
-	if (!export->collate &&
-	    ((export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 != 0) ||
-	    (export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 != 1))) {
+static gboolean
+export_print_page (EvPrintOperationExport *export)
+{
+	EvPrintOperation *op = EV_PRINT_OPERATION (export);
+	EvExportStep     *step;
+	cairo_surface_t  *recording = NULL;
 
-		do {
-			export->page_count++;
-			export->collated++;
-			export->sheet = 1 + (export->page_count - 1) / export->pages_per_sheet;
+	if (!export->temp_file)
+		return FALSE; /* cancelled */
 
-			if (export->collated == export->collated_copies) {
-				export->collated = 0;
+	if (export->step == export->steps->len) {
+		export_stop_recording (export);
 
-				if (!export_print_inc_page (export)) {
-					ev_document_doc_mutex_lock ();
-					ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
-					ev_document_doc_mutex_unlock ();
+		ev_document_doc_mutex_lock ();
+		ev_file_exporter_end (EV_FILE_EXPORTER (op->document));
+		ev_document_doc_mutex_unlock ();
+
+		close (export->fd);
+		export->fd = -1;
+		update_progress (export, export->total);
+		export_print_done (export);
 
-					close (export->fd);
-					export->fd = -1;
+		return FALSE;
+	}
 
-					update_progress (export);
+	step = &g_array_index (export->steps, EvExportStep, export->step);
 
-					export_print_done (export);
-					return FALSE;
-				}
+	if (step->page >= 0 && export->record_pool) {
+		if (step->repeat) {
+			if (export->last_recording)
+				recording = cairo_surface_reference (export->last_recording);
+		} else {
+			gboolean recorded;
+
+			g_mutex_lock (&export->record_mutex);
+			recorded = step->recorded;
+			recording = step->recording;
+			step->recording = NULL;
+			g_mutex_unlock (&export->record_mutex);
+
+			/* export_page_recorded() reschedules us */
+			if (!recorded) {
+				export->waiting_record = TRUE;
+				return FALSE;
 			}
 
-		} while ((export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 != 0) ||
-	    		  (export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 != 1));
+			g_clear_pointer (&export->last_recording, cairo_surface_destroy);
+			if (recording)
+				export->last_recording = cairo_surface_reference (recording);
 
+			export->n_recording--;
+			export_record_pages (export);
+		}
 	}
 
-	if (export->pages_per_sheet == 1 ||
-	    (export->page_count % export->pages_per_sheet == 1 &&
-	    (export->page_set == GTK_PAGE_SET_ALL ||
-	    (export->page_set == GTK_PAGE_SET_EVEN && export->sheet % 2 == 0) ||
-	    (export->page_set == GTK_PAGE_SET_ODD && export->sheet % 2 == 1)))) {
+	if (step->begin_sheet) {
 		ev_document_doc_mutex_lock ();
 		ev_file_exporter_begin_page (EV_FILE_EXPORTER (op->document));
 		ev_document_doc_mutex_unlock ();
 	}
 
+	if (step->page < 0) {
+		export_step_done (export);
+
+		return TRUE;
+	}
+
+	update_progress (export, step->total);
+
+	if (recording) {
+		ev_document_doc_mutex_lock ();
+		ev_file_exporter_do_recorded_page (EV_FILE_EXPORTER (op->document), recording);
+		ev_document_doc_mutex_unlock ();
+		cairo_surface_destroy (recording);
+
+		export_step_done (export);
+
+		return TRUE;
+	}
+
+	/* The page couldn't be recorded, export it in the job thread */
 	if (!export->job_export) {
 		export->job_export = ev_job_export_new (op->document);
 		g_signal_connect (export->job_export, "finished",
@@ -1115,14 +1369,69 @@ export_print_page (EvPrintOperationExport *export)
 				  (gpointer)export);
 	}
 
-	ev_job_export_set_page (EV_JOB_EXPORT (export->job_export), export->page);
+	ev_job_export_set_page (EV_JOB_EXPORT (export->job_export), step->page);
 	ev_job_scheduler_push_job (export->job_export, EV_JOB_PRIORITY_NONE);
 
-	update_progress (export);
-	
 	return FALSE;
 }
 
+static void
+export_copy_progress_cb (goffset                 current_num_bytes,
+			 goffset                 total_num_bytes,
+			 EvPrintOperationExport *export)
+{
+	if (total_num_bytes <= 0)
+		return;
+
+	update_progress (export, MAX (1, export->n_pages_to_print * current_num_bytes / total_num_bytes));
+}
+
+static void
+export_copy_finished_cb (GFile                  *source_file,
+			 GAsyncResult           *result,
+			 EvPrintOperationExport *export)
+{
+	GError *error = NULL;
+
+	g_clear_object (&export->cancellable);
+
+	if (g_file_copy_finish (source_file, result, &error)) {
+		update_progress (export, export->n_pages_to_print + 1);
+		export_print_done (export);
+	} else if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+		export_cancel (export);
+	} else {
+		/* Render the pages instead */
+		g_clear_object (&export->source_file);
+		ev_print_operation_export_begin (export);
+	}
+
+	g_clear_error (&error);
+	g_object_unref (export);
+}
+
+static void
+export_copy_source_file (EvPrintOperationExport *export)
+{
+	GFile *temp_file;
+
+	/* The file is written by name */
+	close (export->fd);
+	export->fd = -1;
+
+	temp_file = g_file_new_for_path (export->temp_file);
+	export->cancellable = g_cancellable_new ();
+	g_file_copy_async (export->source_file, temp_file,
+			   G_FILE_COPY_OVERWRITE,
+			   G_PRIORITY_DEFAULT,
+			   export->cancellable,
+			   (GFileProgressCallback)export_copy_progress_cb,
+			   export,
+			   (GAsyncReadyCallback)export_copy_finished_cb,
+			   g_object_ref (export));
+	g_object_unref (temp_file);
+}
+
 static void
 ev_print_operation_export_begin (EvPrintOperationExport *export)
 {
@@ -1130,15 +1439,20 @@ ev_print_operation_export_begin (EvPrintOperationExport *export)
 
 	if (!export->temp_file)
 		return; /* cancelled */
+
+	if (export->source_file) {
+		export_copy_source_file (export);
+		return;
+	}
 	
 	ev_document_doc_mutex_lock ();
 	ev_file_exporter_begin (EV_FILE_EXPORTER (op->document), &export->fc);
 	ev_document_doc_mutex_unlock ();
 
-	export->idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-					   (GSourceFunc)export_print_page,
-					   export,
-					   (GDestroyNotify)export_print_page_idle_finished);	
+	export_plan_steps (export);
+	export_start_recording (export);
+
+	export_schedule_print_page (export);
 }
 
 static EvFileExporterFormat
@@ -1331,6 +1645,17 @@ ev_print_operation_export_print_dialog_response_cb (GtkDialog              *dial
 	export->fc.duplex = FALSE;
 	export->fc.pages_per_sheet = export->pages_per_sheet;
 
+	/* Print the document file when exporting it would give the same */
+	g_clear_object (&export->source_file);
+	if (export->pages_per_sheet == 1 && scale == 1.0 &&
+	    export->page_set == GTK_PAGE_SET_ALL &&
+	    export->n_ranges == 1 &&
+	    export->ranges[0].start == 0 &&
+	    export->ranges[0].end == export->n_pages - 1) {
+		export->source_file = ev_file_exporter_get_source_file (EV_FILE_EXPORTER (op->document),
+									format);
+	}
+
 	if (ev_print_queue_is_empty (op->document))
 		ev_print_operation_export_begin (export);
 
@@ -1388,8 +1713,11 @@ ev_print_operation_export_cancel (EvPrintOperation *op)
 {
 	EvPrintOperationExport *export = EV_PRINT_OPERATION_EXPORT (op);
 
-	if (export->job_export &&
-	    !ev_job_is_finished (export->job_export)) {
+	if (export->cancellable) {
+		/* export_copy_finished_cb() cancels the export */
+		g_cancellable_cancel (export->cancellable);
+	} else if (export->job_export &&
+		   !ev_job_is_finished (export->job_export)) {
 		ev_job_cancel (export->job_export);
 	} else {
 		export_cancel (export);
@@ -1433,6 +1761,11 @@ ev_print_operation_export_finalize (GObject *object)
 		export->idle_id = 0;
 	}
 
+	export_stop_recording (export);
+	g_array_free (export->steps, TRUE);
+	g_mutex_clear (&export->record_mutex);
+	g_clear_object (&export->source_file);
+
 	if (export->fd != -1) {
 		close (export->fd);
 		export->fd = -1;
@@ -1496,6 +1829,9 @@ ev_print_operation_export_init (EvPrintOperationExport *export)
 {
 	/* sheets are counted from 1 to be physical */
 	export->sheet = 1;
+
+	export->steps = g_array_new (FALSE, FALSE, sizeof (EvExportStep));
+	g_mutex_init (&export->record_mutex);
 }
 
 static GObject *
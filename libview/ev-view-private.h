@@ -249,6 +249,15 @@ struct _EvView {
 
 	/* Synctex */
 	EvMapping *synctex_result;
+	EvJob     *synctex_job;
+	/* Searches requested while synctex_job is running,
+	 * only the latest one of each kind is kept.
+	 */
+	EvSourceLink *synctex_pending_link;
+	gboolean      synctex_pending_backward;
+	gint          synctex_pending_page;
+	gint          synctex_pending_x;
+	gint          synctex_pending_y;
 
 	/* Accessibility */
 	AtkObject *accessible;
@@ -353,6 +362,9 @@ void _ev_view_focus_form_field    (EvView      *view,
 
 void _ev_view_ensure_rectangle_is_visible (EvView       *view,
 					   GdkRectangle *rect);
+gboolean _ev_view_get_page_visible_area (EvView       *view,
+					 gint          page,
+					 GdkRectangle *area);
 
 #endif  /* __EV_VIEW_PRIVATE_H__ */
 
@@ -241,6 +241,9 @@ static void       draw_one_page                              (EvView
 static void       ev_view_reload_page                        (EvView             *view,
 							      gint                page,
 							      cairo_region_t     *region);
+static void       ev_view_reload_annotation_area             (EvView             *view,
+							      EvAnnotation       *annot,
+							      EvRectangle        *old_area);
 /*** Callbacks ***/
 static void       ev_view_change_page                        (EvView             *view,
 							      gint                new_page);
@@ -315,6 +318,10 @@ static void       jump_to_find_result                        (EvView
 static void       jump_to_find_page                          (EvView             *view, 
 							      EvViewFindDirection direction,
 							      gint                shift);
+/*** Synctex ***/
+static void       ev_view_synctex_cancel                     (EvView             *view);
+static void       ev_view_synctex_load                       (EvView             *view);
+
 /*** Selection ***/
 static void       compute_selections                         (EvView             *view,
 							      EvSelectionStyle    style,
@@ -1402,6 +1409,42 @@ real_ev_view_get_page_extents (EvView       *view,
 	return TRUE;
 }
 
+/* Gets the part of @page within the view, in pixels of the page
+ * without its border. Returns %FALSE if @page isn't visible.
+ */
+gboolean
+_ev_view_get_page_visible_area (EvView       *view,
+				gint          page,
+				GdkRectangle *area)
+{
+	GdkRectangle  page_area;
+	GdkRectangle  view_area;
+	GtkBorder     border;
+	GtkAllocation allocation;
+
+	if (!ev_view_get_page_extents (view, page, &page_area, &border))
+		return FALSE;
+
+	page_area.x += border.left;
+	page_area.y += border.top;
+	page_area.width -= border.left + border.right;
+	page_area.height -= border.top + border.bottom;
+
+	gtk_widget_get_allocation (GTK_WIDGET (view), &allocation);
+	view_area.x = view->scroll_x;
+	view_area.y = view->scroll_y;
+	view_area.width = allocation.width;
+	view_area.height = allocation.height;
+
+	if (!gdk_rectangle_intersect (&page_area, &view_area, area))
+		return FALSE;
+
+	area->x -= page_area.x;
+	area->y -= page_area.y;
+
+	return TRUE;
+}
+
 static void
 get_doc_page_size (EvView  *view,
 		   gint     page,
@@ -2180,6 +2223,44 @@ tip_from_link (EvView *view, EvLink *link)
 	return msg;
 }
 
+/* Returns a new reference to @page_surface, or to a copy of it with the
+ * annotations of @page on it when they were rendered separately
+ */
+static cairo_surface_t *
+get_page_surface_with_annots (EvView          *view,
+			      gint             page,
+			      cairo_surface_t *page_surface)
+{
+	cairo_surface_t *annots_surface;
+	cairo_surface_t *surface;
+	cairo_t         *cr;
+
+	annots_surface = ev_pixbuf_cache_get_annots_surface (view->pixbuf_cache, page);
+	if (!annots_surface)
+		return cairo_surface_reference (page_surface);
+
+	surface = cairo_surface_create_similar_image (page_surface,
+						      CAIRO_FORMAT_RGB24,
+						      cairo_image_surface_get_width (page_surface),
+						      cairo_image_surface_get_height (page_surface));
+#ifdef HAVE_HIDPI_SUPPORT
+	{
+		gdouble device_scale_x, device_scale_y;
+
+		cairo_surface_get_device_scale (page_surface, &device_scale_x, &device_scale_y);
+		cairo_surface_set_device_scale (surface, device_scale_x, device_scale_y);
+	}
+#endif
+	cr = cairo_create (surface);
+	cairo_set_source_surface (cr, page_surface, 0, 0);
+	cairo_paint (cr);
+	cairo_set_source_surface (cr, annots_surface, 0, 0);
+	cairo_paint (cr);
+	cairo_destroy (cr);
+
+	return surface;
+}
+
 static void
 ev_view_handle_cursor_over_xy (EvView *view, gint x, gint y)
 {
@@ -2279,12 +2360,16 @@ ev_view_handle_cursor_over_xy (EvView *view, gint x, gint y)
 
 		page_surface = ev_pixbuf_cache_get_surface (view->pixbuf_cache, link_dest_page);
 
-		if (page_surface) {
+		/* Only the whole page is good for a preview */
+		if (page_surface &&
+		    !ev_pixbuf_cache_get_surface_area (view->pixbuf_cache, link_dest_page, NULL)) {
 			GdkPixbuf *slice;
 
+			page_surface = get_page_surface_with_annots (view, link_dest_page, page_surface);
 			slice = gdk_pixbuf_get_from_surface (page_surface, 0, 0,
 							     cairo_image_surface_get_width(page_surface),
 							     cairo_image_surface_get_height(page_surface));
+			cairo_surface_destroy (page_surface);
 			link_preview_show_thumbnail (slice, view);
 			g_object_unref(slice);
 		} else {
@@ -3855,6 +3940,9 @@ ev_view_remove_annotation (EvView       *view,
                            EvAnnotation *annot)
 {
         guint page;
+        GdkRectangle view_rect;
+        EvRectangle doc_rect;
+        cairo_region_t *region;
 
         g_return_if_fail (EV_IS_VIEW (view));
         g_return_if_fail (EV_IS_ANNOTATION (annot));
@@ -3877,13 +3965,37 @@ ev_view_remove_annotation (EvView       *view,
 
         ev_page_cache_mark_dirty (view->page_cache, page, EV_PAGE_DATA_INCLUDE_ANNOTS);
 
-	/* FIXME: only redraw the annot area */
-        ev_view_reload_page (view, page, NULL);
+        ev_annotation_get_area (annot, &doc_rect);
+        _ev_view_transform_doc_rect_to_view_rect (view, page, &doc_rect, &view_rect);
+        view_rect.x -= view->scroll_x;
+        view_rect.y -= view->scroll_y;
+        region = cairo_region_create_rectangle (&view_rect);
+        ev_view_reload_page (view, page, region);
+        cairo_region_destroy (region);
 
 	g_signal_emit (view, signals[SIGNAL_ANNOT_REMOVED], 0, annot);
 	g_object_unref (annot);
 }
 
+static gboolean
+ev_view_synctex_backward_search_at (EvView *view,
+				    gint    page,
+				    gint    x,
+				    gint    y)
+{
+	EvSourceLink *link;
+
+	link = ev_document_synctex_backward_search (view->document, page, x, y);
+	if (link) {
+		g_signal_emit (view, signals[SIGNAL_SYNC_SOURCE], 0, link);
+		ev_source_link_free (link);
+
+		return TRUE;
+	}
+
+	return FALSE;
+}
+
 static gboolean
 ev_view_synctex_backward_search (EvView *view,
 				 gdouble x,
@@ -3891,7 +4003,6 @@ ev_view_synctex_backward_search (EvView *view,
 {
 	gint page = -1;
 	gint x_new = 0, y_new = 0;
-	EvSourceLink *link;
 
 	if (!ev_document_has_synctex (view->document))
 		return FALSE;
@@ -3899,15 +4010,17 @@ ev_view_synctex_backward_search (EvView *view,
 	if (!get_doc_point_from_location (view, x, y, &page, &x_new, &y_new))
 		return FALSE;
 
-	link = ev_document_synctex_backward_search (view->document, page, x_new, y_new);
-	if (link) {
-		g_signal_emit (view, signals[SIGNAL_SYNC_SOURCE], 0, link);
-		ev_source_link_free (link);
+	/* Run it when the SyncTeX data is ready */
+	if (view->synctex_job) {
+		view->synctex_pending_backward = TRUE;
+		view->synctex_pending_page = page;
+		view->synctex_pending_x = x_new;
+		view->synctex_pending_y = y_new;
 
 		return TRUE;
 	}
 
-	return FALSE;
+	return ev_view_synctex_backward_search_at (view, page, x_new, y_new);
 }
 
 /* Caret navigation */
@@ -6059,9 +6172,8 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 			}
 			ev_document_doc_mutex_unlock ();
 
-
-			/* FIXME: reload only annotation area */
-			ev_view_reload_page (view, annot_page, NULL);
+			ev_view_reload_annotation_area (view, view->adding_annot_info.annot,
+							&current_area);
 		} else if (view->moving_annot_info.annot_clicked) {
 			EvRectangle  rect;
 			EvRectangle  current_area;
@@ -6123,8 +6235,8 @@ ev_view_motion_notify_event (GtkWidget      *widget,
 			}
 			ev_document_doc_mutex_unlock ();
 
-			/* FIXME: reload only annotation area */
-			ev_view_reload_page (view, annot_page, NULL);
+			ev_view_reload_annotation_area (view, view->moving_annot_info.annot,
+							&current_area);
 		} else if (ev_document_has_synctex (view->document) && (event->state & GDK_CONTROL_MASK)) {
 			/* Ignore spurious motion event triggered by slightly moving mouse
 			 * while clicking for launching synctex. Issue #951 */
@@ -7495,7 +7607,10 @@ draw_one_page (EvView       *view,
 	if (gdk_rectangle_intersect (&real_page_area, expose_area, &overlap)) {
 		gint             width, height;
 		cairo_surface_t *page_surface = NULL;
+		cairo_surface_t *annots_surface = NULL;
 		cairo_surface_t *selection_surface = NULL;
+		GdkRectangle     surface_area;
+		GdkRectangle     surface_overlap;
 		gint offset_x, offset_y;
 		cairo_region_t *region = NULL;
 
@@ -7517,7 +7632,26 @@ draw_one_page (EvView       *view,
 		offset_x = overlap.x - real_page_area.x;
 		offset_y = overlap.y - real_page_area.y;
 
-		draw_surface (cr, page_surface, overlap.x, overlap.y, offset_x, offset_y, width, height);
+		/* Large pages may only have the area around the visible
+		 * part rendered, the rest is drawn when it's rendered.
+		 */
+		surface_area.x = 0;
+		surface_area.y = 0;
+		surface_area.width = width;
+		surface_area.height = height;
+		ev_pixbuf_cache_get_surface_area (view->pixbuf_cache, page, &surface_area);
+		surface_area.x += real_page_area.x;
+		surface_area.y += real_page_area.y;
+		if (gdk_rectangle_intersect (&overlap, &surface_area, &surface_overlap))
+			draw_surface (cr, page_surface, surface_overlap.x, surface_overlap.y,
+				      surface_overlap.x - surface_area.x,
+				      surface_overlap.y - surface_area.y,
+				      surface_area.width, surface_area.height);
+
+		annots_surface = ev_pixbuf_cache_get_annots_surface (view->pixbuf_cache, page);
+		if (annots_surface)
+			draw_surface (cr, annots_surface, overlap.x, overlap.y, offset_x, offset_y,
+				      width, height);
 
 		/* Get the selection pixbuf iff we have something to draw */
 		if (!find_selection_for_page (view, page))
@@ -7540,8 +7674,8 @@ draw_one_page (EvView       *view,
 			GdkRGBA color;
 			double device_scale_x = 1, device_scale_y = 1;
 
-			scale_x = (gdouble)width / cairo_image_surface_get_width (page_surface);
-			scale_y = (gdouble)height / cairo_image_surface_get_height (page_surface);
+			scale_x = (gdouble)surface_area.width / cairo_image_surface_get_width (page_surface);
+			scale_y = (gdouble)surface_area.height / cairo_image_surface_get_height (page_surface);
 
 #ifdef HAVE_HIDPI_SUPPORT
 			cairo_surface_get_device_scale (page_surface, &device_scale_x, &device_scale_y);
@@ -7613,6 +7747,7 @@ ev_view_dispose (GObject *object)
 	}
 
 	ev_view_find_cancel (view);
+	ev_view_synctex_cancel (view);
 
 	ev_view_window_children_free (view);
 
@@ -8796,6 +8931,7 @@ ev_view_document_changed_cb (EvDocumentModel *model,
 
 		ev_view_remove_all (view);
 		clear_caches (view);
+		ev_view_synctex_cancel (view);
 
 		if (view->document) {
 			g_object_unref (view->document);
@@ -8812,6 +8948,7 @@ ev_view_document_changed_cb (EvDocumentModel *model,
 
 			ev_view_set_loading (view, FALSE);
 			setup_caches (view);
+			ev_view_synctex_load (view);
 
 			if (view->caret_enabled)
 				preload_pages_for_caret_navigation (view);
@@ -9086,16 +9223,71 @@ ev_view_set_model (EvView          *view,
 					      view->model);
 }
 
+/* A @region is given when only annotations or form fields changed in
+ * it, the content of the page doesn't need to be rendered again then.
+ */
 static void
 ev_view_reload_page (EvView         *view,
 		     gint            page,
 		     cairo_region_t *region)
 {
-	ev_pixbuf_cache_reload_page (view->pixbuf_cache,
-				     region,
-				     page,
-				     view->rotation,
-				     view->scale);
+	cairo_rectangle_int_t area;
+	GdkRectangle          page_area;
+	GtkBorder             border;
+
+	if (!region) {
+		ev_pixbuf_cache_reload_page (view->pixbuf_cache,
+					     region,
+					     page,
+					     view->rotation,
+					     view->scale);
+		return;
+	}
+
+	/* From view coordinates to pixels of the page, with some
+	 * room for the rounding of the transformation of the areas
+	 */
+	ev_view_get_page_extents (view, page, &page_area, &border);
+	cairo_region_get_extents (region, &area);
+	area.x += view->scroll_x - page_area.x - border.left - 1;
+	area.y += view->scroll_y - page_area.y - border.top - 1;
+	area.width += 2;
+	area.height += 2;
+
+	ev_pixbuf_cache_reload_annots (view->pixbuf_cache,
+				       region,
+				       &area,
+				       page,
+				       view->rotation,
+				       view->scale);
+}
+
+static void
+ev_view_reload_annotation_area (EvView       *view,
+				EvAnnotation *annot,
+				EvRectangle  *old_area)
+{
+	cairo_region_t *region;
+	GdkRectangle    view_rect;
+	EvRectangle     doc_rect;
+	guint           page;
+
+	page = ev_annotation_get_page_index (annot);
+	ev_annotation_get_area (annot, &doc_rect);
+	_ev_view_transform_doc_rect_to_view_rect (view, page, &doc_rect, &view_rect);
+	view_rect.x -= view->scroll_x;
+	view_rect.y -= view->scroll_y;
+	region = cairo_region_create_rectangle (&view_rect);
+
+	if (old_area) {
+		_ev_view_transform_doc_rect_to_view_rect (view, page, old_area, &view_rect);
+		view_rect.x -= view->scroll_x;
+		view_rect.y -= view->scroll_y;
+		cairo_region_union_rectangle (region, &view_rect);
+	}
+
+	ev_view_reload_page (view, page, region);
+	cairo_region_destroy (region);
 }
 
 void
@@ -9701,6 +9893,72 @@ ev_view_find_cancel (EvView *view)
 }
 
 /*** Synctex ***/
+static void
+synctex_job_finished_cb (EvJob  *job,
+			 EvView *view)
+{
+	EvSourceLink *link = view->synctex_pending_link;
+	gboolean      backward = view->synctex_pending_backward;
+
+	g_signal_handlers_disconnect_by_func (job, synctex_job_finished_cb, view);
+	g_object_unref (view->synctex_job);
+	view->synctex_job = NULL;
+
+	view->synctex_pending_link = NULL;
+	view->synctex_pending_backward = FALSE;
+
+	if (backward) {
+		ev_view_synctex_backward_search_at (view,
+						    view->synctex_pending_page,
+						    view->synctex_pending_x,
+						    view->synctex_pending_y);
+	}
+
+	if (link) {
+		ev_view_highlight_forward_search (view, link);
+		ev_source_link_free (link);
+	}
+}
+
+static void
+ev_view_synctex_cancel (EvView *view)
+{
+	if (view->synctex_job) {
+		g_signal_handlers_disconnect_by_func (view->synctex_job,
+						      synctex_job_finished_cb, view);
+		ev_job_cancel (view->synctex_job);
+		g_object_unref (view->synctex_job);
+		view->synctex_job = NULL;
+	}
+
+	if (view->synctex_pending_link) {
+		ev_source_link_free (view->synctex_pending_link);
+		view->synctex_pending_link = NULL;
+	}
+	view->synctex_pending_backward = FALSE;
+}
+
+/* Parsing the SyncTeX data can take longer than loading the document,
+ * so it's done in a job once the document is shown. Searches requested
+ * in the meantime are delayed until the job finishes.
+ */
+static void
+ev_view_synctex_load (EvView *view)
+{
+	ev_view_synctex_cancel (view);
+
+	if (!view->document ||
+	    !ev_document_has_synctex (view->document) ||
+	    ev_document_synctex_is_loaded (view->document))
+		return;
+
+	view->synctex_job = ev_job_load_synctex_new (view->document);
+	g_signal_connect (view->synctex_job, "finished",
+			  G_CALLBACK (synctex_job_finished_cb),
+			  view);
+	ev_job_scheduler_push_job (view->synctex_job, EV_JOB_PRIORITY_NONE);
+}
+
 void
 ev_view_highlight_forward_search (EvView       *view,
 				  EvSourceLink *link)
@@ -9712,6 +9970,15 @@ ev_view_highlight_forward_search (EvView       *view,
 	if (!ev_document_has_synctex (view->document))
 		return;
 
+	/* Run it when the SyncTeX data is ready */
+	if (view->synctex_job) {
+		if (view->synctex_pending_link)
+			ev_source_link_free (view->synctex_pending_link);
+		view->synctex_pending_link = ev_source_link_copy (link);
+
+		return;
+	}
+
 	mapping = ev_document_synctex_forward_search (view->document, link);
 	if (!mapping)
 		return;
@@ -57,8 +57,10 @@ struct _EvSidebarAnnotationsPrivate {
 	GMenuModel  *popup_model;
 	GtkWidget   *popup;
 
-	EvJob       *job;
-	guint        selection_changed_id;
+	EvJob        *job;
+	/* Filled by the current job, NULL until it finds annotations */
+	GtkTreeStore *model;
+	guint         selection_changed_id;
 };
 
 static void ev_sidebar_annotations_page_iface_init (EvSidebarPageInterface *iface);
@@ -92,6 +94,14 @@ ev_sidebar_annotations_dispose (GObject *object)
 		priv->document = NULL;
 	}
 
+	if (priv->job) {
+		g_signal_handlers_disconnect_matched (priv->job, G_SIGNAL_MATCH_DATA,
+						      0, 0, NULL, NULL, sidebar_annots);
+		ev_job_cancel (priv->job);
+		g_clear_object (&priv->job);
+	}
+
+	g_clear_object (&priv->model);
 	g_clear_object (&priv->popup_model);
 	G_OBJECT_CLASS (ev_sidebar_annotations_parent_class)->dispose (object);
 }
@@ -336,12 +346,37 @@ sidebar_tree_button_press_cb (GtkTreeView    *view,
 }
 
 static void
-job_finished_callback (EvJobAnnots          *job,
-		       EvSidebarAnnotations *sidebar_annots)
+ev_sidebar_annotations_set_model (EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
+	GtkTreeSelection            *selection;
+
+	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->tree_view));
+	gtk_tree_selection_set_mode (selection, GTK_SELECTION_SINGLE);
+	if (priv->selection_changed_id == 0) {
+		priv->selection_changed_id =
+			g_signal_connect (selection, "changed",
+					  G_CALLBACK (selection_changed_cb),
+					  sidebar_annots);
+		g_signal_connect (priv->tree_view, "button-press-event",
+				  G_CALLBACK (sidebar_tree_button_press_cb),
+				  sidebar_annots);
+	}
+
+	priv->model = gtk_tree_store_new (N_COLUMNS,
+					  G_TYPE_STRING,
+					  GDK_TYPE_PIXBUF,
+					  G_TYPE_POINTER);
+	gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view),
+				 GTK_TREE_MODEL (priv->model));
+}
+
+static void
+job_updated_callback (EvJobAnnots          *job,
+		      GList                *annots,
+		      EvSidebarAnnotations *sidebar_annots)
 {
 	EvSidebarAnnotationsPrivate *priv;
-	GtkTreeStore *model;
-	GtkTreeSelection *selection;
 	GList *l;
 	GtkIconTheme *icon_theme;
 	GdkScreen *screen;
@@ -354,41 +389,16 @@ job_finished_callback (EvJobAnnots          *job,
 
 	priv = sidebar_annots->priv;
 
-	if (!job->annots) {
-		GtkTreeModel *list;
-
-		list = ev_sidebar_annotations_create_simple_model (_("Document contains no annotations"));
-		gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view), list);
-		g_object_unref (list);
-
-		g_object_unref (job);
-		priv->job = NULL;
-
-		return;
-	}
-
-	selection = gtk_tree_view_get_selection (GTK_TREE_VIEW (priv->tree_view));
-	gtk_tree_selection_set_mode (selection, GTK_SELECTION_SINGLE);
-	if (priv->selection_changed_id == 0) {
-		priv->selection_changed_id =
-			g_signal_connect (selection, "changed",
-					  G_CALLBACK (selection_changed_cb),
-					  sidebar_annots);
-	}
-    g_signal_connect (priv->tree_view, "button-press-event",
-                      G_CALLBACK (sidebar_tree_button_press_cb),
-                      sidebar_annots);
-
-
-	model = gtk_tree_store_new (N_COLUMNS,
-				    G_TYPE_STRING,
-				    GDK_TYPE_PIXBUF,
-				    G_TYPE_POINTER);
+	/* Keep the rows of the previous job until the first
+	 * annotations of this one are found.
+	 */
+	if (!priv->model)
+		ev_sidebar_annotations_set_model (sidebar_annots);
 
 	screen = gtk_widget_get_screen (GTK_WIDGET (sidebar_annots));
 	icon_theme = gtk_icon_theme_get_for_screen (screen);
 
-	for (l = job->annots; l; l = g_list_next (l)) {
+	for (l = annots; l; l = g_list_next (l)) {
 		EvMappingList *mapping_list;
 		GList         *ll;
 		gchar         *page_label;
@@ -398,8 +408,8 @@ job_finished_callback (EvJobAnnots          *job,
 		mapping_list = (EvMappingList *)l->data;
 		page_label = g_strdup_printf (_("Page %d"),
 					      ev_mapping_list_get_page (mapping_list) + 1);
-		gtk_tree_store_append (model, &iter, NULL);
-		gtk_tree_store_set (model, &iter,
+		gtk_tree_store_append (priv->model, &iter, NULL);
+		gtk_tree_store_set (priv->model, &iter,
 				    COLUMN_MARKUP, page_label,
 				    -1);
 		g_free (page_label);
@@ -484,8 +494,8 @@ job_finished_callback (EvJobAnnots          *job,
                                 }
                         }
 
-			gtk_tree_store_append (model, &child_iter, &iter);
-			gtk_tree_store_set (model, &child_iter,
+			gtk_tree_store_append (priv->model, &child_iter, &iter);
+			gtk_tree_store_set (priv->model, &child_iter,
 					    COLUMN_MARKUP, markup,
 					    COLUMN_ICON, pixbuf,
 					    COLUMN_ANNOT_MAPPING, ll->data,
@@ -495,13 +505,9 @@ job_finished_callback (EvJobAnnots          *job,
 		}
 
 		if (!found)
-			gtk_tree_store_remove (model, &iter);
+			gtk_tree_store_remove (priv->model, &iter);
 	}
 
-	gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view),
-				 GTK_TREE_MODEL (model));
-	g_object_unref (model);
-
 	if (text_icon)
 		g_object_unref (text_icon);
 	if (attachment_icon)
@@ -514,9 +520,26 @@ job_finished_callback (EvJobAnnots          *job,
                 g_object_unref (underline_icon);
         if (squiggly_icon)
                 g_object_unref (squiggly_icon);
+}
+
+static void
+job_finished_callback (EvJobAnnots          *job,
+		       EvSidebarAnnotations *sidebar_annots)
+{
+	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
 
-	g_object_unref (job);
-	priv->job = NULL;
+	if (!priv->model ||
+	    gtk_tree_model_iter_n_children (GTK_TREE_MODEL (priv->model), NULL) == 0) {
+		GtkTreeModel *list;
+
+		list = ev_sidebar_annotations_create_simple_model (_("Document contains no annotations"));
+		gtk_tree_view_set_model (GTK_TREE_VIEW (priv->tree_view), list);
+		g_object_unref (list);
+	}
+
+	g_signal_handlers_disconnect_matched (priv->job, G_SIGNAL_MATCH_DATA,
+					      0, 0, NULL, NULL, sidebar_annots);
+	g_clear_object (&priv->job);
 }
 
 static void
@@ -525,13 +548,17 @@ ev_sidebar_annotations_load (EvSidebarAnnotations *sidebar_annots)
 	EvSidebarAnnotationsPrivate *priv = sidebar_annots->priv;
 
 	if (priv->job) {
-		g_signal_handlers_disconnect_by_func (priv->job,
-						      job_finished_callback,
-						      sidebar_annots);
+		g_signal_handlers_disconnect_matched (priv->job, G_SIGNAL_MATCH_DATA,
+						      0, 0, NULL, NULL, sidebar_annots);
+		ev_job_cancel (priv->job);
 		g_object_unref (priv->job);
 	}
+	g_clear_object (&priv->model);
 
 	priv->job = ev_job_annots_new (priv->document);
+	g_signal_connect (priv->job, "updated",
+			  G_CALLBACK (job_updated_callback),
+			  sidebar_annots);
 	g_signal_connect (priv->job, "finished",
 			  G_CALLBACK (job_finished_callback),
 			  sidebar_annots);
@@ -76,6 +76,10 @@ static void job_finished_callback 			(EvJobLinks     *job,
 static void ev_sidebar_links_set_current_page           (EvSidebarLinks *sidebar_links,
 							 gint            current_page);
 static void sidebar_collapse_recursive                  (EvSidebarLinks *sidebar_links);
+static void update_page_link_tree_cb                    (GtkTreeView    *tree_view,
+							 GtkTreeIter    *expanded_iter,
+							 GtkTreePath    *expanded_path,
+							 EvSidebarLinks *sidebar_links);
 static void ev_sidebar_links_page_iface_init 		(EvSidebarPageInterface *iface);
 static gboolean ev_sidebar_links_support_document	(EvSidebarPage  *sidebar_page,
 						         EvDocument     *document);
@@ -560,21 +564,26 @@ collapse_recursive (GtkTreeView  *tree_view,
 				continue;
 
 			path = gtk_tree_model_get_path (model, &iter);
-			if (gtk_tree_view_row_expanded (tree_view, path)) {
-				if (index_expand == NULL)
-					gtk_tree_view_collapse_row (tree_view, path);
-				else {
-					gchar *path_str, *path_token;
+			/* The rows below a collapsed row are all collapsed,
+			 * don't read them from the model. */
+			if (!gtk_tree_view_row_expanded (tree_view, path)) {
+				gtk_tree_path_free (path);
+				continue;
+			}
 
-					path_str = gtk_tree_path_to_string (path);
-					path_token = g_strconcat ("|", path_str, "|", NULL);
+			if (index_expand == NULL)
+				gtk_tree_view_collapse_row (tree_view, path);
+			else {
+				gchar *path_str, *path_token;
 
-					if (!g_strstr_len (index_expand, -1, path_token))
-						gtk_tree_view_collapse_row (tree_view, path);
+				path_str = gtk_tree_path_to_string (path);
+				path_token = g_strconcat ("|", path_str, "|", NULL);
 
-					g_free (path_str);
-					g_free (path_token);
-				}
+				if (!g_strstr_len (index_expand, -1, path_token))
+					gtk_tree_view_collapse_row (tree_view, path);
+
+				g_free (path_str);
+				g_free (path_token);
 			}
 			gtk_tree_path_free (path);
 			collapse_recursive (tree_view, model, &iter, index_expand);
@@ -675,6 +684,10 @@ ev_sidebar_links_construct (EvSidebarLinks *ev_sidebar_links)
 			  "row-expanded",
 			  G_CALLBACK (row_expanded_cb),
 			  ev_sidebar_links);
+	g_signal_connect (priv->tree_view,
+			  "row-expanded",
+			  G_CALLBACK (update_page_link_tree_cb),
+			  ev_sidebar_links);
 }
 
 static void
@@ -742,6 +755,9 @@ ev_sidebar_links_set_current_page (EvSidebarLinks *sidebar_links,
 	if (!path)
 		return;
 
+	/* Expanding rows adds their children to the tree */
+	path = gtk_tree_path_copy (path);
+
 	tree_view = GTK_TREE_VIEW (sidebar_links->priv->tree_view);
 	selection = gtk_tree_view_get_selection (tree_view);
 
@@ -764,6 +780,7 @@ ev_sidebar_links_set_current_page (EvSidebarLinks *sidebar_links,
 	g_signal_handler_unblock (sidebar_links->priv->tree_view, sidebar_links->priv->row_activated_id);
 	g_signal_handlers_unblock_by_func (sidebar_links->priv->tree_view, row_expanded_cb, sidebar_links);
 
+	gtk_tree_path_free (path);
 	gtk_tree_path_free (start_path);
 	gtk_tree_path_free (end_path);
 }
@@ -831,8 +848,11 @@ expand_open_links (GtkTreeView  *tree_view,
 				g_free (path_str);
 				g_free (path_token);
 			}
+			/* Rows below a collapsed row can't be expanded, don't
+			 * read them from the model. */
+			if (gtk_tree_view_row_expanded (tree_view, path))
+				expand_open_links (tree_view, model, &iter, index_expand, index_collapse);
 			gtk_tree_path_free (path);
-			expand_open_links (tree_view, model, &iter, index_expand, index_collapse);
 		} while (gtk_tree_model_iter_next (model, &iter));
 	}
 }
@@ -844,33 +864,58 @@ page_link_tree_sort (gconstpointer a, gconstpointer b, void *data)
 	return GPOINTER_TO_INT (a) - GPOINTER_TO_INT (b);
 }
 
-static gboolean
-update_page_link_tree_foreach (GtkTreeModel *model,
-			       GtkTreePath  *path,
-			       GtkTreeIter  *iter,
-			       gpointer      data)
+/* Adds the children of @parent to the tree of links per page. It starts
+ * with the top level rows, and the children of a row are added when it's
+ * expanded, so only the rows that have been shown are read from the model.
+ */
+static void
+update_page_link_tree (EvSidebarLinks *sidebar_links,
+		       GtkTreeIter    *parent)
 {
-	EvSidebarLinks *sidebar_links = data;
 	EvSidebarLinksPrivate *priv = sidebar_links->priv;
 	EvDocumentLinks *document_links = EV_DOCUMENT_LINKS (priv->document);
-	EvLink *link;
-	int page;
+	GtkTreeIter iter;
 
-	gtk_tree_model_get (model, iter,
-			    EV_DOCUMENT_LINKS_COLUMN_LINK, &link,
-			    -1);
+	if (!gtk_tree_model_iter_children (priv->model, &iter, parent))
+		return;
+
+	do {
+		GtkTreePath *path, *page_path;
+		EvLink *link;
+		int page;
 
-	if (!link)
-		return FALSE;
+		gtk_tree_model_get (priv->model, &iter,
+				    EV_DOCUMENT_LINKS_COLUMN_LINK, &link,
+				    -1);
 
-	page = ev_document_links_get_link_page (document_links, link);
-	g_object_unref (link);
+		if (!link)
+			continue;
 
-	/* Only save the first link we find per page. */
-	if (!g_tree_lookup (priv->page_link_tree, GINT_TO_POINTER (page)))
-		g_tree_insert (priv->page_link_tree, GINT_TO_POINTER (page), gtk_tree_path_copy (path));
+		page = ev_document_links_get_link_page (document_links, link);
+		g_object_unref (link);
 
-	return FALSE;
+		/* Only save the first link we find per page. */
+		path = gtk_tree_model_get_path (priv->model, &iter);
+		page_path = g_tree_lookup (priv->page_link_tree, GINT_TO_POINTER (page));
+		if (!page_path || gtk_tree_path_compare (path, page_path) < 0)
+			g_tree_insert (priv->page_link_tree, GINT_TO_POINTER (page), path);
+		else
+			gtk_tree_path_free (path);
+	} while (gtk_tree_model_iter_next (priv->model, &iter));
+}
+
+static void
+update_page_link_tree_cb (GtkTreeView    *tree_view,
+			  GtkTreeIter    *expanded_iter,
+			  GtkTreePath    *expanded_path,
+			  EvSidebarLinks *sidebar_links)
+{
+	EvSidebarLinksPrivate *priv = sidebar_links->priv;
+
+	if (!priv->page_link_tree || gtk_tree_view_get_model (tree_view) != priv->model)
+		return;
+
+	update_page_link_tree (sidebar_links, expanded_iter);
 }
 
 static void
@@ -891,9 +936,7 @@ ev_sidebar_links_set_links_model (EvSidebarLinks *sidebar_links,
 		g_tree_unref (priv->page_link_tree);
 	priv->page_link_tree = g_tree_new_full (page_link_tree_sort, NULL, NULL, (GDestroyNotify) gtk_tree_path_free);
 
-	gtk_tree_model_foreach (model,
-				update_page_link_tree_foreach,
-				sidebar_links);
+	update_page_link_tree (sidebar_links, NULL);
 
 	g_object_notify (G_OBJECT (sidebar_links), "model");
 }